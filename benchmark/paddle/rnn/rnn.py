@@ -9,6 +9,8 @@ fixedlen = 100
 batch_size = get_config_arg('batch_size', int, 128)
 lstm_num = get_config_arg('lstm_num', int, 1)
 hidden_size = get_config_arg('hidden_size', int, 128)
+# lstm or gru
+rnn_type = get_config_arg('rnn_type', str, 'lstm')
 # whether to pad sequence into fixed length
 pad_seq = get_config_arg('pad_seq', bool, True)
 imdb.create_data('imdb.pkl')
@@ -28,7 +30,10 @@ net = data_layer('data', size=vocab_size)
 net = embedding_layer(input=net, size=128)
 
 for i in xrange(lstm_num):
-    net = simple_lstm(input=net, size=hidden_size)
+    if rnn_type == 'gru':
+        net = simple_gru(input=net, size=hidden_size)
+    else:
+        net = simple_lstm(input=net, size=hidden_size)
 
 net = last_seq(input=net)
 net = fc_layer(input=net, size=2, act=SoftmaxActivation())
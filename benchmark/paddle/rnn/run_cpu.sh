@@ -0,0 +1,42 @@
+set -e
+
+function train() {
+  cfg=$1
+  thread=$2
+  rnn=$3
+  args="lstm_num=${4},pad_seq=${5},hidden_size=${6},batch_size=${7},rnn_type=${rnn}"
+  paddle train --job=time \
+    --config=$cfg \
+    --use_gpu=0 \
+    --trainer_count=$thread \
+    --log_period=10 \
+    --test_period=100 \
+    --num_passes=1 \
+    --feed_data=1 \
+    --config_args=$args \
+    >logs/rnn-pad${5}-${thread}cpu-${rnn}${4}-batch${7}-hid${6}.log 2>&1
+}
+
+if [ ! -d "logs" ]; then
+  mkdir logs
+fi
+
+## padding, the sizes of run.sh on cpu
+#-----config--threads--rnn--rnn_num--padding--hidden_size--batch_size
+## lstm_num=2, batch_size=64
+train rnn.py 1 lstm 2 1 256 64
+train rnn.py 1 lstm 2 1 512 64
+train rnn.py 1 gru 2 1 256 64
+train rnn.py 1 gru 2 1 512 64
+
+## lstm_num=2, batch_size=128
+train rnn.py 1 lstm 2 1 256 128
+train rnn.py 1 lstm 2 1 512 128
+train rnn.py 1 gru 2 1 256 128
+train rnn.py 1 gru 2 1 512 128
+
+#==================multi threads=====================#
+train rnn.py 4 lstm 2 1 256 128
+train rnn.py 4 lstm 2 1 256 256
+train rnn.py 4 gru 2 1 256 128
+train rnn.py 4 gru 2 1 256 256
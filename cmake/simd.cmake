@@ -10,12 +10,18 @@ IF(CMAKE_COMPILER_IS_GNUCC OR CMAKE_COMPILER_IS_GNUCXX OR CMAKE_CXX_COMPILER_ID
     set(SSE3_FLAG "-msse3")
     SET(AVX_FLAG "-mavx")
     SET(AVX2_FLAG "-mavx2")
+    SET(FMA_FLAG "-mfma")
+    SET(AVX512F_FLAG "-mavx512f")
+    SET(AVX512VNNI_FLAG "-mavx512vnni")
 ELSEIF(MSVC)
     set(MMX_FLAG "/arch:MMX")
     set(SSE2_FLAG "/arch:SSE2")
     set(SSE3_FLAG "/arch:SSE3")
     SET(AVX_FLAG "/arch:AVX")
     SET(AVX2_FLAG "/arch:AVX2")
+    SET(FMA_FLAG "")
+    SET(AVX512F_FLAG "/arch:AVX512")
+    SET(AVX512VNNI_FLAG "")
 ENDIF()
 
 set(CMAKE_REQUIRED_FLAGS_RETAINED ${CMAKE_REQUIRED_FLAGS})
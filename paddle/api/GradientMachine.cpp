@@ -185,6 +185,10 @@ SequenceGenerator* GradientMachine::asSequenceGenerator(
   return r;
 }
 
+SequenceStream* GradientMachine::asSequenceStream() {
+  return SequenceStream::createByGradientMachineSharedPtr(&m->machine);
+}
+
 Evaluator* GradientMachine::makeEvaluator() {
   auto ev = new Evaluator();
   ev->m->rawPtr = m->machine->makeEvaluator();
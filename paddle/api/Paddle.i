@@ -167,6 +167,7 @@ namespace std {
 %newobject GradientMachine::createByConfigProtoStr;
 %newobject GradientMachine::createByModelConfig;
 %newobject GradientMachine::asSequenceGenerator;
+%newobject GradientMachine::asSequenceStream;
 %newobject GradientMachine::getParameter;
 %newobject GradientMachine::getLayerOutput;
 %newobject GradientMachine::makeEvaluator;
@@ -193,6 +194,7 @@ namespace std {
 %ignore ModelConfigPrivate;
 %ignore ParameterPrivate;
 %ignore SequenceGeneratorPrivate;
+%ignore SequenceStreamPrivate;
 %ignore VectorPrivate;
 %ignore ParameterConfigPrivate;
 %ignore OptimizationConfigPrivate;
@@ -485,6 +485,7 @@ private:
   friend class Trainer;
   friend class GradientMachine;
   friend class SequenceGenerator;
+  friend class SequenceStream;
 };
 
 enum GradientMatchineCreateMode {
@@ -715,6 +716,7 @@ private:
 };
 
 class SequenceGenerator;
+class SequenceStream;
 class Evaluator;
 struct GradientMachinePrivate;
 class GradientMachine {
@@ -813,6 +815,15 @@ public:
       size_t max_length = 100UL,
       size_t beam_size = -1UL);
 
+  /**
+   * Create a sequence stream, which forwards a sequence a few timesteps at
+   * a time.
+   *
+   * @note  The machine keeps a state between forwards, it should only be
+   *        used by sequence streams.
+   */
+  SequenceStream* asSequenceStream();
+
   Evaluator* makeEvaluator();
 
   void eval(Evaluator* evaluator);
@@ -1047,3 +1058,34 @@ private:
 private:
   SequenceGeneratorPrivate* m;
 };
+
+struct SequenceStreamPrivate;
+class SequenceStream {
+  DISABLE_COPY(SequenceStream);
+  SequenceStream();
+
+public:
+  virtual ~SequenceStream();
+
+  /**
+   * Forward the next timesteps of the sequence. Only the new timesteps are
+   * computed, from the state of the recurrent layers after the last ones.
+   *
+   * @note  Each of inArgs is a single sequence of the new timesteps, and
+   *        outArgs receive their outputs.
+   * @note  The streams of a machine must not forward concurrently.
+   */
+  void forward(const Arguments& inArgs, Arguments* outArgs);
+
+  /**
+   * Go back to the beginning of a sequence, for a new one.
+   */
+  void reset();
+
+private:
+  static SequenceStream* createByGradientMachineSharedPtr(void* ptr);
+  friend class GradientMachine;
+
+private:
+  SequenceStreamPrivate* m;
+};
@@ -0,0 +1,49 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <vector>
+#include "PaddleAPI.h"
+#include "paddle/gserver/gradientmachines/GradientMachine.h"
+#include "paddle/parameter/Argument.h"
+
+struct SequenceStreamPrivate {
+  std::shared_ptr<paddle::GradientMachine> machine;
+  /// The state after the last timestep, empty at the beginning.
+  paddle::MachineState state;
+
+  template <typename T>
+  inline T& cast(void* ptr) {
+    return *(T*)(ptr);
+  }
+};
+
+SequenceStream::SequenceStream() : m(new SequenceStreamPrivate()) {}
+
+SequenceStream::~SequenceStream() { delete m; }
+
+SequenceStream* SequenceStream::createByGradientMachineSharedPtr(void* ptr) {
+  SequenceStream* r = new SequenceStream();
+  r->m->machine = r->m->cast<std::shared_ptr<paddle::GradientMachine>>(ptr);
+  return r;
+}
+
+void SequenceStream::forward(const Arguments& inArgs, Arguments* outArgs) {
+  auto& in =
+      m->cast<std::vector<paddle::Argument>>(inArgs.getInternalArgumentsPtr());
+  auto& out = m->cast<std::vector<paddle::Argument>>(
+      outArgs->getInternalArgumentsPtr());
+  m->machine->forwardStep(in, &out, &m->state);
+}
+
+void SequenceStream::reset() { m->state.clear(); }
@@ -27,6 +27,8 @@ limitations under the License. */
 #include "gradient_machine.h"
 #include "main.h"
 #include "matrix.h"
+#include "request_batcher.h"
+#include "sequence_stream.h"
 #include "vector.h"
 
 #endif  // PADDLECAPI_H_
@@ -22,7 +22,14 @@ limitations under the License. */
 namespace paddle {
 namespace capi {
 
-enum CType { kIVECTOR = 0, kMATRIX, kARGUMENTS, kGRADIENT_MACHINE };
+enum CType {
+  kIVECTOR = 0,
+  kMATRIX,
+  kARGUMENTS,
+  kGRADIENT_MACHINE,
+  kREQUEST_BATCHER,
+  kSEQUENCE_STREAM
+};
 
 #define STRUCT_HEADER CType type;
 
@@ -74,6 +81,25 @@ struct CGradientMachine {
   CGradientMachine() : type(kGRADIENT_MACHINE) {}
 };
 
+struct CSequenceStream {
+  STRUCT_HEADER
+  paddle::GradientMachinePtr machine;
+  /// The state after the last timestep, empty at the beginning.
+  paddle::MachineState state;
+
+  CSequenceStream() : type(kSEQUENCE_STREAM) {}
+};
+
+class RequestBatcher;
+
+struct CRequestBatcher {
+  STRUCT_HEADER
+  std::unique_ptr<RequestBatcher> batcher;
+
+  CRequestBatcher();
+  ~CRequestBatcher();
+};
+
 template <typename T>
 inline T* cast(void* ptr) {
   return reinterpret_cast<T*>(ptr);
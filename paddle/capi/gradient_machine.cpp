@@ -14,6 +14,7 @@ limitations under the License. */
 
 #include "gradient_machine.h"
 #include "capi_private.h"
+#include "paddle/gserver/gradientmachines/MappedModel.h"
 #include "paddle/gserver/gradientmachines/NeuralNetwork.h"
 
 #define cast(v) paddle::capi::cast<paddle::capi::CGradientMachine>(v)
@@ -54,6 +55,17 @@ paddle_error paddle_gradient_machine_create_for_inference(
   return kPD_NO_ERROR;
 }
 
+paddle_error paddle_gradient_machine_create_from_mapped_model(
+    paddle_gradient_machine* machine, const char* filename) {
+  if (machine == nullptr || filename == nullptr) return kPD_NULLPTR;
+  auto model = paddle::MappedModel::load(filename);
+  if (model == nullptr) return kPD_FILE_ERROR;
+  auto ptr = new paddle::capi::CGradientMachine();
+  ptr->machine.reset(model->createGradientMachine());
+  *machine = ptr;
+  return kPD_NO_ERROR;
+}
+
 paddle_error paddle_gradient_machine_destroy(paddle_gradient_machine machine) {
   delete cast(machine);
   return kPD_NO_ERROR;
@@ -105,6 +117,7 @@ paddle_error paddle_gradient_machine_create_shared_param(
              auto p = o->machine->getParameters()[paramId];
              param->enableSharedType(paddle::PARAMETER_VALUE,
                                      p->getBuf(paddle::PARAMETER_VALUE));
+             param->shareValueCache(*p);
            },
            {paddle::PARAMETER_VALUE},
            false);
@@ -121,3 +134,11 @@ paddle_error paddle_gradient_machine_randomize_param(
   m->machine->randParameters();
   return kPD_NO_ERROR;
 }
+
+paddle_error paddle_gradient_machine_set_quantized_weights(
+    paddle_gradient_machine machine, bool quantized) {
+  auto m = cast(machine);
+  if (m == nullptr || m->machine == nullptr) return kPD_NULLPTR;
+  if (!m->machine->setQuantizeWeights(quantized)) return kPD_NOT_SUPPORTED;
+  return kPD_NO_ERROR;
+}
@@ -36,6 +36,20 @@ typedef void* paddle_gradient_machine;
 PD_API paddle_error paddle_gradient_machine_create_for_inference(
     paddle_gradient_machine* machine, void* modelConfigProtobuf, int size);
 
+/**
+ * @brief Create a gradient machine used for model inference from a model
+ *        file written by `paddle_merge_model --mapped_model`. The file is
+ *        mapped copy-on-write and the parameters are used in place, so
+ *        processes serving the same model share its pages.
+ * @param [out] machine that used for model inference.
+ * @param [in] filename the model file, which must not be modified while the
+ *             machine, or any machine sharing its parameters, is alive.
+ * @return paddle_error, kPD_FILE_ERROR if the file cannot be mapped or is
+ *         not a valid model file.
+ */
+PD_API paddle_error paddle_gradient_machine_create_from_mapped_model(
+    paddle_gradient_machine* machine, const char* filename);
+
 /**
  * @brief Load parameter from disk.
  * @param machine Gradient Machine.
@@ -77,6 +91,21 @@ paddle_gradient_machine_create_shared_param(paddle_gradient_machine origin,
 PD_API paddle_error
 paddle_gradient_machine_randomize_param(paddle_gradient_machine machine);
 
+/**
+ * @brief Set whether the fc and exconv layers of a gradient machine multiply
+ *        by int8 copies of their cpu weights when forwarding for inference,
+ *        which trades some accuracy for a quarter of the weight bandwidth.
+ *        The copies are shared with the machines sharing the parameters, and
+ *        made again after the parameters are loaded or randomized.
+ *        Defaults to --quantize_inference_weights.
+ * @param machine Gradient Machine.
+ * @param quantized whether to use the int8 weights.
+ * @return paddle_error, kPD_NOT_SUPPORTED if the machine does not
+ *         support it.
+ */
+PD_API paddle_error paddle_gradient_machine_set_quantized_weights(
+    paddle_gradient_machine machine, bool quantized);
+
 /**
  * @brief Destroy a gradient machine
  * @param machine that need to destroy
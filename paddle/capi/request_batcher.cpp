@@ -0,0 +1,303 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "request_batcher.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "capi_private.h"
+
+#define cast(v) paddle::capi::cast<paddle::capi::CRequestBatcher>(v)
+
+namespace paddle {
+namespace capi {
+
+/**
+ * The requests wait in a queue for a thread of the batcher, which takes
+ * them in order while they fit into maxBatchSize samples, concatenates
+ * every input slot with Argument::concat, and copies the rows of each
+ * request out of the outputs of the forward.
+ */
+class RequestBatcher {
+public:
+  RequestBatcher(GradientMachine* machine,
+                 size_t maxBatchSize,
+                 std::chrono::microseconds timeout)
+      : machine_(machine),
+        maxBatchSize_(maxBatchSize),
+        timeout_(timeout),
+        queuedSamples_(0),
+        stopping_(false) {
+    thread_ = std::thread([this] { run(); });
+  }
+
+  ~RequestBatcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    queueCV_.notify_all();
+    thread_.join();
+  }
+
+  paddle_error forward(const std::vector<Argument>& inArgs,
+                       std::vector<Argument>* outArgs) {
+    if (inArgs.empty()) return kPD_OUT_OF_RANGE;
+    Request request;
+    request.inArgs = &inArgs;
+    request.outArgs = outArgs;
+    request.numSamples = inArgs[0].getNumSequences();
+    if (request.numSamples == 0) return kPD_OUT_OF_RANGE;
+    request.arrival = std::chrono::steady_clock::now();
+    request.error = kPD_NO_ERROR;
+    request.done = false;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_.push_back(&request);
+    queuedSamples_ += request.numSamples;
+    queueCV_.notify_all();
+    doneCV_.wait(lock, [&request] { return request.done; });
+    return request.error;
+  }
+
+private:
+  struct Request {
+    const std::vector<Argument>* inArgs;
+    std::vector<Argument>* outArgs;
+    size_t numSamples;
+    std::chrono::steady_clock::time_point arrival;
+    paddle_error error;
+    bool done;
+  };
+
+  void run() {
+    std::vector<Request*> batch;
+    while (true) {
+      batch.clear();
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queueCV_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        // the remaining requests are run at once when stopping.
+        queueCV_.wait_until(lock, queue_.front()->arrival + timeout_, [this] {
+          return stopping_ || queuedSamples_ >= maxBatchSize_;
+        });
+        size_t numSamples = 0;
+        while (!queue_.empty() &&
+               (batch.empty() ||
+                numSamples + queue_.front()->numSamples <= maxBatchSize_)) {
+          numSamples += queue_.front()->numSamples;
+          batch.push_back(queue_.front());
+          queue_.pop_front();
+        }
+        queuedSamples_ -= numSamples;
+      }
+
+      forwardBatch(batch);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto request : batch) {
+          request->done = true;
+        }
+      }
+      doneCV_.notify_all();
+    }
+  }
+
+  void forwardBatch(const std::vector<Request*>& batch) {
+    const std::vector<Argument>& first = *batch[0]->inArgs;
+    size_t numSlots = first.size();
+    std::vector<Request*> requests;
+    for (auto request : batch) {
+      if (isConcatenable(first, *request->inArgs)) {
+        requests.push_back(request);
+      } else {
+        request->error = kPD_OUT_OF_RANGE;
+      }
+    }
+
+    inArgs_.resize(numSlots);
+    std::vector<Argument> slot(requests.size());
+    for (size_t i = 0; i < numSlots; ++i) {
+      for (size_t r = 0; r < requests.size(); ++r) {
+        slot[r] = (*requests[r]->inArgs)[i];
+      }
+      inArgs_[i].concat(slot, false, HPPL_STREAM_DEFAULT, PASS_TEST);
+    }
+    VLOG(1) << "forward " << requests.size() << " requests, batch size "
+            << inArgs_[0].getBatchSize();
+    machine_->forward(inArgs_, &outArgs_, PASS_TEST);
+
+    size_t sampleBegin = 0;
+    for (auto request : requests) {
+      size_t sampleEnd = sampleBegin + request->numSamples;
+      request->outArgs->resize(outArgs_.size());
+      for (size_t i = 0; i < outArgs_.size(); ++i) {
+        copySamples(
+            outArgs_[i], sampleBegin, sampleEnd, &(*request->outArgs)[i]);
+      }
+      sampleBegin = sampleEnd;
+    }
+  }
+
+  /**
+   * Whether the slots of a request can be concatenated with those of the
+   * first request of a batch: Argument::concat and the forward CHECK that
+   * all the slots have the same kind of data and sequences.
+   */
+  static bool isConcatenable(const std::vector<Argument>& first,
+                             const std::vector<Argument>& args) {
+    if (args.size() != first.size()) return false;
+    for (size_t i = 0; i < args.size(); ++i) {
+      const Argument& a = first[i];
+      const Argument& b = args[i];
+      if (!a.value != !b.value || !a.ids != !b.ids ||
+          !a.sequenceStartPositions != !b.sequenceStartPositions ||
+          !a.subSequenceStartPositions != !b.subSequenceStartPositions) {
+        return false;
+      }
+      if (a.value && a.value->getWidth() != b.value->getWidth()) {
+        return false;
+      }
+      if (b.getNumSequences() != args[0].getNumSequences()) {
+        return false;
+      }
+      if (b.sequenceStartPositions) {
+        const ICpuGpuVectorPtr& starts = b.sequenceStartPositions;
+        const int* data = starts->getData(false);
+        if (starts->getSize() == 0 || data[0] != 0 ||
+            data[starts->getSize() - 1] != (int)b.getBatchSize()) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * An output with sequences has one sequence per sample of the inputs,
+   * and one row per sample otherwise.
+   */
+  static void copySamples(const Argument& src,
+                          size_t sampleBegin,
+                          size_t sampleEnd,
+                          Argument* dst) {
+    size_t rowBegin = sampleBegin;
+    size_t rowEnd = sampleEnd;
+    if (src.sequenceStartPositions) {
+      const int* starts = src.sequenceStartPositions->getData(false);
+      rowBegin = starts[sampleBegin];
+      rowEnd = starts[sampleEnd];
+      dst->sequenceStartPositions =
+          copyStarts(starts + sampleBegin, starts + sampleEnd + 1);
+    } else {
+      dst->sequenceStartPositions.reset();
+    }
+    if (src.subSequenceStartPositions) {
+      const int* begin = src.subSequenceStartPositions->getData(false);
+      const int* end = begin + src.subSequenceStartPositions->getSize();
+      dst->subSequenceStartPositions =
+          copyStarts(std::lower_bound(begin, end, (int)rowBegin),
+                     std::upper_bound(begin, end, (int)rowEnd));
+    } else {
+      dst->subSequenceStartPositions.reset();
+    }
+
+    size_t numRows = rowEnd - rowBegin;
+    if (src.value) {
+      dst->value =
+          Matrix::create(numRows, src.value->getWidth(), false, false);
+      dst->value->copyFrom(*src.value->subMatrix(rowBegin, numRows));
+    } else {
+      dst->value.reset();
+    }
+    if (src.ids) {
+      dst->ids = IVector::create(numRows, false);
+      dst->ids->copyFrom(*src.ids->subVec(rowBegin, numRows));
+    } else {
+      dst->ids.reset();
+    }
+  }
+
+  /// The start positions in [begin, end), moved to start at 0.
+  static ICpuGpuVectorPtr copyStarts(const int* begin, const int* end) {
+    auto starts = ICpuGpuVector::create(end - begin, false);
+    int* data = starts->getMutableData(false);
+    for (const int* p = begin; p != end; ++p) {
+      *data++ = *p - *begin;
+    }
+    return starts;
+  }
+
+  GradientMachine* machine_;
+  size_t maxBatchSize_;
+  std::chrono::microseconds timeout_;
+
+  std::mutex mutex_;
+  std::condition_variable queueCV_;
+  std::condition_variable doneCV_;
+  std::deque<Request*> queue_;
+  size_t queuedSamples_;
+  bool stopping_;
+  std::thread thread_;
+
+  /// Only used by thread_.
+  std::vector<Argument> inArgs_;
+  std::vector<Argument> outArgs_;
+};
+
+CRequestBatcher::CRequestBatcher() : type(kREQUEST_BATCHER) {}
+
+CRequestBatcher::~CRequestBatcher() {}
+
+}  // namespace capi
+}  // namespace paddle
+
+extern "C" {
+paddle_error paddle_request_batcher_create(paddle_request_batcher* batcher,
+                                           paddle_gradient_machine machine,
+                                           uint64_t maxBatchSize,
+                                           uint64_t timeoutUs) {
+  auto m = paddle::capi::cast<paddle::capi::CGradientMachine>(machine);
+  if (batcher == nullptr || m == nullptr || m->machine == nullptr) {
+    return kPD_NULLPTR;
+  }
+  if (maxBatchSize == 0) return kPD_OUT_OF_RANGE;
+  auto ptr = new paddle::capi::CRequestBatcher();
+  ptr->batcher.reset(new paddle::capi::RequestBatcher(
+      m->machine.get(), maxBatchSize, std::chrono::microseconds(timeoutUs)));
+  *batcher = ptr;
+  return kPD_NO_ERROR;
+}
+
+paddle_error paddle_request_batcher_forward(paddle_request_batcher batcher,
+                                            paddle_arguments inArgs,
+                                            paddle_arguments outArgs) {
+  auto b = cast(batcher);
+  auto in = paddle::capi::cast<paddle::capi::CArguments>(inArgs);
+  auto out = paddle::capi::cast<paddle::capi::CArguments>(outArgs);
+  if (b == nullptr || in == nullptr || out == nullptr) return kPD_NULLPTR;
+  return b->batcher->forward(in->args, &out->args);
+}
+
+paddle_error paddle_request_batcher_destroy(paddle_request_batcher batcher) {
+  if (batcher == nullptr) return kPD_NULLPTR;
+  delete cast(batcher);
+  return kPD_NO_ERROR;
+}
+}
@@ -0,0 +1,78 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#ifndef __PADDLE_CAPI_REQUEST_BATCHER_H__
+#define __PADDLE_CAPI_REQUEST_BATCHER_H__
+#include "arguments.h"
+#include "config.h"
+#include "error.h"
+#include "gradient_machine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+ * @brief RequestBatcher gathers the forward requests of many caller threads
+ *        into one batch, runs one forward of a gradient machine over it, and
+ *        hands every caller back its own rows of the outputs.
+ *
+ * Every request must have the same input slots, of the same kinds (value,
+ * ids, sequence start positions). Sequences are concatenated as they are,
+ * without padding.
+ */
+typedef void* paddle_request_batcher;
+
+/**
+ * @brief Create a request batcher for model inference.
+ * @param [out] batcher the request batcher.
+ * @param [in] machine forwarded by the batcher only, it must not be used
+ *             by the caller, nor destroyed, until the batcher is destroyed.
+ * @param [in] maxBatchSize a batch is run as soon as it holds this many
+ *             samples. A sample is a sequence of a sequence input, and a
+ *             row otherwise.
+ * @param [in] timeoutUs a batch is run at the latest this many
+ *             microseconds after its first request arrived.
+ * @return paddle_error
+ */
+PD_API paddle_error paddle_request_batcher_create(
+    paddle_request_batcher* batcher,
+    paddle_gradient_machine machine,
+    uint64_t maxBatchSize,
+    uint64_t timeoutUs);
+
+/**
+ * @brief Forward inArgs as a part of a batch. Blocks until the batch ran.
+ * @param batcher request batcher.
+ * @param inArgs input arguments, usually a single sample.
+ * @param outArgs output arguments, receive a copy of the rows of inArgs in
+ *        the outputs of the batch.
+ * @return paddle_error
+ */
+PD_API paddle_error
+paddle_request_batcher_forward(paddle_request_batcher batcher,
+                               paddle_arguments inArgs,
+                               paddle_arguments outArgs);
+
+/**
+ * @brief Destroy a request batcher, after running the requests it holds.
+ * @param batcher that need to destroy
+ * @return paddle_error
+ */
+PD_API paddle_error
+paddle_request_batcher_destroy(paddle_request_batcher batcher);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
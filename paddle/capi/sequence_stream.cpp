@@ -0,0 +1,64 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "sequence_stream.h"
+#include "capi_private.h"
+
+#define cast(v) paddle::capi::cast<paddle::capi::CSequenceStream>(v)
+
+extern "C" {
+paddle_error paddle_sequence_stream_create(paddle_sequence_stream* stream,
+                                           paddle_gradient_machine machine) {
+  auto m = paddle::capi::cast<paddle::capi::CGradientMachine>(machine);
+  if (stream == nullptr || m == nullptr || m->machine == nullptr) {
+    return kPD_NULLPTR;
+  }
+  if (!m->machine->supportsForwardStep()) return kPD_NOT_SUPPORTED;
+  auto ptr = new paddle::capi::CSequenceStream();
+  ptr->machine = m->machine;
+  *stream = ptr;
+  return kPD_NO_ERROR;
+}
+
+paddle_error paddle_sequence_stream_forward(paddle_sequence_stream stream,
+                                            paddle_arguments inArgs,
+                                            paddle_arguments outArgs) {
+  auto s = cast(stream);
+  auto in = paddle::capi::cast<paddle::capi::CArguments>(inArgs);
+  auto out = paddle::capi::cast<paddle::capi::CArguments>(outArgs);
+  if (s == nullptr || in == nullptr || out == nullptr) return kPD_NULLPTR;
+  if (in->args.empty()) return kPD_OUT_OF_RANGE;
+  for (auto& arg : in->args) {
+    if (!arg.sequenceStartPositions || arg.getNumSequences() != 1) {
+      return kPD_OUT_OF_RANGE;
+    }
+  }
+  s->machine->forwardStep(in->args, &out->args, &s->state);
+  return kPD_NO_ERROR;
+}
+
+paddle_error paddle_sequence_stream_reset(paddle_sequence_stream stream) {
+  auto s = cast(stream);
+  if (s == nullptr) return kPD_NULLPTR;
+  s->state.clear();
+  return kPD_NO_ERROR;
+}
+
+paddle_error paddle_sequence_stream_destroy(paddle_sequence_stream stream) {
+  auto s = cast(stream);
+  if (s == nullptr) return kPD_NULLPTR;
+  delete s;
+  return kPD_NO_ERROR;
+}
+}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#ifndef __PADDLE_CAPI_SEQUENCE_STREAM_H__
+#define __PADDLE_CAPI_SEQUENCE_STREAM_H__
+#include "arguments.h"
+#include "config.h"
+#include "error.h"
+#include "gradient_machine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+ * @brief SequenceStream forwards a sequence a few timesteps at a time, as
+ *        they arrive. It keeps the state of the recurrent layers after the
+ *        last timestep, so that a forward only computes the new timesteps,
+ *        however long the sequence already is.
+ *
+ * Many streams may share a gradient machine, but not forward concurrently.
+ * Such a gradient machine keeps a state between forwards, it should only
+ * be forwarded by streams. Reversed recurrent layers and recurrent groups
+ * are not supported.
+ */
+typedef void* paddle_sequence_stream;
+
+/**
+ * @brief Create a sequence stream, at the beginning of a sequence.
+ * @param [out] stream the sequence stream.
+ * @param [in] machine forwarded by the stream, it is kept alive until the
+ *             stream is destroyed.
+ * @return paddle_error, kPD_NOT_SUPPORTED if a recurrent layer of the
+ *         machine is reversed.
+ */
+PD_API paddle_error
+paddle_sequence_stream_create(paddle_sequence_stream* stream,
+                              paddle_gradient_machine machine);
+
+/**
+ * @brief Forward the next timesteps of the sequence.
+ * @param stream sequence stream.
+ * @param inArgs input arguments, each of them holds a single sequence of
+ *        one or more new timesteps.
+ * @param outArgs output arguments, the outputs of the new timesteps.
+ * @return paddle_error
+ */
+PD_API paddle_error
+paddle_sequence_stream_forward(paddle_sequence_stream stream,
+                               paddle_arguments inArgs,
+                               paddle_arguments outArgs);
+
+/**
+ * @brief Go back to the beginning of a sequence, for a new one.
+ * @param stream sequence stream.
+ * @return paddle_error
+ */
+PD_API paddle_error paddle_sequence_stream_reset(paddle_sequence_stream stream);
+
+/**
+ * @brief Destroy a sequence stream.
+ * @param stream that need to destroy
+ * @return paddle_error
+ */
+PD_API paddle_error
+paddle_sequence_stream_destroy(paddle_sequence_stream stream);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
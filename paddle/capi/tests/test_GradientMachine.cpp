@@ -105,6 +105,19 @@ TEST(GradientMachine, testPredict) {
   ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_destroy(machine));
 }
 
+TEST(GradientMachine, invalidMappedModel) {
+  paddle_gradient_machine machine = nullptr;
+  ASSERT_EQ(kPD_FILE_ERROR,
+            paddle_gradient_machine_create_from_mapped_model(
+                &machine, "./no_such_model_file"));
+  ASSERT_EQ(nullptr, machine);
+  // the config of the network is not a model file.
+  ASSERT_EQ(kPD_FILE_ERROR,
+            paddle_gradient_machine_create_from_mapped_model(
+                &machine, "./test_predict_network.py"));
+  ASSERT_EQ(nullptr, machine);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   std::vector<char*> argvs;
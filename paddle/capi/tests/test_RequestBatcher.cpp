@@ -0,0 +1,302 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+#include <paddle/gserver/gradientmachines/GradientMachine.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "capi.h"
+#include "paddle/utils/ThreadLocal.h"
+
+const size_t kInputSize = 8;
+const size_t kOutputSize = 5;
+const size_t kNumRequests = 10;
+
+/// input -> fc -> output
+std::string makeConfig() {
+  paddle::ModelConfig config;
+  config.set_type("nn");
+  paddle::LayerConfig* data = config.add_layers();
+  data->set_name("input");
+  data->set_type("data");
+  data->set_size(kInputSize);
+
+  paddle::LayerConfig* layer = config.add_layers();
+  layer->set_name("output");
+  layer->set_type("fc");
+  layer->set_size(kOutputSize);
+  layer->set_active_type("sigmoid");
+  paddle::LayerInputConfig* in = layer->add_inputs();
+  in->set_input_layer_name("input");
+  in->set_input_parameter_name("_output.w");
+
+  paddle::ParameterConfig* para = config.add_parameters();
+  para->set_name("_output.w");
+  para->set_size(kInputSize * kOutputSize);
+  para->add_dims(kInputSize);
+  para->add_dims(kOutputSize);
+  para->set_initial_std(1.0);
+
+  config.add_input_layer_names("input");
+  config.add_output_layer_names("output");
+  std::string buffer;
+  CHECK(config.SerializeToString(&buffer));
+  return buffer;
+}
+
+/// A request of one row, or of sequences of the given lengths.
+paddle_arguments makeRequest(const std::vector<int>& seqLengths,
+                             size_t width = kInputSize) {
+  int numRows = 0;
+  std::vector<int> starts = {0};
+  for (int length : seqLengths) {
+    numRows += length;
+    starts.push_back(numRows);
+  }
+  numRows = std::max(numRows, 1);
+
+  paddle_arguments args = paddle_arguments_create_none();
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_resize(args, 1));
+  paddle_matrix mat = paddle_matrix_create(numRows, width, false);
+  auto& eng = paddle::ThreadLocalRandomEngine::get();
+  std::uniform_real_distribution<paddle_real> dist(-1.0, 1.0);
+  for (int i = 0; i < numRows; ++i) {
+    paddle_real* row;
+    CHECK_EQ(kPD_NO_ERROR, paddle_matrix_get_row(mat, i, &row));
+    for (size_t j = 0; j < width; ++j) {
+      row[j] = dist(eng);
+    }
+  }
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_set_value(args, 0, mat));
+  CHECK_EQ(kPD_NO_ERROR, paddle_matrix_destroy(mat));
+  if (!seqLengths.empty()) {
+    paddle_ivector seq =
+        paddle_ivector_create(starts.data(), starts.size(), true, false);
+    CHECK_EQ(kPD_NO_ERROR,
+             paddle_arguments_set_sequence_start_pos(args, 0, 0, seq));
+    CHECK_EQ(kPD_NO_ERROR, paddle_ivector_destroy(seq));
+  }
+  return args;
+}
+
+/// The outputs of a gradient machine are overwritten by its next forward.
+paddle_arguments copyOutput(paddle_arguments out, bool sequence) {
+  paddle_arguments copy = paddle_arguments_create_none();
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_resize(copy, 1));
+  paddle_matrix src = paddle_matrix_create_none();
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_get_value(out, 0, src));
+  uint64_t height, width;
+  CHECK_EQ(kPD_NO_ERROR, paddle_matrix_get_shape(src, &height, &width));
+  paddle_matrix dst = paddle_matrix_create(height, width, false);
+  for (uint64_t i = 0; i < height; ++i) {
+    paddle_real* row;
+    CHECK_EQ(kPD_NO_ERROR, paddle_matrix_get_row(src, i, &row));
+    CHECK_EQ(kPD_NO_ERROR, paddle_matrix_set_row(dst, i, row));
+  }
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_set_value(copy, 0, dst));
+  CHECK_EQ(kPD_NO_ERROR, paddle_matrix_destroy(src));
+  CHECK_EQ(kPD_NO_ERROR, paddle_matrix_destroy(dst));
+  if (sequence) {
+    paddle_ivector seq = paddle_ivector_create_none();
+    CHECK_EQ(kPD_NO_ERROR,
+             paddle_arguments_get_sequence_start_pos(out, 0, 0, seq));
+    uint64_t size;
+    int* starts;
+    CHECK_EQ(kPD_NO_ERROR, paddle_ivector_get_size(seq, &size));
+    CHECK_EQ(kPD_NO_ERROR, paddle_ivector_get(seq, &starts));
+    paddle_ivector seqCopy = paddle_ivector_create(starts, size, true, false);
+    CHECK_EQ(kPD_NO_ERROR,
+             paddle_arguments_set_sequence_start_pos(copy, 0, 0, seqCopy));
+    CHECK_EQ(kPD_NO_ERROR, paddle_ivector_destroy(seq));
+    CHECK_EQ(kPD_NO_ERROR, paddle_ivector_destroy(seqCopy));
+  }
+  return copy;
+}
+
+void expectEqual(paddle_arguments expected,
+                 paddle_arguments actual,
+                 bool sequence) {
+  paddle_matrix a = paddle_matrix_create_none();
+  paddle_matrix b = paddle_matrix_create_none();
+  ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_get_value(expected, 0, a));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_get_value(actual, 0, b));
+  uint64_t heightA, widthA, heightB, widthB;
+  ASSERT_EQ(kPD_NO_ERROR, paddle_matrix_get_shape(a, &heightA, &widthA));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_matrix_get_shape(b, &heightB, &widthB));
+  ASSERT_EQ(heightA, heightB);
+  ASSERT_EQ(widthA, widthB);
+  for (uint64_t i = 0; i < heightA; ++i) {
+    paddle_real *rowA, *rowB;
+    ASSERT_EQ(kPD_NO_ERROR, paddle_matrix_get_row(a, i, &rowA));
+    ASSERT_EQ(kPD_NO_ERROR, paddle_matrix_get_row(b, i, &rowB));
+    for (uint64_t j = 0; j < widthA; ++j) {
+      ASSERT_NEAR(rowA[j], rowB[j], 1e-5);
+    }
+  }
+  ASSERT_EQ(kPD_NO_ERROR, paddle_matrix_destroy(a));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_matrix_destroy(b));
+
+  if (!sequence) {
+    return;
+  }
+  paddle_ivector seqA = paddle_ivector_create_none();
+  paddle_ivector seqB = paddle_ivector_create_none();
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_arguments_get_sequence_start_pos(expected, 0, 0, seqA));
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_arguments_get_sequence_start_pos(actual, 0, 0, seqB));
+  uint64_t sizeA, sizeB;
+  ASSERT_EQ(kPD_NO_ERROR, paddle_ivector_get_size(seqA, &sizeA));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_ivector_get_size(seqB, &sizeB));
+  ASSERT_EQ(sizeA, sizeB);
+  int *startsA, *startsB;
+  ASSERT_EQ(kPD_NO_ERROR, paddle_ivector_get(seqA, &startsA));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_ivector_get(seqB, &startsB));
+  for (uint64_t i = 0; i < sizeA; ++i) {
+    ASSERT_EQ(startsA[i], startsB[i]);
+  }
+  ASSERT_EQ(kPD_NO_ERROR, paddle_ivector_destroy(seqA));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_ivector_destroy(seqB));
+}
+
+/**
+ * Requests from many threads through a batcher get the outputs of running
+ * each of them alone.
+ */
+void testBatcher(bool sequence, uint64_t maxBatchSize, uint64_t timeoutUs) {
+  std::string config = makeConfig();
+  paddle_gradient_machine machine, slave;
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_gradient_machine_create_for_inference(
+                &machine, &config[0], (int)config.size()));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_randomize_param(machine));
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_gradient_machine_create_shared_param(
+                machine, &config[0], (int)config.size(), &slave));
+
+  std::vector<paddle_arguments> inArgs, expected, outArgs;
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    std::vector<int> seqLengths;
+    if (sequence) {
+      for (size_t j = 0; j <= i % 3; ++j) {
+        seqLengths.push_back(1 + (i + j) % 4);
+      }
+    }
+    inArgs.push_back(makeRequest(seqLengths));
+    outArgs.push_back(paddle_arguments_create_none());
+    paddle_arguments out = paddle_arguments_create_none();
+    ASSERT_EQ(kPD_NO_ERROR,
+              paddle_gradient_machine_forward(slave, inArgs[i], out, false));
+    expected.push_back(copyOutput(out, sequence));
+    ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(out));
+  }
+
+  paddle_request_batcher batcher;
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_request_batcher_create(
+                &batcher, machine, maxBatchSize, timeoutUs));
+  std::vector<std::thread> threads;
+  std::vector<paddle_error> errors(kNumRequests);
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    threads.emplace_back([&, i] {
+      errors[i] =
+          paddle_request_batcher_forward(batcher, inArgs[i], outArgs[i]);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(kPD_NO_ERROR, paddle_request_batcher_destroy(batcher));
+
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    ASSERT_EQ(kPD_NO_ERROR, errors[i]);
+    expectEqual(expected[i], outArgs[i], sequence);
+    ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(inArgs[i]));
+    ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(expected[i]));
+    ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(outArgs[i]));
+  }
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_destroy(slave));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_destroy(machine));
+}
+
+TEST(RequestBatcher, rows) {
+  for (uint64_t maxBatchSize : {1, 4, 32}) {
+    testBatcher(false, maxBatchSize, 1000);
+  }
+}
+
+TEST(RequestBatcher, sequences) {
+  for (uint64_t maxBatchSize : {1, 4, 32}) {
+    testBatcher(true, maxBatchSize, 1000);
+  }
+}
+
+/**
+ * The requests whose inputs can not be concatenated with the first one of
+ * their batch fail alone, the others are run.
+ */
+TEST(RequestBatcher, mismatchedWidths) {
+  std::string config = makeConfig();
+  paddle_gradient_machine machine;
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_gradient_machine_create_for_inference(
+                &machine, &config[0], (int)config.size()));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_randomize_param(machine));
+  paddle_request_batcher batcher;
+  /// a timeout long enough to batch all the requests together
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_request_batcher_create(&batcher, machine, 32, 200000));
+
+  std::vector<paddle_arguments> inArgs, outArgs;
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    inArgs.push_back(makeRequest({}, i % 2 ? kInputSize + 1 : kInputSize));
+    outArgs.push_back(paddle_arguments_create_none());
+  }
+  std::vector<std::thread> threads;
+  std::vector<paddle_error> errors(kNumRequests);
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    threads.emplace_back([&, i] {
+      errors[i] =
+          paddle_request_batcher_forward(batcher, inArgs[i], outArgs[i]);
+    });
+    if (i == 0) {
+      /// the first request of the batch has the width of the network
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(kPD_NO_ERROR, paddle_request_batcher_destroy(batcher));
+
+  for (size_t i = 0; i < kNumRequests; ++i) {
+    EXPECT_EQ(i % 2 ? kPD_OUT_OF_RANGE : kPD_NO_ERROR, errors[i]);
+    ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(inArgs[i]));
+    ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(outArgs[i]));
+  }
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_destroy(machine));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  std::vector<char*> argvs;
+  argvs.push_back(strdup("--use_gpu=false"));
+  paddle_init((int)argvs.size(), argvs.data());
+  for (auto each : argvs) {
+    free(each);
+  }
+  return RUN_ALL_TESTS();
+}
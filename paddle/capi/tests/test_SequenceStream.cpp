@@ -0,0 +1,233 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+#include <paddle/gserver/gradientmachines/GradientMachine.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "capi.h"
+#include "paddle/utils/ThreadLocal.h"
+
+const size_t kInputSize = 6;
+const size_t kHiddenSize = 5;
+
+void addParameter(paddle::ModelConfig& config,
+                  const std::string& name,
+                  size_t height,
+                  size_t width) {
+  paddle::ParameterConfig* para = config.add_parameters();
+  para->set_name(name);
+  para->set_size(height * width);
+  para->add_dims(height);
+  para->add_dims(width);
+  para->set_initial_std(0.5);
+}
+
+/// input -> fc -> lstmemory -> output
+std::string makeConfig(bool reversed = false) {
+  paddle::ModelConfig config;
+  config.set_type("nn");
+  paddle::LayerConfig* data = config.add_layers();
+  data->set_name("input");
+  data->set_type("data");
+  data->set_size(kInputSize);
+
+  paddle::LayerConfig* fc = config.add_layers();
+  fc->set_name("proj");
+  fc->set_type("fc");
+  fc->set_size(kHiddenSize * 4);
+  fc->set_active_type("");
+  fc->add_inputs()->set_input_layer_name("input");
+  fc->mutable_inputs(0)->set_input_parameter_name("_proj.w");
+  addParameter(config, "_proj.w", kInputSize, kHiddenSize * 4);
+
+  paddle::LayerConfig* lstm = config.add_layers();
+  lstm->set_name("output");
+  lstm->set_type("lstmemory");
+  lstm->set_size(kHiddenSize);
+  lstm->set_active_type("tanh");
+  lstm->set_active_gate_type("sigmoid");
+  lstm->set_active_state_type("tanh");
+  lstm->set_bias_parameter_name("_output.b");
+  lstm->set_reversed(reversed);
+  lstm->add_inputs()->set_input_layer_name("proj");
+  lstm->mutable_inputs(0)->set_input_parameter_name("_output.w");
+  addParameter(config, "_output.w", kHiddenSize, kHiddenSize * 4);
+  addParameter(config, "_output.b", 1, kHiddenSize * 7);
+
+  config.add_input_layer_names("input");
+  config.add_output_layer_names("output");
+  std::string buffer;
+  CHECK(config.SerializeToString(&buffer));
+  return buffer;
+}
+
+std::vector<paddle_real> randomSequence(size_t length) {
+  std::vector<paddle_real> values(length * kInputSize);
+  auto& eng = paddle::ThreadLocalRandomEngine::get();
+  std::uniform_real_distribution<paddle_real> dist(-1.0, 1.0);
+  for (auto& value : values) {
+    value = dist(eng);
+  }
+  return values;
+}
+
+/// The timesteps [begin, begin + length) of a sequence, as a sequence.
+paddle_arguments makeInput(const std::vector<paddle_real>& sequence,
+                           size_t begin,
+                           size_t length) {
+  paddle_arguments args = paddle_arguments_create_none();
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_resize(args, 1));
+  paddle_matrix mat = paddle_matrix_create(length, kInputSize, false);
+  for (size_t i = 0; i < length; ++i) {
+    CHECK_EQ(kPD_NO_ERROR,
+             paddle_matrix_set_row(
+                 mat, i, (paddle_real*)&sequence[(begin + i) * kInputSize]));
+  }
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_set_value(args, 0, mat));
+  CHECK_EQ(kPD_NO_ERROR, paddle_matrix_destroy(mat));
+  int starts[] = {0, (int)length};
+  paddle_ivector seq = paddle_ivector_create(starts, 2, true, false);
+  CHECK_EQ(kPD_NO_ERROR,
+           paddle_arguments_set_sequence_start_pos(args, 0, 0, seq));
+  CHECK_EQ(kPD_NO_ERROR, paddle_ivector_destroy(seq));
+  return args;
+}
+
+/// The rows of the output value, which the next forward overwrites.
+std::vector<paddle_real> getOutput(paddle_arguments out) {
+  paddle_matrix mat = paddle_matrix_create_none();
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_get_value(out, 0, mat));
+  uint64_t height, width;
+  CHECK_EQ(kPD_NO_ERROR, paddle_matrix_get_shape(mat, &height, &width));
+  CHECK_EQ(kHiddenSize, width);
+  std::vector<paddle_real> values;
+  for (uint64_t i = 0; i < height; ++i) {
+    paddle_real* row;
+    CHECK_EQ(kPD_NO_ERROR, paddle_matrix_get_row(mat, i, &row));
+    values.insert(values.end(), row, row + width);
+  }
+  CHECK_EQ(kPD_NO_ERROR, paddle_matrix_destroy(mat));
+  return values;
+}
+
+/// The output of a whole sequence, forwarded at once.
+std::vector<paddle_real> forwardAll(paddle_gradient_machine machine,
+                                    const std::vector<paddle_real>& sequence) {
+  paddle_arguments in =
+      makeInput(sequence, 0, sequence.size() / kInputSize);
+  paddle_arguments out = paddle_arguments_create_none();
+  CHECK_EQ(kPD_NO_ERROR,
+           paddle_gradient_machine_forward(machine, in, out, false));
+  std::vector<paddle_real> values = getOutput(out);
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_destroy(in));
+  CHECK_EQ(kPD_NO_ERROR, paddle_arguments_destroy(out));
+  return values;
+}
+
+/// Forward the next length timesteps of a stream, at begin.
+void forwardStep(paddle_sequence_stream stream,
+                 const std::vector<paddle_real>& sequence,
+                 size_t begin,
+                 size_t length,
+                 const std::vector<paddle_real>& expected) {
+  paddle_arguments in = makeInput(sequence, begin, length);
+  paddle_arguments out = paddle_arguments_create_none();
+  ASSERT_EQ(kPD_NO_ERROR, paddle_sequence_stream_forward(stream, in, out));
+  std::vector<paddle_real> values = getOutput(out);
+  ASSERT_EQ(length * kHiddenSize, values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_NEAR(expected[begin * kHiddenSize + i], values[i], 1e-5);
+  }
+  ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(in));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(out));
+}
+
+/**
+ * Two interleaved streams on one machine, fed a few timesteps at a time,
+ * get the outputs of forwarding each of their sequences at once.
+ */
+TEST(SequenceStream, steps) {
+  std::string config = makeConfig();
+  paddle_gradient_machine machine, whole;
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_gradient_machine_create_for_inference(
+                &machine, &config[0], (int)config.size()));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_randomize_param(machine));
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_gradient_machine_create_shared_param(
+                machine, &config[0], (int)config.size(), &whole));
+
+  std::vector<size_t> stepsA = {1, 1, 3, 1, 2};
+  std::vector<size_t> stepsB = {2, 1, 1, 4, 1};
+  std::vector<paddle_real> seqA = randomSequence(8);
+  std::vector<paddle_real> seqB = randomSequence(9);
+  std::vector<paddle_real> expectedA = forwardAll(whole, seqA);
+  std::vector<paddle_real> expectedB = forwardAll(whole, seqB);
+
+  paddle_sequence_stream streamA, streamB;
+  ASSERT_EQ(kPD_NO_ERROR, paddle_sequence_stream_create(&streamA, machine));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_sequence_stream_create(&streamB, machine));
+  for (int pass = 0; pass < 2; ++pass) {
+    size_t beginA = 0, beginB = 0;
+    for (size_t i = 0; i < stepsA.size(); ++i) {
+      forwardStep(streamA, seqA, beginA, stepsA[i], expectedA);
+      forwardStep(streamB, seqB, beginB, stepsB[i], expectedB);
+      beginA += stepsA[i];
+      beginB += stepsB[i];
+    }
+    // the same sequences again, from their beginning.
+    ASSERT_EQ(kPD_NO_ERROR, paddle_sequence_stream_reset(streamA));
+    ASSERT_EQ(kPD_NO_ERROR, paddle_sequence_stream_reset(streamB));
+  }
+
+  paddle_arguments in = makeInput(seqA, 0, 1);
+  paddle_arguments out = paddle_arguments_create_none();
+  ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_resize(in, 0));
+  ASSERT_EQ(kPD_OUT_OF_RANGE, paddle_sequence_stream_forward(streamA, in, out));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(in));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_arguments_destroy(out));
+
+  ASSERT_EQ(kPD_NO_ERROR, paddle_sequence_stream_destroy(streamA));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_sequence_stream_destroy(streamB));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_destroy(whole));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_destroy(machine));
+}
+
+/**
+ * A reversed recurrent layer needs the whole sequence, so no stream can be
+ * created on its machine.
+ */
+TEST(SequenceStream, reversed) {
+  std::string config = makeConfig(true);
+  paddle_gradient_machine machine;
+  ASSERT_EQ(kPD_NO_ERROR,
+            paddle_gradient_machine_create_for_inference(
+                &machine, &config[0], (int)config.size()));
+  paddle_sequence_stream stream;
+  ASSERT_EQ(kPD_NOT_SUPPORTED, paddle_sequence_stream_create(&stream, machine));
+  ASSERT_EQ(kPD_NO_ERROR, paddle_gradient_machine_destroy(machine));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  std::vector<char*> argvs;
+  argvs.push_back(strdup("--use_gpu=false"));
+  paddle_init((int)argvs.size(), argvs.data());
+  for (auto each : argvs) {
+    free(each);
+  }
+  return RUN_ALL_TESTS();
+}
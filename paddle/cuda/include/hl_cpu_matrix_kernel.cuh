@@ -22,6 +22,15 @@ limitations under the License. */
 #include "hl_cpu_matrix_kernel_detail.cuh"
 #endif
 
+/**
+ * The hl_sse_matrix_* loops used below take the vecType of the build flags
+ * only, unlike the kernels of paddle/math/SIMDKernels.h they are not picked
+ * at runtime from CpuId. Every op of hl_matrix_ops.cuh defines its vecOp
+ * against that single type, and these templates are instantiated all over
+ * the library, so a copy compiled with wider instructions could be picked
+ * by the linker for every caller.
+ */
+
 /**
  * @brief   cpu element wise unary operator.
  */
@@ -17,6 +17,7 @@ limitations under the License. */
 #include <iostream>
 #include "paddle/math/MathFunctions.h"
 #include "paddle/math/SIMDFunctions.h"
+#include "paddle/utils/Thread.h"
 #include "paddle/utils/ThreadLocal.h"
 
 #ifndef PADDLE_TYPE_DOUBLE
@@ -25,6 +26,11 @@ limitations under the License. */
 #define GEMM paddle::gemm<double>
 #endif
 
+DEFINE_int32(sparse_mul_threads,
+             1,
+             "Number of threads used by one cpu sparse x dense MulOp. Every "
+             "thread calling MulOp gets its own pool of threads.");
+
 namespace {
 inline void vecAddTo(real* a, const real* b, real scaleB, size_t len) {
   for (unsigned int i = 0; i < len; ++i) {
@@ -32,11 +38,62 @@ inline void vecAddTo(real* a, const real* b, real scaleB, size_t len) {
   }
 }
 
-inline void colVecAddTo(
-    real* a, real* b, real c, size_t len, size_t aWidth, size_t bWidth) {
-  for (unsigned int i = 0; i < len; ++i) {
-    a[i * aWidth] += (1.0 == c) ? b[i * bWidth] : b[i * bWidth] * c;
+/// Columns of the dense operand processed at a time, so that the part of
+/// the rows of b picked by the sparse rows stays in cache.
+const size_t kColumnBlock = 512;
+/// Rows of the dense output processed at a time by dense = dense * sparse.
+const size_t kRowBlock = 4;
+/// Below this many multiply-adds a sparse mul is not split across threads.
+const size_t kMinParallelWork = 1 << 16;
+
+paddle::ThreadLocal<std::unique_ptr<paddle::SyncThreadPool>> mulThreadPool;
+
+/**
+ * Split the rows [0, numRows) into one range per thread so that every range
+ * gets about the same work, and run job(begin, end) on them in parallel.
+ * rowWork(i) is the work of the rows [0, i), so it is non-decreasing, and
+ * rowWork(numRows) * width is the total number of multiply-adds.
+ */
+template <typename RowWork>
+void parallelRows(size_t numRows,
+                  size_t width,
+                  RowWork rowWork,
+                  const std::function<void(size_t, size_t)>& job) {
+  size_t totalWork = rowWork(numRows);
+  if (FLAGS_sparse_mul_threads <= 1 || numRows < 2 ||
+      totalWork * width < kMinParallelWork) {
+    job(0, numRows);
+    return;
+  }
+
+  std::unique_ptr<paddle::SyncThreadPool>& pool = *mulThreadPool;
+  if (!pool || pool->getNumThreads() + 1 != (size_t)FLAGS_sparse_mul_threads) {
+    pool.reset(new paddle::SyncThreadPool(FLAGS_sparse_mul_threads - 1));
+  }
+  size_t numParts = pool->getNumThreads() + 1;
+  std::vector<size_t> bounds(numParts + 1, numRows);
+  bounds[0] = 0;
+  for (size_t t = 1; t < numParts; ++t) {
+    // the first row whose prefix work reaches t / numParts of the total.
+    size_t target = totalWork * t / numParts;
+    size_t lo = bounds[t - 1], hi = numRows;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (rowWork(mid) < target) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    bounds[t] = lo;
   }
+
+  pool->execPlusOwner([&](int tid, size_t numThreads) {
+    (void)numThreads;
+    if (bounds[tid] < bounds[tid + 1]) {
+      job(bounds[tid], bounds[tid + 1]);
+    }
+  });
 }
 }  // namespace
 
@@ -150,17 +207,51 @@ void MulOp<DEVICE_TYPE_CPU>(CpuMatrix& out,
 
   int* cols = a.getCols();
   real* values = a.getValue();
-  for (size_t i = 0; i < a.getHeight(); ++i) {
-    const int start = a.getRowStartIdx(i);
-    const int end = a.getRowStartIdx(i + 1);
-    for (int j = start; j < end; ++j) {
-      vecAddTo(!aTrans ? out.getRow(i) : out.getRow(cols[j]),
-               !aTrans ? const_cast<CpuMatrix&>(b).getRow(cols[j])
-                       : const_cast<CpuMatrix&>(b).getRow(i),
-               (a.getValueType() == FLOAT_VALUE) ? values[j] : (real)1.0,
-               out.getWidth());
+  if (aTrans) {
+    /// the rows of a scatter into the rows of out, keep it serial.
+    for (size_t i = 0; i < a.getHeight(); ++i) {
+      const int start = a.getRowStartIdx(i);
+      const int end = a.getRowStartIdx(i + 1);
+      for (int j = start; j < end; ++j) {
+        vecAddTo(out.getRow(cols[j]),
+                 const_cast<CpuMatrix&>(b).getRow(i),
+                 (a.getValueType() == FLOAT_VALUE) ? values[j] : (real)1.0,
+                 out.getWidth());
+      }
     }
+    return;
   }
+
+  /// out.row(i) += sum_j a(i, j) * b.row(j). Rows of out are split by the
+  /// number of non-zeros, and within a column block every row of out is
+  /// accumulated in registers over all the rows of b it picks.
+  size_t width = out.getWidth();
+  size_t ldb = b.getStride();
+  size_t ldc = out.getStride();
+  const real* scale = (a.getValueType() == FLOAT_VALUE) ? values : nullptr;
+  parallelRows(
+      a.getHeight(),
+      width,
+      [&](size_t i) { return a.getRowStartIdx(i) + i; },
+      [&](size_t begin, size_t end) {
+        std::vector<const real*> rows;
+        for (size_t col = 0; col < width; col += kColumnBlock) {
+          size_t len = std::min(kColumnBlock, width - col);
+          for (size_t i = begin; i < end; ++i) {
+            size_t start = a.getRowStartIdx(i);
+            size_t nnz = a.getRowStartIdx(i + 1) - start;
+            rows.resize(nnz);
+            for (size_t j = 0; j < nnz; ++j) {
+              rows[j] = B + cols[start + j] * ldb + col;
+            }
+            simd::batchAxpy(C + i * ldc + col,
+                            rows.data(),
+                            scale ? scale + start : nullptr,
+                            nnz,
+                            len);
+          }
+        }
+      });
 }
 
 /// dense matrix (+)= dense matrix * sparse matrix
@@ -175,45 +266,48 @@ void MulOp<DEVICE_TYPE_CPU>(CpuMatrix& out,
   if (scaleT == 0) {
     out.zeroMem();
   }
-  real* A = const_cast<real*>(a.getData());
-  real* B = const_cast<real*>(b.getValue());
+  if (b.getFormat() != SPARSE_CSC && b.getFormat() != SPARSE_CSR) {
+    return;
+  }
+  const real* A = a.getData();
+  const real* B = b.getValue();
   real* C = out.getData();
   int* rows = b.getRows();
   int* cols = b.getCols();
+  size_t lda = a.getStride();
+  size_t ldc = out.getStride();
+  bool isCsc = b.getFormat() == SPARSE_CSC;
+  size_t numMajor = isCsc ? b.getWidth() : b.getHeight();
+  int* majorStart = isCsc ? cols : rows;
+  int* minorIdx = isCsc ? rows : cols;
 
-  /// SPARSE_CSC format
-  if (b.getFormat() == SPARSE_CSC) {
-    for (size_t j = 0; j < b.getWidth(); ++j) {
-      int start = b.getColStartIdx(j);
-      int end = b.getColStartIdx(j + 1);
-      for (int i = start; i < end; ++i) {
-        colVecAddTo(!bTrans ? C + j : C + rows[i],
-                    !bTrans ? A + rows[i] : A + j,
-                    (b.getValueType() == NO_VALUE) ? (real)1.0 : B[i],
-                    out.getHeight(),
-                    out.getWidth(),
-                    a.getWidth());
-      }
-    }
-    return;
-  }
-
-  /// SPARSE_CSR format
-  if (b.getFormat() == SPARSE_CSR) {
-    for (size_t j = 0; j < b.getHeight(); ++j) {
-      int start = b.getRowStartIdx(j);
-      int end = b.getRowStartIdx(j + 1);
-      for (int i = start; i < end; ++i) {
-        colVecAddTo(!bTrans ? C + cols[i] : C + j,
-                    !bTrans ? A + j : A + cols[i],
-                    (b.getValueType() == NO_VALUE) ? (real)1.0 : B[i],
-                    out.getHeight(),
-                    out.getWidth(),
-                    a.getWidth());
-      }
-    }
-    return;
-  }
+  /// Every non-zero b(r, c) = v gives out.col(c) += v * a.col(r), or with
+  /// bTrans, out.col(r) += v * a.col(c). The rows of out are independent,
+  /// so they are split evenly across threads, and kRowBlock rows of out are
+  /// updated for each non-zero so that the index and value loads of b are
+  /// shared by them.
+  size_t nnz = b.getElementCnt();
+  parallelRows(
+      out.getHeight(),
+      1,
+      [nnz](size_t i) { return i * (nnz + 1); },
+      [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row += kRowBlock) {
+          size_t rowEnd = std::min(row + kRowBlock, end);
+          for (size_t major = 0; major < numMajor; ++major) {
+            for (int i = majorStart[major]; i < majorStart[major + 1]; ++i) {
+              size_t r = isCsc ? minorIdx[i] : major;
+              size_t c = isCsc ? major : minorIdx[i];
+              size_t in = !bTrans ? r : c;
+              size_t to = !bTrans ? c : r;
+              real v = (b.getValueType() == NO_VALUE) ? (real)1.0 : B[i];
+              for (size_t m = row; m < rowEnd; ++m) {
+                C[m * ldc + to] += v * A[m * lda + in];
+              }
+            }
+          }
+        }
+      });
 }
 
 /**
@@ -0,0 +1,160 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include "MulOp.h"
+#include "paddle/math/tests/TensorCheck.h"
+#include "paddle/testing/TestUtil.h"
+
+using namespace paddle;  // NOLINT
+
+DECLARE_int32(sparse_mul_threads);
+
+/**
+ * The cpu sparse x dense MulOp with several threads is compared with the
+ * dense GEMM on the densified sparse matrix.
+ */
+CpuSparseMatrixPtr makeSparse(size_t height,
+                              size_t width,
+                              real density,
+                              SparseFormat format,
+                              SparseValueType valueType) {
+  size_t nnz = std::max((size_t)(height * width * density), (size_t)1);
+  auto mat = std::make_shared<CpuSparseMatrix>(
+      height, width, nnz, valueType, format);
+  mat->randomizeUniform();
+  return mat;
+}
+
+CpuMatrixPtr densify(const CpuSparseMatrix& sparse) {
+  auto dense =
+      std::make_shared<CpuMatrix>(sparse.getHeight(), sparse.getWidth());
+  dense->zeroMem();
+  bool isCsr = sparse.getFormat() == SPARSE_CSR;
+  size_t numMajor = isCsr ? sparse.getHeight() : sparse.getWidth();
+  int* start = isCsr ? sparse.getRows() : sparse.getCols();
+  int* minor = isCsr ? sparse.getCols() : sparse.getRows();
+  for (size_t major = 0; major < numMajor; ++major) {
+    for (int i = start[major]; i < start[major + 1]; ++i) {
+      real v = sparse.getValueType() == FLOAT_VALUE ? sparse.getValue()[i] : 1;
+      size_t r = isCsr ? major : minor[i];
+      size_t c = isCsr ? minor[i] : major;
+      dense->getData()[r * dense->getWidth() + c] += v;
+    }
+  }
+  return dense;
+}
+
+void testDSparseDMul(size_t dimM,
+                     size_t dimN,
+                     size_t dimK,
+                     real density,
+                     SparseValueType valueType) {
+  auto a = makeSparse(dimM, dimK, density, SPARSE_CSR, valueType);
+  CpuMatrix b(dimK, dimN);
+  b.randomizeUniform();
+  CpuMatrix expected(dimM, dimN);
+  expected.randomizeUniform();
+  CpuMatrix out(dimM, dimN);
+  out.copyFrom(expected);
+
+  MulOp<DEVICE_TYPE_CPU>(expected, *densify(*a), b, 1.0, 1.0, false, false);
+  MulOp<DEVICE_TYPE_CPU>(out, *a, b, 1.0, 1.0, false, false);
+  autotest::TensorCheckErr(expected, out);
+}
+
+void testDDSparseMul(size_t dimM,
+                     size_t dimN,
+                     size_t dimK,
+                     real density,
+                     SparseFormat format,
+                     bool bTrans) {
+  auto b = bTrans ? makeSparse(dimN, dimK, density, format, FLOAT_VALUE)
+                  : makeSparse(dimK, dimN, density, format, FLOAT_VALUE);
+  CpuMatrix a(dimM, dimK);
+  a.randomizeUniform();
+  CpuMatrix expected(dimM, dimN);
+  expected.zeroMem();
+  CpuMatrix out(dimM, dimN);
+  out.zeroMem();
+
+  MulOp<DEVICE_TYPE_CPU>(expected, a, *densify(*b), 1.0, 1.0, false, bTrans);
+  MulOp<DEVICE_TYPE_CPU>(out, a, *b, 1.0, 1.0, false, bTrans);
+  autotest::TensorCheckErr(expected, out);
+}
+
+TEST(MulOpCpu, DSparseDMul) {
+  for (const auto threads : {1, 4}) {
+    FLAGS_sparse_mul_threads = threads;
+    for (const auto dimM : {1, 100, 1000}) {
+      for (const auto dimN : {1, 33, 600}) {
+        for (const auto density : {0.001, 0.1}) {
+          for (const auto valueType : {FLOAT_VALUE, NO_VALUE}) {
+            testDSparseDMul(dimM, dimN, 500, density, valueType);
+          }
+        }
+      }
+    }
+  }
+  FLAGS_sparse_mul_threads = 1;
+}
+
+TEST(MulOpCpu, DDSparseMul) {
+  for (const auto threads : {1, 4}) {
+    FLAGS_sparse_mul_threads = threads;
+    for (const auto dimM : {1, 100, 1000}) {
+      for (const auto dimN : {1, 100}) {
+        for (const auto format : {SPARSE_CSR, SPARSE_CSC}) {
+          for (const auto bTrans : {false, true}) {
+            testDDSparseMul(dimM, dimN, 200, 0.05, format, bTrans);
+          }
+        }
+      }
+    }
+  }
+  FLAGS_sparse_mul_threads = 1;
+}
+
+/**
+ * dense = CSR x dense as in the first fc layer of a CTR model, a batch of
+ * sparse features times the weight, at several densities of the batch.
+ */
+TEST(MulOpCpu, DSparseDMulBenchmark) {
+  const size_t dimM = 512, dimK = 20000, dimN = 256;
+  CpuMatrix b(dimK, dimN);
+  b.randomizeUniform();
+  CpuMatrix out(dimM, dimN);
+  for (const auto density : {0.0005, 0.005, 0.05}) {
+    auto a = makeSparse(dimM, dimK, density, SPARSE_CSR, FLOAT_VALUE);
+    for (const auto threads : {1, 2, 4}) {
+      FLAGS_sparse_mul_threads = threads;
+      MulOp<DEVICE_TYPE_CPU>(out, *a, b, 1.0, 0.0, false, false);
+      const int repeat = 10;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < repeat; ++i) {
+        MulOp<DEVICE_TYPE_CPU>(out, *a, b, 1.0, 0.0, false, false);
+      }
+      double seconds = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count() /
+                       repeat;
+      LOG(INFO) << "density=" << density << " nnz=" << a->getElementCnt()
+                << " threads=" << threads << " time=" << seconds * 1e3
+                << "ms GFLOPS="
+                << 2.0 * a->getElementCnt() * dimN / seconds * 1e-9;
+    }
+  }
+  FLAGS_sparse_mul_threads = 1;
+}
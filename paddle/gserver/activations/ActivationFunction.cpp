@@ -77,6 +77,7 @@ public:
     (void)act;
     return Error();
   }
+  bool isRowWise() const { return true; }
   const std::string& getName() const { return name; }
 };
 const std::string IdentityActivation::name = "";
@@ -100,6 +101,8 @@ Error __must_check backward(Argument& act) {
   act.grad->sigmoidDerivative(*act.value);
   return Error();
 }
+
+bool isRowWise() const { return true; }
 END_DEFINE_ACTIVATION(sigmoid)
 
 /**
@@ -154,6 +157,8 @@ Error __must_check backward(Argument& act) {
   }
   return Error();
 }
+
+bool isRowWise() const { return true; }
 END_DEFINE_ACTIVATION(softmax)
 
 /**
@@ -234,6 +239,8 @@ Error __must_check backward(Argument& act) {
   act.grad->reluDerivative(*act.value);
   return Error();
 }
+
+bool isRowWise() const { return true; }
 END_DEFINE_ACTIVATION(relu)
 
 /**
@@ -259,6 +266,8 @@ Error __must_check backward(Argument& act) {
   act.grad->breluDerivative(*act.value);
   return Error();
 }
+
+bool isRowWise() const { return true; }
 END_DEFINE_ACTIVATION(brelu)
 
 /**
@@ -277,6 +286,8 @@ Error __must_check backward(Argument& act) {
   act.grad->tanhDerivative(*act.value);
   return Error();
 }
+
+bool isRowWise() const { return true; }
 END_DEFINE_ACTIVATION(tanh)
 
 /**
@@ -300,6 +311,8 @@ Error __must_check backward(Argument& act) {
   act.grad->scaledTanhDerivative(*act.value, a, b);
   return Error();
 }
+
+bool isRowWise() const { return true; }
 END_DEFINE_ACTIVATION(stanh)
 
 /**
@@ -318,6 +331,8 @@ Error __must_check backward(Argument& act) {
   act.grad->softreluDerivative(*act.value);
   return Error();
 }
+
+bool isRowWise() const { return true; }
 END_DEFINE_ACTIVATION(softrelu)
 
 /**
@@ -394,6 +409,8 @@ Error __must_check backward(Argument& act) {
   act.grad->expDerivative(*act.value);
   return Error();
 }
+
+bool isRowWise() const { return true; }
 END_DEFINE_ACTIVATION(exponential)
 
 /**
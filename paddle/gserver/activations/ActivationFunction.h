@@ -60,6 +60,14 @@ public:
    */
   virtual Error __must_check backward(Argument& act) = 0;
 
+  /**
+   * @brief Whether forward() of a matrix gives the same result as forward()
+   * of each of its rows in turn. Only then a layer can fuse the activation
+   * into one sweep over the rows of its output, see
+   * Layer::forwardFusedEpilogue().
+   */
+  virtual bool isRowWise() const { return false; }
+
   virtual const std::string& getName() const = 0;
 };
 
@@ -171,7 +171,18 @@ int64_t DataProvider::getNextBatch(int64_t size, DataBatch* batch) {
   int64_t batchSize = doubleBuffer_ ? getNextBatchFromBuffer(size, batch)
                                     : getNextBatchInternal(size, batch);
 
-  if (!batchSize) return 0;
+  if (!batchSize) {
+    if (numPaddedTimesteps_) {
+      LOG(INFO) << "Padding efficiency of the pass: "
+                << (double)numTimesteps_ / numPaddedTimesteps_ << " ("
+                << numTimesteps_ << " timesteps, " << numPaddedTimesteps_
+                << " padded to the longest sequence of each batch)";
+      numTimesteps_ = 0;
+      numPaddedTimesteps_ = 0;
+    }
+    return 0;
+  }
+  addPaddingStats(*batch);
 
   if (!config_.constant_slots_size()) return batchSize;
 
@@ -197,6 +208,23 @@ int64_t DataProvider::getNextBatch(int64_t size, DataBatch* batch) {
   return batchSize;
 }
 
+void DataProvider::addPaddingStats(const DataBatch& batch) {
+  for (int64_t i = 0; i < batch.getNumStreams(); ++i) {
+    const Argument& arg = batch.getStream(i);
+    if (!arg.sequenceStartPositions) continue;
+    const int* starts = arg.sequenceStartPositions->getData(false);
+    size_t numSequences = arg.getNumSequences();
+    int maxLength = 0;
+    for (size_t j = 0; j < numSequences; ++j) {
+      maxLength = std::max(maxLength, starts[j + 1] - starts[j]);
+    }
+    numTimesteps_ += starts[numSequences];
+    numPaddedTimesteps_ += (int64_t)maxLength * numSequences;
+    // all sequence slots of a sample usually have the same length.
+    return;
+  }
+}
+
 int64_t DataProvider::getNextBatchFromBuffer(int64_t size, DataBatch* batch) {
   CHECK(doubleBuffer_ != nullptr);
 
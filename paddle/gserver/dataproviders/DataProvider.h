@@ -310,7 +310,9 @@ public:
       : config_(config),
         skipShuffle_(false),
         usageRatio_(config.usage_ratio()),
-        useGpu_(useGpu) {
+        useGpu_(useGpu),
+        numTimesteps_(0),
+        numPaddedTimesteps_(0) {
     if (config_.async_load_data()) {
       initAsyncLoader();
     }
@@ -341,6 +343,8 @@ public:
    * at the end of the function
    */
   virtual void reset() {
+    numTimesteps_ = 0;
+    numPaddedTimesteps_ = 0;
     if (doubleBuffer_ != nullptr) {
       doubleBuffer_->startAsyncLoad();
     }
@@ -377,6 +381,18 @@ protected:
   int64_t getNextBatchFromBuffer(int64_t size, DataBatch* batch);
 
   void initAsyncLoader();
+
+private:
+  /**
+   * The timesteps of the sequences of the batches of a pass, and how many
+   * they would be if every sequence were as long as the longest of its
+   * batch, as the number of steps of a recurrent layer is. Their ratio is
+   * logged at the end of the pass.
+   */
+  int64_t numTimesteps_;
+  int64_t numPaddedTimesteps_;
+
+  void addPaddingStats(const DataBatch& batch);
 };
 
 /**
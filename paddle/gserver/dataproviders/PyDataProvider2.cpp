@@ -19,6 +19,7 @@ limitations under the License. */
 #include <stdio.h>
 #include <stdlib.h>
 #include <list>
+#include <map>
 #include <unordered_set>
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <numpy/ndarrayobject.h>
@@ -289,6 +290,8 @@ private:
 
     this->canOverBatchSize_ = self.getBoolAttr("can_over_batch_size");
 
+    this->bucketByLength_ = self.getBoolAttr("bucket_by_length");
+
     calcBatchSize_.reset(self.getAttr("calc_batch_size"));
     if (this->calcBatchSize_ && !py::isCallable(this->calcBatchSize_)) {
       this->calcBatchSize_.reset();
@@ -388,6 +391,12 @@ private:
         CHECK(ok) << "CalcBatchSize must return int or long";
       }
 
+      size_t length = 0;
+      if (bucketByLength_) {
+        PyGuard guard;
+        length = sampleLength(data);
+      }
+
       if (this->loadThread_) {  // wait poolActualSize < poolSize;
         std::unique_lock<std::mutex> l(mtx_);
         pushCV_.wait(l, [this, additionalBatchSize] {
@@ -398,7 +407,12 @@ private:
       {
         std::lock_guard<std::mutex> guard(mtx_);
         poolActualSize_ += additionalBatchSize;
-        dataPool_.emplace_back(data);
+        if (bucketByLength_) {
+          lengthBuckets_[length].emplace_back(data);
+          ++numBucketedSamples_;
+        } else {
+          dataPool_.emplace_back(data);
+        }
       }
       pullCV_.notify_all();
     }
@@ -422,7 +436,9 @@ private:
     {
       PyGuard g;
       dataPool_.clear();
+      lengthBuckets_.clear();
     }
+    numBucketedSamples_ = 0;
     poolActualSize_ = 0;
 
     if (startNewThread && cache_->reset()) {
@@ -442,6 +458,9 @@ private:
   std::atomic<bool> exit_;
   std::deque<PyObjectPtr> callingContexts_;
   std::deque<PyObjectPtr> dataPool_;
+  /// the data pool when bucketByLength_, <sample length, samples>
+  std::map<size_t, std::deque<PyObjectPtr>> lengthBuckets_;
+  size_t numBucketedSamples_;
   size_t poolActualSize_;
   std::condition_variable pushCV_;
   std::condition_variable pullCV_;
@@ -456,6 +475,7 @@ private:
   size_t poolSize_;
   size_t minPoolSize_;
   bool canOverBatchSize_;
+  bool bucketByLength_;
   PyObjectPtr calcBatchSize_;
   PyObjectPtr generator_;
   std::vector<std::string> fileLists_;
@@ -494,6 +514,92 @@ public:
     DataProvider::reset();
   }
 
+  /**
+   * The number of timesteps of a sample, the ones of its longest sequence
+   * slot, or 0 if it has no sequence slot.
+   */
+  size_t sampleLength(PyObject* sample) {
+    py::SequenceHelper s(sample);
+    size_t length = 0;
+    for (size_t i = 0; i < headers_.size(); ++i) {
+      size_t slotLength = 0;
+      if (headers_[i].seqType == SQT_SEQ) {
+        slotLength = (size_t)PySequence_Size(s[i]);
+      } else if (headers_[i].seqType == SQT_SUBSEQ) {
+        py::SequenceHelper subSequences(s[i]);
+        for (size_t j = 0; j < subSequences.size(); ++j) {
+          slotLength += (size_t)PySequence_Size(subSequences[j]);
+        }
+      }
+      length = std::max(length, slotLength);
+    }
+    return length;
+  }
+
+  /**
+   * Move samples loaded from the cache to the length buckets, their lengths
+   * are computed once there.
+   */
+  void bucketByLength(std::deque<PyObjectPtr>& samples) {
+    std::vector<size_t> lengths(samples.size());
+    {
+      PyGuard g;
+      for (size_t i = 0; i < samples.size(); ++i) {
+        lengths[i] = sampleLength(samples[i].get());
+      }
+    }
+    std::lock_guard<std::mutex> guard(mtx_);
+    for (size_t i = 0; i < samples.size(); ++i) {
+      lengthBuckets_[lengths[i]].emplace_back(std::move(samples[i]));
+    }
+    numBucketedSamples_ += samples.size();
+    samples.clear();
+  }
+
+  /**
+   * The length of a sample picked at random in the length buckets, which
+   * the samples of a batch are the closest to. So the batch has few padded
+   * steps, while the batches of a pass still come in a random order.
+   */
+  size_t pickSeedLength() {
+    if (lengthBuckets_.empty()) return 0;
+    if (skipShuffle_) return lengthBuckets_.begin()->first;
+    size_t i = ThreadLocalRand::rand() % numBucketedSamples_;
+    for (auto& bucket : lengthBuckets_) {
+      if (i < bucket.second.size()) return bucket.first;
+      i -= bucket.second.size();
+    }
+    return lengthBuckets_.rbegin()->first;
+  }
+
+  /**
+   * Pop a sample of the length bucket the closest to seedLength.
+   */
+  PyObjectPtr popClosestLength(size_t seedLength, size_t* length) {
+    CHECK(!lengthBuckets_.empty());
+    auto it = lengthBuckets_.lower_bound(seedLength);
+    if (it == lengthBuckets_.end() ||
+        (it != lengthBuckets_.begin() &&
+         seedLength - std::prev(it)->first < it->first - seedLength)) {
+      --it;
+    }
+    auto& bucket = it->second;
+    if (!skipShuffle_) {
+      size_t i = ThreadLocalRand::rand() % bucket.size();
+      if (i != 0) {
+        std::swap(bucket[i], bucket.front());
+      }
+    }
+    PyObjectPtr sample = std::move(bucket.front());
+    bucket.pop_front();
+    *length = it->first;
+    if (bucket.empty()) {
+      lengthBuckets_.erase(it);
+    }
+    --numBucketedSamples_;
+    return sample;
+  }
+
   /**
    * Shuffle. Do nothing because PyDataProvider do shuffle implicitly by random
    * select data from datapool.
@@ -543,11 +649,24 @@ public:
 
     std::deque<PyObjectPtr>& pool = *poolPtr;
 
-    while (bsize < size && !pool.empty()) {
+    size_t seedLength = 0;
+    if (bucketByLength_) {
+      if (!this->loadThread_) {
+        bucketByLength(pool);
+      }
+      std::lock_guard<std::mutex> guard(mtx_);
+      seedLength = pickSeedLength();
+    }
+
+    while (bsize < size &&
+           (bucketByLength_ ? numBucketedSamples_ != 0 : !pool.empty())) {
       {
         // move data from pool to data
         std::lock_guard<std::mutex> guard(mtx_);
-        if (skipShuffle_) {
+        size_t length = 0;
+        if (bucketByLength_) {
+          data.emplace_back(popClosestLength(seedLength, &length));
+        } else if (skipShuffle_) {
           size_t i = 0;
           CHECK(pool[i] != nullptr);
           data.emplace_back(std::move(pool[i]));
@@ -575,7 +694,12 @@ public:
 
           if (bsize + tmp > size && !canOverBatchSize_) {
             // Put data back.
-            pool.push_front(std::move(data.back()));
+            if (bucketByLength_) {
+              lengthBuckets_[length].push_front(std::move(data.back()));
+              ++numBucketedSamples_;
+            } else {
+              pool.push_front(std::move(data.back()));
+            }
             data.pop_back();
             break;
           } else {
@@ -92,4 +92,17 @@ void GradientMachine::randParameters() {
   LOG(INFO) << "Init parameters done.";
 }
 
+void GradientMachine::forwardStep(const std::vector<Argument>& inArgs,
+                                  std::vector<Argument>* outArgs,
+                                  MachineState* state) {
+  // a layer only takes a state after its first resetState().
+  if (state->empty()) {
+    resetState();
+  } else {
+    setState(*state);
+  }
+  forward(inArgs, outArgs, PASS_TEST);
+  getState(*state);
+}
+
 }  // namespace paddle
@@ -145,6 +145,25 @@ public:
   // save machine state
   virtual void getState(MachineState& machineState) {}
 
+  /**
+   * Forward the next timesteps of one sequence for inference, starting
+   * from state, which is empty at the beginning of the sequence, and
+   * replace state by the one after the last timestep. Only the new
+   * timesteps are computed, however long the sequence already is.
+   *
+   * Each input holds a single sequence. The recurrent layers must not be
+   * reversed, and layers in a recurrent_group do not keep their state.
+   * The layers hold the state while forwarding, so streams sharing a
+   * machine must not forward concurrently, and the machine is left
+   * stateful: it should only be used for streams.
+   */
+  void forwardStep(const std::vector<Argument>& inArgs,
+                   std::vector<Argument>* outArgs,
+                   MachineState* state);
+
+  /// Whether forwardStep() can be used, i.e. no recurrent layer is reversed.
+  virtual bool supportsForwardStep() const { return true; }
+
   virtual void onPassEnd() = 0;
 
   /**
@@ -212,6 +231,15 @@ public:
    */
   virtual void restart() {}
 
+  /**
+   * @brief   Set whether the fc and exconv layers multiply by int8 copies of
+   *          their cpu weights in a PASS_TEST forward, which is
+   *          --quantize_inference_weights by default.
+   *
+   * @return  false if the machine does not support it.
+   */
+  virtual bool setQuantizeWeights(bool quantize) { return false; }
+
   /// Set the gradient of the output from outside.
   virtual void setOutputGrad(const std::vector<Argument>& args) {
     LOG(FATAL) << "Not implemented!";
@@ -0,0 +1,255 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "MappedModel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include "NeuralNetwork.h"
+#include "paddle/utils/Logging.h"
+
+namespace paddle {
+
+static const char kMagic[8] = "PDMODEL";
+
+static uint64_t alignUp(uint64_t offset) {
+  const uint64_t align = MappedModel::kAlignment;
+  return (offset + align - 1) / align * align;
+}
+
+/**
+ * A file mapped copy-on-write, unmapped when the last MappedMemoryHandle of
+ * it is released. The pages are shared with the page cache until they are
+ * written, and the writes never reach the file.
+ */
+class MappedFile {
+public:
+  MappedFile() : data_(nullptr), size_(0) {}
+
+  ~MappedFile() {
+    if (data_) {
+      munmap(data_, size_);
+    }
+  }
+
+  /// Map filename, false with the error logged if it fails.
+  bool open(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      LOG(ERROR) << "Fail to open " << filename << ": " << strerror(errno);
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      LOG(ERROR) << "Fail to stat " << filename << ": " << strerror(errno);
+      close(fd);
+      return false;
+    }
+    if ((size_t)st.st_size < sizeof(MappedModel::FileHeader)) {
+      LOG(ERROR) << filename << " is not a model file";
+      close(fd);
+      return false;
+    }
+    void* addr =
+        mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      LOG(ERROR) << "Fail to mmap " << filename << ": " << strerror(errno);
+      return false;
+    }
+    data_ = reinterpret_cast<char*>(addr);
+    size_ = st.st_size;
+    return true;
+  }
+
+  char* getData() const { return data_; }
+  size_t getSize() const { return size_; }
+
+private:
+  char* data_;
+  size_t size_;
+};
+
+/**
+ * A parameter value in a MappedFile. Every value has its own handle, since
+ * a Weight creates its matrix from the start of the memory handle.
+ */
+class MappedMemoryHandle : public CpuMemoryHandle {
+public:
+  MappedMemoryHandle(const std::shared_ptr<MappedFile>& file,
+                     void* buf,
+                     size_t size)
+      : CpuMemoryHandle(buf, size), file_(file) {}
+
+private:
+  std::shared_ptr<MappedFile> file_;
+};
+
+void MappedModel::write(const std::string& filename,
+                        const ModelConfig& config,
+                        const std::vector<ParameterPtr>& parameters) {
+  std::unordered_map<std::string, ParameterPtr> parameterMap;
+  for (auto& para : parameters) {
+    parameterMap[para->getName()] = para;
+  }
+
+  std::string buf;
+  CHECK(config.SerializeToString(&buf));
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kFormatVersion;
+  header.valueSize = sizeof(real);
+  header.numParameters = config.parameters_size();
+  header.configOffset =
+      sizeof(FileHeader) + header.numParameters * sizeof(IndexEntry);
+  header.configSize = buf.size();
+
+  std::vector<ParameterPtr> values;
+  std::vector<IndexEntry> index;
+  uint64_t offset = alignUp(header.configOffset + header.configSize);
+  for (auto& paraConfig : config.parameters()) {
+    auto it = parameterMap.find(paraConfig.name());
+    CHECK(it != parameterMap.end()) << "Missing parameter "
+                                    << paraConfig.name();
+    ParameterPtr para = it->second;
+    CHECK(para->isFullSize() && !para->isSparse())
+        << "Only dense parameters can be mapped: " << para->getName();
+    CHECK_EQ(para->getSize(), paraConfig.size());
+    values.push_back(para);
+    index.push_back({offset, para->getSize()});
+    offset = alignUp(offset + para->getSize() * sizeof(real));
+  }
+
+  std::ofstream os(filename, std::ios_base::binary);
+  CHECK(os) << "Fail to open " << filename;
+  os.write(reinterpret_cast<char*>(&header), sizeof(header));
+  os.write(reinterpret_cast<char*>(index.data()),
+           index.size() * sizeof(IndexEntry));
+  os.write(buf.data(), buf.size());
+  std::vector<char> zeros(kAlignment, 0);
+  for (size_t i = 0; i < values.size(); ++i) {
+    os.write(zeros.data(), index[i].offset - os.tellp());
+    CpuVector vec(*values[i]->getBuf(PARAMETER_VALUE));
+    os.write(reinterpret_cast<char*>(vec.getData()),
+             vec.getSize() * sizeof(real));
+  }
+  CHECK(os) << "Fail to write to " << filename;
+}
+
+MappedModel::MappedModel(const std::string& filename) {
+  CHECK(init(filename)) << "Fail to load the model " << filename;
+}
+
+std::unique_ptr<MappedModel> MappedModel::load(const std::string& filename) {
+  std::unique_ptr<MappedModel> model(new MappedModel());
+  if (!model->init(filename)) {
+    return nullptr;
+  }
+  return model;
+}
+
+bool MappedModel::init(const std::string& filename) {
+  file_ = std::make_shared<MappedFile>();
+  if (!file_->open(filename)) {
+    return false;
+  }
+  const char* data = file_->getData();
+  uint64_t fileSize = file_->getSize();
+  FileHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    LOG(ERROR) << filename << " is not a model file";
+    return false;
+  }
+  if (header.version != kFormatVersion) {
+    LOG(ERROR) << "Incorrect format version: " << header.version;
+    return false;
+  }
+  if (header.valueSize != sizeof(real)) {
+    LOG(ERROR) << "Unsupported valueSize " << header.valueSize;
+    return false;
+  }
+  // the sizes are checked against the ones left, which do not overflow.
+  if (header.configOffset < sizeof(header) ||
+      header.configOffset > fileSize ||
+      header.configSize > fileSize - header.configOffset ||
+      header.numParameters >
+          (header.configOffset - sizeof(header)) / sizeof(IndexEntry)) {
+    LOG(ERROR) << filename << " is truncated or corrupted";
+    return false;
+  }
+  if (!config_.ParseFromArray(data + header.configOffset,
+                              header.configSize)) {
+    LOG(ERROR) << "Fail to parse the config in " << filename;
+    return false;
+  }
+  if (header.numParameters != (uint64_t)config_.parameters_size()) {
+    LOG(ERROR) << filename << " has " << header.numParameters
+               << " parameters, but its config has "
+               << config_.parameters_size();
+    return false;
+  }
+
+  const IndexEntry* index =
+      reinterpret_cast<const IndexEntry*>(data + sizeof(header));
+  for (uint64_t i = 0; i < header.numParameters; ++i) {
+    const ParameterConfig& paraConfig = config_.parameters(i);
+    if (index[i].size != paraConfig.size() ||
+        index[i].offset % kAlignment != 0 || index[i].offset > fileSize ||
+        index[i].size > (fileSize - index[i].offset) / sizeof(real)) {
+      LOG(ERROR) << "The value of " << paraConfig.name() << " in "
+                 << filename << " is truncated or corrupted";
+      return false;
+    }
+    index_[paraConfig.name()] = index[i];
+  }
+  return true;
+}
+
+VectorPtr MappedModel::getValue(const std::string& name) const {
+  auto it = index_.find(name);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  const IndexEntry& entry = it->second;
+  // A value which is written, as by randParameters(), gets private pages.
+  auto handle = std::make_shared<MappedMemoryHandle>(
+      file_, file_->getData() + entry.offset, entry.size * sizeof(real));
+  return std::make_shared<CpuVector>(entry.size, handle, 0);
+}
+
+GradientMachine* MappedModel::createGradientMachine() const {
+  NeuralNetwork* nn = NeuralNetwork::create(config_);
+  nn->init(config_,
+           [this](int paramId, Parameter* para) {
+             VectorPtr value = getValue(para->getName());
+             CHECK(value) << "Missing parameter " << para->getName();
+             if (para->useGpu()) {
+               para->enableType(PARAMETER_VALUE);
+               para->getBuf(PARAMETER_VALUE)->copyFrom(*value);
+             } else {
+               para->enableSharedType(PARAMETER_VALUE, value);
+             }
+           },
+           {PARAMETER_VALUE},
+           false);
+  return nn;
+}
+
+}  // namespace paddle
@@ -0,0 +1,109 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "GradientMachine.h"
+#include "ModelConfig.pb.h"
+#include "paddle/math/Vector.h"
+#include "paddle/parameter/Parameter.h"
+
+namespace paddle {
+
+class MappedFile;
+
+/**
+ * @brief A model in one file: the ModelConfig and the values of all its
+ * parameters, each starting on its own page, so that the file can be mapped
+ * and the parameters used in place.
+ *
+ * Layout:
+ *   FileHeader
+ *   IndexEntry[numParameters], in the order of ModelConfig::parameters()
+ *   serialized ModelConfig
+ *   the values of every parameter, each at an offset of kAlignment
+ *
+ * The pages of a mapped model are shared by all the processes which map the
+ * same file, and are read from disk only when first touched. The mapping is
+ * copy-on-write: a value written, by training or randomizing the parameters
+ * of a machine created from the model, gets private pages, and the file is
+ * never modified.
+ */
+class MappedModel {
+public:
+  static const int kFormatVersion = 0;
+  static const size_t kAlignment = 4096;
+
+  struct FileHeader {
+    char magic[8];       // = "PDMODEL"
+    int32_t version;     // = kFormatVersion
+    uint32_t valueSize;  // = sizeof(real)
+    uint64_t configOffset;
+    uint64_t configSize;
+    uint64_t numParameters;
+  };
+
+  struct IndexEntry {
+    uint64_t offset;  // from the beginning of the file, in bytes
+    uint64_t size;    // in values
+  };
+
+  /**
+   * @brief Write config and the values of parameters into filename.
+   *
+   * Every parameter of config must be found by name in parameters.
+   */
+  static void write(const std::string& filename,
+                    const ModelConfig& config,
+                    const std::vector<ParameterPtr>& parameters);
+
+  /// Map filename. Fails if it is not a valid model file.
+  explicit MappedModel(const std::string& filename);
+
+  /**
+   * @brief Map filename, nullptr with the error logged if it cannot be
+   * mapped or is not a valid model file.
+   */
+  static std::unique_ptr<MappedModel> load(const std::string& filename);
+
+  const ModelConfig& getConfig() const { return config_; }
+
+  /**
+   * @brief The value of a parameter, pointing into the mapping. The mapping
+   * lives as long as any of the values. nullptr if there is no such
+   * parameter.
+   */
+  VectorPtr getValue(const std::string& name) const;
+
+  /**
+   * @brief Create a network for inference, whose cpu parameters use the
+   * mapped values, and whose gpu parameters are copied from them.
+   */
+  GradientMachine* createGradientMachine() const;
+
+private:
+  MappedModel() {}
+
+  /// Map and check filename, false with the error logged if it fails.
+  bool init(const std::string& filename);
+
+  std::shared_ptr<MappedFile> file_;
+  ModelConfig config_;
+  std::unordered_map<std::string, IndexEntry> index_;
+};
+
+}  // namespace paddle
@@ -109,6 +109,23 @@ void MultiNetwork::onPassEnd() {
   }
 }
 
+bool MultiNetwork::setQuantizeWeights(bool quantize) {
+  bool supported = true;
+  for (auto& subNetwork : subNetworks_) {
+    supported = subNetwork->setQuantizeWeights(quantize) && supported;
+  }
+  return supported;
+}
+
+bool MultiNetwork::supportsForwardStep() const {
+  for (auto& subNetwork : subNetworks_) {
+    if (!subNetwork->supportsForwardStep()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void MultiNetwork::start() {
   for (auto& subNetwork : subNetworks_) {
     subNetwork->start();
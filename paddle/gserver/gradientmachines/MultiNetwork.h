@@ -46,6 +46,10 @@ public:
 
   virtual void onPassEnd();
 
+  virtual bool setQuantizeWeights(bool quantize);
+
+  virtual bool supportsForwardStep() const;
+
   virtual Evaluator* makeEvaluator() const;
 
   virtual void eval(Evaluator* evaluator) const;
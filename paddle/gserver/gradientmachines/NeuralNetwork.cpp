@@ -12,6 +12,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
+#include <numeric>
 #include "paddle/utils/Util.h"
 
 #include "paddle/utils/CustomStackTrace.h"
@@ -22,9 +23,53 @@ limitations under the License. */
 #include "RecurrentGradientMachine.h"
 #include "hl_gpu.h"
 #include "paddle/gserver/layers/AgentLayer.h"
+#include "paddle/math/Storage.h"
 #include "paddle/utils/Stat.h"
 
+DEFINE_int64(cpu_arena_size,
+             -1,
+             "Initial size in bytes of the arena holding the cpu temporaries "
+             "of one forward/backward. -1 disables the arena, 0 lets it grow "
+             "on demand. The peak size per batch is logged at the end of "
+             "each pass.");
+DEFINE_bool(reuse_inference_buffers,
+            false,
+            "In PASS_TEST, let layers whose outputs are not alive at the "
+            "same time share output buffers. Only the outputs of the network "
+            "are valid after forward.");
+
 namespace paddle {
+
+/**
+ * Bind the arena of a network to the calling thread while it runs, unless
+ * the thread already has one, i.e. the network is a sub network running
+ * inside the forward/backward of another one.
+ */
+class CpuArenaGuard {
+public:
+  explicit CpuArenaGuard(std::unique_ptr<MemoryArena>& arena) : bound_(false) {
+    if (FLAGS_cpu_arena_size < 0 ||
+        StorageEngine::singleton()->getCpuArena() != nullptr) {
+      return;
+    }
+    if (!arena) {
+      arena.reset(new MemoryArena(FLAGS_cpu_arena_size));
+    }
+    StorageEngine::singleton()->setCpuArena(arena.get());
+    bound_ = true;
+  }
+
+  ~CpuArenaGuard() {
+    if (bound_) {
+      StorageEngine::singleton()->setCpuArena(nullptr);
+    }
+  }
+
+  bool bound() const { return bound_; }
+
+private:
+  bool bound_;
+};
 void parameterInitNN(int paramId,
                      Parameter* para,
                      std::vector<ParameterPtr>* sharedParams) {
@@ -33,6 +78,7 @@ void parameterInitNN(int paramId,
     para->enableSharedType(PARAMETER_VALUE,
                            (*sharedParams)[paramId]->getBuf(PARAMETER_VALUE),
                            (*sharedParams)[paramId]->getMat(PARAMETER_VALUE));
+    para->shareValueCache(*(*sharedParams)[paramId]);
   } else {
     if (para->isSparseRemoteUpdate()) {
       para->enableType(PARAMETER_VALUE,
@@ -241,14 +287,46 @@ void NeuralNetwork::forward(const std::vector<Argument>& inArgs,
     dataLayers_[i]->setData(inArgs[i]);
   }
 
+  CpuArenaGuard arenaGuard(cpuArena_);
+  if (arenaGuard.bound()) {
+    // a new batch starts, the temporaries of the last one are all released.
+    cpuArena_->reset();
+  }
+
+  bool shareBuffers = canShareOutputBuffers(passType);
+  bool unshareBuffers = !shareBuffers;
   {
-    for (auto& layer : layers_) {
+    for (size_t i = 0; i < layers_.size(); ++i) {
+      auto& layer = layers_[i];
       REGISTER_TIMER_INFO("ForwardTimer", layer->getName().c_str());
       gLayerStackTrace.push(layer->getName());
+      int bufferId = outputBufferIds_.empty() ? -1 : outputBufferIds_[i];
+      MatrixPtr& value = layer->getOutput().value;
+      if (bufferId >= 0) {
+        // the layer gets back a buffer of its own when the plan is not used.
+        value = shareBuffers ? outputBuffers_[bufferId] : nullptr;
+      }
       layer->forward(passType);
+      if (shareBuffers && bufferId >= 0) {
+        if (outputBuffers_[bufferId] && value != outputBuffers_[bufferId]) {
+          LOG(WARNING) << "Layer " << layer->getName()
+                       << " replaced its shared output buffer, "
+                       << "disable output buffer sharing";
+          outputBufferPlanFailed_ = true;
+          shareBuffers = false;
+        }
+        outputBuffers_[bufferId] = value;
+      }
     }
   }
 
+  if (unshareBuffers) {
+    outputBufferIds_.clear();
+    outputBuffers_.clear();
+  } else if (shareBuffers && outputBufferIds_.empty()) {
+    planOutputBuffers();
+  }
+
   outArgs->clear();
   outArgs->reserve(outputLayers_.size());
   for (auto& layer : outputLayers_) {
@@ -259,12 +337,160 @@ void NeuralNetwork::forward(const std::vector<Argument>& inArgs,
   }
 }
 
+bool NeuralNetwork::canShareOutputBuffers(PassType passType) const {
+  // sub networks and layer groups may reach the outputs of any layer.
+  return FLAGS_reuse_inference_buffers && passType == PASS_TEST &&
+         !outputBufferPlanFailed_ && !FLAGS_parallel_nn &&
+         rootNetwork_ == nullptr && subModelName_.empty() &&
+         config_.sub_models_size() <= 1;
+}
+
+void NeuralNetwork::planOutputBuffers() {
+  size_t numLayers = layers_.size();
+  std::map<std::string, size_t> layerIndex;
+  for (size_t i = 0; i < numLayers; ++i) {
+    layerIndex[layers_[i]->getName()] = i;
+  }
+
+  // outputs which must survive the forward.
+  std::vector<bool> pinned(numLayers, false);
+  auto pin = [&](const std::string& name) {
+    auto it = layerIndex.find(name);
+    if (it != layerIndex.end()) {
+      pinned[it->second] = true;
+    }
+  };
+  for (auto& layer : outputLayers_) {
+    pin(layer->getName());
+  }
+  for (auto& layer : dataLayers_) {
+    pin(layer->getName());
+  }
+  for (const auto& evaluator : config_.evaluators()) {
+    for (const auto& name : evaluator.input_layers()) {
+      pin(name);
+    }
+  }
+
+  std::vector<bool> shareable(numLayers, false);
+  std::vector<size_t> sizes(numLayers, 0);
+  for (size_t i = 0; i < numLayers; ++i) {
+    const MatrixPtr& value = layers_[i]->getOutput().value;
+    if (pinned[i] || !value || value.use_count() != 1 || value->useGpu() ||
+        value->isSparse()) {
+      continue;
+    }
+    MemoryHandlePtr handle = value->getMemoryHandle();
+    if (handle && handle->getBuf() == value->getData()) {
+      shareable[i] = true;
+      sizes[i] = handle->getSize();
+    }
+  }
+
+  std::vector<std::vector<size_t>> consumers(numLayers);
+  for (const auto& layerConfig : config_.layers()) {
+    auto consumer = layerIndex.find(layerConfig.name());
+    if (consumer == layerIndex.end()) {
+      continue;
+    }
+    for (const auto& input : layerConfig.inputs()) {
+      auto producer = layerIndex.find(input.input_layer_name());
+      if (producer != layerIndex.end()) {
+        consumers[producer->second].push_back(consumer->second);
+      }
+    }
+  }
+
+  // lastUse[i] is the last layer whose forward may read the output of i.
+  std::vector<size_t> lastUse(numLayers);
+  for (size_t i = numLayers; i-- > 0;) {
+    lastUse[i] = pinned[i] ? numLayers : i;
+    for (size_t c : consumers[i]) {
+      lastUse[i] = std::max(lastUse[i], shareable[c] ? c : lastUse[c]);
+    }
+  }
+
+  // greedy interval coloring in layer order. A free buffer is chosen by
+  // best fit on the observed sizes: the smallest one which is large enough,
+  // otherwise the largest one.
+  outputBufferIds_.assign(numLayers, -1);
+  std::vector<size_t> bufferSizes;
+  std::vector<size_t> bufferFreeAfter;
+  size_t naiveSize = 0;
+  for (size_t i = 0; i < numLayers; ++i) {
+    if (!shareable[i]) {
+      continue;
+    }
+    naiveSize += sizes[i];
+    auto better = [&](size_t a, size_t b) {
+      bool fitA = bufferSizes[a] >= sizes[i];
+      bool fitB = bufferSizes[b] >= sizes[i];
+      if (fitA != fitB) {
+        return fitA;
+      }
+      return fitA ? bufferSizes[a] < bufferSizes[b]
+                  : bufferSizes[a] > bufferSizes[b];
+    };
+    int best = -1;
+    for (size_t b = 0; b < bufferSizes.size(); ++b) {
+      if (bufferFreeAfter[b] < i && (best < 0 || better(b, best))) {
+        best = b;
+      }
+    }
+    if (best < 0) {
+      best = bufferSizes.size();
+      bufferSizes.push_back(0);
+      bufferFreeAfter.push_back(0);
+    }
+    bufferSizes[best] = std::max(bufferSizes[best], sizes[i]);
+    bufferFreeAfter[best] = lastUse[i];
+    outputBufferIds_[i] = best;
+  }
+
+  // hand the current output of a layer over to its buffer, the others are
+  // released.
+  outputBuffers_.assign(bufferSizes.size(), nullptr);
+  for (size_t i = 0; i < numLayers; ++i) {
+    int bufferId = outputBufferIds_[i];
+    if (bufferId < 0) {
+      continue;
+    }
+    MatrixPtr& value = layers_[i]->getOutput().value;
+    if (!outputBuffers_[bufferId] && sizes[i] == bufferSizes[bufferId]) {
+      outputBuffers_[bufferId] = value;
+    }
+    value = nullptr;
+  }
+  size_t plannedSize =
+      std::accumulate(bufferSizes.begin(), bufferSizes.end(), (size_t)0);
+
+  LOG(INFO) << "Output buffers of " << numLayers << " layers: "
+            << outputBuffers_.size() << " shared buffers, planned size="
+            << plannedSize << " naive size=" << naiveSize;
+}
+
 void NeuralNetwork::resetState() {
   for (auto& layer : layers_) {
     layer->resetState();
   }
 }
 
+bool NeuralNetwork::setQuantizeWeights(bool quantize) {
+  for (auto& layer : layers_) {
+    layer->setQuantizeWeights(quantize);
+  }
+  return true;
+}
+
+bool NeuralNetwork::supportsForwardStep() const {
+  for (auto& layer : layers_) {
+    if (layer->isReversed()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void NeuralNetwork::setState(const MachineState& machineState) {
   for (size_t i = 0; i < layers_.size(); i++) {
     if (machineState[i] != nullptr) {
@@ -283,6 +509,7 @@ void NeuralNetwork::getState(MachineState& machineState) {
 }
 
 void NeuralNetwork::backward(const UpdateCallback& callback) {
+  CpuArenaGuard arenaGuard(cpuArena_);
   gLayerStackTrace.pop("");  // tell layer trace is during backward.
   FOR_EACH_R(layer, layers_) {
     REGISTER_TIMER_INFO("BackwardTimer", (*layer)->getName().c_str());
@@ -301,6 +528,12 @@ void NeuralNetwork::onPassEnd() {
   for (auto& layer : layers_) {
     layer->onPassEnd();
   }
+  if (cpuArena_) {
+    cpuArena_->reset();
+    LOG(INFO) << "cpu arena of " << subModelName_
+              << ": peak size per batch=" << cpuArena_->getPeakSize()
+              << " capacity=" << cpuArena_->getCapacity();
+  }
 }
 
 class CombinedEvaluator : public Evaluator {
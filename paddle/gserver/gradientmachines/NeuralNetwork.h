@@ -24,6 +24,7 @@ limitations under the License. */
 #include "paddle/gserver/layers/CostLayer.h"
 #include "paddle/gserver/layers/DataLayer.h"
 #include "paddle/gserver/layers/Layer.h"
+#include "paddle/math/MemoryArena.h"
 #include "paddle/parameter/Parameter.h"
 #include "paddle/utils/ClassRegistrar.h"
 
@@ -101,6 +102,8 @@ public:
 
   virtual void eval(Evaluator* evaluator) const;
   virtual void resetState();
+  virtual bool setQuantizeWeights(bool quantize);
+  virtual bool supportsForwardStep() const;
   virtual void setOutputGrad(const std::vector<Argument>& args);
 
   /// set machine state
@@ -129,6 +132,14 @@ public:
   static NeuralNetwork* newNeuralNetwork(const std::string& name = "",
                                          NeuralNetwork* rootNetwork = nullptr);
 
+  /**
+   * @brief The shared output buffer of each layer in PASS_TEST, -1 if the
+   *        layer owns its output. Empty until the buffers are planned.
+   */
+  const std::vector<int>& getOutputBufferIds() const {
+    return outputBufferIds_;
+  }
+
 protected:
   /**
    * The constructor of NeuralNetwork.
@@ -140,7 +151,9 @@ protected:
    */
   NeuralNetwork(std::string subModelName = "",
                 NeuralNetwork* rootNetwork = nullptr)
-      : subModelName_(subModelName), rootNetwork_(rootNetwork) {}
+      : subModelName_(subModelName),
+        rootNetwork_(rootNetwork),
+        outputBufferPlanFailed_(false) {}
 
   std::string subModelName_;
   ModelConfig config_;
@@ -158,6 +171,32 @@ protected:
   /// Whether parameter of this NN is initialized by its own
   /// (i.e., not by callback supplied with the caller)
   bool paramSelfInited_;
+
+  /// Arena for the cpu temporaries of one forward/backward. Only created
+  /// for the outermost network (see FLAGS_cpu_arena_size); sub networks
+  /// running inside its forward share it.
+  std::unique_ptr<MemoryArena> cpuArena_;
+
+  /**
+   * @brief Assign the output values of the layers to shared buffers.
+   *
+   * A layer's output is live from its forward until the forward of its
+   * last consumer, so layers with non-overlapping live ranges can share one
+   * buffer. The plan is made from the outputs of one PASS_TEST forward:
+   * only layers which produced a dense cpu matrix of their own take part,
+   * and since the others may alias their inputs, they extend the live
+   * ranges of their inputs to their own. Outputs of the network and inputs
+   * of evaluators are never shared.
+   */
+  void planOutputBuffers();
+
+  /// See FLAGS_reuse_inference_buffers.
+  bool canShareOutputBuffers(PassType passType) const;
+
+  std::vector<int> outputBufferIds_;
+  std::vector<MatrixPtr> outputBuffers_;
+  /// set if a layer did not write into its shared buffer.
+  bool outputBufferPlanFailed_;
 };
 
 }  // namespace paddle
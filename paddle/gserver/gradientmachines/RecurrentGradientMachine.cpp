@@ -17,6 +17,7 @@ limitations under the License. */
 #include <algorithm>
 #include <cmath>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include "NeuralNetwork.h"
 #include "paddle/gserver/layers/AgentLayer.h"
@@ -25,6 +26,15 @@ limitations under the License. */
 #include "paddle/utils/Util.h"
 
 DEFINE_string(diy_beam_search_prob_so, "", "the diy beam search cost so");
+DEFINE_int32(beam_search_threads,
+             1,
+             "Number of threads expanding the sequences of a batch in one "
+             "beam search step, without beam search control callbacks");
+DEFINE_bool(rnn_frame_views,
+            true,
+            "Let the frames of a recurrent layer group write their outputs "
+            "in place into the buffers of the group, and share inputs and "
+            "outputs whose rows are already in order, instead of copying");
 
 static const char* DIY_CALC_PROB_SYMBOL_NAME = "calc_prob";
 static const char* DIY_START_CALC_PROB_SYMBOL_NAME = "start_calc_prob";
@@ -325,6 +335,7 @@ void RecurrentGradientMachine::resizeOrCreateFrames(int numFrames) {
     para->enableSharedType(PARAMETER_VALUE,
                            this->parameters_[paramId]->getBuf(PARAMETER_VALUE),
                            this->parameters_[paramId]->getMat(PARAMETER_VALUE));
+    para->shareValueCache(*this->parameters_[paramId]);
     para->enableSharedType(
         PARAMETER_GRADIENT,
         this->parameters_[paramId]->getBuf(PARAMETER_GRADIENT),
@@ -471,6 +482,7 @@ void RecurrentGradientMachine::forward(const std::vector<Argument>& inArgs,
       int curInlinkId = shareInlinkInfo ? 0 : i;
       selectRowsOneTime(inFrameLines_[i].inLayer,
                         info_[curInlinkId].allIds,
+                        info_[curInlinkId].inOrder,
                         &(inFrameLines_[i].outArg),
                         passType);
     }
@@ -549,6 +561,15 @@ void RecurrentGradientMachine::forward(const std::vector<Argument>& inArgs,
     }
   }
 
+  if (FLAGS_rnn_frame_views) {
+    for (auto& outFrameLine : outFrameLines_) {
+      auto gatherAgent =
+          dynamic_cast<GatherAgentLayer*>(outFrameLine.agentLayer.get());
+      gatherAgent->bindRealLayerOutputs(info_[targetInfoInlinkId_].inOrder,
+                                        passType);
+    }
+  }
+
   REGISTER_TIMER_INFO("RecurrentFwTime", "RecurrentFwTime");
   // forward
   for (auto& memoryFrameLine : memoryFrameLines_) {
@@ -706,7 +727,8 @@ void RecurrentGradientMachine::createInFrameInfo(int inlinkId,
   }
 
   // copy and check scatterId
-  copyScattedId(allIds, &inlinkInfo->allIds, input.getBatchSize());
+  inlinkInfo->inOrder =
+      copyScattedId(allIds, &inlinkInfo->allIds, input.getBatchSize());
   CHECK_EQ(inlinkInfo->idIndex.size(),
            static_cast<size_t>(maxSequenceLength_ + 1));
 }
@@ -743,15 +765,17 @@ void RecurrentGradientMachine::createMemoryFrameInfo(
     }
   }
   // copy and check scatterId
-  copyScattedId(allIds, &(*memoryFrameLine).allIds, input.getBatchSize());
+  bool inOrder =
+      copyScattedId(allIds, &(*memoryFrameLine).allIds, input.getBatchSize());
   // memoryFrameLine select rows in real layer one time
   selectRowsOneTime((*memoryFrameLine).rootLayer,
                     (*memoryFrameLine).allIds,
+                    inOrder,
                     &(*memoryFrameLine).outArg,
                     passType);
 }
 
-void RecurrentGradientMachine::copyScattedId(std::vector<int>& srcIds,
+bool RecurrentGradientMachine::copyScattedId(std::vector<int>& srcIds,
                                              IVectorPtr* dstIds,
                                              int size) {
   int idSize = srcIds.size();
@@ -759,25 +783,49 @@ void RecurrentGradientMachine::copyScattedId(std::vector<int>& srcIds,
   IVector::resizeOrCreate(*dstIds, idSize, useGpu_);
   (*dstIds)->copyFrom(srcIds.data(), idSize);
   // check
-  std::sort(srcIds.begin(), srcIds.end());
+  bool inOrder = std::is_sorted(srcIds.begin(), srcIds.end());
+  if (!inOrder) {
+    std::sort(srcIds.begin(), srcIds.end());
+  }
   for (int i = 0; i < idSize; ++i) {
     CHECK_EQ(srcIds[i], i);
   }
+  return inOrder;
 }
 
 void RecurrentGradientMachine::selectRowsOneTime(LayerPtr layer,
                                                  const IVectorPtr& allIds,
+                                                 bool inOrder,
                                                  Argument* arg,
                                                  PassType passType) {
   Argument& src = layer->getOutput();
+  if (inOrder && FLAGS_rnn_frame_views &&
+      (src.grad || passType == PASS_TEST)) {
+    // the frames read and write the rows of the real layer in place. The
+    // views own no memory, so resizing them later does not touch the rows.
+    auto view = [this](const MatrixPtr& m) -> MatrixPtr {
+      return m ? Matrix::create(m->getData(),
+                                m->getHeight(),
+                                m->getWidth(),
+                                /* trans */ false,
+                                useGpu_)
+               : nullptr;
+    };
+    arg->value = view(src.value);
+    arg->grad = passType != PASS_TEST ? view(src.grad) : nullptr;
+    arg->ids = src.ids ? IVector::create(
+                             src.ids->getData(), src.ids->getSize(), useGpu_)
+                       : nullptr;
+    return;
+  }
   if (src.value) {
     const MatrixPtr& realV = src.value;
     int height = realV->getHeight();
     int width = realV->getWidth();
     Matrix::resizeOrCreate(
         arg->value, height, width, /* trans */ false, useGpu_);
-    arg->value->zeroMem();
-    arg->value->selectRows(*realV, *allIds);
+    arg->value->copyByRowIndex(*realV, *allIds);
+    addFrameCopyBytes(*arg->value);
     if (passType != PASS_TEST) {
       Matrix::resizeOrCreate(
           arg->grad, height, width, /* trans */ false, useGpu_);
@@ -1105,6 +1153,11 @@ void RecurrentGradientMachine::beamExpand(std::vector<Path>& paths,
   // so user can drop some node customly.
   CHECK_EQ(cpuId_->getSize() % candidatePathCount, 0UL);
   size_t expandWidth = cpuId_->getSize() / candidatePathCount;
+  if (!beamSearchCtrlCallbacks_ && !gDiyProbMethod && !gDiyProbStart &&
+      !gDiyProbStop) {
+    batchBeamExpand(paths, newPaths, expandWidth);
+    return;
+  }
 
   // iterate over each sequence
   size_t totalExpandCount = 0;
@@ -1123,6 +1176,110 @@ void RecurrentGradientMachine::beamExpand(std::vector<Path>& paths,
   }  // for paths
 }
 
+void RecurrentGradientMachine::batchBeamExpand(std::vector<Path>& paths,
+                                               std::vector<Path>& newPaths,
+                                               size_t expandWidth) {
+  candidates_.resize(paths.size() * expandWidth);
+  // the paths of a sequence are contiguous.
+  std::vector<size_t> starts;
+  for (size_t j = 0; j < paths.size(); ++j) {
+    if (j == 0 || paths[j].seqId != paths[j - 1].seqId) {
+      starts.push_back(j);
+    }
+  }
+  starts.push_back(paths.size());
+  size_t numSequences = starts.size() - 1;
+  sequencePaths_.resize(std::max(sequencePaths_.size(), numSequences));
+
+  auto expand = [&](size_t i) {
+    expandSequence(
+        paths, starts[i], starts[i + 1], expandWidth, sequencePaths_[i]);
+  };
+  if (FLAGS_beam_search_threads > 1 && numSequences > 1) {
+    if (!beamSearchPool_ ||
+        beamSearchPool_->getNumThreads() + 1 !=
+            (size_t)FLAGS_beam_search_threads) {
+      beamSearchPool_.reset(new SyncThreadPool(FLAGS_beam_search_threads - 1,
+                                               /* checkOwner= */ false));
+    }
+    beamSearchPool_->execPlusOwner([&](int tid, size_t numThreads) {
+      for (size_t i = tid; i < numSequences; i += numThreads + 1) {
+        expand(i);
+      }
+    });
+  } else {
+    for (size_t i = 0; i < numSequences; ++i) {
+      expand(i);
+    }
+  }
+
+  for (size_t i = 0; i < numSequences; ++i) {
+    std::move(sequencePaths_[i].begin(),
+              sequencePaths_[i].end(),
+              std::back_inserter(newPaths));
+  }
+}
+
+void RecurrentGradientMachine::expandSequence(std::vector<Path>& paths,
+                                              size_t begin,
+                                              size_t end,
+                                              size_t expandWidth,
+                                              std::vector<Path>& newPaths) {
+  const int* idVec = cpuId_->getData();
+  const real* probMat = cpuProb_->getData();
+  const int* eosVec = cpuEos_->getData();
+  bool logProb = generator_.config.log_prob();
+  size_t seqId = paths[begin].seqId;
+
+  Candidate* candidates = candidates_.data() + begin * expandWidth;
+  size_t numCandidates = 0;
+  for (size_t j = begin; j < end; ++j) {
+    Path& curPath = paths[j];
+    for (size_t k = 0; k < expandWidth; ++k) {
+      size_t index = j * expandWidth + k;
+      if (idVec[index] == -1) break;  // see singlePathExpand()
+      real newLogProb = logProb ? std::log(probMat[index]) : probMat[index];
+      real pathLogProb = curPath.logProb + newLogProb;
+      if (std::isinf(pathLogProb) && pathLogProb < 0) continue;
+      if (eosVec[index] == 1 ||
+          curPath.ids.size() + 1 >= (size_t)maxSequenceLength_) {
+        finalPaths_[seqId].emplace_back(
+            curPath, idVec[index], newLogProb, j, k);
+        if (dataArgsSize_) {
+          finalPaths_[seqId].back().machineIdVec = curPath.machineIdVec;
+          finalPaths_[seqId].back().machineIdVec.push_back(j);
+        }
+      } else {
+        candidates[numCandidates++] = {pathLogProb, (int)j, (int)k};
+      }
+    }
+  }
+
+  size_t numRetained = std::min(getBeamSize(), numCandidates);
+  std::nth_element(candidates,
+                   candidates + numRetained,
+                   candidates + numCandidates,
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.logProb > b.logProb;
+                   });
+  newPaths.clear();
+  for (size_t i = 0; i < numRetained; ++i) {
+    Path& curPath = paths[candidates[i].pathId];
+    size_t index = candidates[i].pathId * expandWidth + candidates[i].topIndex;
+    real newLogProb = logProb ? std::log(probMat[index]) : probMat[index];
+    newPaths.emplace_back(curPath,
+                          idVec[index],
+                          newLogProb,
+                          candidates[i].pathId,
+                          candidates[i].topIndex);
+    if (dataArgsSize_) {
+      newPaths.back().machineIdVec = curPath.machineIdVec;
+      newPaths.back().machineIdVec.push_back(candidates[i].pathId);
+    }
+  }
+  beamShrink(newPaths, seqId, 0);
+}
+
 // Drop extra nodes to beam size.
 size_t RecurrentGradientMachine::beamShrink(std::vector<Path>& newPaths,
                                             size_t seqId,
@@ -19,6 +19,7 @@ limitations under the License. */
 #include "NeuralNetwork.h"
 
 #include "paddle/utils/Locks.h"
+#include "paddle/utils/Thread.h"
 
 namespace paddle {
 
@@ -335,6 +336,7 @@ protected:
     ICpuGpuVectorPtr
         sequenceStartPositions;         // scattered sequenceStartPositions
     std::vector<int> seqStartPosIndex;  // index of sequenceStartPositions
+    bool inOrder;  // allIds are the rows of realLayer in order
   };
   std::vector<Info> info_;
 
@@ -358,10 +360,13 @@ protected:
   void createMemoryFrameInfo(MemoryFrameLine* memoryFrameLine,
                              PassType passType);
 
-  void copyScattedId(std::vector<int>& srcIds, IVectorPtr* dstIds, int size);
+  // return whether srcIds are in order, and the frames can use the rows of
+  // the real layer as they are.
+  bool copyScattedId(std::vector<int>& srcIds, IVectorPtr* dstIds, int size);
 
   void selectRowsOneTime(LayerPtr layer,
                          const IVectorPtr& allIds,
+                         bool inOrder,
                          Argument* arg,
                          PassType passType);
 
@@ -493,6 +498,38 @@ private:
    */
   void beamExpand(std::vector<Path>& paths, std::vector<Path>& newPaths);
 
+  /*
+   * @brief An expansion of a path, scored before it becomes a Path, which
+   * only the expansions kept in the beam do.
+   */
+  struct Candidate {
+    real logProb;
+    int pathId;    // index of the expanded path
+    int topIndex;  // index of MaxIdLayer output in one sample
+  };
+
+  /*
+   * @brief beamExpand() without control callbacks nor DIY probabilities.
+   * The expansions of all paths are scored in one buffer, each sequence
+   * keeps its best ones with a partial selection, and the sequences of the
+   * batch are expanded in parallel with --beam_search_threads.
+   * @param expandWidth : number of expansions of each path
+   */
+  void batchBeamExpand(std::vector<Path>& paths,
+                       std::vector<Path>& newPaths,
+                       size_t expandWidth);
+
+  /*
+   * @brief expand the paths [begin, end) of one sequence, which are all
+   * of the paths of the sequence, and reduce them to beam size.
+   * @param newPaths : receive the retained paths of the sequence
+   */
+  void expandSequence(std::vector<Path>& paths,
+                      size_t begin,
+                      size_t end,
+                      size_t expandWidth,
+                      std::vector<Path>& newPaths);
+
   /*
    * @brief fill sequence start positions and some other information that are
    * uesed by the "text_printer" evaluator.
@@ -505,6 +542,9 @@ private:
   std::vector<int> batchMachineIdVec_;
   std::vector<std::vector<Path>> finalPaths_;
   std::vector<real> minFinalPathLogProb_;
+  std::vector<Candidate> candidates_;
+  std::vector<std::vector<Path>> sequencePaths_;
+  std::unique_ptr<SyncThreadPool> beamSearchPool_;
   BeamSearchControlCallbacks* beamSearchCtrlCallbacks_;
   BeamSearchStatisticsCallbacks* beamSearchStatistics_;
 };
@@ -14,12 +14,21 @@ limitations under the License. */
 
 #include "AgentLayer.h"
 
+#include <atomic>
 #include "paddle/utils/Logging.h"
 
 #include "paddle/utils/Stat.h"
 
 namespace paddle {
 
+static std::atomic<int64_t> frameCopyBytes(0);
+
+int64_t getFrameCopyBytes() { return frameCopyBytes; }
+
+void addFrameCopyBytes(const Matrix& matrix) {
+  frameCopyBytes += matrix.getElementCnt() * sizeof(real);
+}
+
 REGISTER_LAYER(agent, AgentLayer);
 
 bool AgentLayer::init(const LayerMap& layerMap,
@@ -99,6 +108,78 @@ void GatherAgentLayer::copyIdAndSequenceInfo(const Argument& input,
   realLayers_.clear();
   allIds_ = ids;
   idIndex_ = idIndex;
+  framesBound_ = false;
+}
+
+// numRows rows of buffer from startRow, which stay in place when the layer
+// owning them resizes them.
+static MatrixPtr frameRows(const MatrixPtr& buffer,
+                           size_t startRow,
+                           size_t numRows) {
+  const MemoryHandlePtr& handle = buffer->getMemoryHandle();
+  CHECK(handle);
+  size_t width = buffer->getWidth();
+  size_t offset = (buffer->getData() + startRow * width -
+                   reinterpret_cast<real*>(handle->getBuf())) *
+                  sizeof(real);
+  return Matrix::create(
+      createSubMemoryHandle(handle, offset, numRows * width * sizeof(real)),
+      numRows,
+      width);
+}
+
+static bool holdsFrameRows(const MatrixPtr& matrix,
+                           const MatrixPtr& buffer,
+                           size_t startRow,
+                           size_t numRows) {
+  return matrix && matrix->getHeight() == numRows &&
+         matrix->getData() == buffer->getData() + startRow * buffer->getWidth();
+}
+
+void GatherAgentLayer::detachFrameBuffers() {
+  if (output_.value == frameValue_) {
+    output_.value = nullptr;
+  }
+  if (output_.grad == frameGrad_) {
+    output_.grad = nullptr;
+  }
+}
+
+void GatherAgentLayer::bindRealLayerOutputs(bool inOrder, PassType passType) {
+  int height = allIds_->getSize();
+  int width = this->getSize();
+  CHECK_EQ(realLayers_.size() + 1, idIndex_.size());
+  detachFrameBuffers();
+  bool useOutput = inOrder && output_.value;
+  if (useOutput) {
+    // the output may be a view given by an enclosing group, then the real
+    // layers write straight into the buffer of that group.
+    frameValue_ = output_.value;
+    frameGrad_ = output_.grad;
+  } else {
+    frameValue_ = ownFrameValue_;
+    frameGrad_ = ownFrameGrad_;
+  }
+  Matrix::resizeOrCreate(frameValue_, height, width, false, useGpu_);
+  if (passType != PASS_TEST) {
+    Matrix::resizeOrCreate(frameGrad_, height, width, false, useGpu_);
+    frameGrad_->zeroMem();
+  }
+  if (!useOutput) {
+    ownFrameValue_ = frameValue_;
+    ownFrameGrad_ = frameGrad_;
+  }
+
+  for (size_t i = 0; i < realLayers_.size(); ++i) {
+    Argument& realOutput = realLayers_[i]->getOutput();
+    int numRows = idIndex_[i + 1] - idIndex_[i];
+    realOutput.value = frameRows(frameValue_, idIndex_[i], numRows);
+    if (frameGrad_) {
+      realOutput.grad = frameRows(frameGrad_, idIndex_[i], numRows);
+    }
+  }
+  inOrder_ = inOrder;
+  framesBound_ = true;
 }
 
 void GatherAgentLayer::forward(PassType passType) {
@@ -106,6 +187,28 @@ void GatherAgentLayer::forward(PassType passType) {
 
   int height = allIds_->getSize();
   int width = this->getSize();
+  if (framesBound_) {
+    for (size_t i = 0; i < realLayers_.size(); ++i) {
+      const MatrixPtr& realV = realLayers_[i]->getOutputValue();
+      int numRows = idIndex_[i + 1] - idIndex_[i];
+      if (!holdsFrameRows(realV, frameValue_, idIndex_[i], numRows)) {
+        frameValue_->subMatrix(idIndex_[i], realV->getHeight())
+            ->copyFrom(*realV);
+        addFrameCopyBytes(*realV);
+      }
+    }
+    if (inOrder_) {
+      output_.value = frameValue_;
+      output_.grad = frameGrad_;
+    } else {
+      resetOutput(height, width);
+      frameValue_->addToRows(*getOutputValue(), *allIds_);
+      addFrameCopyBytes(*frameValue_);
+    }
+    return;
+  }
+
+  detachFrameBuffers();
   resetOutput(height, width);
   idsVec_.resize(idIndex_.size());
 
@@ -117,6 +220,7 @@ void GatherAgentLayer::forward(PassType passType) {
                                  /* size */ realV->getHeight(),
                                  useGpu_);
     realV->addToRows(*outV, *idsVec_[i]);
+    addFrameCopyBytes(*realV);
   }
 }
 
@@ -124,10 +228,27 @@ void GatherAgentLayer::backward(const UpdateCallback& callback) {
   (void)callback;
   const MatrixPtr& outputGrad = getOutputGrad();
 
+  if (framesBound_) {
+    if (!inOrder_ && outputGrad) {
+      frameGrad_->selectRows(*outputGrad, *allIds_);
+      addFrameCopyBytes(*frameGrad_);
+    }
+    for (size_t i = 0; i < realLayers_.size(); ++i) {
+      const MatrixPtr& realG = realLayers_[i]->getOutputGrad();
+      int numRows = idIndex_[i + 1] - idIndex_[i];
+      if (realG && !holdsFrameRows(realG, frameGrad_, idIndex_[i], numRows)) {
+        realG->add(*frameGrad_->subMatrix(idIndex_[i], realG->getHeight()));
+        addFrameCopyBytes(*realG);
+      }
+    }
+    return;
+  }
+
   for (size_t i = 0; i < realLayers_.size(); ++i) {
     const MatrixPtr& realG = realLayers_[i]->getOutputGrad();
     if (realG) {
       realG->selectRows(*outputGrad, *idsVec_[i]);
+      addFrameCopyBytes(*realG);
     }
   }
 }
@@ -162,6 +283,7 @@ void ScatterAgentLayer::forward(PassType passType) {
       const MatrixPtr& outV = getOutputValue();
       const MatrixPtr& realV = realLayer_->getOutputValue();
       outV->selectRows(*realV, *ids_);
+      addFrameCopyBytes(*outV);
     }
   }
 }
@@ -173,9 +295,11 @@ void ScatterAgentLayer::backward(const UpdateCallback& callback) {
   const MatrixPtr& realGrad = realLayer_->getOutputGrad();
   if (realGrad) {
     // for agent in inFrameLines and memoryFrameLines,
-    // only first scatterAgentLayer should do addToRows in backward
-    if (idIndex_ == 0) {
+    // only first scatterAgentLayer should do addToRows in backward.
+    // Nothing to do if the frames shared the gradient of the real layer.
+    if (idIndex_ == 0 && outputGrad->getData() != realGrad->getData()) {
       outputGrad->addToRows(*realGrad, *ids_);
+      addFrameCopyBytes(*outputGrad);
     }
   }
 }
@@ -281,6 +405,7 @@ void SequenceScatterAgentLayer::forward(PassType passType) {
 
     outputValue->copyByRowIndex(*input.value,
                                 *inputStartPos_->getVector(useGpu_));
+    addFrameCopyBytes(*outputValue);
   }
 }
 
@@ -20,6 +20,13 @@ limitations under the License. */
 
 namespace paddle {
 
+/**
+ * Bytes of values and gradients copied between the recurrent layer groups
+ * and their frames since the process started, for benchmarks.
+ */
+int64_t getFrameCopyBytes();
+void addFrameCopyBytes(const Matrix& matrix);
+
 /**
  * AgentLayer use as a virtual input of another layer in config,
  * before execute forward/backward, setRealLayer() should be
@@ -73,6 +80,18 @@ protected:
   // we don't clear idsVec_ vector to aviod IVector alloc/free
   IVectorPtr allIds_;
   std::vector<int> idIndex_;
+  // real layers write their outputs in place into the rows of these, in the
+  // order of allIds_, when bound by bindRealLayerOutputs(). They are either
+  // the output or the buffers owned by the layer.
+  MatrixPtr frameValue_;
+  MatrixPtr frameGrad_;
+  MatrixPtr ownFrameValue_;
+  MatrixPtr ownFrameGrad_;
+  bool framesBound_ = false;
+  bool inOrder_ = false;
+
+  // stop using the buffers of the real layers as output
+  void detachFrameBuffers();
 
 public:
   explicit GatherAgentLayer(const LayerConfig& config) : Layer(config) {}
@@ -90,6 +109,17 @@ public:
   // add one real layer, can call many times
   void addRealLayer(LayerPtr layer) { realLayers_.push_back(layer); }
 
+  /**
+   * @brief Give the real layers views of consecutive rows of one buffer as
+   *        outputs, so that they write in place. Call after all real layers
+   *        are added and before they forward.
+   *
+   * If inOrder, the rows of allIds are in order and the buffer becomes the
+   * output, otherwise it is gathered at once. A real layer which replaces
+   * its view is copied.
+   */
+  void bindRealLayerOutputs(bool inOrder, PassType passType);
+
   void forward(PassType passType) override;
   void backward(const UpdateCallback& callback) override;
 };
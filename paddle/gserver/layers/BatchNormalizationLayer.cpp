@@ -17,6 +17,7 @@ limitations under the License. */
 #include "hl_batch_transpose.h"
 #endif
 #include "BatchNormalizationLayer.h"
+#include "paddle/math/MathUtils.h"
 
 namespace paddle {
 
@@ -97,21 +98,8 @@ void BatchNormalizationLayer::expandMat(const MatrixPtr& in, MatrixPtr& out) {
         in->getData(), out->getData(), imgPixels_, channels_, batchSize);
 #endif
   } else {
-    for (size_t i = 0; i < batchSize; i++) {
-      const MatrixPtr inTmp =
-          Matrix::create(in->getData() + i * imgPixels_ * channels_,
-                         channels_,
-                         imgPixels_,
-                         false,
-                         useGpu_);
-      MatrixPtr outTmp =
-          Matrix::create(out->getData() + i * imgPixels_ * channels_,
-                         imgPixels_,
-                         channels_,
-                         false,
-                         useGpu_);
-      inTmp->transpose(outTmp, false);
-    }
+    cpuBatchTranspose(
+        in->getData(), out->getData(), imgPixels_, channels_, batchSize);
   }
 }
 
@@ -134,20 +122,8 @@ void BatchNormalizationLayer::shrinkMat(const MatrixPtr& in, MatrixPtr& out) {
         in->getData(), out->getData(), channels_, imgPixels_, batchSize);
 #endif
   } else {
-    for (size_t i = 0; i < batchSize; i++) {
-      const MatrixPtr inTmp =
-          Matrix::create(in->getData() + i * channels_ * imgPixels_,
-                         imgPixels_,
-                         channels_,
-                         false,
-                         useGpu_);
-      MatrixPtr outTmp =
-          Matrix::create(out->getData() + i * imgPixels_ * channels_,
-                         channels_,
-                         imgPixels_,
-                         useGpu_);
-      inTmp->transpose(outTmp, false);
-    }
+    cpuBatchTranspose(
+        in->getData(), out->getData(), channels_, imgPixels_, batchSize);
   }
 }
 
@@ -121,7 +121,8 @@ void BlockExpandLayer::backward(const UpdateCallback& callback) {
     return;
   }
   MatrixPtr grad = getOutputGrad();
-  MatrixPtr gradTrans = Matrix::create(blockSize, blockNum, false, useGpu_);
+  MatrixPtr gradTrans =
+      Matrix::create(blockSize, blockNum, false, useGpu_, /* tmp= */ true);
   size_t batchSize = preGrad->getHeight();
 
   CHECK_EQ(batchSize * blockNum, grad->getHeight());
@@ -14,6 +14,8 @@ limitations under the License. */
 
 #include "ExpandConvBaseLayer.h"
 
+#include "paddle/math/SIMDFunctions.h"
+#include "paddle/math/Storage.h"
 #include "paddle/utils/Logging.h"
 namespace paddle {
 
@@ -62,7 +64,31 @@ size_t ExpandConvBaseLayer::getOutputSize() {
 }
 
 void ExpandConvBaseLayer::resetExpandInput(size_t height, size_t width) {
-  Matrix::resizeOrCreate(expandInput_, height, width, false, useGpu_);
+  resetScratch(expandInput_, height, width, useGpu_);
+}
+
+void ExpandConvBaseLayer::resetScratch(MatrixPtr &mat,
+                                       size_t height,
+                                       size_t width,
+                                       bool useGpu) {
+  if (useGpu || (mat && mat->getMemoryHandle()->getSize() >=
+                            height * width * sizeof(real))) {
+    Matrix::resizeOrCreate(mat, height, width, false, useGpu);
+  } else {
+    // resize() would take the larger buffer from the pool, not the arena.
+    mat = Matrix::create(height, width, false, false, /* tmp= */ true);
+  }
+}
+
+void ExpandConvBaseLayer::releaseScratch() {
+  // without an arena the temporaries come from the pool, and are kept.
+  if (useGpu_ || !StorageEngine::singleton()->getCpuArena()) {
+    return;
+  }
+  expandInput_.reset();
+  transOutValue_.reset();
+  transExpandInput_.reset();
+  transGroupOut_.reset();
 }
 
 void ExpandConvBaseLayer::addSharedBias() {
@@ -71,7 +97,7 @@ void ExpandConvBaseLayer::addSharedBias() {
   MatrixPtr out =
       Matrix::create(getOutputValue()->getData(), mapH, mapW, false, useGpu_);
 
-  Matrix::resizeOrCreate(transOutValue_, mapW, mapH, false, useGpu_);
+  resetScratch(transOutValue_, mapW, mapH, useGpu_);
 
   out->transpose(transOutValue_, false);  // false means no memory allocation
   transOutValue_->reshape(transOutValue_->getElementCnt() / numFilters_,
@@ -165,6 +191,40 @@ void ExpandConvBaseLayer::expandFwdOnce(MatrixPtr image,
   }
 }
 
+void ExpandConvBaseLayer::expandFwdOnceQuantized(MatrixPtr image,
+                                                 MatrixPtr out,
+                                                 int inIdx,
+                                                 int startIdx) {
+  CHECK(!isDeconv_);
+  int subM = subM_[inIdx];
+  int subN = subN_[inIdx];
+  int subK = subK_[inIdx];
+
+  expandOneFrame(image, startIdx, inIdx);
+
+  // W * X is computed as (X^T * W^T)^T, so that the rows which are rounded
+  // to int8 one by one are the output pixels.
+  resetScratch(transExpandInput_, subN, subK, false);
+  resetScratch(transGroupOut_, subN, subM, false);
+  auto &transIn = static_cast<CpuMatrix &>(*transExpandInput_);
+  auto &transOut = static_cast<CpuMatrix &>(*transGroupOut_);
+
+  real *outData = out->getData() + startIdx * subN * numFilters_;
+  real *expInData = expandInput_->getData();
+  for (int g = 0; g < groups_[inIdx]; ++g) {
+    simd::transpose(transIn.getData(), subK, expInData, subN, subK, subN);
+    weights_[inIdx]->getQuantizedW(g).mul(transOut, transIn, nullptr, 0);
+    const real *t = transOut.getData();
+    for (int m = 0; m < subM; ++m) {
+      for (int n = 0; n < subN; ++n) {
+        outData[m * subN + n] += t[n * subM + m];
+      }
+    }
+    expInData += subK * subN;
+    outData += subM * subN;
+  }
+}
+
 void ExpandConvBaseLayer::bpropActs(MatrixPtr out,
                                     MatrixPtr image,
                                     int inpIdx) {
@@ -273,7 +333,7 @@ void ExpandConvBaseLayer::bpropSharedBias(MatrixPtr biases, MatrixPtr v) {
   size_t mapH = v->getElementCnt() / mapW;
   MatrixPtr vTmp = Matrix::create(v->getData(), mapH, mapW, false, useGpu_);
 
-  Matrix::resizeOrCreate(transOutValue_, mapW, mapH, false, useGpu_);
+  resetScratch(transOutValue_, mapW, mapH, useGpu_);
 
   vTmp->transpose(transOutValue_, false);  // false means no memory allocation
   transOutValue_->reshape(transOutValue_->getElementCnt() / numFilters_,
@@ -37,10 +37,18 @@ protected:
   /*The expandInput_ and transOutValue_ are used for CPU expand conv calc
    * Expand one sample at a time. shape:
    * (numChannels * filterPixels_, outputSizeH * outputSizeW)
+   *
+   * The scratch matrices are set by resetScratch(). On cpu they are taken
+   * from the arena of the batch when one is bound to the thread, and
+   * releaseScratch() drops them at the end of forward() and backward().
    * */
   MatrixPtr expandInput_;
   /// The transpose of output, which is an auxiliary matrix.
   MatrixPtr transOutValue_;
+  /// The transposes of expandInput_ and of the output of a group, for
+  /// expandFwdOnceQuantized().
+  MatrixPtr transExpandInput_;
+  MatrixPtr transGroupOut_;
 
 public:
   explicit ExpandConvBaseLayer(const LayerConfig& config)
@@ -57,6 +65,18 @@ public:
    */
   void resetExpandInput(size_t height, size_t width);
 
+  /**
+   * Resize a scratch matrix, which is created as a temporary (tmp = true)
+   * when it is too small.
+   */
+  void resetScratch(MatrixPtr& mat, size_t height, size_t width, bool useGpu);
+
+  /**
+   * Drop the cpu scratch matrices if they are from the arena of the batch,
+   * which they must not outlive.
+   */
+  void releaseScratch();
+
   /**
    * Add shared bias.
    */
@@ -76,6 +96,15 @@ public:
    */
   void expandFwdOnce(MatrixPtr image, MatrixPtr out, int inIdx, int startIdx);
 
+  /**
+   * expandFwdOnce() by the int8 weights of Weight::prepareQuantizedW(),
+   * which holds a block of subK x subM per group.
+   */
+  void expandFwdOnceQuantized(MatrixPtr image,
+                              MatrixPtr out,
+                              int inIdx,
+                              int startIdx);
+
   void bpropSharedBias(MatrixPtr biases, MatrixPtr v);
   void bpropBiases(MatrixPtr v);
   void bpropWeights(MatrixPtr image, MatrixPtr out, int inpIdx);
@@ -39,9 +39,15 @@ void ExpandConvLayer::forward(PassType passType) {
   for (size_t i = 0; i < inputLayers_.size(); ++i) {
     LayerPtr prevLayer = getPrev(i);
     image = prevLayer->getOutputValue();
+    bool quantized = weights_[i]->prepareQuantizedW(
+        quantizeWeights_, passType, subK_[i], subM_[i], true);
     for (size_t off = 0; off < image->getHeight(); off++) {
       REGISTER_TIMER_INFO("expandFwdOnce", getName().c_str());
-      expandFwdOnce(image, outV, i, off);
+      if (quantized) {
+        expandFwdOnceQuantized(image, outV, i, off);
+      } else {
+        expandFwdOnce(image, outV, i, off);
+      }
     }
   }
   /* add the bias-vector */
@@ -55,6 +61,7 @@ void ExpandConvLayer::forward(PassType passType) {
 
   /* activation */
   forwardActivation();
+  releaseScratch();
 }
 
 void ExpandConvLayer::backward(const UpdateCallback &callback) {
@@ -79,6 +86,7 @@ void ExpandConvLayer::backward(const UpdateCallback &callback) {
       weights_[i]->getParameterPtr()->incUpdate(callback);
     }
   }
+  releaseScratch();
 }
 
 }  // namespace paddle
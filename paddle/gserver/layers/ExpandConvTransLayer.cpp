@@ -59,6 +59,7 @@ void ExpandConvTransLayer::forward(PassType passType) {
 
   /* activation */
   forwardActivation();
+  releaseScratch();
 }
 
 void ExpandConvTransLayer::backward(const UpdateCallback &callback) {
@@ -85,6 +86,7 @@ void ExpandConvTransLayer::backward(const UpdateCallback &callback) {
       weights_[i]->getParameterPtr()->incUpdate(callback);
     }
   }
+  releaseScratch();
 }
 
 }  // namespace paddle
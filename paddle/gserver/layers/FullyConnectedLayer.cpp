@@ -79,19 +79,43 @@ void FullyConnectedLayer::forward(PassType passType) {
   }
 
   MatrixPtr outV = getOutputValue();
+  // an int8 mul adds the bias while it stores its product, only once.
+  MatrixPtr bias = biases_ ? biases_->getW() : nullptr;
 
   for (size_t i = 0; i != inputLayers_.size(); ++i) {
     auto input = getInput(i);
     CHECK(input.value) << "The input of 'fc' layer must be matrix";
     REGISTER_TIMER_INFO("FwMulTimer", getName().c_str());
+    if (typeid(*input.value) == typeid(CpuMatrix) &&
+        weights_[i]->prepareQuantizedW(quantizeWeights_,
+                                       passType,
+                                       input.value->getWidth(),
+                                       size,
+                                       false)) {
+      bool fuseBias = bias && typeid(*bias) == typeid(CpuMatrix);
+      weights_[i]->getQuantizedW().mul(
+          static_cast<CpuMatrix&>(*outV),
+          static_cast<CpuMatrix&>(*input.value),
+          fuseBias ? static_cast<CpuMatrix*>(bias.get()) : nullptr,
+          i == 0 ? 0 : 1);
+      if (fuseBias) bias = nullptr;
+      continue;
+    }
+    weights_[i]->preparePackedW(passType);
     i == 0 ? outV->mul(*input.value, *weights_[i]->getW(), 1, 0)
            : outV->mul(*input.value, *weights_[i]->getW(), 1, 1);
   }
 
+  if (canFuseEpilogue()) {
+    REGISTER_TIMER_INFO("FwEpilogueTimer", getName().c_str());
+    forwardFusedEpilogue(bias);
+    return;
+  }
+
   /* add the bias-vector */
-  if (biases_.get() != NULL) {
+  if (bias) {
     REGISTER_TIMER_INFO("FwBiasTimer", getName().c_str());
-    outV->addBias(*(biases_->getW()), 1);
+    outV->addBias(*bias, 1);
   }
 
   /* activation */ {
@@ -14,6 +14,8 @@ limitations under the License. */
 
 #include "GruCompute.h"
 #include "hl_recurrent_apply.cuh"
+#include "paddle/math/MathFunctions.h"
+#include "paddle/math/SIMDFunctions.h"
 #include "paddle/utils/Util.h"
 
 namespace paddle {
@@ -23,8 +25,57 @@ void GruCompute::init(LayerConfig &config) {
   activeGate_ = hlActiveType(config.active_gate_type());
 }
 
+/**
+ * With sigmoid gates, the elementwise parts of a step run over the whole
+ * batch in fused passes (simd::gruResetOutput() and the others), between the
+ * same gemms as hl_cpu_gru_forward() and hl_cpu_gru_backward().
+ */
 template <>
 void GruCompute::forward<0>(hl_gru_value value, int frameSize, int batchSize) {
+  if (activeGate_ == HL_ACTIVATION_SIGMOID) {
+    if (value.prevOutValue) {
+      gemm<real>(CblasNoTrans,
+                 CblasNoTrans,
+                 batchSize,
+                 frameSize * 2,
+                 frameSize,
+                 1,
+                 value.prevOutValue,
+                 frameSize,
+                 value.gateWeight,
+                 frameSize * 2,
+                 1,
+                 value.gateValue,
+                 frameSize * 3);
+    }
+    simd::gruResetOutput(value.gateValue,
+                         value.prevOutValue,
+                         value.resetOutputValue,
+                         frameSize,
+                         batchSize);
+    if (value.prevOutValue) {
+      gemm<real>(CblasNoTrans,
+                 CblasNoTrans,
+                 batchSize,
+                 frameSize,
+                 frameSize,
+                 1,
+                 value.resetOutputValue,
+                 frameSize,
+                 value.stateWeight,
+                 frameSize,
+                 1,
+                 value.gateValue + frameSize * 2,
+                 frameSize * 3);
+    }
+    simd::gruFinalOutput(value.gateValue,
+                         value.prevOutValue,
+                         value.outputValue,
+                         frameSize,
+                         batchSize,
+                         static_cast<simd::Activation>(activeNode_));
+    return;
+  }
   hl_cpu_gru_forward(hppl::forward::gru_resetOutput(),
                      hppl::forward::gru_finalOutput(),
                      value,
@@ -39,6 +90,84 @@ void GruCompute::backward<0>(hl_gru_value value,
                              hl_gru_grad grad,
                              int frameSize,
                              int batchSize) {
+  if (activeGate_ == HL_ACTIVATION_SIGMOID) {
+    simd::gruStateGrad(value.gateValue,
+                       grad.gateGrad,
+                       value.prevOutValue,
+                       grad.prevOutGrad,
+                       grad.outputGrad,
+                       frameSize,
+                       batchSize,
+                       static_cast<simd::Activation>(activeNode_));
+    if (value.prevOutValue && grad.prevOutGrad) {
+      gemm<real>(CblasNoTrans,
+                 CblasTrans,
+                 batchSize,
+                 frameSize,
+                 frameSize,
+                 1,
+                 grad.gateGrad + frameSize * 2,
+                 frameSize * 3,
+                 value.stateWeight,
+                 frameSize,
+                 0,
+                 grad.resetOutputGrad,
+                 frameSize);
+      if (grad.stateWeightGrad) {
+        gemm<real>(CblasTrans,
+                   CblasNoTrans,
+                   frameSize,
+                   frameSize,
+                   batchSize,
+                   1,
+                   value.resetOutputValue,
+                   frameSize,
+                   grad.gateGrad + frameSize * 2,
+                   frameSize * 3,
+                   1,
+                   grad.stateWeightGrad,
+                   frameSize);
+      }
+    }
+    simd::gruResetGrad(value.gateValue,
+                       grad.gateGrad,
+                       value.prevOutValue,
+                       grad.prevOutGrad,
+                       grad.resetOutputGrad,
+                       frameSize,
+                       batchSize);
+    if (value.prevOutValue && grad.prevOutGrad) {
+      gemm<real>(CblasNoTrans,
+                 CblasTrans,
+                 batchSize,
+                 frameSize,
+                 frameSize * 2,
+                 1,
+                 grad.gateGrad,
+                 frameSize * 3,
+                 value.gateWeight,
+                 frameSize * 2,
+                 1,
+                 grad.prevOutGrad,
+                 frameSize);
+      if (grad.gateWeightGrad) {
+        gemm<real>(CblasTrans,
+                   CblasNoTrans,
+                   frameSize,
+                   frameSize * 2,
+                   batchSize,
+                   1,
+                   value.prevOutValue,
+                   frameSize,
+                   grad.gateGrad,
+                   frameSize * 3,
+                   1,
+                   grad.gateWeightGrad,
+                   frameSize * 2);
+      }
+    }
+    return;
+  }
   hl_cpu_gru_backward(hppl::backward::gru_stateGrad(),
                       hppl::backward::gru_resetGrad(),
                       value,
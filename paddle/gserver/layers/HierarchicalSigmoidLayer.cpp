@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include "HierarchicalSigmoidLayer.h"
+#include "paddle/math/SparseRowMatrix.h"
 #include "paddle/utils/Util.h"
 
 namespace paddle {
@@ -27,7 +28,16 @@ bool HierarchicalSigmoidLayer::init(const LayerMap& layerMap,
   CHECK(config_.has_num_classes()) << "num_classes must be specifed in config";
   numClasses_ = config_.num_classes();
   CHECK_GE(numClasses_, (size_t)2);
-  codeLength_ = findLastSet(numClasses_ - 1);
+  if (config_.tree_file().empty()) {
+    tree_ = std::make_shared<BitCodeTree>(numClasses_);
+  } else {
+    CHECK(!useGpu_) << "tree_file is only supported on cpu";
+    tree_ = BitCodeTree::load(config_.tree_file());
+    CHECK_EQ(tree_->getNumClasses(), numClasses_)
+        << "The tree of " << config_.tree_file() << " has "
+        << tree_->getNumClasses() << " classes";
+  }
+  codeLength_ = tree_->getMaxCodeLength();
 
   size_t height = numClasses_ - 1;
 
@@ -72,24 +82,40 @@ void HierarchicalSigmoidLayer::forward(PassType passType) {
                          useGpu(deviceId_));
 
   IVectorPtr label = getInput(*getLabelLayer()).ids;
+  if (!useGpu_ && !prefetched_) {
+    codes_.reset(*tree_, *label);
+  }
+  prefetched_ = false;
 
   preOutput_.value->zeroMem();
 
   /* add the bias-vector */
   if (biases_.get() != NULL) {
-    preOutput_.value->addByBitCode(numClasses_, *label, *biases_->getW());
+    if (useGpu_) {
+      preOutput_.value->addByBitCode(numClasses_, *label, *biases_->getW());
+    } else {
+      codes_.addByBitCode(*preOutput_.value, *biases_->getW());
+    }
   }
   for (size_t i = 0; i < inputLayers_.size() - 1; ++i) {
     MatrixPtr input = getInputValue(i);
-    preOutput_.value->mulByBitCode(
-        numClasses_, *label, *weights_[i]->getW(), *input);
+    if (useGpu_) {
+      preOutput_.value->mulByBitCode(
+          numClasses_, *label, *weights_[i]->getW(), *input);
+    } else {
+      codes_.mulByBitCode(*preOutput_.value, *weights_[i]->getW(), *input);
+    }
   }
   // keep consistent with the clipping in the following softrelu
   preOutput_.value->clip(-40.0, 40.0);
-  preOutput_.value->sumByBitCode(numClasses_,
-                                 *label,
-                                 *output_.value,
-                                 -1);  // scaleSum
+  if (useGpu_) {
+    preOutput_.value->sumByBitCode(numClasses_,
+                                   *label,
+                                   *output_.value,
+                                   -1);  // scaleSum
+  } else {
+    codes_.sumByBitCode(*preOutput_.value, *output_.value, -1);
+  }
   preOutput_.value->softrelu(*preOutput_.value);
   MatrixPtr sum =
       Matrix::create(batchSize, 1, /* trans= */ false, useGpu(deviceId_));
@@ -101,11 +127,19 @@ void HierarchicalSigmoidLayer::backward(const UpdateCallback& callback) {
   IVectorPtr label = getInput(*getLabelLayer()).ids;
   preOutput_.grad->one();
   preOutput_.grad->softreluDerivative(*preOutput_.value);
-  preOutput_.grad->subByBitCode(numClasses_, *label);
+  if (useGpu_) {
+    preOutput_.grad->subByBitCode(numClasses_, *label);
+  } else {
+    codes_.subByBitCode(*preOutput_.grad);
+  }
 
   if (biases_ && biases_->getWGrad()) {
-    preOutput_.grad->addByBitCodeBackward(
-        numClasses_, *label, *biases_->getWGrad());
+    if (useGpu_) {
+      preOutput_.grad->addByBitCodeBackward(
+          numClasses_, *label, *biases_->getWGrad());
+    } else {
+      codes_.addByBitCodeBackward(*preOutput_.grad, *biases_->getWGrad());
+    }
 
     /* Increasing the number of gradient */
     biases_->getParameterPtr()->incUpdate(callback);
@@ -115,8 +149,13 @@ void HierarchicalSigmoidLayer::backward(const UpdateCallback& callback) {
     /* Calculate the W-gradient for the current layer */
     MatrixPtr input = getInputValue(i);
     if (weights_[i]->getWGrad()) {
-      preOutput_.grad->mulByBitCodeBackwardWeight(
-          numClasses_, *label, *weights_[i]->getWGrad(), *input);
+      if (useGpu_) {
+        preOutput_.grad->mulByBitCodeBackwardWeight(
+            numClasses_, *label, *weights_[i]->getWGrad(), *input);
+      } else {
+        codes_.mulByBitCodeBackwardWeight(
+            *preOutput_.grad, *weights_[i]->getWGrad(), *input);
+      }
 
       /* Increasing the number of gradient */
       weights_[i]->getParameterPtr()->incUpdate(callback);
@@ -125,8 +164,31 @@ void HierarchicalSigmoidLayer::backward(const UpdateCallback& callback) {
     /* Calculate the input layers error */
     MatrixPtr inputGrad = getInputGrad(i);
     if (inputGrad) {
-      preOutput_.grad->mulByBitCodeBackwardError(
-          numClasses_, *label, *weights_[i]->getW(), *inputGrad);
+      if (useGpu_) {
+        preOutput_.grad->mulByBitCodeBackwardError(
+            numClasses_, *label, *weights_[i]->getW(), *inputGrad);
+      } else {
+        codes_.mulByBitCodeBackwardError(
+            *preOutput_.grad, *weights_[i]->getW(), *inputGrad);
+      }
+    }
+  }
+}
+
+void HierarchicalSigmoidLayer::prefetch() {
+  if (useGpu_) return;
+  codes_.reset(*tree_, *getInput(*getLabelLayer()).ids);
+  prefetched_ = true;
+
+  // the rows of the nodes on the codes of the labels.
+  const std::vector<int>& nodes = codes_.getNodes();
+  IVector::resizeOrCreate(nodeIds_, nodes.size(), false);
+  std::copy(nodes.begin(), nodes.end(), nodeIds_->getData());
+  for (size_t i = 0; i < inputLayers_.size() - 1; ++i) {
+    auto sparseParam =
+        dynamic_cast<SparsePrefetchRowCpuMatrix*>(weights_[i]->getW().get());
+    if (sparseParam) {
+      sparseParam->addRows(nodeIds_);
     }
   }
 }
@@ -15,6 +15,7 @@ limitations under the License. */
 #pragma once
 
 #include "Layer.h"
+#include "paddle/math/MatrixBitCode.h"
 
 namespace paddle {
 
@@ -55,6 +56,11 @@ namespace paddle {
  * \f$\left\lfloor(i+1)/2^{j+1}\right\rfloor - 1\f$.
  * - A node i is a left child of its parent if \f$(i-1)\%2==0\f$.
  *
+ * On cpu, config.tree_file may give another tree, a Huffman tree for
+ * instance, see BitCodeTree. The cpu layer visits the codes of a batch node
+ * by node (BitCodeBatch), and only touches the rows of the weights of the
+ * nodes on the codes of the labels, so the weights may be sparse parameters.
+ *
  * The config file api is hsigmod_layer.
  */
 class HierarchicalSigmoidLayer : public Layer {
@@ -65,6 +71,7 @@ public:
             const ParameterMap& parameterMap) override;
   void forward(PassType passType) override;
   void backward(const UpdateCallback& callback) override;
+  void prefetch() override;
 
 protected:
   /**
@@ -76,10 +83,17 @@ protected:
   std::unique_ptr<Weight> biases_;
   /// number of classes
   size_t numClasses_;
+  /// the longest code, for the complete tree
   /// codeLength_ = \f$1 + \left\lfloor log_{2}(numClasses-1)\right\rfloor\f$
   int codeLength_;
   /// temporary result of output_
   Argument preOutput_;
+  BitCodeTreePtr tree_;
+  /// the codes of the labels of the batch, on cpu
+  BitCodeBatch codes_;
+  /// whether codes_ holds the labels of the batch prefetched
+  bool prefetched_ = false;
+  IVectorPtr nodeIds_;
 };
 
 }  // namespace paddle
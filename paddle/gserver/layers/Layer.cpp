@@ -35,6 +35,7 @@ limitations under the License. */
 #include "ValidationLayer.h"
 
 DEFINE_bool(log_error_clipping, false, "enable log error clipping or not");
+DECLARE_bool(quantize_inference_weights);
 
 namespace paddle {
 
@@ -42,7 +43,8 @@ Layer::Layer(const LayerConfig& config, bool useGpu)
     : config_(config),
       useGpu_(useGpu),
       deviceId_(-1),
-      needSequenceInfo_(true) {}
+      needSequenceInfo_(true),
+      quantizeWeights_(FLAGS_quantize_inference_weights) {}
 
 bool Layer::init(const LayerMap& layerMap, const ParameterMap& parameterMap) {
   if (useGpu_ && FLAGS_parallel_nn) {
@@ -378,6 +380,55 @@ void Layer::backwardActivation() {
   status.check();
 }
 
+bool Layer::canFuseEpilogue() const {
+  return config_.fuse_epilogue() && !useGpu_ && passType_ != PASS_GC &&
+         activation_->isRowWise();
+}
+
+void Layer::forwardFusedEpilogue(const MatrixPtr& bias) {
+  CHECK(canFuseEpilogue());
+  MatrixPtr outV = getOutputValue();
+  CHECK(outV->isContiguous());
+  size_t height = outV->getHeight();
+  size_t width = outV->getWidth();
+  bool dropOut = config_.drop_rate() > 0;
+  if (dropOut) {
+    CHECK_NE(activation_->getName(), "softmax")
+        << "Softmax activation cannot be used with Dropout";
+  }
+  if (dropOut && passType_ == PASS_TRAIN) {
+    Matrix::resizeOrCreate(dropOutMask_, height, width, false, false);
+  }
+  if (!epilogueRow_.value) {
+    epilogueRow_.value = Matrix::create(nullptr, 1, width, false, false);
+  }
+  epilogueRow_.deviceId = output_.deviceId;
+
+  // The same matrix functions as the unfused path, on one row at a time.
+  // The dropOut mask rows are drawn in order from the same random seed.
+  MatrixPtr& row = epilogueRow_.value;
+  for (size_t i = 0; i < height; ++i) {
+    row->setData(outV->getData() + i * width, 1, width);
+    if (bias) {
+      row->addBias(*bias, 1);
+    }
+    auto status = activation_->forward(epilogueRow_);
+    status.check();
+    if (dropOut && passType_ == PASS_TRAIN) {
+      CpuMatrix mask(dropOutMask_->getData() + i * width, 1, width);
+      mask.randomizeUniform();
+      mask.biggerThanScalar(config_.drop_rate());
+      row->dotMul(*row, mask);
+    } else if (dropOut) {
+      row->mulScalar(1.0 - config_.drop_rate());
+    }
+  }
+
+  if (FLAGS_show_layer_stat) {
+    showOutputStats();
+  }
+}
+
 void Layer::forwardDropOut() {
   auto& outV = getOutputValue();
 
@@ -91,10 +91,15 @@ protected:
   /// Random 0-1 matrix for dropOut
   MatrixPtr dropOutMask_;
 
+  /// One row of output_.value, used by forwardFusedEpilogue()
+  Argument epilogueRow_;
+
   /// Whether the layer need to compute gradient
   bool needGradient_;
   /// Whether the layer need to compute re-sequence information
   bool needSequenceInfo_;
+  /// Whether the cpu weights are rounded to int8 in a PASS_TEST forward
+  bool quantizeWeights_;
 
   /// Mark input grad in(true) or out(false) of backward function.
   std::vector<bool> markInBackward_;
@@ -246,6 +251,13 @@ public:
    */
   void setNeedSequenceInfo(bool need) { needSequenceInfo_ = need; }
 
+  /**
+   * Set whether the layers which support it multiply by int8 copies of their
+   * cpu weights in a PASS_TEST forward (Weight::prepareQuantizedW), which
+   * is --quantize_inference_weights by default.
+   */
+  void setQuantizeWeights(bool quantize) { quantizeWeights_ = quantize; }
+
   /**
    * Get layer's name.
    */
@@ -261,6 +273,12 @@ public:
    */
   size_t getSize() const { return config_.size(); }
 
+  /**
+   * Whether the recurrence of a recurrent layer runs from the end of the
+   * sequence to the beginning.
+   */
+  bool isReversed() const { return config_.reversed(); }
+
   /**
    * Get layer's deviceId.
    */
@@ -469,6 +487,17 @@ protected:
    * Forward of dropOut.
    */
   void forwardDropOut();
+  /**
+   * Whether forwardFusedEpilogue() can be used: the config asks for it, the
+   * layer is on cpu, the activation is row wise and the pass is not PASS_GC.
+   */
+  bool canFuseEpilogue() const;
+  /**
+   * Add the bias (if not null), forward the activation and the dropOut of
+   * the output value row by row, so that each row is swept once while it is
+   * in cache. The result is the same as addBias() and forwardActivation().
+   */
+  void forwardFusedEpilogue(const MatrixPtr& bias);
   /**
    * Initilize the needGradient_ flag.
    */
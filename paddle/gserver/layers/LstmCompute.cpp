@@ -14,10 +14,32 @@ limitations under the License. */
 
 #include "LstmCompute.h"
 #include "hl_recurrent_apply.cuh"
+#include "paddle/math/SIMDFunctions.h"
 #include "paddle/utils/Util.h"
 
 namespace paddle {
 
+static simd::LstmValue<real> simdValue(const hl_lstm_value &value) {
+  return {value.gateValue,
+          value.prevStateValue,
+          value.stateValue,
+          value.stateActiveValue,
+          value.outputValue,
+          value.checkIg,
+          value.checkFg,
+          value.checkOg};
+}
+
+static simd::LstmGrad<real> simdGrad(const hl_lstm_grad &grad) {
+  return {grad.gateGrad,
+          grad.prevStateGrad,
+          grad.stateGrad,
+          grad.outputGrad,
+          grad.checkIgGrad,
+          grad.checkFgGrad,
+          grad.checkOgGrad};
+}
+
 void LstmCompute::init(LayerConfig &config) {
   activeNode_ = hlActiveType(config.active_type());
   activeGate_ = hlActiveType(config.active_gate_type());
@@ -26,6 +48,14 @@ void LstmCompute::init(LayerConfig &config) {
 
 template <>
 void LstmCompute::forwardOneSequence<0>(hl_lstm_value value, int frameSize) {
+  if (activeGate_ == HL_ACTIVATION_SIGMOID) {
+    simd::lstmForward(simdValue(value),
+                      frameSize,
+                      1,
+                      static_cast<simd::Activation>(activeNode_),
+                      static_cast<simd::Activation>(activeState_));
+    return;
+  }
   hl_cpu_lstm_forward(hppl::forward::lstm(),
                       value,
                       frameSize,
@@ -38,6 +68,15 @@ template <>
 void LstmCompute::backwardOneSequence<0>(hl_lstm_value value,
                                          hl_lstm_grad grad,
                                          int frameSize) {
+  if (activeGate_ == HL_ACTIVATION_SIGMOID) {
+    simd::lstmBackward(simdValue(value),
+                       simdGrad(grad),
+                       frameSize,
+                       1,
+                       static_cast<simd::Activation>(activeNode_),
+                       static_cast<simd::Activation>(activeState_));
+    return;
+  }
   hl_cpu_lstm_backward(hppl::backward::lstm(),
                        value,
                        grad,
@@ -51,6 +90,15 @@ template <>
 void LstmCompute::forwardBatch<0>(hl_lstm_value value,
                                   int frameSize,
                                   int batchSize) {
+  if (activeGate_ == HL_ACTIVATION_SIGMOID) {
+    // the whole batch in one fused pass, see simd::lstmForward().
+    simd::lstmForward(simdValue(value),
+                      frameSize,
+                      batchSize,
+                      static_cast<simd::Activation>(activeNode_),
+                      static_cast<simd::Activation>(activeState_));
+    return;
+  }
   for (int b = 0; b < batchSize; b++) {
     forwardOneSequence<0>(value, frameSize);
 
@@ -69,6 +117,15 @@ void LstmCompute::backwardBatch<0>(hl_lstm_value value,
                                    hl_lstm_grad grad,
                                    int frameSize,
                                    int batchSize) {
+  if (activeGate_ == HL_ACTIVATION_SIGMOID) {
+    simd::lstmBackward(simdValue(value),
+                       simdGrad(grad),
+                       frameSize,
+                       batchSize,
+                       static_cast<simd::Activation>(activeNode_),
+                       static_cast<simd::Activation>(activeState_));
+    return;
+  }
   for (int b = 0; b < batchSize; b++) {
     backwardOneSequence<0>(value, grad, frameSize);
 
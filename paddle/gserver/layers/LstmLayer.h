@@ -190,6 +190,10 @@ protected:
   /// The gradient of peephole connection for output gates.
   MatrixPtr checkOgGrad_;
 
+  /// The buffers below keep the values of forward() for backward(), so they
+  /// are not temporaries of the batch arena; resizeOrCreate() reuses them
+  /// and the frames are views, so a batch allocates nothing once they have
+  /// grown to the largest batch.
   /// Stores the cell state of previous time step, namely \f$c_{t-1}\f$.
   Argument state_;
   /// Stores the hidden of previous time step, namely \f$h_{t-1}\f$.
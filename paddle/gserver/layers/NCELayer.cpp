@@ -27,6 +27,12 @@ namespace paddle {
  * models.
  *
  * The config file api is nce_layer.
+ *
+ * With share_neg_samples, the num_neg_samples negative labels are drawn once
+ * per batch and shared by all the samples, so their outputs are a dense
+ * batchSize x num_neg_samples block computed by one matrix product with
+ * the gathered rows of the weight, instead of a dot product per sample and
+ * negative label.
  */
 class NCELayer : public Layer {
   int numClasses_;
@@ -50,8 +56,17 @@ class NCELayer : public Layer {
   std::vector<Sample> samples_;
   /// whether samples_ is prepared
   bool prepared_;
+  /// the outputs of samples_, followed by the batchSize x negIds_.size()
+  /// block of the shared negative labels
   Argument sampleOut_;
 
+  bool shareNegSamples_;
+  /// the negative labels of the whole batch, if shareNegSamples_
+  std::vector<int> negIds_;
+  /// the rows of negIds_ of a weight, and their gradient
+  MatrixPtr negWeight_;
+  MatrixPtr negWeightGrad_;
+
   IVectorPtr labelIds_;
 
 public:
@@ -59,7 +74,8 @@ public:
       : Layer(config),
         numClasses_(config.num_classes()),
         rand_(0, config.num_classes() - 1),
-        prepared_(false) {}
+        prepared_(false),
+        shareNegSamples_(config.share_neg_samples()) {}
 
   bool init(const LayerMap& layerMap,
             const ParameterMap& parameterMap) override {
@@ -122,7 +138,8 @@ public:
     auto& randEngine = ThreadLocalRandomEngine::get();
 
     samples_.clear();
-    samples_.reserve(batchSize * (1 + config_.num_neg_samples()));
+    samples_.reserve(batchSize *
+                     (1 + (shareNegSamples_ ? 0 : config_.num_neg_samples())));
 
     real* weight =
         weightLayer_ ? getInputValue(*weightLayer_)->getData() : nullptr;
@@ -139,21 +156,64 @@ public:
           samples_.push_back({i, cols[j], true, w});
         }
       }
+      if (shareNegSamples_) continue;
       for (int j = 0; j < config_.num_neg_samples(); ++j) {
         int id = sampler_ ? sampler_->gen(randEngine) : rand_(randEngine);
         samples_.push_back({i, id, false, w});
       }
     }
+
+    negIds_.clear();
+    if (shareNegSamples_) {
+      for (int j = 0; j < config_.num_neg_samples(); ++j) {
+        negIds_.push_back(sampler_ ? sampler_->gen(randEngine)
+                                   : rand_(randEngine));
+      }
+    }
     prepared_ = true;
   }
 
+  /// The batchSize x negIds_.size() block of the shared negative labels in
+  /// mat, which is sampleOut_.value or sampleOut_.grad.
+  MatrixPtr getNegBlock(const MatrixPtr& mat, size_t batchSize) {
+    return Matrix::create(mat->getData() + samples_.size(),
+                          batchSize,
+                          negIds_.size(),
+                          /* trans= */ false,
+                          useGpu_);
+  }
+
+  /// Copy the rows of negIds_ of weight into negWeight_.
+  void gatherNegWeight(Matrix& weight) {
+    size_t dim = weight.getWidth();
+    Matrix::resizeOrCreate(negWeight_,
+                           negIds_.size(),
+                           dim,
+                           /* trans= */ false,
+                           useGpu_);
+    for (size_t k = 0; k < negIds_.size(); ++k) {
+      memcpy(negWeight_->getRowBuf(k),
+             weight.getRowBuf(negIds_[k]),
+             dim * sizeof(real));
+    }
+  }
+
+  /// The b of the cost, the expected number of noise samples of a label.
+  real getNoiseRate(int labelId) {
+    return sampler_ ? config_.num_neg_samples() *
+                          config_.neg_sampling_dist(labelId)
+                    : 1. / numClasses_ * config_.num_neg_samples();
+  }
+
   void prefetch() override {
     prepareSamples();
-    IVector::resizeOrCreate(labelIds_, samples_.size(), useGpu_);
+    IVector::resizeOrCreate(
+        labelIds_, samples_.size() + negIds_.size(), useGpu_);
     int* ids = labelIds_->getData();
     for (size_t i = 0; i < samples_.size(); ++i) {
       ids[i] = samples_[i].labelId;
     }
+    std::copy(negIds_.begin(), negIds_.end(), ids + samples_.size());
 
     for (int i = 0; i < numInputs_; ++i) {
       auto sparseParam =
@@ -184,7 +244,7 @@ public:
 
     Matrix::resizeOrCreate(sampleOut_.value,
                            1,
-                           samples_.size(),
+                           samples_.size() + batchSize * negIds_.size(),
                            /* trans= */ false,
                            useGpu_);
 
@@ -203,7 +263,7 @@ public:
   void backward(const UpdateCallback& callback) override {
     Matrix::resizeOrCreate(sampleOut_.grad,
                            1,
-                           samples_.size(),
+                           sampleOut_.value->getWidth(),
                            /* trans= */ false,
                            useGpu_);
 
@@ -230,6 +290,12 @@ public:
       for (size_t i = 0; i < samples_.size(); ++i) {
         sampleOut[i] = bias[samples_[i].labelId];
       }
+      sampleOut += samples_.size();
+      for (size_t i = 0; i < getOutputValue()->getHeight(); ++i) {
+        for (size_t k = 0; k < negIds_.size(); ++k) {
+          *sampleOut++ = bias[negIds_[k]];
+        }
+      }
     }
   }
 
@@ -240,6 +306,12 @@ public:
     for (size_t i = 0; i < samples_.size(); ++i) {
       bias[samples_[i].labelId] += sampleOut[i];
     }
+    sampleOut += samples_.size();
+    for (size_t i = 0; i < getOutputValue()->getHeight(); ++i) {
+      for (size_t k = 0; k < negIds_.size(); ++k) {
+        bias[negIds_[k]] += *sampleOut++;
+      }
+    }
     biases_->incUpdate(callback);
   }
 
@@ -255,6 +327,12 @@ public:
                                  inputMat->getRowBuf(samples_[i].sampleId),
                                  weightMat->getRowBuf(samples_[i].labelId));
     }
+
+    if (!negIds_.empty()) {
+      gatherNegWeight(*weightMat);
+      getNegBlock(sampleOut_.value, inputMat->getHeight())
+          ->mul(*inputMat, *negWeight_->getTranspose(), 1, 1);
+    }
   }
 
   void backwardOneInput(int layerId, const UpdateCallback& callback) {
@@ -265,6 +343,10 @@ public:
 
     int dim = inputMat->getWidth();
     real* sampleGrad = sampleOut_.grad->getData();
+    MatrixPtr negGrad;
+    if (!negIds_.empty()) {
+      negGrad = getNegBlock(sampleOut_.grad, inputMat->getHeight());
+    }
 
     if (weightGradMat) {
       for (size_t i = 0; i < samples_.size(); ++i) {
@@ -273,6 +355,20 @@ public:
              inputMat->getRowBuf(samples_[i].sampleId),
              weightGradMat->getRowBuf(samples_[i].labelId));
       }
+      if (!negIds_.empty()) {
+        Matrix::resizeOrCreate(negWeightGrad_,
+                               negIds_.size(),
+                               dim,
+                               /* trans= */ false,
+                               useGpu_);
+        negWeightGrad_->mul(*negGrad->getTranspose(), *inputMat, 1, 0);
+        for (size_t k = 0; k < negIds_.size(); ++k) {
+          axpy(dim,
+               (real)1,
+               negWeightGrad_->getRowBuf(k),
+               weightGradMat->getRowBuf(negIds_[k]));
+        }
+      }
       weights_[layerId]->incUpdate(callback);
     }
 
@@ -283,38 +379,57 @@ public:
              weightMat->getRowBuf(samples_[i].labelId),
              inputGradMat->getRowBuf(samples_[i].sampleId));
       }
+      if (!negIds_.empty()) {
+        gatherNegWeight(*weightMat);
+        inputGradMat->mul(*negGrad, *negWeight_, 1, 1);
+      }
     }
   }
 
   void forwardCost() {
     real* out = output_.value->getData();
     real* sampleOut = sampleOut_.value->getData();
-    real b = 1. / numClasses_ * config_.num_neg_samples();
     for (size_t i = 0; i < samples_.size(); ++i) {
       real o = sampleOut[i];
-      if (sampler_) {
-        b = config_.num_neg_samples() *
-            config_.neg_sampling_dist(samples_[i].labelId);
-      }
+      real b = getNoiseRate(samples_[i].labelId);
       real cost = samples_[i].target ? -log(o / (o + b)) : -log(b / (o + b));
       out[samples_[i].sampleId] += samples_[i].weight * cost;
     }
+
+    sampleOut += samples_.size();
+    real* weight =
+        weightLayer_ ? getInputValue(*weightLayer_)->getData() : nullptr;
+    for (size_t i = 0; i < output_.value->getHeight(); ++i) {
+      for (size_t k = 0; k < negIds_.size(); ++k) {
+        real o = *sampleOut++;
+        real b = getNoiseRate(negIds_[k]);
+        out[i] += (weight ? weight[i] : 1) * -log(b / (o + b));
+      }
+    }
   }
 
   void backwardCost() {
     real* sampleOut = sampleOut_.value->getData();
     real* sampleGrad = sampleOut_.grad->getData();
 
-    real b = 1. / numClasses_ * config_.num_neg_samples();
     for (size_t i = 0; i < samples_.size(); ++i) {
       real o = sampleOut[i];
-      if (sampler_) {
-        b = config_.num_neg_samples() *
-            config_.neg_sampling_dist(samples_[i].labelId);
-      }
+      real b = getNoiseRate(samples_[i].labelId);
       real w = samples_[i].weight;
       sampleGrad[i] = samples_[i].target ? -w * b / (o * (o + b)) : w / (o + b);
     }
+
+    sampleOut += samples_.size();
+    sampleGrad += samples_.size();
+    real* weight =
+        weightLayer_ ? getInputValue(*weightLayer_)->getData() : nullptr;
+    for (size_t i = 0; i < output_.value->getHeight(); ++i) {
+      for (size_t k = 0; k < negIds_.size(); ++k) {
+        real o = *sampleOut++;
+        real b = getNoiseRate(negIds_[k]);
+        *sampleGrad++ = (weight ? weight[i] : 1) / (o + b);
+      }
+    }
   }
 };
 
@@ -37,6 +37,9 @@ namespace paddle {
  * 2. seq2batch.resizeOrCreateBatch(seqStarts);     // calculate seq2BatchIdx
  * 3. seq2batch.copy(seqMatrix, batchMatrix, true); // copy seq to batch matrix
  *
+ * The indices and batchValue_ are used again by backward(), so they are
+ * resized in place rather than taken from the arena of the batch.
+ *
  */
 class SequenceToBatch {
 public:
@@ -73,7 +73,8 @@ void TensorLayer::forward(PassType passType) {
     MatrixPtr tmpMat = Matrix::create(input2->getHeight(),
                                       input2->getWidth(),
                                       /* trans= */ false,
-                                      input2->useGpu());
+                                      input2->useGpu(),
+                                      /* tmp= */ true);
     REGISTER_TIMER_INFO("TensorFwMulTimer", getName().c_str());
     for (size_t i = 0; i < getSize(); ++i) {
       MatrixPtr weights = weights_[i]->getW();
@@ -104,7 +105,8 @@ void TensorLayer::backward(const UpdateCallback& callback) {
   MatrixPtr tmpMat = Matrix::create(input1->getHeight(),
                                     input1->getWidth(),
                                     /* trans= */ false,
-                                    input1->useGpu());
+                                    input1->useGpu(),
+                                    /* tmp= */ true);
 
   /* trans(grad * e1) * e2 */ {
     REGISTER_TIMER_INFO("TensorGradMulTimer", getName().c_str());
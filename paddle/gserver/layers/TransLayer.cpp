@@ -60,7 +60,8 @@ void TransLayer::backward(const UpdateCallback& callback) {
     MatrixPtr transGrad = Matrix::create(preGrad->getHeight(),
                                          preGrad->getWidth(),
                                          /* trans= */ false,
-                                         preGrad->useGpu());
+                                         preGrad->useGpu(),
+                                         /* tmp= */ true);
     outputGrad->transpose(transGrad, false);
     preGrad->add(*transGrad);
   }
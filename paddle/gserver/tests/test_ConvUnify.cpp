@@ -19,6 +19,8 @@ limitations under the License. */
 #include "paddle/gserver/layers/DataLayer.h"
 #include "paddle/gserver/layers/ExpandConvTransLayer.h"
 #include "paddle/math/MathUtils.h"
+#include "paddle/math/MemoryArena.h"
+#include "paddle/math/Storage.h"
 #include "paddle/trainer/Trainer.h"
 #include "paddle/utils/GlobalConstants.h"
 
@@ -308,6 +310,67 @@ TEST(Layer, convParaUnified) {
 #endif
 }
 
+TEST(Layer, exconvScratchInArena) {
+  TestConfig config;
+  config.biasSize = 4;
+  config.layerConfig.set_type("exconv");
+  config.layerConfig.set_num_filters(4);
+  config.layerConfig.set_partial_sum(1);
+  config.layerConfig.set_shared_biases(true);
+  config.layerConfig.set_size(6 * 6 * 4);
+  config.inputDefs.push_back({INPUT_DATA, "layer_0", 8 * 8 * 2, 2 * 9 * 4});
+
+  LayerInputConfig* input = config.layerConfig.add_inputs();
+  ConvConfig* conv = input->mutable_conv_conf();
+  conv->set_filter_size(3);
+  conv->set_filter_size_y(3);
+  conv->set_channels(2);
+  conv->set_padding(0);
+  conv->set_padding_y(0);
+  conv->set_stride(1);
+  conv->set_stride_y(1);
+  conv->set_groups(1);
+  conv->set_filter_channels(2);
+  conv->set_img_size(8);
+  conv->set_output_x(6);
+  config.layerConfig.set_name("conv");
+
+  std::vector<DataLayerPtr> dataLayers;
+  LayerMap layerMap;
+  vector<Argument> datas;
+  initDataLayer(
+      config, &dataLayers, &datas, &layerMap, "conv", 3, false, false);
+  std::vector<ParameterPtr> parameters;
+  LayerPtr convLayer;
+  initTestLayer(config, &layerMap, &parameters, &convLayer);
+
+  convLayer->forward(PASS_TRAIN);
+  MatrixPtr expected = convLayer->getOutputValue()->clone(0, 0, false);
+  expected->copyFrom(*convLayer->getOutputValue());
+
+  /* the scratch is taken from the arena once the pool scratch of the
+   * first batch is released, and is released before the arena is reset for
+   * the next batch */
+  MemoryArena arena;
+  StorageEngine::singleton()->setCpuArena(&arena);
+  size_t usedSize = 0;
+  for (int batch = 0; batch < 3; ++batch) {
+    arena.reset();
+    convLayer->forward(PASS_TRAIN);
+    if (batch == 1) {
+      usedSize = arena.getUsedSize();
+      EXPECT_LT(0UL, usedSize);
+    } else if (batch > 1) {
+      EXPECT_EQ(usedSize, arena.getUsedSize());
+    }
+    checkMatrixEqual(expected, convLayer->getOutputValue());
+    convLayer->getOutputGrad()->randomizeUniform();
+    convLayer->backward();
+  }
+  arena.reset();
+  StorageEngine::singleton()->setCpuArena(nullptr);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   initMain(argc, argv);
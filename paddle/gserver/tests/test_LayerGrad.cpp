@@ -13,6 +13,9 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include <gtest/gtest.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fstream>
 #include <string>
 #include <vector>
 #include "ModelConfig.pb.h"
@@ -524,6 +527,64 @@ TEST(Layer, fcLayer) {
   testFcLayer("csr", 4096 * 40);
 }
 
+/**
+ * The fused epilogue of the fc layer must give the same bits as addBias,
+ * forwardActivation and forwardDropOut.
+ */
+void testFcFusedEpilogue(const string& activation, double dropRate) {
+  TestConfig config;
+  config.biasSize = 100;
+  config.layerConfig.set_name("fc");
+  config.layerConfig.set_type("fc");
+  config.layerConfig.set_size(100);
+  config.layerConfig.set_active_type(activation);
+  config.layerConfig.set_drop_rate(dropRate);
+  config.inputDefs.push_back({INPUT_DATA, "layer_0", 50, 5000});
+  config.layerConfig.add_inputs();
+
+  std::vector<DataLayerPtr> dataLayers;
+  LayerMap layerMap;
+  vector<Argument> datas;
+  initDataLayer(
+      config, &dataLayers, &datas, &layerMap, "fc", 64, false, false);
+  LayerPtr layers[2];
+  std::vector<ParameterPtr> parameters[2];
+  for (int fuse = 0; fuse < 2; ++fuse) {
+    config.layerConfig.set_fuse_epilogue(fuse);
+    initTestLayer(config, &layerMap, &parameters[fuse], &layers[fuse]);
+  }
+  for (size_t i = 0; i < parameters[0].size(); ++i) {
+    parameters[1][i]->getBuf(PARAMETER_VALUE)->copyFrom(
+        *parameters[0][i]->getBuf(PARAMETER_VALUE));
+  }
+
+  for (auto passType : {PASS_TRAIN, PASS_TEST}) {
+    MatrixPtr outputs[2];
+    for (int fuse = 0; fuse < 2; ++fuse) {
+      *ThreadLocalRand::getSeed() = 1;
+      layers[fuse]->forward(passType);
+      outputs[fuse] = layers[fuse]->getOutputValue();
+    }
+    ASSERT_EQ(outputs[0]->getElementCnt(), outputs[1]->getElementCnt());
+    EXPECT_EQ(0,
+              memcmp(outputs[0]->getData(),
+                     outputs[1]->getData(),
+                     outputs[0]->getElementCnt() * sizeof(real)))
+        << activation << " drop_rate=" << dropRate << " pass=" << passType;
+  }
+}
+
+TEST(Layer, fcFusedEpilogue) {
+  for (auto activation : {"", "sigmoid", "tanh", "relu", "softmax"}) {
+    for (auto dropRate : {0.0, 0.3}) {
+      if (dropRate > 0 && string(activation) == "softmax") {
+        continue;
+      }
+      testFcFusedEpilogue(activation, dropRate);
+    }
+  }
+}
+
 TEST(Layer, SelectiveFullyConnectedLayer) {
   TestConfig config;
   size_t nin = 16;
@@ -590,12 +651,29 @@ TEST(Layer, hsigmoidLayer) {
   config.layerConfig.add_inputs();
   config.layerConfig.add_inputs();
 
-  // Not support GPU now
-  testLayerGrad(config,
-                "hsigmoid",
-                100,
-                /* trans */ false, /* useGpu */
-                false);
+  // the complete tree, the Huffman tree of class frequencies and a tree
+  // given by its codes.
+  char treeFile[] = "/tmp/hsigmoid_treeXXXXXX";
+  int fd = mkstemp(treeFile);
+  ASSERT_NE(-1, fd);
+  close(fd);
+  const char* trees[] = {"",
+                         "30\n2\n9\n9\n1\n",
+                         "0 0 1 0\n0 1 1 0\n2 0 1 1\n"
+                         "3 0 2 1 1 1\n3 1 2 1 1 1\n"};
+  for (const char* tree : trees) {
+    if (*tree) {
+      std::ofstream(treeFile) << tree;
+      config.layerConfig.set_tree_file(treeFile);
+    }
+    // Not support GPU now
+    testLayerGrad(config,
+                  "hsigmoid",
+                  100,
+                  /* trans */ false, /* useGpu */
+                  false);
+  }
+  unlink(treeFile);
 }
 
 TEST(Layer, multi_cross) {
@@ -1393,15 +1471,19 @@ TEST(Layer, NCELayer) {
             config.layerConfig.set_neg_sampling_dist(i, p);
           }
         }
-        LOG(INFO) << "NCELayer "
-                  << " isIdLabel=" << isIdLabel << " withWeight=" << withWeight
-                  << " withDist=" << withDist;
-        // Not support GPU now
-        testLayerGrad(config,
-                      "nce",
-                      100,
-                      /* trans= */ false,
-                      /* useGpu */ false);
+        for (auto shareNeg : {false, true}) {
+          config.layerConfig.set_share_neg_samples(shareNeg);
+          LOG(INFO) << "NCELayer "
+                    << " isIdLabel=" << isIdLabel
+                    << " withWeight=" << withWeight << " withDist=" << withDist
+                    << " shareNeg=" << shareNeg;
+          // Not support GPU now
+          testLayerGrad(config,
+                        "nce",
+                        100,
+                        /* trans= */ false,
+                        /* useGpu */ false);
+        }
       }
     }
   }
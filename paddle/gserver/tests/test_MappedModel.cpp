@@ -0,0 +1,188 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include "paddle/gserver/gradientmachines/MappedModel.h"
+#include "paddle/gserver/gradientmachines/NeuralNetwork.h"
+#include "paddle/math/tests/TensorCheck.h"
+#include "paddle/testing/TestUtil.h"
+
+using namespace paddle;  // NOLINT
+
+DECLARE_bool(pack_inference_weights);
+
+const size_t kInputSize = 100;
+const size_t kHiddenSize = 37;
+const size_t kBatchSize = 5;
+const char* kModelFile = "./test_MappedModel.model";
+
+void addFcLayer(ModelConfig& config,
+                const std::string& name,
+                const std::string& input,
+                size_t inputSize) {
+  LayerConfig* layer = config.add_layers();
+  layer->set_name(name);
+  layer->set_type("fc");
+  layer->set_size(kHiddenSize);
+  layer->set_active_type("sigmoid");
+  layer->set_bias_parameter_name("_" + name + ".wbias");
+  LayerInputConfig* in = layer->add_inputs();
+  in->set_input_layer_name(input);
+  in->set_input_parameter_name("_" + name + ".w");
+
+  ParameterConfig* para = config.add_parameters();
+  para->set_name("_" + name + ".w");
+  para->set_size(inputSize * kHiddenSize);
+  para->add_dims(inputSize);
+  para->add_dims(kHiddenSize);
+  para->set_initial_std(1.0 / sqrt(inputSize));
+
+  ParameterConfig* bias = config.add_parameters();
+  bias->set_name("_" + name + ".wbias");
+  bias->set_size(kHiddenSize);
+  bias->add_dims(1);
+  bias->add_dims(kHiddenSize);
+  bias->set_initial_std(1.0);
+}
+
+/// input -> h1 -> output
+ModelConfig makeConfig() {
+  ModelConfig config;
+  config.set_type("nn");
+  LayerConfig* data = config.add_layers();
+  data->set_name("input");
+  data->set_type("data");
+  data->set_size(kInputSize);
+  addFcLayer(config, "h1", "input", kInputSize);
+  addFcLayer(config, "output", "h1", kHiddenSize);
+  config.add_input_layer_names("input");
+  config.add_output_layer_names("output");
+  return config;
+}
+
+MatrixPtr forward(GradientMachine& machine,
+                  const std::vector<Argument>& inArgs) {
+  std::vector<Argument> outArgs;
+  machine.forward(inArgs, &outArgs, PASS_TEST);
+  MatrixPtr out = Matrix::create(kBatchSize, kHiddenSize, false, false);
+  out->copyFrom(*outArgs[0].value);
+  return out;
+}
+
+TEST(MappedModel, inference) {
+  ModelConfig config = makeConfig();
+  std::unique_ptr<GradientMachine> network(
+      GradientMachine::create(
+          config, GradientMachine::kTesting, {PARAMETER_VALUE}));
+  network->randParameters();
+  MappedModel::write(kModelFile, config, network->getParameters());
+
+  std::unique_ptr<GradientMachine> mapped;
+  {
+    MappedModel model(kModelFile);
+    EXPECT_EQ(config.DebugString(), model.getConfig().DebugString());
+    EXPECT_EQ(nullptr, model.getValue("no_such_parameter"));
+    mapped.reset(model.createGradientMachine());
+  }
+
+  // the values are used in place, each on its own page.
+  auto& parameters = network->getParameters();
+  auto& mappedParameters = mapped->getParameters();
+  ASSERT_EQ(parameters.size(), mappedParameters.size());
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    VectorPtr value = mappedParameters[i]->getBuf(PARAMETER_VALUE);
+    EXPECT_EQ(0UL,
+              reinterpret_cast<uintptr_t>(value->getData()) %
+                  MappedModel::kAlignment);
+    autotest::TensorCheckEqual(*parameters[i]->getBuf(PARAMETER_VALUE),
+                               *value);
+  }
+
+  std::vector<Argument> inArgs(1);
+  inArgs[0].value = Matrix::create(kBatchSize, kInputSize, false, false);
+  inArgs[0].value->randomizeUniform();
+  MatrixPtr expected = forward(*network, inArgs);
+  autotest::TensorCheckErr(*expected, *forward(*mapped, inArgs));
+  FLAGS_pack_inference_weights = true;
+  autotest::TensorCheckErr(*expected, *forward(*mapped, inArgs));
+  FLAGS_pack_inference_weights = false;
+
+  // the values written get private pages, and the file is left unchanged.
+  mapped->randParameters();
+  MappedModel model(kModelFile);
+  for (auto& para : parameters) {
+    autotest::TensorCheckEqual(*para->getBuf(PARAMETER_VALUE),
+                               *model.getValue(para->getName()));
+  }
+
+  mapped.reset();
+  remove(kModelFile);
+}
+
+/// Write the first size bytes of contents to kModelFile, with the bytes
+/// at offset replaced by patch.
+void writeModelFile(const std::string& contents,
+                    size_t size,
+                    size_t offset = 0,
+                    const std::string& patch = "") {
+  std::string file = contents.substr(0, size);
+  file.replace(offset, patch.size(), patch);
+  std::ofstream os(kModelFile, std::ios_base::binary);
+  os.write(file.data(), file.size());
+}
+
+TEST(MappedModel, invalidFiles) {
+  ModelConfig config = makeConfig();
+  std::unique_ptr<GradientMachine> network(
+      GradientMachine::create(
+          config, GradientMachine::kTesting, {PARAMETER_VALUE}));
+  MappedModel::write(kModelFile, config, network->getParameters());
+  std::string contents;
+  {
+    std::ifstream is(kModelFile, std::ios_base::binary);
+    std::stringstream ss;
+    ss << is.rdbuf();
+    contents = ss.str();
+  }
+  EXPECT_NE(nullptr, MappedModel::load(kModelFile));
+
+  // truncated in the header, in the config and in the last value.
+  for (size_t size : {(size_t)10,
+                      sizeof(MappedModel::FileHeader) + 10,
+                      contents.size() - 1}) {
+    writeModelFile(contents, size);
+    EXPECT_EQ(nullptr, MappedModel::load(kModelFile)) << size;
+  }
+  writeModelFile(contents, contents.size(), 0, "NOMODEL");
+  EXPECT_EQ(nullptr, MappedModel::load(kModelFile));
+  // a config offset far out of the file.
+  writeModelFile(contents,
+                 contents.size(),
+                 offsetof(MappedModel::FileHeader, configOffset),
+                 std::string(8, '\xff'));
+  EXPECT_EQ(nullptr, MappedModel::load(kModelFile));
+
+  remove(kModelFile);
+  EXPECT_EQ(nullptr, MappedModel::load(kModelFile));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  initMain(argc, argv);
+  return RUN_ALL_TESTS();
+}
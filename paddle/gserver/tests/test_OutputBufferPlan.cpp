@@ -0,0 +1,125 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include "paddle/gserver/gradientmachines/NeuralNetwork.h"
+#include "paddle/testing/TestUtil.h"
+
+using namespace paddle;  // NOLINT
+
+DECLARE_bool(reuse_inference_buffers);
+
+const size_t kLayerSize = 16;
+const size_t kBatchSize = 10;
+
+void addFcLayer(ModelConfig& config,
+                const std::string& name,
+                const std::string& input) {
+  LayerConfig* layer = config.add_layers();
+  layer->set_name(name);
+  layer->set_type("fc");
+  layer->set_size(kLayerSize);
+  layer->set_active_type("tanh");
+  LayerInputConfig* in = layer->add_inputs();
+  in->set_input_layer_name(input);
+  in->set_input_parameter_name("_" + name + ".w");
+
+  ParameterConfig* para = config.add_parameters();
+  para->set_name("_" + name + ".w");
+  para->set_size(kLayerSize * kLayerSize);
+  para->add_dims(kLayerSize);
+  para->add_dims(kLayerSize);
+  para->set_initial_std(1.0 / sqrt(kLayerSize));
+}
+
+/**
+ * input -> h1 -> h2 -> h3 -> h4 = h3 + h1 -> output
+ *
+ * h4 can take the buffer of h2, the others are alive at the same time.
+ */
+ModelConfig makeConfig() {
+  ModelConfig config;
+  config.set_type("nn");
+  LayerConfig* data = config.add_layers();
+  data->set_name("input");
+  data->set_type("data");
+  data->set_size(kLayerSize);
+  addFcLayer(config, "h1", "input");
+  addFcLayer(config, "h2", "h1");
+  addFcLayer(config, "h3", "h2");
+  LayerConfig* addto = config.add_layers();
+  addto->set_name("h4");
+  addto->set_type("addto");
+  addto->set_size(kLayerSize);
+  addto->set_active_type("");
+  addto->add_inputs()->set_input_layer_name("h3");
+  addto->add_inputs()->set_input_layer_name("h1");
+  addFcLayer(config, "output", "h4");
+  config.add_input_layer_names("input");
+  config.add_output_layer_names("output");
+  return config;
+}
+
+TEST(OutputBufferPlan, shareBuffers) {
+  ModelConfig config = makeConfig();
+  std::unique_ptr<NeuralNetwork> network(NeuralNetwork::create(config));
+  network->init(config, nullptr, {PARAMETER_VALUE}, false);
+  network->randParameters();
+
+  std::vector<Argument> inArgs(1);
+  inArgs[0].value = Matrix::create(kBatchSize, kLayerSize, false, false);
+  inArgs[0].value->randomizeUniform();
+  std::vector<Argument> outArgs;
+
+  FLAGS_reuse_inference_buffers = false;
+  network->forward(inArgs, &outArgs, PASS_TEST);
+  MatrixPtr expected = Matrix::create(kBatchSize, kLayerSize, false, false);
+  expected->copyFrom(*outArgs[0].value);
+  EXPECT_TRUE(network->getOutputBufferIds().empty());
+
+  FLAGS_reuse_inference_buffers = true;
+  for (int pass = 0; pass < 3; ++pass) {
+    network->forward(inArgs, &outArgs, PASS_TEST);
+    MatrixPtr diff = Matrix::create(kBatchSize, kLayerSize, false, false);
+    diff->copyFrom(*outArgs[0].value);
+    diff->sub(*expected);
+    EXPECT_EQ(0, diff->getAbsSum());
+  }
+
+  // input, h1, h2, h3, h4, output
+  const std::vector<int>& ids = network->getOutputBufferIds();
+  ASSERT_EQ(6UL, ids.size());
+  EXPECT_EQ(-1, ids[0]);
+  EXPECT_EQ(-1, ids[5]);
+  EXPECT_NE(ids[1], ids[2]);
+  EXPECT_NE(ids[1], ids[3]);
+  EXPECT_NE(ids[2], ids[3]);
+  EXPECT_EQ(ids[2], ids[4]);
+  EXPECT_EQ(network->getLayer("h2")->getOutputValue(),
+            network->getLayer("h4")->getOutputValue());
+
+  // training gives every layer its own output again.
+  network->forward(inArgs, &outArgs, PASS_TRAIN);
+  EXPECT_TRUE(network->getOutputBufferIds().empty());
+  EXPECT_NE(network->getLayer("h2")->getOutputValue(),
+            network->getLayer("h4")->getOutputValue());
+  FLAGS_reuse_inference_buffers = false;
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  initMain(argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include "paddle/gserver/gradientmachines/NeuralNetwork.h"
+#include "paddle/math/tests/TensorCheck.h"
+#include "paddle/testing/TestUtil.h"
+
+using namespace paddle;  // NOLINT
+
+DECLARE_bool(pack_inference_weights);
+
+const size_t kInputSize = 100;
+const size_t kHiddenSize = 37;
+const size_t kBatchSize = 5;
+
+void addFcLayer(ModelConfig& config,
+                const std::string& name,
+                const std::string& input,
+                size_t inputSize) {
+  LayerConfig* layer = config.add_layers();
+  layer->set_name(name);
+  layer->set_type("fc");
+  layer->set_size(kHiddenSize);
+  layer->set_active_type("sigmoid");
+  LayerInputConfig* in = layer->add_inputs();
+  in->set_input_layer_name(input);
+  in->set_input_parameter_name("_" + name + ".w");
+
+  ParameterConfig* para = config.add_parameters();
+  para->set_name("_" + name + ".w");
+  para->set_size(inputSize * kHiddenSize);
+  para->add_dims(inputSize);
+  para->add_dims(kHiddenSize);
+  para->set_initial_std(1.0 / sqrt(inputSize));
+}
+
+/// input -> h1 -> output
+ModelConfig makeConfig() {
+  ModelConfig config;
+  config.set_type("nn");
+  LayerConfig* data = config.add_layers();
+  data->set_name("input");
+  data->set_type("data");
+  data->set_size(kInputSize);
+  addFcLayer(config, "h1", "input", kInputSize);
+  addFcLayer(config, "output", "h1", kHiddenSize);
+  config.add_input_layer_names("input");
+  config.add_output_layer_names("output");
+  return config;
+}
+
+MatrixPtr forward(NeuralNetwork& network,
+                  const std::vector<Argument>& inArgs,
+                  bool packed) {
+  FLAGS_pack_inference_weights = packed;
+  std::vector<Argument> outArgs;
+  network.forward(inArgs, &outArgs, PASS_TEST);
+  FLAGS_pack_inference_weights = false;
+  MatrixPtr out = Matrix::create(kBatchSize, kHiddenSize, false, false);
+  out->copyFrom(*outArgs[0].value);
+  return out;
+}
+
+TEST(PackedWeights, inference) {
+  ModelConfig config = makeConfig();
+  std::unique_ptr<NeuralNetwork> network(NeuralNetwork::create(config));
+  // without gradients, as GradientMachine::create() in testing mode.
+  network->init(config,
+                [](int paramId, Parameter* para) {
+                  para->enableType(PARAMETER_VALUE);
+                },
+                {PARAMETER_VALUE},
+                false);
+  network->randParameters();
+
+  std::vector<Argument> inArgs(1);
+  inArgs[0].value = Matrix::create(kBatchSize, kInputSize, false, false);
+  inArgs[0].value->randomizeUniform();
+
+  MatrixPtr expected = forward(*network, inArgs, false);
+  for (int pass = 0; pass < 2; ++pass) {
+    autotest::TensorCheckErr(*expected, *forward(*network, inArgs, true));
+  }
+
+  // a new value is packed again before the next forward.
+  network->randParameters();
+  MatrixPtr out = forward(*network, inArgs, true);
+  autotest::TensorCheckErr(*forward(*network, inArgs, false), *out);
+}
+
+TEST(PackedWeights, sharedParameters) {
+  ModelConfig config = makeConfig();
+  std::unique_ptr<NeuralNetwork> origin(NeuralNetwork::create(config));
+  origin->init(config,
+               [](int paramId, Parameter* para) {
+                 para->enableType(PARAMETER_VALUE);
+               },
+               {PARAMETER_VALUE},
+               false);
+  origin->randParameters();
+  // as paddle_gradient_machine_create_shared_param().
+  std::unique_ptr<NeuralNetwork> slave(NeuralNetwork::create(config));
+  slave->init(config,
+              [&origin](int paramId, Parameter* para) {
+                auto& p = origin->getParameters()[paramId];
+                para->enableSharedType(PARAMETER_VALUE,
+                                       p->getBuf(PARAMETER_VALUE));
+                para->shareValueCache(*p);
+              },
+              {PARAMETER_VALUE},
+              false);
+
+  std::vector<Argument> inArgs(1);
+  inArgs[0].value = Matrix::create(kBatchSize, kInputSize, false, false);
+  inArgs[0].value->randomizeUniform();
+  autotest::TensorCheckErr(*forward(*origin, inArgs, true),
+                           *forward(*slave, inArgs, true));
+
+  // the value is packed once for both machines.
+  ParameterPtr para = origin->getParameters()[0];
+  CpuMemHandlePtr packed = para->getPackedValue(kInputSize, kHiddenSize);
+  EXPECT_EQ(packed,
+            slave->getParameters()[0]->getPackedValue(kInputSize,
+                                                      kHiddenSize));
+
+  // a write to the value of the origin repacks it for the slave.
+  para->getBuf(PARAMETER_VALUE)->uniform(-0.1, 0.1);
+  para->setValueUpdated();
+  MatrixPtr out = forward(*slave, inArgs, true);
+  EXPECT_NE(packed, para->getPackedValue(kInputSize, kHiddenSize));
+  autotest::TensorCheckErr(*forward(*origin, inArgs, false), *out);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  initMain(argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -300,6 +300,75 @@ TEST(PyDataProvider2, can_over_batch_size) {
   }
 }
 
+TEST(PyDataProvider2, bucket_by_length) {
+  paddle::DataConfig config;
+  config.set_type("py2");
+  config.set_files(FLAGS_train_list.c_str());
+  config.set_load_data_module("test_PyDataProvider2");
+  config.set_load_data_object("test_bucket_by_length");
+  config.set_load_data_args("");
+  paddle::DataBatch batch;
+  std::unique_ptr<paddle::DataProvider> provider(
+      paddle::DataProvider::create(config, false));
+  provider->reset();
+  constexpr size_t batchSize = 10;
+  size_t numSamples = 0;
+  size_t numTimesteps = 0;
+  size_t numPaddedTimesteps = 0;
+  while (int64_t realBatchSize = provider->getNextBatch(batchSize, &batch)) {
+    auto &arg = batch.getStreams()[0];
+    const int *starts = arg.sequenceStartPositions->getData(false);
+    int maxLength = 0;
+    for (int64_t i = 0; i < realBatchSize; ++i) {
+      maxLength = std::max(maxLength, starts[i + 1] - starts[i]);
+    }
+    numSamples += realBatchSize;
+    numTimesteps += starts[realBatchSize];
+    numPaddedTimesteps += maxLength * realBatchSize;
+  }
+  ASSERT_EQ(1000UL, numSamples);
+  // about 0.55 for batches of random lengths.
+  ASSERT_GT((double)numTimesteps / numPaddedTimesteps, 0.9);
+}
+
+TEST(PyDataProvider2, bucket_by_length_calc_batch_size) {
+  paddle::DataConfig config;
+  config.set_type("py2");
+  config.set_files(FLAGS_train_list.c_str());
+  config.set_load_data_module("test_PyDataProvider2");
+  config.set_load_data_object("test_bucket_by_length_calc_batch_size");
+  config.set_load_data_args("");
+  paddle::DataBatch batch;
+  std::unique_ptr<paddle::DataProvider> provider(
+      paddle::DataProvider::create(config, false));
+  // the batch size counts timesteps, not samples.
+  constexpr size_t batchSize = 500;
+  // the second pass is read from the cache.
+  for (int pass = 0; pass < 2; ++pass) {
+    provider->reset();
+    size_t numSamples = 0;
+    size_t numTimesteps = 0;
+    size_t numPaddedTimesteps = 0;
+    while (int64_t realBatchSize =
+               provider->getNextBatch(batchSize, &batch)) {
+      ASSERT_LE(static_cast<size_t>(realBatchSize), batchSize);
+      auto &arg = batch.getStreams()[0];
+      size_t numSequences = arg.getNumSequences();
+      const int *starts = arg.sequenceStartPositions->getData(false);
+      ASSERT_EQ(realBatchSize, starts[numSequences]);
+      int maxLength = 0;
+      for (size_t i = 0; i < numSequences; ++i) {
+        maxLength = std::max(maxLength, starts[i + 1] - starts[i]);
+      }
+      numSamples += numSequences;
+      numTimesteps += starts[numSequences];
+      numPaddedTimesteps += maxLength * numSequences;
+    }
+    ASSERT_EQ(1000UL, numSamples);
+    ASSERT_GT((double)numTimesteps / numPaddedTimesteps, 0.9);
+  }
+}
+
 TEST(PyDataProvider2, input_order) {
   paddle::DataConfig config;
   config.set_type("py2");
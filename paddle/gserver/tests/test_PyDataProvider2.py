@@ -91,6 +91,32 @@ def test_can_over_batch_size(setting, filename):
         yield [random.randint(0, 100 - 1) for _ in xrange(seq_len)]
 
 
+@provider(
+    input_types=[index_slot(
+        100, seq_type=SequenceType.SEQUENCE)],
+    min_pool_size=1000,
+    bucket_by_length=True)
+def test_bucket_by_length(setting, filename):
+    for _ in xrange(1000):
+        seq_len = random.randint(1, 100)
+        yield [random.randint(0, 100 - 1) for _ in xrange(seq_len)]
+
+
+@provider(
+    input_types=[index_slot(
+        100, seq_type=SequenceType.SEQUENCE)],
+    # the pool size is counted by calc_batch_size, in timesteps.
+    min_pool_size=100000,
+    can_over_batch_size=False,
+    calc_batch_size=lambda x: len(x[0]),
+    cache=CacheType.CACHE_PASS_IN_MEM,
+    bucket_by_length=True)
+def test_bucket_by_length_calc_batch_size(setting, filename):
+    for _ in xrange(1000):
+        seq_len = random.randint(1, 100)
+        yield [random.randint(0, 100 - 1) for _ in xrange(seq_len)]
+
+
 @provider(input_types={'input1': index_slot(10), 'input2': index_slot(10)})
 def test_input_order(setting, filename):
     for _ in xrange(1000):
@@ -0,0 +1,242 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include "paddle/gserver/gradientmachines/NeuralNetwork.h"
+#include "paddle/testing/TestUtil.h"
+
+using namespace paddle;  // NOLINT
+
+const size_t kBatchSize = 5;
+
+const size_t kInputSize = 100;
+const size_t kHiddenSize = 37;
+
+const size_t kChannels = 4;
+const size_t kImgSize = 9;
+const size_t kFilterSize = 3;
+const size_t kNumFilters = 6;
+const size_t kGroups = 2;
+
+void addParameter(ModelConfig& config,
+                  const std::string& name,
+                  size_t height,
+                  size_t width,
+                  double std) {
+  ParameterConfig* para = config.add_parameters();
+  para->set_name(name);
+  para->set_size(height * width);
+  para->add_dims(height);
+  para->add_dims(width);
+  para->set_initial_std(std);
+}
+
+LayerConfig* addDataLayer(ModelConfig& config, size_t size) {
+  LayerConfig* data = config.add_layers();
+  data->set_name("input");
+  data->set_type("data");
+  data->set_size(size);
+  config.add_input_layer_names("input");
+  return data;
+}
+
+void addFcLayer(ModelConfig& config,
+                const std::string& name,
+                const std::string& input,
+                size_t inputSize) {
+  LayerConfig* layer = config.add_layers();
+  layer->set_name(name);
+  layer->set_type("fc");
+  layer->set_size(kHiddenSize);
+  layer->set_active_type("sigmoid");
+  layer->set_bias_parameter_name("_" + name + ".b");
+  LayerInputConfig* in = layer->add_inputs();
+  in->set_input_layer_name(input);
+  in->set_input_parameter_name("_" + name + ".w");
+
+  addParameter(
+      config, "_" + name + ".w", inputSize, kHiddenSize, 1.0 / sqrt(inputSize));
+  addParameter(config, "_" + name + ".b", 1, kHiddenSize, 1.0);
+}
+
+/// input -> h1 -> output, both fc with biases.
+ModelConfig makeFcConfig() {
+  ModelConfig config;
+  config.set_type("nn");
+  addDataLayer(config, kInputSize);
+  addFcLayer(config, "h1", "input", kInputSize);
+  addFcLayer(config, "output", "h1", kHiddenSize);
+  config.add_output_layer_names("output");
+  return config;
+}
+
+/// input -> output, a grouped exconv with shared biases.
+ModelConfig makeConvConfig() {
+  ModelConfig config;
+  config.set_type("nn");
+  addDataLayer(config, kChannels * kImgSize * kImgSize);
+
+  LayerConfig* layer = config.add_layers();
+  layer->set_name("output");
+  layer->set_type("exconv");
+  layer->set_num_filters(kNumFilters);
+  layer->set_shared_biases(true);
+  layer->set_bias_parameter_name("_output.b");
+  layer->set_active_type("");
+  LayerInputConfig* in = layer->add_inputs();
+  in->set_input_layer_name("input");
+  in->set_input_parameter_name("_output.w");
+  ConvConfig* conv = in->mutable_conv_conf();
+  conv->set_channels(kChannels);
+  conv->set_filter_size(kFilterSize);
+  conv->set_filter_size_y(kFilterSize);
+  conv->set_stride(2);
+  conv->set_stride_y(2);
+  conv->set_padding(1);
+  conv->set_padding_y(1);
+  conv->set_groups(kGroups);
+  conv->set_filter_channels(kChannels / kGroups);
+  conv->set_img_size(kImgSize);
+  conv->set_img_size_y(kImgSize);
+  conv->set_caffe_mode(true);
+  size_t outputSize = (kImgSize + 2 - kFilterSize) / 2 + 1;
+  conv->set_output_x(outputSize);
+  conv->set_output_y(outputSize);
+  layer->set_size(outputSize * outputSize * kNumFilters);
+
+  size_t filterSize = kChannels / kGroups * kFilterSize * kFilterSize;
+  addParameter(
+      config, "_output.w", filterSize, kNumFilters, 1.0 / sqrt(filterSize));
+  addParameter(config, "_output.b", 1, kNumFilters, 1.0);
+  config.add_output_layer_names("output");
+  return config;
+}
+
+std::unique_ptr<NeuralNetwork> createNetwork(const ModelConfig& config) {
+  std::unique_ptr<NeuralNetwork> network(NeuralNetwork::create(config));
+  // without gradients, as GradientMachine::create() in testing mode.
+  network->init(config,
+                [](int paramId, Parameter* para) {
+                  para->enableType(PARAMETER_VALUE);
+                },
+                {PARAMETER_VALUE},
+                false);
+  network->randParameters();
+  return network;
+}
+
+MatrixPtr forward(NeuralNetwork& network, const std::vector<Argument>& inArgs) {
+  std::vector<Argument> outArgs;
+  network.forward(inArgs, &outArgs, PASS_TEST);
+  const MatrixPtr& value = outArgs[0].value;
+  MatrixPtr out =
+      Matrix::create(value->getHeight(), value->getWidth(), false, false);
+  out->copyFrom(*value);
+  return out;
+}
+
+MatrixPtr forward(NeuralNetwork& network,
+                  const std::vector<Argument>& inArgs,
+                  bool quantized) {
+  network.setQuantizeWeights(quantized);
+  return forward(network, inArgs);
+}
+
+/**
+ * The int8 output is close to the real one, relative to the largest output,
+ * but not equal to it, which would mean that the int8 path was not taken.
+ */
+void checkClose(const Matrix& expected, const Matrix& actual) {
+  ASSERT_EQ(expected.getElementCnt(), actual.getElementCnt());
+  real maxAbs = 0;
+  real maxDiff = 0;
+  for (size_t i = 0; i < expected.getElementCnt(); ++i) {
+    maxAbs = std::max(maxAbs, std::abs(expected.getData()[i]));
+    maxDiff = std::max(
+        maxDiff, std::abs(expected.getData()[i] - actual.getData()[i]));
+  }
+  EXPECT_GT(maxDiff, 0);
+  EXPECT_LT(maxDiff, 0.03 * maxAbs);
+}
+
+void testQuantizedWeights(const ModelConfig& config, size_t inputSize) {
+  std::unique_ptr<NeuralNetwork> network = createNetwork(config);
+  std::vector<Argument> inArgs(1);
+  inArgs[0].value = Matrix::create(kBatchSize, inputSize, false, false);
+  inArgs[0].value->randomizeUniform();
+
+  MatrixPtr expected = forward(*network, inArgs, false);
+  for (int pass = 0; pass < 2; ++pass) {
+    checkClose(*expected, *forward(*network, inArgs, true));
+  }
+
+  // a new value is quantized again before the next forward.
+  network->randParameters();
+  MatrixPtr out = forward(*network, inArgs, true);
+  checkClose(*forward(*network, inArgs, false), *out);
+}
+
+#ifndef PADDLE_TYPE_DOUBLE
+
+TEST(QuantizedWeights, fc) { testQuantizedWeights(makeFcConfig(), kInputSize); }
+
+TEST(QuantizedWeights, exconv) {
+  testQuantizedWeights(makeConvConfig(), kChannels * kImgSize * kImgSize);
+}
+
+TEST(QuantizedWeights, perMachine) {
+  ModelConfig config = makeFcConfig();
+  std::unique_ptr<NeuralNetwork> origin = createNetwork(config);
+  // as paddle_gradient_machine_create_shared_param().
+  std::unique_ptr<NeuralNetwork> slave(NeuralNetwork::create(config));
+  slave->init(config,
+              [&origin](int paramId, Parameter* para) {
+                auto& p = origin->getParameters()[paramId];
+                para->enableSharedType(PARAMETER_VALUE,
+                                       p->getBuf(PARAMETER_VALUE));
+                para->shareValueCache(*p);
+              },
+              {PARAMETER_VALUE},
+              false);
+  std::vector<Argument> inArgs(1);
+  inArgs[0].value = Matrix::create(kBatchSize, kInputSize, false, false);
+  inArgs[0].value->randomizeUniform();
+
+  // only the machine which is set quantizes its weights.
+  ASSERT_TRUE(origin->setQuantizeWeights(true));
+  ASSERT_TRUE(slave->setQuantizeWeights(false));
+  MatrixPtr expected = forward(*slave, inArgs);
+  checkClose(*expected, *forward(*origin, inArgs));
+  MatrixPtr out = forward(*slave, inArgs);
+  for (size_t i = 0; i < out->getElementCnt(); ++i) {
+    ASSERT_EQ(expected->getData()[i], out->getData()[i]);
+  }
+
+  // a write to the shared value is quantized again for both machines.
+  ParameterPtr para = origin->getParameters()[0];
+  para->getBuf(PARAMETER_VALUE)->uniform(-0.1, 0.1);
+  para->setValueUpdated();
+  expected = forward(*origin, inArgs, false);
+  checkClose(*expected, *forward(*slave, inArgs, true));
+}
+
+#endif
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  initMain(argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -14,6 +14,7 @@ limitations under the License. */
 
 #include <gtest/gtest.h>
 #include <paddle/gserver/gradientmachines/GradientMachine.h>
+#include <paddle/gserver/layers/AgentLayer.h>
 #include <paddle/parameter/ParameterUpdateFunctions.h>
 #include <paddle/trainer/Trainer.h>
 #include <paddle/trainer/TrainerInternal.h>
@@ -22,6 +23,7 @@ limitations under the License. */
 #include <paddle/utils/Version.h>
 
 DECLARE_int32(seed);
+DECLARE_bool(rnn_frame_views);
 
 using namespace paddle;  // NOLINT
 using namespace std;     // NOLINT
@@ -155,6 +157,30 @@ TEST(RecurrentGradientMachine, rnn_multi_unequalength_input) {
   }
 }
 
+TEST(RecurrentGradientMachine, frame_views) {
+  FLAGS_use_gpu = false;
+  const int num_passes = 2;
+  real cost[2][num_passes];
+  int64_t bytes[2];
+  for (bool views : {false, true}) {
+    FLAGS_rnn_frame_views = views;
+    int64_t before = getFrameCopyBytes();
+    CalCost("gserver/tests/sequence_nest_rnn.conf",
+            "gserver/tests/t1",
+            cost[views],
+            num_passes);
+    bytes[views] = getFrameCopyBytes() - before;
+  }
+  FLAGS_rnn_frame_views = true;
+  LOG(INFO) << "bytes copied between the groups and their frames: "
+            << bytes[false] << " without frame views, " << bytes[true]
+            << " with them";
+  for (int i = 0; i < num_passes; i++) {
+    EXPECT_EQ(cost[false][i], cost[true][i]);
+  }
+  EXPECT_LT(bytes[true], bytes[false]);
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
 
@@ -26,6 +26,27 @@ namespace paddle {
 
 const char* SPARSE_SUPPORT_ERROR = "Sparse Matrix/Vector is not supported.";
 
+/**
+ * Run job(row, col, numRows, numCols) on the blocks of a dimM x dimN cpu
+ * elementwise apply, in parallel when --tensor_apply_threads > 1. The blocks
+ * are ranges of rows, or ranges of columns when there is a single row and
+ * splitColumns is set. An operand used as a column vector may be accumulated
+ * into (binaryClassificationError2), so its apply is only split by rows.
+ */
+template <class Job>
+void cpuApplyBlocks(int dimM, int dimN, bool splitColumns, Job job) {
+  if (dimM > 1 || !splitColumns) {
+    tensorCpuParallelFor(dimM, dimN, 1, [&](size_t begin, size_t end) {
+      job(begin, 0, end - begin, dimN);
+    });
+  } else {
+    tensorCpuParallelFor(
+        dimN, dimM, kTensorCpuGrain, [&](size_t begin, size_t end) {
+          job(0, begin, dimM, end - begin);
+        });
+  }
+}
+
 template<class T>
 template <class Op>
 int BaseMatrixT<T>::applyUnary(Op op) {
@@ -51,7 +72,10 @@ int BaseMatrixT<T>::applyUnary(Op op, int numRows, int numCols,
   if (true == useGpu_) {
     hl_gpu_apply_unary_op(op, A, dimM, dimN, lda);
   } else {
-    hl_cpu_apply_unary_op(op, A, dimM, dimN, lda);
+    cpuApplyBlocks(dimM, dimN, true, [&](int row, int col, int rows,
+                                         int cols) {
+      hl_cpu_apply_unary_op(op, A + row * lda + col, rows, cols, lda);
+    });
   }
   return 0;
 }
@@ -108,8 +132,13 @@ int BaseMatrixT<T>::applyBinary(Op op, BaseMatrixT& b, int numRows, int numCols,
     hl_gpu_apply_binary_op<T, Op, bAsRowVector::value, bAsColVector::value>(
         op, A, B, dimM, dimN, lda, ldb);
   } else {
-    hl_cpu_apply_binary_op<T, Op, bAsRowVector::value, bAsColVector::value>(
-        op, A, B, dimM, dimN, lda, ldb);
+    cpuApplyBlocks(dimM, dimN, !bAsColVector::value, [&](int row, int col,
+                                                          int rows, int cols) {
+      T* bBlock = B + (bAsRowVector::value ? 0 : row * ldb) +
+                  (bAsColVector::value ? 0 : col);
+      hl_cpu_apply_binary_op<T, Op, bAsRowVector::value, bAsColVector::value>(
+          op, A + row * lda + col, bBlock, rows, cols, lda, ldb);
+    });
   }
 
   return 0;
@@ -184,9 +213,15 @@ int BaseMatrixT<T>::applyTernary(Op op, BaseMatrixT& b, BaseMatrixT& c,
       <T, Op, cAsRowVector::value, cAsColVector::value>(
         op, A, B, C, dimM, dimN, lda, ldb, ldc);
   } else {
-    hl_cpu_apply_ternary_op
-      <T, Op, cAsRowVector::value, cAsColVector::value>(
-        op, A, B, C, dimM, dimN, lda, ldb, ldc);
+    cpuApplyBlocks(dimM, dimN, !cAsColVector::value, [&](int row, int col,
+                                                          int rows, int cols) {
+      T* cBlock = C + (cAsRowVector::value ? 0 : row * ldc) +
+                  (cAsColVector::value ? 0 : col);
+      hl_cpu_apply_ternary_op
+        <T, Op, cAsRowVector::value, cAsColVector::value>(
+          op, A + row * lda + col, B + row * ldb + col, cBlock,
+          rows, cols, lda, ldb, ldc);
+    });
   }
 
   return 0;
@@ -253,8 +288,13 @@ int BaseMatrixT<T>::applyQuaternary(Op op, BaseMatrixT& b, BaseMatrixT& c,
     hl_gpu_apply_quaternary_op(op, A, B, C, D, dimM, dimN, lda, ldb,
                                ldc, ldd);
   } else {
-    hl_cpu_apply_quaternary_op(op, A, B, C, D, dimM, dimN, lda, ldb,
-                               ldc, ldd);
+    cpuApplyBlocks(dimM, dimN, true, [&](int row, int col, int rows,
+                                         int cols) {
+      hl_cpu_apply_quaternary_op(op, A + row * lda + col,
+                                 B + row * ldb + col, C + row * ldc + col,
+                                 D + row * ldd + col, rows, cols, lda, ldb,
+                                 ldc, ldd);
+    });
   }
 
   return 0;
@@ -355,7 +395,13 @@ void BaseMatrixT<T>::neg() { applyUnary(unary::Neg<T>()); }
 
 DEFINE_MATRIX_UNARY_OP(Exp, a = exp(a));
 template<>
-void BaseMatrixT<real>::exp2() { applyUnary(unary::Exp<real>()); }
+void BaseMatrixT<real>::exp2() {
+  if (useGpu_ || stride_ != width_) {
+    applyUnary(unary::Exp<real>());
+  } else {
+    vExp(height_ * width_, data_, data_);
+  }
+}
 
 DEFINE_MATRIX_UNARY_OP(Log, a = log(a));
 template<>
@@ -691,27 +737,7 @@ void BaseMatrixT<real>::sigmoid(BaseMatrixT& b) {
     size_t dim = this->width_;
     CHECK_EQ(b.height_, numSamples);
     CHECK_EQ(b.width_, dim);
-    const real* in = this->data_;
-    real* out = b.data_;
-
-    // out = - in
-    const float THRESHOLD_MIN = -40.0;  // make sure sigmoid(x) > 0
-    const float THRESHOLD_MAX = 13.0;   // make sure sigmoid(x) < 1
-    for (size_t i = 0; i < numSamples * dim; ++i) {
-      real tmp = in[i];
-      tmp = (tmp < THRESHOLD_MIN)
-                ? THRESHOLD_MIN
-                : ((tmp > THRESHOLD_MAX) ? THRESHOLD_MAX : tmp);
-      out[i] = -tmp;
-    }
-
-    // out = exp(out)
-    vExp(numSamples * dim, out, out);
-
-    // out = 1 / (1 + out)
-    for (size_t i = 0; i < numSamples * dim; ++i) {
-      out[i] = 1 / (1 + out[i]);
-    }
+    vSigmoid(numSamples * dim, this->data_, b.data_);
   }
 }
 
@@ -736,7 +762,13 @@ void BaseMatrixT<T>::sign2(BaseMatrixT& b) {
 DEFINE_MATRIX_BINARY_OP(Exp, a = exp(b));
 template<>
 void BaseMatrixT<real>::exp2(BaseMatrixT& b) {
-  applyBinary(binary::Exp<real>(), b);
+  if (useGpu_ || stride_ != width_ || b.stride_ != b.width_) {
+    applyBinary(binary::Exp<real>(), b);
+  } else {
+    CHECK_EQ(b.height_, height_);
+    CHECK_EQ(b.width_, width_);
+    vExp(height_ * width_, b.data_, data_);
+  }
 }
 
 DEFINE_MATRIX_BINARY_OP(Log, a = log(b));
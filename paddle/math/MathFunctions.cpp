@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include "MathFunctions.h"
+#include "SIMDFunctions.h"
 #include "hl_matrix_apply.cuh"
 #include "hl_matrix_ops.cuh"
 #include "paddle/utils/DynamicLoader.h"
@@ -282,6 +283,11 @@ void vExp(const int n, const T* a, T* r) {
       binary::vExp<T>(), const_cast<T*>(a), r, 1, n, n, n);
 }
 
+template <>
+void vExp<float>(const int n, const float* a, float* r) {
+  simd::vExp(r, a, n);
+}
+
 DEFINE_MATRIX_BINARY_OP(vLog, b = std::log(a));
 template <class T>
 void vLog(const int n, const T* a, T* r) {
@@ -289,6 +295,11 @@ void vLog(const int n, const T* a, T* r) {
       binary::vLog<T>(), const_cast<T*>(a), r, 1, n, n, n);
 }
 
+template <>
+void vLog<float>(const int n, const float* a, float* r) {
+  simd::vLog(r, a, n);
+}
+
 DEFINE_MATRIX_BINARY_OP(vInvSqrt, b = 1.0f / std::sqrt(a));
 template <class T>
 void vInvSqrt(const int n, const T* a, T* r) {
@@ -303,6 +314,11 @@ void vLog1p(const int n, const T* a, T* r) {
       binary::vLog1p<T>(), const_cast<T*>(a), r, 1, n, n, n);
 }
 
+template <>
+void vLog1p<float>(const int n, const float* a, float* r) {
+  simd::vLog1p(r, a, n);
+}
+
 DEFINE_MATRIX_BINARY_OP(vTanh, T tmp = -2.0 * a;
                         tmp = (tmp > EXP_MAX_INPUT) ? EXP_MAX_INPUT : tmp;
                         b = 2.0 / (1.0 + std::exp(tmp)) - 1.0);
@@ -312,6 +328,11 @@ void vTanh(const int n, const T* a, T* r) {
       binary::vTanh<T>(), const_cast<T*>(a), r, 1, n, n, n);
 }
 
+template <>
+void vTanh<float>(const int n, const float* a, float* r) {
+  simd::vTanh(r, a, n);
+}
+
 DEFINE_MATRIX_BINARY_PARAMETER_OP(vPow, ONE_PARAMETER, b = std::pow(a, p));
 template <class T>
 void vPow(const int n, const T* a, const T b, T* r) {
@@ -333,15 +354,11 @@ void vAdd(const int n, const T* a, const T* b, T* r) {
                                                      n);
 }
 
-template void vExp(const int n, const float* a, float* r);
 template void vExp(const int n, const double* a, double* r);
-template void vLog(const int n, const float* a, float* r);
 template void vLog(const int n, const double* a, double* r);
 template void vInvSqrt(const int n, const double* a, double* r);
 template void vInvSqrt(const int n, const float* a, float* r);
-template void vLog1p(const int n, const float* a, float* r);
 template void vLog1p(const int n, const double* a, double* r);
-template void vTanh(const int n, const float* a, float* r);
 template void vTanh(const int n, const double* a, double* r);
 template void vPow(const int n, const float* a, const float b, float* r);
 template void vPow(const int n, const double* a, const double b, double* r);
@@ -350,4 +367,23 @@ template void vAdd(const int n, const double* a, const double* b, double* r);
 
 #endif
 
+DEFINE_MATRIX_BINARY_OP(vSigmoid, const T THRESHOLD_MIN = -40.0;
+                        const T THRESHOLD_MAX = 13.0;
+                        T tmp = (a < THRESHOLD_MIN)
+                                    ? THRESHOLD_MIN
+                                    : ((a > THRESHOLD_MAX) ? THRESHOLD_MAX : a);
+                        b = 1.0 / (1.0 + std::exp(-tmp)));
+template <class T>
+void vSigmoid(const int n, const T* a, T* r) {
+  hl_cpu_apply_binary_op<T, binary::vSigmoid<T>, 0, 0>(
+      binary::vSigmoid<T>(), const_cast<T*>(a), r, 1, n, n, n);
+}
+
+template <>
+void vSigmoid<float>(const int n, const float* a, float* r) {
+  simd::vSigmoid(r, a, n);
+}
+
+template void vSigmoid(const int n, const double* a, double* r);
+
 }  // namespace paddle
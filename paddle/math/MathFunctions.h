@@ -104,6 +104,130 @@ void vLog1p(const int n, const T* a, T* r);
 template <class T>
 void vTanh(const int n, const T* a, T* r);
 
+/// r = 1 / (1 + exp(-a)), with a clipped to [-40, 13] so that 0 < r < 1.
+template <class T>
+void vSigmoid(const int n, const T* a, T* r);
+
+/// The explicit specializations defined in MathFunctions.cpp.
+template <>
+void gemm<float>(const CBLAS_TRANSPOSE transA,
+                 const CBLAS_TRANSPOSE transB,
+                 const int M,
+                 const int N,
+                 const int K,
+                 const float alpha,
+                 const float* A,
+                 const int lda,
+                 const float* B,
+                 const int ldb,
+                 const float beta,
+                 float* C,
+                 const int ldc);
+
+template <>
+void gemm<double>(const CBLAS_TRANSPOSE transA,
+                  const CBLAS_TRANSPOSE transB,
+                  const int M,
+                  const int N,
+                  const int K,
+                  const double alpha,
+                  const double* A,
+                  const int lda,
+                  const double* B,
+                  const int ldb,
+                  const double beta,
+                  double* C,
+                  const int ldc);
+
+template <>
+int getrf<float>(const CBLAS_ORDER order,
+                 const int M,
+                 const int N,
+                 float* A,
+                 const int lda,
+                 int* ipiv);
+
+template <>
+int getrf<double>(const CBLAS_ORDER order,
+                  const int M,
+                  const int N,
+                  double* A,
+                  const int lda,
+                  int* ipiv);
+
+template <>
+int getri<float>(const CBLAS_ORDER order,
+                 const int N,
+                 float* A,
+                 const int lda,
+                 const int* ipiv);
+
+template <>
+int getri<double>(const CBLAS_ORDER order,
+                  const int N,
+                  double* A,
+                  const int lda,
+                  const int* ipiv);
+
+template <>
+void axpy<float>(const int n, const float alpha, const float* x, float* y);
+
+template <>
+void axpy<double>(const int n, const double alpha, const double* x, double* y);
+
+template <>
+float dotProduct<float>(const int n, const float* x, const float* y);
+
+template <>
+double dotProduct<double>(const int n, const double* x, const double* y);
+
+template <>
+void vExp<float>(const int n, const float* a, float* r);
+
+template <>
+void vLog<float>(const int n, const float* a, float* r);
+
+template <>
+void vLog1p<float>(const int n, const float* a, float* r);
+
+template <>
+void vTanh<float>(const int n, const float* a, float* r);
+
+template <>
+void vSigmoid<float>(const int n, const float* a, float* r);
+
+#ifdef PADDLE_USE_MKL
+template <>
+void vExp<double>(const int n, const double* a, double* r);
+
+template <>
+void vPow<float>(const int n, const float* a, const float b, float* r);
+
+template <>
+void vPow<double>(const int n, const double* a, const double b, double* r);
+
+template <>
+void vLog<double>(const int n, const double* a, double* r);
+
+template <>
+void vAdd<float>(const int n, const float* a, const float* b, float* r);
+
+template <>
+void vAdd<double>(const int n, const double* a, const double* b, double* r);
+
+template <>
+void vInvSqrt<float>(const int n, const float* a, float* r);
+
+template <>
+void vInvSqrt<double>(const int n, const double* a, double* r);
+
+template <>
+void vLog1p<double>(const int n, const double* a, double* r);
+
+template <>
+void vTanh<double>(const int n, const double* a, double* r);
+#endif
+
 }  // namespace paddle
 
 #endif  // MATHFUNCTIONS_H_
@@ -14,6 +14,8 @@ limitations under the License. */
 
 #include "MathUtils.h"
 #include <algorithm>
+#include "SIMDFunctions.h"
+#include "TensorExpression.h"
 #include "Vector.h"
 #include "paddle/utils/Logging.h"
 
@@ -94,4 +96,15 @@ int imageSize(
   return imageSize;
 }
 
+void cpuBatchTranspose(
+    const real* input, real* output, int width, int height, int batchSize) {
+  size_t size = (size_t)width * height;
+  tensorCpuParallelFor(batchSize, size, 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      simd::transpose(
+          output + i * size, height, input + i * size, width, height, width);
+    }
+  });
+}
+
 }  // namespace paddle
@@ -14,6 +14,8 @@ limitations under the License. */
 
 #pragma once
 
+#include "paddle/utils/Common.h"
+
 namespace paddle {
 
 /**
@@ -67,4 +69,12 @@ int outputSize(
 int imageSize(
     int outputSize, int filterSize, int padding, int stride, bool caffeMode);
 
+/**
+ * Cpu counterpart of batchTranspose() in hl_batch_transpose.h. Each of the
+ * batchSize height x width matrices in input, stored one after another, is
+ * transposed into a width x height matrix at the same offset of output.
+ */
+void cpuBatchTranspose(
+    const real* input, real* output, int width, int height, int batchSize);
+
 }  // namespace paddle
@@ -14,8 +14,10 @@ limitations under the License. */
 
 #include "Matrix.h"
 #include "MathFunctions.h"
+#include "MemoryArena.h"
 #include "SparseMatrix.h"
 #include "SparseRowMatrix.h"
+#include "Storage.h"
 
 #include <float.h>
 #include <algorithm>
@@ -121,9 +123,17 @@ MatrixPtr Matrix::create(MemoryHandlePtr memHandle,
   }
 }
 
-MatrixPtr Matrix::create(size_t height, size_t width, bool trans, bool useGpu) {
+MatrixPtr Matrix::create(
+    size_t height, size_t width, bool trans, bool useGpu, bool tmp) {
   if (useGpu) {
     return std::make_shared<GpuMatrix>(height, width, trans);
+  }
+  MemoryArena* arena =
+      tmp ? StorageEngine::singleton()->getCpuArena() : nullptr;
+  if (arena && height * width > 0) {
+    auto handle = std::make_shared<ArenaMemoryHandle>(
+        arena, height * width * sizeof(real));
+    return std::make_shared<CpuMatrix>(handle, height, width, trans);
   } else {
     return std::make_shared<CpuMatrix>(height, width, trans);
   }
@@ -1645,6 +1655,7 @@ void CpuMatrix::resize(size_t newHeight, size_t newWidth) {
   width_ = newWidth;
   elementCnt_ = newSize;
   stride_ = width_;
+  releasePackedForMul();
 }
 
 real CpuMatrix::getElement(size_t x, size_t y) const {
@@ -1706,11 +1717,11 @@ void CpuMatrix::transpose(MatrixPtr& matTrans, bool memAlloc) {
   int lda = getStride();
   int ldc = matTrans->getStride();
 
-  for (size_t i = 0; i < height_; i++) {
-    for (size_t j = 0; j < width_; j++) {
-      dataTrans[j * ldc + i] = data[i * lda + j];
-    }
-  }
+  // every thread transposes a stripe of rows into a stripe of columns.
+  tensorCpuParallelFor(height_, width_, 32, [&](size_t begin, size_t end) {
+    simd::transpose(
+        dataTrans + begin, ldc, data + begin * lda, lda, end - begin, width_);
+  });
 }
 
 void CpuMatrix::rotate(MatrixPtr& matRot, bool memAlloc, bool clockWise) {
@@ -1723,16 +1734,28 @@ void CpuMatrix::rotate(MatrixPtr& matRot, bool memAlloc, bool clockWise) {
   }
   real* dataRot = matRot->getData();
   real* data = getData();
-
-  for (size_t i = 0; i < height_; i++) {
-    for (size_t j = 0; j < width_; j++) {
-      if (clockWise) {
-        dataRot[j * height_ + i] = data[(height_ - i - 1) * width_ + j];
-      } else {
-        dataRot[j * height_ + i] = data[i * width_ + (width_ - j - 1)];
-      }
+  int lda = width_;
+  int ldc = height_;
+
+  // Clockwise is the transpose of the matrix read from its last row up,
+  // anti-clockwise is the transpose written from the last row of matRot up.
+  tensorCpuParallelFor(height_, width_, 32, [&](size_t begin, size_t end) {
+    if (clockWise) {
+      simd::transpose(dataRot + begin,
+                      ldc,
+                      data + (height_ - 1 - begin) * lda,
+                      -lda,
+                      end - begin,
+                      width_);
+    } else {
+      simd::transpose(dataRot + (width_ - 1) * ldc + begin,
+                      -ldc,
+                      data + begin * lda,
+                      lda,
+                      end - begin,
+                      width_);
     }
-  }
+  });
 }
 
 MatrixPtr CpuMatrix::getInverse() {
@@ -2426,10 +2449,46 @@ void CpuMatrix::mul(CpuMatrix* a, CpuMatrix* b, real scaleAB, real scaleT) {
   int lda = a->getStride();
   int ldb = b->getStride();
   int ldc = getStride();
+  if (b->isPackedForMul() && a_trans == CblasNoTrans) {
+    // the panels of columns are independent.
+    const real* packed = reinterpret_cast<real*>(b->packedForMul_->getBuf());
+    size_t numPanels = (N + simd::kGemmPanelWidth - 1) / simd::kGemmPanelWidth;
+    tensorCpuParallelFor(numPanels, M * K, 1, [&](size_t begin, size_t end) {
+      size_t col = begin * simd::kGemmPanelWidth;
+      simd::gemmPackedB(C + col,
+                        ldc,
+                        A,
+                        lda,
+                        packed + col * K,
+                        M,
+                        std::min(end * simd::kGemmPanelWidth, (size_t)N) - col,
+                        K,
+                        scaleAB,
+                        scaleT);
+    });
+    return;
+  }
   gemm<real>(
       a_trans, b_trans, M, N, K, scaleAB, A, lda, B, ldb, scaleT, C, ldc);
 }
 
+void CpuMatrix::packForMul() {
+  size_t K = isTransposed() ? getWidth() : getHeight();
+  size_t N = isTransposed() ? getHeight() : getWidth();
+  size_t size = simd::packedGemmBSize(K, N) * sizeof(real);
+  // a copy shared through setPackedForMul() is not packed over.
+  if (!packedForMul_ || packedForMul_.use_count() > 1 ||
+      packedForMul_->getAllocSize() < size) {
+    packedForMul_ = std::make_shared<CpuMemoryHandle>(size);
+  }
+  simd::packGemmB(reinterpret_cast<real*>(packedForMul_->getBuf()),
+                  getData(),
+                  getStride(),
+                  isTransposed(),
+                  K,
+                  N);
+}
+
 void CpuMatrix::mul(
     CpuMatrix* a, CpuMatrix* b, CpuSparseMatrix* c, real scaleAB, real scaleT) {
   CHECK(!c->isTransposed()) << "Not supported";
@@ -106,10 +106,17 @@ public:
                           size_t height,
                           size_t width,
                           bool trans = false);
+  /**
+   * @param tmp  The matrix is a temporary which is released before the end
+   *             of the current batch. A cpu matrix is then allocated from
+   *             the arena bound to the thread (StorageEngine::getCpuArena())
+   *             if there is one.
+   */
   static MatrixPtr create(size_t height,
                           size_t width,
                           bool trans = false,
-                          bool useGpu = false);
+                          bool useGpu = false,
+                          bool tmp = false);
   static MatrixPtr create(real* data,
                           size_t height,
                           size_t width,
@@ -1672,6 +1679,23 @@ public:
   void mul(const Matrix& a, const Matrix& b, real scaleAB, real scaleT);
   void mul(CpuMatrix* a, CpuMatrix* b, real scaleAB, real scaleT);
 
+  /**
+   * Keep a copy of this matrix packed by simd::packGemmB(), which every
+   * following mul(a, this) with an untransposed a uses instead of cblas.
+   * Meant for weights that stay unchanged over many small batches: the
+   * copy is not updated with the data, so it must be packed again or
+   * released after the data changes.
+   */
+  void packForMul();
+  void releasePackedForMul() { packedForMul_.reset(); }
+  bool isPackedForMul() const { return packedForMul_ != nullptr; }
+  /// The copy of packForMul(), which another matrix with the same data
+  /// can use through setPackedForMul().
+  const CpuMemHandlePtr& getPackedForMul() const { return packedForMul_; }
+  void setPackedForMul(const CpuMemHandlePtr& packed) {
+    packedForMul_ = packed;
+  }
+
   void mul(CpuMatrix* a, CpuSparseMatrix* b, real scaleAB, real scaleT);
 
   static void mul(CpuMatrix* a,
@@ -1817,6 +1841,10 @@ public:
   void operator=(const ExpressionType& expr) {
     TensorCpuApply<real>(*this, expr);
   }
+
+private:
+  /// The copy made by packForMul(), null when the matrix is not packed.
+  CpuMemHandlePtr packedForMul_;
 };
 
 class SharedCpuMatrix : public CpuMatrix {
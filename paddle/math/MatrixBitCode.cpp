@@ -12,280 +12,445 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
-#include "Matrix.h"
+#include "MatrixBitCode.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <sstream>
+#include "SIMDFunctions.h"
 #include "hl_gpu.h"
 #include "paddle/utils/Logging.h"
 #include "paddle/utils/Util.h"
 
 namespace paddle {
 
-namespace {
+BitCodeTree::BitCodeTree(size_t numClasses)
+    : numClasses_(numClasses), maxCodeLength_(findLastSet(numClasses - 1)) {
+  CHECK_GE(numClasses, 2UL);
+}
 
-struct SimpleCode {
-  SimpleCode(size_t code, size_t numClasses) : c_(code + numClasses) {}
-  inline size_t calcIndex(int bit) const { return (c_ >> (bit + 1)) - 1; }
-  inline bool calcBit(int bit) const { return c_ & (1 << bit); }
-  inline int getLength() const { return findLastSet(c_) - 1; }
+BitCodeTree::BitCodeTree(std::vector<size_t> offsets,
+                         std::vector<int> nodes,
+                         std::vector<uint8_t> bits)
+    : numClasses_(offsets.size() - 1),
+      maxCodeLength_(0),
+      offsets_(std::move(offsets)),
+      nodes_(std::move(nodes)),
+      bits_(std::move(bits)) {
+  CHECK_GE(offsets_.size(), 3UL) << "A tree needs at least 2 classes";
+  CHECK_EQ(offsets_.front(), 0UL);
+  CHECK_EQ(offsets_.back(), nodes_.size());
+  CHECK_EQ(bits_.size(), nodes_.size());
+  for (size_t c = 0; c < numClasses_; ++c) {
+    CHECK_LT(offsets_[c], offsets_[c + 1]) << "Class " << c << " has no code";
+    maxCodeLength_ =
+        std::max(maxCodeLength_, (int)(offsets_[c + 1] - offsets_[c]));
+  }
+  for (int node : nodes_) {
+    CHECK(node >= 0 && (size_t)node < numClasses_ - 1)
+        << "The internal nodes of " << numClasses_ << " classes are 0 to "
+        << numClasses_ - 2 << ", not " << node;
+  }
+}
+
+BitCodeTreePtr BitCodeTree::createHuffman(const std::vector<int64_t>& counts) {
+  size_t numClasses = counts.size();
+  CHECK_GE(numClasses, 2UL) << "A tree needs at least 2 classes";
+  // the leaves are 0 to numClasses - 1, internal node k is numClasses + k.
+  typedef std::pair<int64_t, size_t> Item;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+  for (size_t c = 0; c < numClasses; ++c) {
+    queue.push(Item(counts[c], c));
+  }
+  std::vector<size_t> parent(2 * numClasses - 1);
+  std::vector<uint8_t> isRight(2 * numClasses - 1);
+  for (size_t id = numClasses; id < 2 * numClasses - 1; ++id) {
+    Item left = queue.top();
+    queue.pop();
+    Item right = queue.top();
+    queue.pop();
+    parent[left.second] = parent[right.second] = id;
+    isRight[left.second] = 0;
+    isRight[right.second] = 1;
+    queue.push(Item(left.first + right.first, id));
+  }
 
-private:
-  size_t c_;
-};
+  size_t root = 2 * numClasses - 2;
+  std::vector<size_t> offsets = {0};
+  std::vector<int> nodes;
+  std::vector<uint8_t> bits;
+  for (size_t c = 0; c < numClasses; ++c) {
+    for (size_t id = c; id != root; id = parent[id]) {
+      nodes.push_back(parent[id] - numClasses);
+      bits.push_back(isRight[id]);
+    }
+    offsets.push_back(nodes.size());
+  }
+  return std::make_shared<BitCodeTree>(
+      std::move(offsets), std::move(nodes), std::move(bits));
+}
 
-struct SimpleCodeTable {
-  explicit SimpleCodeTable(size_t numClasses) : numClasses_(numClasses) {}
-  SimpleCode operator()(size_t code) const {
-    return SimpleCode(code, numClasses_);
+BitCodeTreePtr BitCodeTree::load(const std::string& path) {
+  std::ifstream in(path);
+  CHECK(in) << "Fail to open " << path;
+  std::vector<std::vector<int64_t>> lines;
+  bool allCounts = true;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream tokens(line);
+    std::vector<int64_t> values;
+    int64_t value;
+    while (tokens >> value) {
+      values.push_back(value);
+    }
+    CHECK(tokens.eof()) << path << ":" << lines.size() + 1
+                        << ": not a list of integers";
+    CHECK(!values.empty()) << path << ":" << lines.size() + 1 << ": empty";
+    allCounts = allCounts && values.size() == 1;
+    lines.push_back(std::move(values));
   }
-  size_t size() const { return numClasses_; }
-  int getMaxCodeLength() const { return findLastSet(numClasses_ - 1); }
-
-private:
-  size_t numClasses_;
-  int maxCodeLength_;
-};
-
-}  // namespace
-
-/**
- * CodeTable class should support 3 functions:
- *
- * size_t size()
- *   return the number of codes
- *
- * int getMaxCodeLength()
- *   return the maximal code length
- *
- * Code operator()(size_t i)
- *   return the i-th code. Code class is descriebed below.
- *
- * Code class should support 3 functions:
- *
- * int getLength()
- *   return the length of the code
- *
- * bool calcIndex(int bit)
- *   bit ranges from 0 to getLength() - 1
- *   return the index for the (1+bit) level parent
- *
- * bool calcBit(int bit)
- *   return true if the bit level parent is the right child of (1+bit) level
- *   parent
- *
- */
 
-/*
-   for i:
-     for j < codeLength:
-       op(tmat(i, j), vec(0, index(i, j)))
-*/
-template <class CodeTable, class Op, class TMat, class Mat>
-static void addByBitCodeT(
-    Op op, CodeTable codeTable, const IVector& codes, TMat& tmat, Mat& vec) {
-  CHECK(!vec.useGpu());
+  if (allCounts) {
+    std::vector<int64_t> counts;
+    for (auto& values : lines) {
+      counts.push_back(values[0]);
+    }
+    return createHuffman(counts);
+  }
+  std::vector<size_t> offsets = {0};
+  std::vector<int> nodes;
+  std::vector<uint8_t> bits;
+  for (size_t c = 0; c < lines.size(); ++c) {
+    CHECK_EQ(lines[c].size() % 2, 0UL)
+        << path << ":" << c + 1 << ": a code is a list of 'node bit' pairs";
+    for (size_t k = 0; k < lines[c].size(); k += 2) {
+      nodes.push_back(lines[c][k]);
+      bits.push_back(lines[c][k + 1] != 0);
+    }
+    offsets.push_back(nodes.size());
+  }
+  return std::make_shared<BitCodeTree>(
+      std::move(offsets), std::move(nodes), std::move(bits));
+}
+
+int BitCodeTree::getCode(size_t c, int* nodes, uint8_t* bits) const {
+  CHECK_LT(c, numClasses_);
+  if (offsets_.empty()) {
+    size_t code = c + numClasses_;
+    int length = findLastSet(code) - 1;
+    for (int j = 0; j < length; ++j) {
+      nodes[j] = (code >> (j + 1)) - 1;
+      bits[j] = (code >> j) & 1;
+    }
+    return length;
+  }
+  int length = offsets_[c + 1] - offsets_[c];
+  std::copy_n(nodes_.begin() + offsets_[c], length, nodes);
+  std::copy_n(bits_.begin() + offsets_[c], length, bits);
+  return length;
+}
 
-  size_t numClasses = codeTable.size();
-  size_t maxCodeLength = codeTable.getMaxCodeLength();
-  size_t numSamples = tmat.getHeight();
-  size_t oWidth = tmat.getWidth();
-  CHECK_EQ(tmat.getWidth(), maxCodeLength);
-  CHECK_EQ(codes.getSize(), numSamples);
-  CHECK_EQ(vec.getHeight(), (size_t)1);
-  CHECK_EQ(vec.getWidth(), numClasses - 1);
-
-  auto data = tmat.getData();
-  auto v = vec.getData();
-  const int* c = codes.getData();
+void BitCodeBatch::reset(const BitCodeTree& tree, const IVector& labels) {
+  CHECK(!labels.useGpu());
+  size_t numSamples = labels.getSize();
+  numNodes_ = tree.getNumClasses() - 1;
+  maxCodeLength_ = tree.getMaxCodeLength();
+  lengths_.resize(numSamples);
+  nodes_.resize(numSamples * maxCodeLength_);
+  bits_.resize(numSamples * maxCodeLength_);
+  const int* ids = labels.getData();
   for (size_t i = 0; i < numSamples; ++i) {
-    auto code = codeTable(c[i]);
-    int codeLength = code.getLength();
-    for (int j = 0; j < codeLength; ++j) {
-      size_t index = code.calcIndex(j);
-      op(data[i * oWidth + j], v[index]);
+    lengths_[i] = tree.getCode(ids[i],
+                               nodes_.data() + i * maxCodeLength_,
+                               bits_.data() + i * maxCodeLength_);
+  }
+  grouped_ = false;
+}
+
+void BitCodeBatch::groupByNode() {
+  if (grouped_) return;
+  // a radix sort of the (node, pair) keys by node, 11 bits per pass, is
+  // cheaper than counting over all the nodes of a large tree. The keys are
+  // made in increasing pair order and every pass is stable.
+  keys_.clear();
+  for (size_t i = 0; i < lengths_.size(); ++i) {
+    for (int j = 0; j < lengths_[i]; ++j) {
+      uint64_t pair = i * maxCodeLength_ + j;
+      keys_.push_back((uint64_t)nodes_[pair] << 32 | pair);
+    }
+  }
+  const int kRadixBits = 11;
+  std::vector<size_t> counts(1 << kRadixBits);
+  sortedKeys_.resize(keys_.size());
+  size_t maxNode = numNodes_ > 0 ? numNodes_ - 1 : 0;
+  for (int shift = 32; maxNode >> (shift - 32) > 0; shift += kRadixBits) {
+    std::fill(counts.begin(), counts.end(), 0);
+    for (uint64_t key : keys_) {
+      ++counts[(key >> shift) & ((1 << kRadixBits) - 1)];
+    }
+    size_t start = 0;
+    for (size_t& count : counts) {
+      std::swap(count, start);
+      start += count;
+    }
+    for (uint64_t key : keys_) {
+      sortedKeys_[counts[(key >> shift) & ((1 << kRadixBits) - 1)]++] = key;
+    }
+    keys_.swap(sortedKeys_);
+  }
+
+  groupNodes_.clear();
+  groupStarts_.clear();
+  groupPairs_.resize(keys_.size());
+  size_t maxGroupSize = 0;
+  for (size_t k = 0; k < keys_.size(); ++k) {
+    int node = keys_[k] >> 32;
+    if (groupNodes_.empty() || groupNodes_.back() != node) {
+      if (!groupStarts_.empty()) {
+        maxGroupSize = std::max(maxGroupSize, k - groupStarts_.back());
+      }
+      groupNodes_.push_back(node);
+      groupStarts_.push_back(k);
+    }
+    groupPairs_[k] = keys_[k] & 0xFFFFFFFF;
+  }
+  if (!groupStarts_.empty()) {
+    maxGroupSize = std::max(maxGroupSize, keys_.size() - groupStarts_.back());
+  }
+  groupStarts_.push_back(keys_.size());
+  rows_.resize(std::max(maxGroupSize, (size_t)maxCodeLength_));
+  values_.resize(maxGroupSize);
+  grouped_ = true;
+}
+
+const std::vector<int>& BitCodeBatch::getNodes() {
+  groupByNode();
+  return groupNodes_;
+}
+
+void BitCodeBatch::checkShape(const Matrix& tmat) const {
+  CHECK(!tmat.useGpu());
+  CHECK_EQ(tmat.getHeight(), lengths_.size());
+  CHECK_EQ(tmat.getWidth(), (size_t)maxCodeLength_);
+}
+
+/// The rows of weights, which may be sparse row matrices.
+static inline real* rowOf(const Matrix& mat, size_t row) {
+  return const_cast<Matrix&>(mat).getRowBuf(row);
+}
+
+static inline const real* inputRow(const Matrix& mat, size_t row) {
+  return mat.getData() + row * mat.getStride();
+}
+
+void BitCodeBatch::addByBitCode(Matrix& tmat, const Matrix& vec) {
+  checkShape(tmat);
+  CHECK(!vec.useGpu());
+  CHECK_EQ(vec.getHeight(), 1UL);
+  CHECK_EQ(vec.getWidth(), numNodes_);
+  const real* v = vec.getData();
+  for (size_t i = 0; i < lengths_.size(); ++i) {
+    real* t = tmat.getData() + i * tmat.getStride();
+    const int* nodes = nodes_.data() + i * maxCodeLength_;
+    for (int j = 0; j < lengths_[i]; ++j) {
+      t[j] += v[nodes[j]];
+    }
+  }
+}
+
+void BitCodeBatch::addByBitCodeBackward(const Matrix& tmat, Matrix& vec) {
+  checkShape(tmat);
+  CHECK(!vec.useGpu());
+  CHECK_EQ(vec.getHeight(), 1UL);
+  CHECK_EQ(vec.getWidth(), numNodes_);
+  real* v = vec.getData();
+  for (size_t i = 0; i < lengths_.size(); ++i) {
+    const real* t = tmat.getData() + i * tmat.getStride();
+    const int* nodes = nodes_.data() + i * maxCodeLength_;
+    for (int j = 0; j < lengths_[i]; ++j) {
+      v[nodes[j]] += t[j];
     }
   }
 }
 
-/* For j < codeLength:
-   this(i, j) += vec(0, index(i, j))
+void BitCodeBatch::mulByBitCode(Matrix& tmat,
+                                const Matrix& weight,
+                                const Matrix& input) {
+  checkShape(tmat);
+  CHECK(!weight.useGpu() && !input.useGpu());
+  CHECK_EQ(input.getHeight(), lengths_.size());
+  CHECK_EQ(weight.getHeight(), numNodes_);
+  CHECK_EQ(weight.getWidth(), input.getWidth());
+  groupByNode();
+
+  size_t dim = input.getWidth();
+  for (size_t g = 0; g < groupNodes_.size(); ++g) {
+    const int* pairs = groupPairs_.data() + groupStarts_[g];
+    int size = groupStarts_[g + 1] - groupStarts_[g];
+    for (int k = 0; k < size; ++k) {
+      rows_[k] = inputRow(input, pairs[k] / maxCodeLength_);
+    }
+    simd::batchDot(values_.data(),
+                   (const real*)rowOf(weight, groupNodes_[g]),
+                   rows_.data(),
+                   size,
+                   dim);
+    for (int k = 0; k < size; ++k) {
+      tmat.getData()[pairs[k] / maxCodeLength_ * tmat.getStride() +
+                     pairs[k] % maxCodeLength_] += values_[k];
+    }
+  }
+}
+
+void BitCodeBatch::mulByBitCodeBackwardWeight(const Matrix& tmat,
+                                              Matrix& weight,
+                                              const Matrix& input) {
+  checkShape(tmat);
+  CHECK(!weight.useGpu() && !input.useGpu());
+  CHECK_EQ(input.getHeight(), lengths_.size());
+  CHECK_EQ(weight.getHeight(), numNodes_);
+  CHECK_EQ(weight.getWidth(), input.getWidth());
+  groupByNode();
+
+  size_t dim = input.getWidth();
+  for (size_t g = 0; g < groupNodes_.size(); ++g) {
+    const int* pairs = groupPairs_.data() + groupStarts_[g];
+    int size = groupStarts_[g + 1] - groupStarts_[g];
+    for (int k = 0; k < size; ++k) {
+      rows_[k] = inputRow(input, pairs[k] / maxCodeLength_);
+      values_[k] = tmat.getData()[pairs[k] / maxCodeLength_ *
+                                      tmat.getStride() +
+                                  pairs[k] % maxCodeLength_];
+    }
+    simd::batchAxpy(rowOf(weight, groupNodes_[g]),
+                    rows_.data(),
+                    (const real*)values_.data(),
+                    size,
+                    dim);
+  }
+}
+
+void BitCodeBatch::mulByBitCodeBackwardError(const Matrix& tmat,
+                                             const Matrix& weight,
+                                             Matrix& input) {
+  checkShape(tmat);
+  CHECK(!weight.useGpu() && !input.useGpu());
+  CHECK_EQ(input.getHeight(), lengths_.size());
+  CHECK_EQ(weight.getHeight(), numNodes_);
+  CHECK_EQ(weight.getWidth(), input.getWidth());
+  rows_.resize(std::max(rows_.size(), (size_t)maxCodeLength_));
+
+  // the input row of a sample takes all its bits while it is in registers.
+  size_t dim = input.getWidth();
+  for (size_t i = 0; i < lengths_.size(); ++i) {
+    const int* nodes = nodes_.data() + i * maxCodeLength_;
+    for (int j = 0; j < lengths_[i]; ++j) {
+      rows_[j] = rowOf(weight, nodes[j]);
+    }
+    simd::batchAxpy(input.getData() + i * input.getStride(),
+                    rows_.data(),
+                    (const real*)tmat.getData() + i * tmat.getStride(),
+                    lengths_[i],
+                    dim);
+  }
+}
+
+void BitCodeBatch::sumByBitCode(const Matrix& tmat,
+                                Matrix& sum,
+                                real scaleSum) {
+  checkShape(tmat);
+  CHECK(!sum.useGpu());
+  CHECK_EQ(sum.getHeight(), lengths_.size());
+  CHECK_EQ(sum.getWidth(), 1UL);
+  for (size_t i = 0; i < lengths_.size(); ++i) {
+    const real* t = tmat.getData() + i * tmat.getStride();
+    const uint8_t* bits = bits_.data() + i * maxCodeLength_;
+    real sm = 0;
+    for (int j = 0; j < lengths_[i]; ++j) {
+      if (bits[j]) {
+        sm += t[j];
+      }
+    }
+    sum.getData()[i * sum.getStride()] = scaleSum * sm;
+  }
+}
+
+void BitCodeBatch::subByBitCode(Matrix& tmat) {
+  checkShape(tmat);
+  for (size_t i = 0; i < lengths_.size(); ++i) {
+    real* t = tmat.getData() + i * tmat.getStride();
+    const uint8_t* bits = bits_.data() + i * maxCodeLength_;
+    for (int j = 0; j < lengths_[i]; ++j) {
+      t[j] -= bits[j];
+    }
+  }
+}
+
+/*
+   The Matrix functions below use the complete tree of numClasses classes,
+   in which the code of class c is c + numClasses without its leading 1:
+     node(i, j) = ((codes(i) + numClasses) >> (j + 1)) - 1
+     bit(i, j) = (codes(i) + numClasses) & 2^j
 */
+
 void CpuMatrix::addByBitCode(size_t numClasses,
                              const IVector& codes,
                              const Matrix& vec) {
-  auto op = [](real& t, real v) { t += v; };
-  addByBitCodeT(op, SimpleCodeTable(numClasses), codes, *this, vec);
+  BitCodeBatch batch;
+  batch.reset(BitCodeTree(numClasses), codes);
+  batch.addByBitCode(*this, vec);
 }
 
-/* For j < codeLength:
-   vec(0, index(i, j)) += this(i, j)
-*/
 void CpuMatrix::addByBitCodeBackward(size_t numClasses,
                                      const IVector& codes,
                                      Matrix& vec) {
-  auto op = [](real t, real& v) { v += t; };
-  addByBitCodeT(op, SimpleCodeTable(numClasses), codes, *this, vec);
+  BitCodeBatch batch;
+  batch.reset(BitCodeTree(numClasses), codes);
+  batch.addByBitCodeBackward(*this, vec);
 }
 
-/*
-  for i:
-    for j < codeLength:
-      op(tmat(i, j), mat.row(index(i, j)), input.row(i))
-*/
-template <class Op,
-          class CodeTable,
-          class IVec,
-          class TMat,
-          class WMat,
-          class InMat>
-void mulByBitCodeT(Op op,
-                   CodeTable codeTable,
-                   IVec& codes,
-                   TMat& tmat,
-                   WMat& weight,
-                   InMat& input) {
-  CHECK(!tmat.useGpu() && !weight.useGpu() && !input.useGpu());
-
-  size_t numClasses = codeTable.size();
-  size_t maxCodeLength = codeTable.getMaxCodeLength();
-  size_t numSamples = tmat.getHeight();
-  size_t inputDim = input.getWidth();
-  size_t oWidth = tmat.getWidth();
-  CHECK_EQ(tmat.getWidth(), maxCodeLength);
-  CHECK_EQ(codes.getSize(), numSamples);
-  CHECK_EQ(input.getHeight(), numSamples);
-  CHECK_EQ(weight.getHeight(), numClasses - 1);
-  CHECK_EQ(weight.getWidth(), inputDim);
-
-  real* data = tmat.getData();
-  const int* c = codes.getData();
-  for (size_t i = 0; i < numSamples; ++i) {
-    auto code = codeTable(c[i]);
-    int codeLength = code.getLength();
-    for (int j = 0; j < codeLength; ++j) {
-      size_t index = code.calcIndex(j);
-      op(data[i * oWidth + j], weight.rowBuf(index), input.rowBuf(i), inputDim);
-    }
-  }
-}
-
-/* For j < codeLength:
-   this(i, j) += <weight.row(index(i, j)), input.row(i)>
-*/
 void CpuMatrix::mulByBitCode(size_t numClasses,
                              const IVector& codes,
                              const Matrix& weight,
                              const Matrix& input) {
-  auto op = [](
-      real& t, const real* weightRow, const real* inputRow, size_t inputDim) {
-    real sum = 0;
-    for (size_t k = 0; k < inputDim; ++k) {
-      sum += weightRow[k] * inputRow[k];
-    }
-    t += sum;
-  };
-
-  mulByBitCodeT(op, SimpleCodeTable(numClasses), codes, *this, weight, input);
+  BitCodeBatch batch;
+  batch.reset(BitCodeTree(numClasses), codes);
+  batch.mulByBitCode(*this, weight, input);
 }
 
-/* For index(i, j) >= 0:
-   weight.row(index(i, j)) += this(i, j) * input.row(i)
-*/
 void CpuMatrix::mulByBitCodeBackwardWeight(size_t numClasses,
                                            const IVector& codes,
                                            Matrix& weight,
                                            const Matrix& input) {
-  auto op = [](
-      const real t, real* weightRow, const real* inputRow, size_t inputDim) {
-    for (size_t k = 0; k < inputDim; ++k) {
-      weightRow[k] += t * inputRow[k];
-    }
-  };
-
-  mulByBitCodeT(op, SimpleCodeTable(numClasses), codes, *this, weight, input);
+  BitCodeBatch batch;
+  batch.reset(BitCodeTree(numClasses), codes);
+  batch.mulByBitCodeBackwardWeight(*this, weight, input);
 }
 
-/* For j < codeLength:
-   input.row(i) += this(i, j) * weight.row(index(i, j))
-*/
 void CpuMatrix::mulByBitCodeBackwardError(size_t numClasses,
                                           const IVector& codes,
                                           const Matrix& weight,
                                           Matrix& input) {
-  auto op = [](
-      const real t, const real* weightRow, real* inputRow, size_t inputDim) {
-    for (size_t k = 0; k < inputDim; ++k) {
-      inputRow[k] += t * weightRow[k];
-    }
-  };
-
-  mulByBitCodeT(op, SimpleCodeTable(numClasses), codes, *this, weight, input);
+  BitCodeBatch batch;
+  batch.reset(BitCodeTree(numClasses), codes);
+  batch.mulByBitCodeBackwardError(*this, weight, input);
 }
 
-template <class CodeTable>
-void sumByBitCodeT(CodeTable codeTable,
-                   IVector& codes,
-                   const CpuMatrix& tmat,
-                   Matrix& sum,
-                   real scaleSum) {
-  size_t maxCodeLength = codeTable.getMaxCodeLength();
-  size_t numSamples = tmat.getHeight();
-  size_t oWidth = tmat.getWidth();
-  CHECK_EQ(tmat.getWidth(), maxCodeLength);
-  CHECK_EQ(codes.getSize(), numSamples);
-  CHECK_EQ(sum.getHeight(), numSamples);
-  CHECK_EQ(sum.getWidth(), (size_t)1);
-
-  const real* data = tmat.getData();
-  real* s = sum.getData();
-  int* c = codes.getData();
-  for (size_t i = 0; i < numSamples; ++i) {
-    real sm = 0;
-    auto code = codeTable(c[i]);
-    int codeLength = code.getLength();
-    for (int j = 0; j < codeLength; ++j) {
-      if (code.calcBit(j)) {
-        sm += data[i * oWidth + j];
-      }
-    }
-    s[i] = scaleSum * sm;
-  }
-}
-
-/* For j < codeLength:
-   sum(i, 0) = \sum_j  bit(i, j) * this(i, j)
-*/
 void CpuMatrix::sumByBitCode(size_t numClasses,
                              IVector& codes,
                              Matrix& sum,
                              real scaleSum) {
-  sumByBitCodeT(SimpleCodeTable(numClasses), codes, *this, sum, scaleSum);
+  BitCodeBatch batch;
+  batch.reset(BitCodeTree(numClasses), codes);
+  batch.sumByBitCode(*this, sum, scaleSum);
 }
 
-template <class CodeTable>
-void subByBitCodeT(CodeTable codeTable, IVector& codes, CpuMatrix& tmat) {
-  size_t maxCodeLength = codeTable.getMaxCodeLength();
-  size_t numSamples = tmat.getHeight();
-  size_t oWidth = tmat.getWidth();
-  CHECK_EQ(tmat.getWidth(), maxCodeLength);
-  CHECK_EQ(codes.getSize(), numSamples);
-
-  real* data = tmat.getData();
-  int* c = codes.getData();
-  for (size_t i = 0; i < numSamples; ++i) {
-    auto code = codeTable(c[i]);
-    int codeLength = code.getLength();
-    for (int j = 0; j < codeLength; ++j) {
-      if (code.calcBit(j)) {
-        data[i * oWidth + j] -= 1;
-      }
-    }
-  }
-}
-
-/* For j < codeLength
-   this(i, j) -= bit(i, j)
-*/
 void CpuMatrix::subByBitCode(size_t numClasses, IVector& codes) {
-  subByBitCodeT(SimpleCodeTable(numClasses), codes, *this);
+  BitCodeBatch batch;
+  batch.reset(BitCodeTree(numClasses), codes);
+  batch.subByBitCode(*this);
 }
 
 }  // namespace paddle
@@ -0,0 +1,154 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Matrix.h"
+#include "Vector.h"
+
+namespace paddle {
+
+class BitCodeTree;
+typedef std::shared_ptr<BitCodeTree> BitCodeTreePtr;
+
+/**
+ * @brief The binary tree of the classes of a hierarchical sigmoid.
+ *
+ * The classes are the leaves and the numClasses - 1 internal nodes are
+ * numbered from 0. The code of a class is the path from its leaf up to the
+ * root: bit j tells whether the path enters node(j), the (j + 1)-th
+ * ancestor of the leaf, from its right child.
+ *
+ * The complete tree of HierarchicalSigmoidLayer computes its codes from the
+ * class ids. Any other tree, a Huffman tree for instance, stores the codes
+ * of all the classes.
+ */
+class BitCodeTree {
+public:
+  /// The complete tree of numClasses classes.
+  explicit BitCodeTree(size_t numClasses);
+
+  /**
+   * A tree given by the codes of its classes. The code of class c is
+   * nodes[k], bits[k] for offsets[c] <= k < offsets[c + 1].
+   */
+  BitCodeTree(std::vector<size_t> offsets,
+              std::vector<int> nodes,
+              std::vector<uint8_t> bits);
+
+  /// The Huffman tree of classes with these frequencies.
+  static BitCodeTreePtr createHuffman(const std::vector<int64_t>& counts);
+
+  /**
+   * Load a tree from a text file with one line per class. If every line
+   * holds a single number, the lines are the frequencies of the classes
+   * and give their Huffman tree. Otherwise a line is the code of a class,
+   * "node bit node bit ...", from the leaf up.
+   */
+  static BitCodeTreePtr load(const std::string& path);
+
+  size_t getNumClasses() const { return numClasses_; }
+
+  int getMaxCodeLength() const { return maxCodeLength_; }
+
+  /**
+   * Write the code of class c into nodes and bits, which hold
+   * getMaxCodeLength() entries, and return its length.
+   */
+  int getCode(size_t c, int* nodes, uint8_t* bits) const;
+
+private:
+  size_t numClasses_;
+  int maxCodeLength_;
+  /// empty for the complete tree
+  std::vector<size_t> offsets_;
+  std::vector<int> nodes_;
+  std::vector<uint8_t> bits_;
+};
+
+/**
+ * @brief The codes of the labels of a batch, for the cpu.
+ *
+ * The matrices named tmat hold a row per sample and a column per bit, like
+ * the ones of the Matrix::xxxByBitCode() functions, which use it. Instead
+ * of walking the code of every sample, the products with the rows of a
+ * weight visit the (sample, bit) pairs grouped by node, so each row of the
+ * weight is read once per batch, and the rows of the weight and its
+ * gradient are reached by getRowBuf(), which works for the sparse row
+ * matrices of sparse parameters.
+ */
+class BitCodeBatch {
+public:
+  /// Compute the codes of labels, which are class ids of tree.
+  void reset(const BitCodeTree& tree, const IVector& labels);
+
+  size_t getNumSamples() const { return lengths_.size(); }
+
+  /// The nodes used by the codes of the batch, in increasing order.
+  const std::vector<int>& getNodes();
+
+  /// tmat(i, j) += vec(0, node(i, j))
+  void addByBitCode(Matrix& tmat, const Matrix& vec);
+
+  /// vec(0, node(i, j)) += tmat(i, j)
+  void addByBitCodeBackward(const Matrix& tmat, Matrix& vec);
+
+  /// tmat(i, j) += <weight.row(node(i, j)), input.row(i)>
+  void mulByBitCode(Matrix& tmat, const Matrix& weight, const Matrix& input);
+
+  /// weight.row(node(i, j)) += tmat(i, j) * input.row(i)
+  void mulByBitCodeBackwardWeight(const Matrix& tmat,
+                                  Matrix& weight,
+                                  const Matrix& input);
+
+  /// input.row(i) += tmat(i, j) * weight.row(node(i, j))
+  void mulByBitCodeBackwardError(const Matrix& tmat,
+                                 const Matrix& weight,
+                                 Matrix& input);
+
+  /// sum(i, 0) = scaleSum * \sum_j bit(i, j) * tmat(i, j)
+  void sumByBitCode(const Matrix& tmat, Matrix& sum, real scaleSum);
+
+  /// tmat(i, j) -= bit(i, j)
+  void subByBitCode(Matrix& tmat);
+
+private:
+  void checkShape(const Matrix& tmat) const;
+  void groupByNode();
+
+  size_t numNodes_ = 0;
+  int maxCodeLength_ = 0;
+  std::vector<int> lengths_;
+  /// the code of sample i starts at i * maxCodeLength_
+  std::vector<int> nodes_;
+  std::vector<uint8_t> bits_;
+
+  bool grouped_ = false;
+  std::vector<uint64_t> keys_;
+  std::vector<uint64_t> sortedKeys_;
+  std::vector<int> groupNodes_;
+  /// the pairs of groupNodes_[g] are groupPairs_[groupStarts_[g]] to
+  /// groupPairs_[groupStarts_[g + 1] - 1], as i * maxCodeLength_ + j
+  std::vector<int> groupStarts_;
+  std::vector<int> groupPairs_;
+
+  std::vector<const real*> rows_;
+  std::vector<real> values_;
+};
+
+}  // namespace paddle
@@ -0,0 +1,76 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "MemoryArena.h"
+#include <algorithm>
+#include "paddle/utils/Logging.h"
+
+namespace paddle {
+
+constexpr size_t MemoryArena::kAlignment;
+
+MemoryArena::MemoryArena(size_t initialSize)
+    : offset_(0), usedSize_(0), peakSize_(0), liveHandles_(0) {
+  if (initialSize > 0) {
+    addChunk(initialSize);
+  }
+}
+
+void MemoryArena::addChunk(size_t size) {
+  chunks_.push_back(std::make_shared<CpuMemoryHandle>(size));
+  offset_ = 0;
+}
+
+void* MemoryArena::alloc(size_t size) {
+  size = (size + kAlignment - 1) & ~(kAlignment - 1);
+  if (chunks_.empty() || offset_ + size > chunks_.back()->getAllocSize()) {
+    // Grow geometrically so that a batch needs few chunks before reset()
+    // merges them.
+    addChunk(std::max(size, getCapacity()));
+  }
+  void* buf = static_cast<char*>(chunks_.back()->getBuf()) + offset_;
+  offset_ += size;
+  usedSize_ += size;
+  return buf;
+}
+
+void MemoryArena::reset() {
+  CHECK_EQ(liveHandles_.load(), 0)
+      << "Temporary matrices must not outlive the batch they are created in";
+  peakSize_ = std::max(peakSize_, usedSize_);
+  if (chunks_.size() > 1) {
+    size_t capacity = getCapacity();
+    chunks_.clear();
+    addChunk(capacity);
+  }
+  offset_ = 0;
+  usedSize_ = 0;
+}
+
+size_t MemoryArena::getCapacity() const {
+  size_t capacity = 0;
+  for (auto& chunk : chunks_) {
+    capacity += chunk->getAllocSize();
+  }
+  return capacity;
+}
+
+ArenaMemoryHandle::ArenaMemoryHandle(MemoryArena* arena, size_t size)
+    : CpuMemoryHandle(arena->alloc(size), size), arena_(arena) {
+  ++arena_->liveHandles_;
+}
+
+ArenaMemoryHandle::~ArenaMemoryHandle() { --arena_->liveHandles_; }
+
+}  // namespace paddle
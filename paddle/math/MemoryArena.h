@@ -0,0 +1,91 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "MemoryHandle.h"
+
+namespace paddle {
+
+/**
+ * @brief Bump-pointer arena for CPU temporaries which live within one batch.
+ *
+ * alloc() carves aligned blocks out of the current chunk and adds a new
+ * chunk when it runs out. reset() rewinds the arena. If more than one chunk
+ * was used since the last reset, they are merged into one chunk large enough
+ * for the whole batch, so in steady state a batch is served from a single
+ * chunk without touching the allocator.
+ *
+ * Memory returned by alloc() is not zeroed and is only valid until the next
+ * reset(). The arena is not thread-safe; it is meant to be bound to one
+ * thread through StorageEngine::setCpuArena().
+ */
+class MemoryArena {
+public:
+  /**
+   * @param initialSize size of the first chunk, 0 means it is allocated on
+   *                    the first request.
+   */
+  explicit MemoryArena(size_t initialSize = 0);
+
+  void* alloc(size_t size);
+
+  /**
+   * @brief Rewind the arena. All ArenaMemoryHandle must have been released.
+   */
+  void reset();
+
+  /// bytes handed out since the last reset.
+  size_t getUsedSize() const { return usedSize_; }
+
+  /// the largest getUsedSize() seen at a reset, i.e. the peak per batch.
+  size_t getPeakSize() const { return peakSize_; }
+
+  /// bytes currently held by the arena.
+  size_t getCapacity() const;
+
+  /// Alignment of every block returned by alloc().
+  static constexpr size_t kAlignment = 32;
+
+private:
+  friend class ArenaMemoryHandle;
+
+  void addChunk(size_t size);
+
+  std::vector<CpuMemHandlePtr> chunks_;
+  size_t offset_;  // offset in chunks_.back()
+  size_t usedSize_;
+  size_t peakSize_;
+  std::atomic<int> liveHandles_;
+};
+
+/**
+ * @brief Cpu memory handle whose buffer is taken from a MemoryArena.
+ *
+ * The buffer is returned to the arena as a whole by MemoryArena::reset(),
+ * so the handle must not outlive the batch it was created in.
+ */
+class ArenaMemoryHandle : public CpuMemoryHandle {
+public:
+  ArenaMemoryHandle(MemoryArena* arena, size_t size);
+  virtual ~ArenaMemoryHandle();
+
+private:
+  MemoryArena* arena_;
+};
+
+}  // namespace paddle
@@ -43,7 +43,17 @@ GpuMemoryHandle::GpuMemoryHandle(size_t size) : MemoryHandle(size) {
   buf_ = allocator_->alloc(allocSize_);
 }
 
-GpuMemoryHandle::~GpuMemoryHandle() { allocator_->free(buf_, allocSize_); }
+GpuMemoryHandle::GpuMemoryHandle(void* buf, size_t size) : MemoryHandle(size) {
+  deviceId_ = hl_get_device();
+  allocSize_ = size;
+  buf_ = buf;
+}
+
+GpuMemoryHandle::~GpuMemoryHandle() {
+  if (allocator_) {
+    allocator_->free(buf_, allocSize_);
+  }
+}
 
 CpuMemoryHandle::CpuMemoryHandle(size_t size) : MemoryHandle(size) {
   CHECK(size != 0) << " allocate 0 bytes";
@@ -51,6 +61,43 @@ CpuMemoryHandle::CpuMemoryHandle(size_t size) : MemoryHandle(size) {
   buf_ = allocator_->alloc(allocSize_);
 }
 
-CpuMemoryHandle::~CpuMemoryHandle() { allocator_->free(buf_, allocSize_); }
+CpuMemoryHandle::CpuMemoryHandle(void* buf, size_t size) : MemoryHandle(size) {
+  allocSize_ = size;
+  buf_ = buf;
+}
+
+CpuMemoryHandle::~CpuMemoryHandle() {
+  if (allocator_) {
+    allocator_->free(buf_, allocSize_);
+  }
+}
+
+namespace {
+
+template <class Handle>
+class SubMemoryHandle : public Handle {
+public:
+  SubMemoryHandle(const MemoryHandlePtr& parent, size_t offset, size_t size)
+      : Handle(static_cast<char*>(parent->getBuf()) + offset, size),
+        parent_(parent) {}
+
+private:
+  MemoryHandlePtr parent_;
+};
+
+}  // namespace
+
+MemoryHandlePtr createSubMemoryHandle(const MemoryHandlePtr& parent,
+                                      size_t offset,
+                                      size_t size) {
+  CHECK_LE(offset + size, parent->getAllocSize());
+  if (std::dynamic_pointer_cast<GpuMemoryHandle>(parent)) {
+    return std::make_shared<SubMemoryHandle<GpuMemoryHandle>>(
+        parent, offset, size);
+  }
+  CHECK(std::dynamic_pointer_cast<CpuMemoryHandle>(parent));
+  return std::make_shared<SubMemoryHandle<CpuMemoryHandle>>(
+      parent, offset, size);
+}
 
 }  // namespace paddle
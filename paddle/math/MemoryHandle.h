@@ -30,7 +30,7 @@ public:
   size_t getAllocSize() const { return allocSize_; }
 
 protected:
-  PoolAllocator* allocator_;
+  PoolAllocator* allocator_ = nullptr;
   size_t size_;       // the requested size
   size_t allocSize_;  // the allocated size
   int deviceId_;      // the device id of memory if gpu memory
@@ -46,6 +46,13 @@ class GpuMemoryHandle : public MemoryHandle {
 public:
   explicit GpuMemoryHandle(size_t size);
   virtual ~GpuMemoryHandle();
+
+protected:
+  /**
+   * Wrap a buffer owned by someone else (see createSubMemoryHandle).
+   * The buffer is not released at destructor.
+   */
+  GpuMemoryHandle(void* buf, size_t size);
 };
 
 /**
@@ -57,9 +64,27 @@ class CpuMemoryHandle : public MemoryHandle {
 public:
   explicit CpuMemoryHandle(size_t size);
   virtual ~CpuMemoryHandle();
+
+protected:
+  /**
+   * Wrap a buffer owned by someone else (see ArenaMemoryHandle).
+   * The buffer is not released at destructor.
+   */
+  CpuMemoryHandle(void* buf, size_t size);
 };
 
 typedef std::shared_ptr<MemoryHandle> MemoryHandlePtr;
 typedef std::shared_ptr<CpuMemoryHandle> CpuMemHandlePtr;
 typedef std::shared_ptr<GpuMemoryHandle> GpuMemHandlePtr;
+
+/**
+ * @brief Handle of the size bytes at offset in the buffer of parent, of the
+ *        same kind as parent, which it keeps alive.
+ *
+ * A matrix created on it is resized in place as long as it fits, so it can
+ * be given to a layer as its output and stays a view of parent.
+ */
+MemoryHandlePtr createSubMemoryHandle(const MemoryHandlePtr& parent,
+                                      size_t offset,
+                                      size_t size);
 }  // namespace paddle
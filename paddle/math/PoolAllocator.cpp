@@ -13,51 +13,182 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include "PoolAllocator.h"
+#include <algorithm>
 
 namespace paddle {
 
+constexpr size_t PoolAllocator::kMinSizeClass;
+constexpr size_t PoolAllocator::kMaxThreadCacheSize;
+constexpr size_t PoolAllocator::kMagazineSize;
+
 PoolAllocator::PoolAllocator(Allocator* allocator,
                              size_t sizeLimit,
                              const std::string& name)
     : allocator_(allocator),
       sizeLimit_(sizeLimit),
       poolMemorySize_(0),
-      name_(name) {}
+      threadCacheMemorySize_(0),
+      name_(name),
+      hitStat_(getStat(name + "_hit")),
+      missStat_(getStat(name + "_miss")),
+      cachedBytesStat_(getStat(name + "_cached_bytes")) {}
+
+PoolAllocator::~PoolAllocator() {
+  // The caches themselves are not deleted when the thread local key is, but
+  // freeAll() releases the buffers of all of them.
+  freeAll();
+}
+
+size_t PoolAllocator::sizeClass(size_t size) {
+  if (size <= kMinSizeClass) {
+    return kMinSizeClass;
+  }
+  // 2^k < size <= 2^(k+1); the classes in that range are 2^(k-2) apart,
+  // so the rounding wastes less than a quarter of the request.
+  int k = 63 - __builtin_clzll(static_cast<unsigned long long>(size - 1));
+  size_t step = static_cast<size_t>(1) << (k - 2);
+  return (size + step - 1) & ~(step - 1);
+}
 
-PoolAllocator::~PoolAllocator() { freeAll(); }
+PoolAllocator::ThreadCache::~ThreadCache() {
+  if (owner) {
+    std::lock_guard<std::mutex> cachesGuard(owner->cachesMutex_);
+    owner->caches_.erase(this);
+    owner->flushAll(this);
+  }
+}
+
+PoolAllocator::ThreadCache* PoolAllocator::threadCache() {
+  ThreadCache* cache = threadCache_.get();
+  if (!cache->owner) {
+    cache->owner = this;
+    std::lock_guard<std::mutex> cachesGuard(cachesMutex_);
+    caches_.insert(cache);
+  }
+  return cache;
+}
+
+void PoolAllocator::refill(std::vector<void*>& magazine, size_t classSize) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = pool_.find(classSize);
+  if (it == pool_.end()) {
+    return;
+  }
+  auto& bufs = it->second;
+  size_t n = std::min(bufs.size(), kMagazineSize / 2);
+  magazine.insert(magazine.end(), bufs.end() - n, bufs.end());
+  bufs.resize(bufs.size() - n);
+  poolMemorySize_ -= n * classSize;
+  threadCacheMemorySize_ += n * classSize;
+}
+
+void PoolAllocator::flush(std::vector<void*>& magazine, size_t classSize) {
+  size_t n = std::min(magazine.size(), kMagazineSize / 2);
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto& bufs = pool_[classSize];
+    bufs.insert(bufs.end(), magazine.begin(), magazine.begin() + n);
+    poolMemorySize_ += n * classSize;
+  }
+  threadCacheMemorySize_ -= n * classSize;
+  magazine.erase(magazine.begin(), magazine.begin() + n);
+}
+
+void PoolAllocator::flushAll(ThreadCache* cache) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& it : cache->magazines) {
+    auto& bufs = pool_[it.first];
+    bufs.insert(bufs.end(), it.second.begin(), it.second.end());
+    poolMemorySize_ += it.second.size() * it.first;
+    threadCacheMemorySize_ -= it.second.size() * it.first;
+  }
+  cache->magazines.clear();
+}
 
 void* PoolAllocator::alloc(size_t size) {
-  if (sizeLimit_ > 0) {
+  if (sizeLimit_ == 0) {
+    return allocator_->alloc(size);
+  }
+
+  size = sizeClass(size);
+  if (size <= kMaxThreadCacheSize) {
+    ThreadCache* cache = threadCache();
+    std::lock_guard<std::mutex> cacheGuard(cache->mutex);
+    auto& magazine = cache->magazines[size];
+    if (magazine.empty()) {
+      refill(magazine, size);
+    }
+    if (!magazine.empty()) {
+      void* buf = magazine.back();
+      magazine.pop_back();
+      threadCacheMemorySize_ -= size;
+      hitStat_->addSample(size);
+      return buf;
+    }
+  } else {
     std::lock_guard<std::mutex> guard(mutex_);
     auto it = pool_.find(size);
-    if (it == pool_.end() || it->second.size() == 0) {
-      if (poolMemorySize_ >= sizeLimit_) {
-        freeAll();
-      }
-      return allocator_->alloc(size);
-    } else {
-      auto buf = it->second.back();
+    if (it != pool_.end() && !it->second.empty()) {
+      void* buf = it->second.back();
       it->second.pop_back();
       poolMemorySize_ -= size;
+      hitStat_->addSample(size);
       return buf;
     }
-  } else {
-    return allocator_->alloc(size);
   }
+
+  size_t cachedBytes;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    cachedBytes = poolMemorySize_ + threadCacheMemorySize_;
+  }
+  cachedBytesStat_->addSample(cachedBytes);
+  if (cachedBytes >= sizeLimit_) {
+    freeAll();
+  }
+  missStat_->addSample(size);
+  return allocator_->alloc(size);
 }
 
 void PoolAllocator::free(void* ptr, size_t size) {
-  if (sizeLimit_ > 0) {
+  if (sizeLimit_ == 0) {
+    allocator_->free(ptr);
+    return;
+  }
+
+  size = sizeClass(size);
+  if (size <= kMaxThreadCacheSize) {
+    ThreadCache* cache = threadCache();
+    std::lock_guard<std::mutex> cacheGuard(cache->mutex);
+    auto& magazine = cache->magazines[size];
+    magazine.push_back(ptr);
+    threadCacheMemorySize_ += size;
+    if (magazine.size() > kMagazineSize) {
+      flush(magazine, size);
+    }
+  } else {
     std::lock_guard<std::mutex> guard(mutex_);
-    auto& it = pool_[size];
-    it.push_back(ptr);
+    pool_[size].push_back(ptr);
     poolMemorySize_ += size;
-  } else {
-    allocator_->free(ptr);
   }
 }
 
 void PoolAllocator::freeAll() {
+  {
+    std::lock_guard<std::mutex> cachesGuard(cachesMutex_);
+    for (ThreadCache* cache : caches_) {
+      std::lock_guard<std::mutex> cacheGuard(cache->mutex);
+      for (auto& it : cache->magazines) {
+        for (auto ptr : it.second) {
+          allocator_->free(ptr);
+        }
+        threadCacheMemorySize_ -= it.second.size() * it.first;
+        it.second.clear();
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(mutex_);
   for (auto it : pool_) {
     for (auto ptr : it.second) {
       allocator_->free(ptr);
@@ -78,6 +209,7 @@ void PoolAllocator::printAll() {
     }
   }
   LOG(INFO) << "memory size: " << memory;
+  LOG(INFO) << "thread cache memory size: " << threadCacheMemorySize_;
 }
 
 }  // namespace paddle
@@ -14,17 +14,35 @@ limitations under the License. */
 
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "Allocator.h"
+#include "paddle/utils/Stat.h"
+#include "paddle/utils/ThreadLocal.h"
 
 namespace paddle {
 
 /**
  * @brief Memory pool allocator implementation.
+ *
+ * Requests are rounded up to size classes (four classes between consecutive
+ * powers of two), so buffers of similar sizes can be reused for each other.
+ *
+ * Buffers up to kMaxThreadCacheSize are cached per thread: every thread keeps
+ * a small magazine of free buffers for each size class, refilled from and
+ * flushed to the shared pool in batches of kMagazineSize / 2. Most alloc and
+ * free calls therefore do not touch the shared mutex. The cached buffers count
+ * against sizeLimit, and a miss over sizeLimit releases the magazines of every
+ * thread along with the shared pool.
+ *
+ * Counters are reported to globalStat as "<name>_hit", "<name>_miss" (count
+ * is the number of requests, total the number of bytes) and
+ * "<name>_cached_bytes" (sampled on every miss).
  */
 class PoolAllocator {
 public:
@@ -47,15 +65,64 @@ public:
   void free(void* ptr, size_t size);
   std::string getName() { return name_; }
 
+  /**
+   * @brief The size class a request of size bytes is served from.
+   */
+  static size_t sizeClass(size_t size);
+
+  /// Smallest size class.
+  static constexpr size_t kMinSizeClass = 32;
+  /// Largest size class which is cached per thread.
+  static constexpr size_t kMaxThreadCacheSize = 4 << 20;
+  /// Maximum number of buffers a thread caches for one size class.
+  static constexpr size_t kMagazineSize = 16;
+
 private:
+  /**
+   * @brief Free buffers cached by one thread.
+   *
+   * They go back to the shared pool when the thread exits. mutex is only
+   * contended when freeAll() releases the magazines from another thread.
+   */
+  struct ThreadCache {
+    PoolAllocator* owner = nullptr;
+    std::mutex mutex;
+    std::unordered_map<size_t, std::vector<void*>> magazines;
+    ~ThreadCache();
+  };
+
+  ThreadCache* threadCache();
+  /// Move up to kMagazineSize / 2 buffers of classSize from the shared pool.
+  void refill(std::vector<void*>& magazine, size_t classSize);
+  /// Move the oldest kMagazineSize / 2 buffers to the shared pool.
+  void flush(std::vector<void*>& magazine, size_t classSize);
+  /// Return every buffer of cache to the shared pool.
+  void flushAll(ThreadCache* cache);
+
+  /**
+   * @brief Release the shared pool and the magazines of every thread.
+   *
+   * Locks cachesMutex_, then each ThreadCache::mutex, then mutex_, which is
+   * the order every other path takes them in. So the caller must hold none
+   * of them.
+   */
   void freeAll();
   void printAll();
+
   std::unique_ptr<Allocator> allocator_;
   std::mutex mutex_;
   std::unordered_map<size_t, std::vector<void*>> pool_;
   size_t sizeLimit_;
   size_t poolMemorySize_;
+  std::atomic<size_t> threadCacheMemorySize_;
   std::string name_;
+  ThreadLocal<ThreadCache> threadCache_;
+  /// The caches of the threads which use this pool.
+  std::mutex cachesMutex_;
+  std::unordered_set<ThreadCache*> caches_;
+  StatPtr hitStat_;
+  StatPtr missStat_;
+  StatPtr cachedBytesStat_;
 };
 
 }  // namespace paddle
@@ -0,0 +1,161 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "QuantizedMatrix.h"
+#include <algorithm>
+#include <cmath>
+#include "SIMDFunctions.h"
+#include "TensorEvaluate.h"
+
+namespace paddle {
+
+#ifndef PADDLE_TYPE_DOUBLE
+
+/// The scale that maps [-maxAbs, maxAbs] onto [-127, 127].
+static inline float int8Scale(float maxAbs) { return maxAbs / 127; }
+
+static inline int8_t roundToInt8(float x, float invScale) {
+  float y = std::nearbyint(x * invScale);
+  return (int8_t)std::max(-127.0f, std::min(127.0f, y));
+}
+
+QuantizedMatrix::QuantizedMatrix(
+    const real* data, int ld, bool trans, size_t K, size_t N)
+    : height_(K),
+      width_(N),
+      packed_(simd::packedGemmInt8BSize(K, N)),
+      sums_(N),
+      scales_(N) {
+  auto at = [&](size_t k, size_t j) {
+    return trans ? data[j * ld + k] : data[k * ld + j];
+  };
+  std::vector<int8_t> quantized(K * N);
+  for (size_t j = 0; j < N; ++j) {
+    float maxAbs = 0;
+    for (size_t k = 0; k < K; ++k) {
+      maxAbs = std::max(maxAbs, std::abs(at(k, j)));
+    }
+    scales_[j] = int8Scale(maxAbs);
+    float invScale = maxAbs == 0 ? 0 : 1 / scales_[j];
+    for (size_t k = 0; k < K; ++k) {
+      quantized[k * N + j] = roundToInt8(at(k, j), invScale);
+    }
+  }
+  simd::packGemmInt8B(
+      packed_.data(), sums_.data(), quantized.data(), N, false, K, N);
+}
+
+void QuantizedMatrix::quantizeRows(int8_t* dst,
+                                   int ldDst,
+                                   float* scales,
+                                   const real* src,
+                                   int ldSrc,
+                                   size_t M,
+                                   size_t K) {
+  size_t groupedK = simd::int8GroupedK(K);
+  for (size_t i = 0; i < M; ++i) {
+    const real* row = src + i * ldSrc;
+    int8_t* q = dst + i * ldDst;
+    float maxAbs = 0;
+    for (size_t k = 0; k < K; ++k) {
+      maxAbs = std::max(maxAbs, std::abs(row[k]));
+    }
+    scales[i] = int8Scale(maxAbs);
+    float invScale = maxAbs == 0 ? 0 : 1 / scales[i];
+    for (size_t k = 0; k < K; ++k) {
+      q[k] = roundToInt8(row[k], invScale);
+    }
+    std::fill(q + K, q + groupedK, 0);
+  }
+}
+
+void QuantizedMatrix::mul(CpuMatrix& out,
+                          const CpuMatrix& input,
+                          const CpuMatrix* bias,
+                          real beta) const {
+  CHECK(!input.isTransposed() && !out.isTransposed());
+  CHECK_EQ(input.getWidth(), height_);
+  CHECK_EQ(out.getWidth(), width_);
+  CHECK_EQ(out.getHeight(), input.getHeight());
+  if (bias) {
+    CHECK_EQ(bias->getElementCnt(), width_);
+  }
+  size_t M = input.getHeight();
+  size_t K = height_;
+  size_t N = width_;
+  size_t groupedK = simd::int8GroupedK(K);
+
+  std::vector<int8_t> rows(M * groupedK);
+  std::vector<float> rowScales(M);
+  tensorCpuParallelFor(M, K, 1, [&](size_t begin, size_t end) {
+    quantizeRows(rows.data() + begin * groupedK,
+                 groupedK,
+                 rowScales.data() + begin,
+                 input.getData() + begin * input.getStride(),
+                 input.getStride(),
+                 end - begin,
+                 K);
+  });
+
+  // the panels of columns are independent.
+  real* C = out.getData();
+  const real* biasData = bias ? bias->getData() : nullptr;
+  size_t numPanels =
+      (N + simd::kInt8PanelWidth - 1) / simd::kInt8PanelWidth;
+  tensorCpuParallelFor(numPanels, M * K, 1, [&](size_t begin, size_t end) {
+    size_t col = begin * simd::kInt8PanelWidth;
+    simd::gemmInt8(C + col,
+                   out.getStride(),
+                   rows.data(),
+                   groupedK,
+                   rowScales.data(),
+                   packed_.data() + col * groupedK,
+                   sums_.data() + col,
+                   scales_.data() + col,
+                   biasData ? biasData + col : nullptr,
+                   M,
+                   std::min(end * simd::kInt8PanelWidth, N) - col,
+                   K,
+                   beta);
+  });
+}
+
+#else
+
+QuantizedMatrix::QuantizedMatrix(
+    const real* data, int ld, bool trans, size_t K, size_t N)
+    : height_(K), width_(N) {
+  LOG(FATAL) << "QuantizedMatrix needs a float real";
+}
+
+void QuantizedMatrix::quantizeRows(int8_t* dst,
+                                   int ldDst,
+                                   float* scales,
+                                   const real* src,
+                                   int ldSrc,
+                                   size_t M,
+                                   size_t K) {
+  LOG(FATAL) << "QuantizedMatrix needs a float real";
+}
+
+void QuantizedMatrix::mul(CpuMatrix& out,
+                          const CpuMatrix& input,
+                          const CpuMatrix* bias,
+                          real beta) const {
+  LOG(FATAL) << "QuantizedMatrix needs a float real";
+}
+
+#endif
+
+}  // namespace paddle
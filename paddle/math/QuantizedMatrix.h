@@ -0,0 +1,81 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "Matrix.h"
+
+namespace paddle {
+
+/**
+ * @brief An int8 copy of a cpu weight, for inference.
+ *
+ * The weight is the right operand of mul(), a K x N matrix. Each of its N
+ * columns is rounded to int8 with its own scale, max(|column|) / 127. mul()
+ * rounds each row of the input the same way, multiplies in int8 with exact
+ * int32 sums (simd::gemmInt8), and scales the sums back to real while
+ * storing them, together with the bias. The weight takes a quarter of the
+ * memory, and of the memory bandwidth, of the real one.
+ *
+ * Only available when real is float, it fails with a double real.
+ */
+class QuantizedMatrix {
+public:
+  /**
+   * @brief Quantize the K x N matrix in data, which is stored as a N x K
+   * matrix when trans is set. ld is the stride of the stored matrix.
+   */
+  QuantizedMatrix(const real* data, int ld, bool trans, size_t K, size_t N);
+
+  size_t getHeight() const { return height_; }
+  size_t getWidth() const { return width_; }
+
+  /**
+   * @brief out = input * this + bias + beta * out.
+   *
+   * input is M x K, out is M x N, and bias is a 1 x N matrix or nullptr.
+   * out is not read when beta is 0.
+   */
+  void mul(CpuMatrix& out,
+           const CpuMatrix& input,
+           const CpuMatrix* bias,
+           real beta) const;
+
+  /**
+   * @brief Round every row of the M x K src to int8, with its own scale.
+   *
+   * dst has rows of ldDst bytes, which are zero from K up to
+   * simd::int8GroupedK(K), as simd::gemmInt8() reads them.
+   */
+  static void quantizeRows(int8_t* dst,
+                           int ldDst,
+                           float* scales,
+                           const real* src,
+                           int ldSrc,
+                           size_t M,
+                           size_t K);
+
+private:
+  size_t height_;
+  size_t width_;
+  std::vector<int8_t> packed_;
+  std::vector<int32_t> sums_;
+  std::vector<float> scales_;
+};
+
+typedef std::shared_ptr<QuantizedMatrix> QuantizedMatrixPtr;
+
+}  // namespace paddle
@@ -13,242 +13,22 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include "SIMDFunctions.h"
-#ifdef __SSE3__
-#include <immintrin.h>
-#endif
+#include <float.h>
 #include <algorithm>
+#include <string.h>
+#include <cmath>
+#include "SIMDKernels.h"
+#include "paddle/utils/CpuId.h"
 
-#ifdef __AVX__
-static void addto_avx(float* a, const float* b, size_t len) {
-  int offset = len % 32;
-
-  __m256 ma0, ma1, ma2, ma3;
-  __m256 mb0, mb1, mb2, mb3;
-
-  for (unsigned int k = 0; k < len / 32; k++, a += 32, b += 32) {
-    ma0 = _mm256_load_ps(a);
-    ma1 = _mm256_load_ps(a + 8);
-    ma2 = _mm256_load_ps(a + 16);
-    ma3 = _mm256_load_ps(a + 24);
-
-    mb0 = _mm256_load_ps(b);
-    mb1 = _mm256_load_ps(b + 8);
-    mb2 = _mm256_load_ps(b + 16);
-    mb3 = _mm256_load_ps(b + 24);
-
-    ma0 = _mm256_add_ps(ma0, mb0);
-    ma1 = _mm256_add_ps(ma1, mb1);
-    ma2 = _mm256_add_ps(ma2, mb2);
-    ma3 = _mm256_add_ps(ma3, mb3);
-
-    _mm256_store_ps(a, ma0);
-    _mm256_store_ps(a + 8, ma1);
-    _mm256_store_ps(a + 16, ma2);
-    _mm256_store_ps(a + 24, ma3);
-  }
-
-  for (int i = 0; i < offset; i++) a[i] += b[i];
-
-  return;
-}
-
-static void batch_addto_avx(float* a, const float* b[], int batch, size_t len) {
-  int offset = len % 32;
-
-  __m256 ma0, ma1, ma2, ma3;
-  __m256 mb0, mb1, mb2, mb3;
-
-  for (unsigned int k = 0; k < len / 32; k++, a += 32) {
-    ma0 = _mm256_load_ps(a);
-    ma1 = _mm256_load_ps(a + 8);
-    ma2 = _mm256_load_ps(a + 16);
-    ma3 = _mm256_load_ps(a + 24);
-
-    for (int i = 0; i < batch; i++) {
-      mb0 = _mm256_load_ps(b[i]);
-      mb1 = _mm256_load_ps(b[i] + 8);
-      mb2 = _mm256_load_ps(b[i] + 16);
-      mb3 = _mm256_load_ps(b[i] + 24);
-      ma0 = _mm256_add_ps(ma0, mb0);
-      ma1 = _mm256_add_ps(ma1, mb1);
-      ma2 = _mm256_add_ps(ma2, mb2);
-      ma3 = _mm256_add_ps(ma3, mb3);
-      b[i] += 32;
-    }
-
-    _mm256_store_ps(a, ma0);
-    _mm256_store_ps(a + 8, ma1);
-    _mm256_store_ps(a + 16, ma2);
-    _mm256_store_ps(a + 24, ma3);
-  }
-
-  for (int i = 0; i < offset; i++) {
-    for (int k = 0; k < batch; k++) a[i] += b[k][i];
-  }
-  return;
-}
-
-static void col_max_avx(float* result,
-                        const float* data,
-                        int dim,
-                        int numSamples) {
-  // first sample, direct copy
-  for (int d = 0; d < dim; ++d) {
-    result[d] = data[d];
-  }
-  int offset = dim % 32;
-  __m256 ma0, ma1, ma2, ma3;
-  __m256 mb0, mb1, mb2, mb3;
-  // first 16n dims
-  for (int k = 0; k < dim / 32; k++, result += 32, data += 32) {
-    ma0 = _mm256_load_ps(result);
-    ma1 = _mm256_load_ps(result + 8);
-    ma2 = _mm256_load_ps(result + 16);
-    ma3 = _mm256_load_ps(result + 24);
-    for (int i = 1; i < numSamples; i++) {
-      mb0 = _mm256_load_ps(data + i * dim);
-      mb1 = _mm256_load_ps(data + i * dim + 8);
-      mb2 = _mm256_load_ps(data + i * dim + 16);
-      mb3 = _mm256_load_ps(data + i * dim + 24);
-      ma0 = _mm256_max_ps(ma0, mb0);
-      ma1 = _mm256_max_ps(ma1, mb1);
-      ma2 = _mm256_max_ps(ma2, mb2);
-      ma3 = _mm256_max_ps(ma3, mb3);
-    }
-    _mm256_store_ps(result, ma0);
-    _mm256_store_ps(result + 8, ma1);
-    _mm256_store_ps(result + 16, ma2);
-    _mm256_store_ps(result + 24, ma3);
-  }
-  // last dims
-  for (int d = 0; d < offset; ++d) {
-    float sm = data[d];
-    for (int i = 1; i < numSamples; ++i) {
-      sm = std::max(sm, data[i * dim + d]);
-    }
-    result[d] = sm;
-  }
-}
-
-static void decayL1_avx(float* dst, float* src, float lambda, size_t sz) {
-  int64_t i;
-  int64_t size = sz;
-  float src_val;
-
-  __m256 ymm1, ymm2, ymm3, ymm4, ymm5, ymm6, ymm7, ymm8;
-  //  __m256 ymm9, ymm10;
-
-  ymm1 = _mm256_set1_ps(lambda);
-  ymm2 = _mm256_setzero_ps();
-
-  for (i = 0; i <= size - 16; i += 16) {
-    ymm3 = _mm256_load_ps(src + i);
-    ymm6 = _mm256_load_ps(src + i + 8);
-
-    ymm4 = _mm256_sub_ps(ymm3, ymm1);
-    ymm7 = _mm256_sub_ps(ymm6, ymm1);
-
-    ymm5 = _mm256_add_ps(ymm3, ymm1);
-    ymm8 = _mm256_add_ps(ymm6, ymm1);
-
-    ymm4 = _mm256_max_ps(ymm4, ymm2);
-    ymm7 = _mm256_max_ps(ymm7, ymm2);
-
-    ymm5 = _mm256_min_ps(ymm5, ymm2);
-    ymm8 = _mm256_min_ps(ymm8, ymm2);
-
-    ymm5 = _mm256_or_ps(ymm4, ymm5);
-    ymm8 = _mm256_or_ps(ymm7, ymm8);
-
-    _mm256_store_ps(dst + i, ymm5);
-    _mm256_store_ps(dst + i + 8, ymm8);
-  }
-  if (i <= size - 8) {
-    ymm3 = _mm256_load_ps(src + i);
-    ymm4 = _mm256_sub_ps(ymm3, ymm1);
-    ymm5 = _mm256_add_ps(ymm3, ymm1);
-    ymm4 = _mm256_max_ps(ymm4, ymm2);
-    ymm5 = _mm256_min_ps(ymm5, ymm2);
-    ymm5 = _mm256_or_ps(ymm4, ymm5);
-    _mm256_store_ps(dst + i, ymm5);
-
-    i += 8;
-  }
-  for (; i < size; i++) {
-    src_val = src[i];
-    if (src_val > 0) {
-      dst[i] = ((src_val > lambda) ? (src_val - lambda) : 0);
-    } else {
-      dst[i] = ((-src_val > lambda) ? (src_val + lambda) : 0);
-    }
-  }
-}
-
-static void decayL1_avx(
-    float* dst, float* src, float* lr, float lambda, size_t sz) {
-  int64_t i;
-  int64_t size = sz;
-  float src_val;
-
-  __m256 ymm1, ymm2, ymm3, ymm4, ymm5, ymm6, ymm7, ymm8;
-  __m256 ymm9, ymm10;
-
-  ymm1 = _mm256_set1_ps(lambda);
-  ymm2 = _mm256_setzero_ps();
-
-  for (i = 0; i <= size - 16; i += 16) {
-    ymm9 = _mm256_load_ps(lr + i);
-    ymm10 = _mm256_load_ps(lr + i + 8);
-
-    ymm3 = _mm256_load_ps(src + i);
-    ymm6 = _mm256_load_ps(src + i + 8);
-
-    ymm9 = _mm256_mul_ps(ymm9, ymm1);
-    ymm10 = _mm256_mul_ps(ymm10, ymm1);
-
-    ymm4 = _mm256_sub_ps(ymm3, ymm9);
-    ymm7 = _mm256_sub_ps(ymm6, ymm10);
-
-    ymm5 = _mm256_add_ps(ymm3, ymm9);
-    ymm8 = _mm256_add_ps(ymm6, ymm10);
-
-    ymm4 = _mm256_max_ps(ymm4, ymm2);
-    ymm7 = _mm256_max_ps(ymm7, ymm2);
-
-    ymm5 = _mm256_min_ps(ymm5, ymm2);
-    ymm8 = _mm256_min_ps(ymm8, ymm2);
-
-    ymm5 = _mm256_or_ps(ymm4, ymm5);
-    ymm8 = _mm256_or_ps(ymm7, ymm8);
-
-    _mm256_store_ps(dst + i, ymm5);
-    _mm256_store_ps(dst + i + 8, ymm8);
-  }
-  if (i <= size - 8) {
-    ymm3 = _mm256_load_ps(src + i);
-    ymm9 = _mm256_load_ps(lr + i);
-    ymm9 = _mm256_mul_ps(ymm9, ymm1);
-    ymm4 = _mm256_sub_ps(ymm3, ymm9);
-    ymm5 = _mm256_add_ps(ymm3, ymm9);
-    ymm4 = _mm256_max_ps(ymm4, ymm2);
-    ymm5 = _mm256_min_ps(ymm5, ymm2);
-    ymm5 = _mm256_or_ps(ymm4, ymm5);
-    _mm256_store_ps(dst + i, ymm5);
-
-    i += 8;
-  }
-  for (; i < size; i++) {
-    src_val = src[i];
-    float nlambda = lr[i] * lambda;
-    if (src_val > 0) {
-      dst[i] = ((src_val > nlambda) ? (src_val - nlambda) : 0);
-    } else {
-      dst[i] = ((-src_val > nlambda) ? (src_val + nlambda) : 0);
-    }
-  }
-}
+namespace paddle {
+namespace simd {
+namespace internal {
+#ifdef __SSE3__
 
-#elif defined(__SSE3__)
+/**
+ * The SSE3 kernels are the baseline; they are compiled with the flags of the
+ * whole library. The wider kernels are in their own files, see SIMDKernels.h.
+ */
 
 static void addto_sse(float* a, const float* b, size_t len) {
   int offset = len % 16;
@@ -316,6 +96,73 @@ static void batch_addto_sse(float* a, const float* b[], int batch, size_t len) {
   return;
 }
 
+/**
+ * The rows of b are read with unaligned loads since they are usually rows of
+ * a matrix picked by the indices of a sparse matrix. 16 columns of a are kept
+ * in registers while all rows of b are added to them.
+ */
+static void batch_axpy_sse(
+    float* a, const float* b[], const float* scale, int batch, size_t len) {
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128 ma0 = _mm_loadu_ps(a + i);
+    __m128 ma1 = _mm_loadu_ps(a + i + 4);
+    __m128 ma2 = _mm_loadu_ps(a + i + 8);
+    __m128 ma3 = _mm_loadu_ps(a + i + 12);
+    for (int k = 0; k < batch; k++) {
+      __m128 ms = _mm_set1_ps(scale ? scale[k] : 1.0f);
+      ma0 = _mm_add_ps(ma0, _mm_mul_ps(ms, _mm_loadu_ps(b[k] + i)));
+      ma1 = _mm_add_ps(ma1, _mm_mul_ps(ms, _mm_loadu_ps(b[k] + i + 4)));
+      ma2 = _mm_add_ps(ma2, _mm_mul_ps(ms, _mm_loadu_ps(b[k] + i + 8)));
+      ma3 = _mm_add_ps(ma3, _mm_mul_ps(ms, _mm_loadu_ps(b[k] + i + 12)));
+    }
+    _mm_storeu_ps(a + i, ma0);
+    _mm_storeu_ps(a + i + 4, ma1);
+    _mm_storeu_ps(a + i + 8, ma2);
+    _mm_storeu_ps(a + i + 12, ma3);
+  }
+  for (; i < len; i++) {
+    float sum = a[i];
+    for (int k = 0; k < batch; k++) {
+      sum += (scale ? scale[k] : 1.0f) * b[k][i];
+    }
+    a[i] = sum;
+  }
+}
+
+/**
+ * r[k] = <a, b[k]> for ROWS rows of b at once, so that every load of a is
+ * shared by ROWS products.
+ */
+template <int ROWS>
+static inline void dot_rows_sse(float* r,
+                                const float* a,
+                                const float* const* b,
+                                size_t len) {
+  __m128 sum[ROWS];
+  for (int k = 0; k < ROWS; k++) sum[k] = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    __m128 ma = _mm_loadu_ps(a + i);
+    for (int k = 0; k < ROWS; k++) {
+      sum[k] = _mm_add_ps(sum[k], _mm_mul_ps(ma, _mm_loadu_ps(b[k] + i)));
+    }
+  }
+  for (int k = 0; k < ROWS; k++) {
+    __m128 s = _mm_hadd_ps(sum[k], sum[k]);
+    float dot = _mm_cvtss_f32(_mm_hadd_ps(s, s));
+    for (size_t j = i; j < len; j++) dot += a[j] * b[k][j];
+    r[k] = dot;
+  }
+}
+
+static void batch_dot_sse(
+    float* r, const float* a, const float* b[], int batch, size_t len) {
+  int k = 0;
+  for (; k + 4 <= batch; k += 4) dot_rows_sse<4>(r + k, a, b + k, len);
+  for (; k < batch; k++) dot_rows_sse<1>(r + k, a, b + k, len);
+}
+
 static void col_max_sse(float* result,
                         const float* data,
                         int dim,
@@ -358,40 +205,555 @@ static void col_max_sse(float* result,
   }
 }
 
+
+static inline __m128 select_sse(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 exp_sse(__m128 x) {
+  // min and max return their second operand if one of them is NaN.
+  x = _mm_max_ps(_mm_set1_ps(kExpLo), _mm_min_ps(_mm_set1_ps(kExpHi), x));
+  __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(kLog2e)));
+  __m128 fn = _mm_cvtepi32_ps(n);
+  __m128 r = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(kLn2Hi)));
+  r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(kLn2Lo)));
+  __m128 p = _mm_set1_ps(kExpP[0]);
+  for (int i = 1; i < 6; ++i) {
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(kExpP[i]));
+  }
+  p = _mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), r);
+  p = _mm_add_ps(p, _mm_set1_ps(1.0f));
+  __m128i half = _mm_srai_epi32(n, 1);
+  __m128i bias = _mm_set1_epi32(127);
+  __m128 s1 = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(half, bias), 23));
+  __m128 s2 = _mm_castsi128_ps(
+      _mm_slli_epi32(_mm_add_epi32(_mm_sub_epi32(n, half), bias), 23));
+  return _mm_mul_ps(_mm_mul_ps(p, s1), s2);
+}
+
+static inline __m128 log_sse(__m128 x) {
+  __m128 zero = _mm_setzero_ps();
+  __m128 invalid = _mm_cmpnge_ps(x, zero);
+  __m128 isZero = _mm_cmpeq_ps(x, zero);
+  __m128 isInf = _mm_cmpeq_ps(x, _mm_set1_ps(INFINITY));
+
+  __m128i bits = _mm_castps_si128(_mm_max_ps(x, _mm_set1_ps(FLT_MIN)));
+  __m128 e = _mm_cvtepi32_ps(
+      _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+  __m128 m = _mm_castsi128_ps(
+      _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                   _mm_set1_epi32(0x3f000000)));
+  // m is in [0.5, 1), move it to [sqrt(0.5), sqrt(2)) and subtract 1.
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 small = _mm_cmplt_ps(m, _mm_set1_ps(kSqrtHalf));
+  e = _mm_sub_ps(e, _mm_and_ps(small, one));
+  m = _mm_add_ps(_mm_sub_ps(m, one), _mm_and_ps(small, m));
+
+  __m128 z = _mm_mul_ps(m, m);
+  __m128 p = _mm_set1_ps(kLogP[0]);
+  for (int i = 1; i < 9; ++i) {
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(kLogP[i]));
+  }
+  p = _mm_mul_ps(_mm_mul_ps(p, m), z);
+  p = _mm_add_ps(p, _mm_mul_ps(e, _mm_set1_ps(kLn2Lo)));
+  p = _mm_sub_ps(p, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  __m128 y = _mm_add_ps(_mm_add_ps(m, p), _mm_mul_ps(e, _mm_set1_ps(kLn2Hi)));
+
+  y = select_sse(isZero, _mm_set1_ps(-INFINITY), y);
+  y = select_sse(isInf, x, y);
+  return _mm_or_ps(y, invalid);
+}
+
+static inline __m128 log1p_sse(__m128 x) {
+  // log1p(x) = log(u) * x / (u - 1) with u = 1 + x, which cancels the
+  // rounding error of 1 + x; it is x itself when u rounds to 1.
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 u = _mm_add_ps(x, one);
+  __m128 d = _mm_sub_ps(u, one);
+  __m128 isOne = _mm_cmpeq_ps(d, _mm_setzero_ps());
+  __m128 isInf = _mm_cmpeq_ps(u, _mm_set1_ps(INFINITY));
+  d = select_sse(_mm_or_ps(isOne, isInf), one, d);
+  __m128 y = _mm_mul_ps(log_sse(u), _mm_div_ps(x, d));
+  y = select_sse(isOne, x, y);
+  return select_sse(isInf, u, y);
+}
+
+static inline __m128 tanh_sse(__m128 x) {
+  __m128 t = _mm_mul_ps(x, _mm_set1_ps(-2.0f));
+  t = exp_sse(_mm_min_ps(_mm_set1_ps(kTanhMaxExpInput), t));
+  __m128 one = _mm_set1_ps(1.0f);
+  return _mm_sub_ps(_mm_div_ps(_mm_set1_ps(2.0f), _mm_add_ps(one, t)), one);
+}
+
+static inline __m128 sigmoid_sse(__m128 x) {
+  x = _mm_max_ps(_mm_set1_ps(kSigmoidMin),
+                 _mm_min_ps(_mm_set1_ps(kSigmoidMax), x));
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 t = exp_sse(_mm_sub_ps(_mm_setzero_ps(), x));
+  return _mm_div_ps(one, _mm_add_ps(one, t));
+}
+
+/**
+ * Apply Func to every element, the tail goes through a buffer padded with
+ * ones so that no lane raises a floating point exception.
+ */
+template <__m128 (*Func)(__m128)>
+static void unary_sse(float* r, const float* a, size_t len) {
+  size_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    _mm_storeu_ps(r + i, Func(_mm_loadu_ps(a + i)));
+  }
+  if (i < len) {
+    float buf[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    std::copy(a + i, a + len, buf);
+    _mm_storeu_ps(buf, Func(_mm_loadu_ps(buf)));
+    std::copy(buf, buf + len - i, r + i);
+  }
+}
+
+
+static void transpose_sse(float* dst,
+                          int ldDst,
+                          const float* src,
+                          int ldSrc,
+                          size_t height,
+                          size_t width) {
+  for (size_t i0 = 0; i0 < height; i0 += kTransposeTile) {
+    size_t i1 = std::min(i0 + kTransposeTile, height);
+    for (size_t j0 = 0; j0 < width; j0 += kTransposeTile) {
+      size_t j1 = std::min(j0 + kTransposeTile, width);
+      size_t i = i0;
+      for (; i + 4 <= i1; i += 4) {
+        const float* s = src + (ptrdiff_t)i * ldSrc;
+        size_t j = j0;
+        for (; j + 4 <= j1; j += 4) {
+          __m128 r0 = _mm_loadu_ps(s + j);
+          __m128 r1 = _mm_loadu_ps(s + ldSrc + j);
+          __m128 r2 = _mm_loadu_ps(s + 2 * ldSrc + j);
+          __m128 r3 = _mm_loadu_ps(s + 3 * ldSrc + j);
+          _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+          float* d = dst + (ptrdiff_t)j * ldDst + i;
+          _mm_storeu_ps(d, r0);
+          _mm_storeu_ps(d + ldDst, r1);
+          _mm_storeu_ps(d + 2 * ldDst, r2);
+          _mm_storeu_ps(d + 3 * ldDst, r3);
+        }
+        transpose_edge(dst, ldDst, src, ldSrc, i, i + 4, j, j1);
+      }
+      transpose_edge(dst, ldDst, src, ldSrc, i, i1, j0, j1);
+    }
+  }
+}
+
+
+template <int ROWS>
+static inline void gemm_packed_tile_sse(float* C,
+                                        int ldc,
+                                        const float* A,
+                                        int lda,
+                                        const float* panel,
+                                        size_t K,
+                                        size_t cols,
+                                        float alpha,
+                                        float beta) {
+  __m128 acc[ROWS][4];
+  for (int r = 0; r < ROWS; ++r) {
+    for (int v = 0; v < 4; ++v) {
+      acc[r][v] = _mm_setzero_ps();
+    }
+  }
+  for (size_t k = 0; k < K; ++k, panel += kGemmPanel) {
+    __m128 b[4];
+    for (int v = 0; v < 4; ++v) {
+      b[v] = _mm_loadu_ps(panel + 4 * v);
+    }
+    for (int r = 0; r < ROWS; ++r) {
+      __m128 a = _mm_set1_ps(A[r * lda + k]);
+      for (int v = 0; v < 4; ++v) {
+        acc[r][v] = _mm_add_ps(acc[r][v], _mm_mul_ps(a, b[v]));
+      }
+    }
+  }
+  __m128 va = _mm_set1_ps(alpha);
+  __m128 vb = _mm_set1_ps(beta);
+  for (int r = 0; r < ROWS; ++r) {
+    float* c = C + r * ldc;
+    if (cols < kGemmPanel) {
+      float buf[kGemmPanel];
+      for (int v = 0; v < 4; ++v) {
+        _mm_storeu_ps(buf + 4 * v, acc[r][v]);
+      }
+      gemm_store_edge(c, buf, cols, alpha, beta);
+      continue;
+    }
+    for (int v = 0; v < 4; ++v) {
+      __m128 y = _mm_mul_ps(va, acc[r][v]);
+      if (beta != 0) {
+        y = _mm_add_ps(y, _mm_mul_ps(vb, _mm_loadu_ps(c + 4 * v)));
+      }
+      _mm_storeu_ps(c + 4 * v, y);
+    }
+  }
+}
+
+static void gemm_packed_sse(float* C,
+                            int ldc,
+                            const float* A,
+                            int lda,
+                            const float* packedB,
+                            size_t M,
+                            size_t N,
+                            size_t K,
+                            float alpha,
+                            float beta) {
+  for (size_t j = 0; j < N; j += kGemmPanel) {
+    const float* panel = packedB + j * K;
+    size_t cols = std::min(kGemmPanel, N - j);
+    size_t i = 0;
+    for (; i + 2 <= M; i += 2) {
+      gemm_packed_tile_sse<2>(
+          C + i * ldc + j, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+    }
+    if (i < M) {
+      gemm_packed_tile_sse<1>(
+          C + i * ldc + j, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+    }
+  }
+}
+
+static void decayL1_naive(float* dst, float* src, float lambda, size_t len) {
+  naive::decayL1(dst, src, lambda, len);
+}
+
+static void decayL1_naive(
+    float* dst, float* src, float* lr, float lambda, size_t len) {
+  naive::decayL1(dst, src, lr, lambda, len);
+}
+
+static void gemm_int8_naive(float* C,
+                            int ldc,
+                            const int8_t* A,
+                            int lda,
+                            const float* scaleA,
+                            const int8_t* packedB,
+                            const int32_t* sumB,
+                            const float* scaleB,
+                            const float* bias,
+                            size_t M,
+                            size_t N,
+                            size_t K,
+                            float beta) {
+  naive::gemmInt8(
+      C, ldc, A, lda, scaleA, packedB, sumB, scaleB, bias, M, N, K, beta);
+}
+
+// Below AVX2, the recurrent kernels are the scalar ones of naive::.
+static const KernelTable kSSE3Kernels = {"sse3",
+                                         addto_sse,
+                                         batch_addto_sse,
+                                         batch_axpy_sse,
+                                         batch_dot_sse,
+                                         col_max_sse,
+                                         decayL1_naive,
+                                         decayL1_naive,
+                                         unary_sse<exp_sse>,
+                                         unary_sse<log_sse>,
+                                         unary_sse<log1p_sse>,
+                                         unary_sse<tanh_sse>,
+                                         unary_sse<sigmoid_sse>,
+                                         transpose_sse,
+                                         gemm_packed_sse,
+                                         gemm_int8_naive,
+                                         naive::lstmForward<float>,
+                                         naive::lstmBackward<float>,
+                                         naive::gruResetOutput<float>,
+                                         naive::gruFinalOutput<float>,
+                                         naive::gruStateGrad<float>,
+                                         naive::gruResetGrad<float>};
+
+#ifdef PADDLE_SIMD_DISPATCH
+// AVX has no 256-bit integer instructions for the exponent arithmetic.
+static const KernelTable kAVXKernels = {"avx",
+                                        addto_avx,
+                                        batch_addto_avx,
+                                        batch_axpy_avx,
+                                        batch_dot_avx,
+                                        col_max_avx,
+                                        decayL1_avx,
+                                        decayL1_avx,
+                                        unary_sse<exp_sse>,
+                                        unary_sse<log_sse>,
+                                        unary_sse<log1p_sse>,
+                                        unary_sse<tanh_sse>,
+                                        unary_sse<sigmoid_sse>,
+                                        transpose_avx,
+                                        gemm_packed_sse,
+                                        gemm_int8_naive,
+                                        naive::lstmForward<float>,
+                                        naive::lstmBackward<float>,
+                                        naive::gruResetOutput<float>,
+                                        naive::gruFinalOutput<float>,
+                                        naive::gruStateGrad<float>,
+                                        naive::gruResetGrad<float>};
+
+static const KernelTable kAVX2Kernels = {"avx2_fma",
+                                         addto_avx,
+                                         batch_addto_avx,
+                                         batch_axpy_avx2_fma,
+                                         batch_dot_avx2_fma,
+                                         col_max_avx,
+                                         decayL1_avx,
+                                         decayL1_avx2_fma,
+                                         vexp_avx2,
+                                         vlog_avx2,
+                                         vlog1p_avx2,
+                                         vtanh_avx2,
+                                         vsigmoid_avx2,
+                                         transpose_avx,
+                                         gemm_packed_avx2_fma,
+                                         gemm_int8_avx2_fma,
+                                         lstm_forward_avx2_fma,
+                                         lstm_backward_avx2_fma,
+                                         gru_reset_output_avx2_fma,
+                                         gru_final_output_avx2_fma,
+                                         gru_state_grad_avx2_fma,
+                                         gru_reset_grad_avx2_fma};
+
+static const KernelTable kAVX512Kernels = {"avx512",
+                                           addto_avx512,
+                                           batch_addto_avx512,
+                                           batch_axpy_avx512,
+                                           batch_dot_avx512,
+                                           col_max_avx512,
+                                           decayL1_avx512,
+                                           decayL1_avx512,
+                                           vexp_avx512,
+                                           vlog_avx512,
+                                           vlog1p_avx512,
+                                           vtanh_avx512,
+                                           vsigmoid_avx512,
+                                           transpose_avx,
+                                           gemm_packed_avx512,
+                                           gemm_int8_avx2_fma,
+                                           lstm_forward_avx512,
+                                           lstm_backward_avx512,
+                                           gru_reset_output_avx512,
+                                           gru_final_output_avx512,
+                                           gru_state_grad_avx512,
+                                           gru_reset_grad_avx512};
+
+static const KernelTable kAVX512VNNIKernels = {"avx512_vnni",
+                                               addto_avx512,
+                                               batch_addto_avx512,
+                                               batch_axpy_avx512,
+                                               batch_dot_avx512,
+                                               col_max_avx512,
+                                               decayL1_avx512,
+                                               decayL1_avx512,
+                                               vexp_avx512,
+                                               vlog_avx512,
+                                               vlog1p_avx512,
+                                               vtanh_avx512,
+                                               vsigmoid_avx512,
+                                               transpose_avx,
+                                               gemm_packed_avx512,
+                                               gemm_int8_vnni,
+                                               lstm_forward_avx512,
+                                               lstm_backward_avx512,
+                                               gru_reset_output_avx512,
+                                               gru_final_output_avx512,
+                                               gru_state_grad_avx512,
+                                               gru_reset_grad_avx512};
 #endif
 
-#if defined(__AVX__)
-#define SIMD_INVOKE(func, ...) func##_avx(__VA_ARGS__)
-#elif defined(__SSE3__)
-#define SIMD_INVOKE(func, ...) func##_sse(__VA_ARGS__)
+std::vector<const KernelTable*> supportedKernelTables() {
+  std::vector<const KernelTable*> tables = {&kSSE3Kernels};
+#ifdef PADDLE_SIMD_DISPATCH
+  if (HAS_AVX) {
+    tables.push_back(&kAVXKernels);
+  }
+  if (HAS_SIMD(SIMD_AVX | SIMD_AVX2 | SIMD_FMA3)) {
+    tables.push_back(&kAVX2Kernels);
+  }
+  if (HAS_SIMD(SIMD_AVX | SIMD_AVX2 | SIMD_FMA3 | SIMD_AVX512)) {
+    tables.push_back(&kAVX512Kernels);
+  }
+  if (HAS_SIMD(SIMD_AVX | SIMD_AVX2 | SIMD_FMA3 | SIMD_AVX512 |
+               SIMD_AVX512_VNNI)) {
+    tables.push_back(&kAVX512VNNIKernels);
+  }
 #endif
+  return tables;
+}
+
+const KernelTable& activeKernelTable() {
+  static const KernelTable* table = supportedKernelTables().back();
+  return *table;
+}
 
-namespace paddle {
-namespace simd {
-namespace internal {
-#ifdef __SSE3__
 void addToImpl(float* a, const float* b, size_t len) {
-  SIMD_INVOKE(addto, a, b, len);
+  activeKernelTable().addTo(a, b, len);
 }
+
 void batchAddToImpl(float* a, const float* b[], int batch, size_t len) {
-  SIMD_INVOKE(batch_addto, a, b, batch, len);
+  activeKernelTable().batchAddTo(a, b, batch, len);
+}
+
+void batchAxpyImpl(
+    float* a, const float* b[], const float* scale, int batch, size_t len) {
+  activeKernelTable().batchAxpy(a, b, scale, batch, len);
+}
+
+void batchDotImpl(
+    float* r, const float* a, const float* b[], int batch, size_t len) {
+  activeKernelTable().batchDot(r, a, b, batch, len);
 }
 
 void colMaxImpl(float* result, const float* data, int dim, int numSamples) {
-  SIMD_INVOKE(col_max, result, data, dim, numSamples);
+  activeKernelTable().colMax(result, data, dim, numSamples);
 }
-#endif
 
-#ifdef __AVX__
-void decayL1AvxImpl(float* dst, float* src, float lambda, size_t len) {
-  decayL1_avx(dst, src, lambda, len);
+void decayL1Impl(float* dst, float* src, float lambda, size_t len) {
+  activeKernelTable().decayL1(dst, src, lambda, len);
 }
-void decayL1AvxImpl(
-    float* dst, float* src, float* lr, float lambda, size_t len) {
-  decayL1_avx(dst, src, lr, lambda, len);
+
+void decayL1Impl(float* dst, float* src, float* lr, float lambda, size_t len) {
+  activeKernelTable().decayL1WithLR(dst, src, lr, lambda, len);
+}
+
+void vExpImpl(float* r, const float* a, size_t len) {
+  activeKernelTable().vExp(r, a, len);
+}
+
+void vLogImpl(float* r, const float* a, size_t len) {
+  activeKernelTable().vLog(r, a, len);
+}
+
+void vLog1pImpl(float* r, const float* a, size_t len) {
+  activeKernelTable().vLog1p(r, a, len);
+}
+
+void vTanhImpl(float* r, const float* a, size_t len) {
+  activeKernelTable().vTanh(r, a, len);
+}
+
+void vSigmoidImpl(float* r, const float* a, size_t len) {
+  activeKernelTable().vSigmoid(r, a, len);
+}
+
+void transposeImpl(float* dst,
+                   int ldDst,
+                   const float* src,
+                   int ldSrc,
+                   size_t height,
+                   size_t width) {
+  activeKernelTable().transpose(dst, ldDst, src, ldSrc, height, width);
+}
+
+void gemmPackedBImpl(float* C,
+                     int ldc,
+                     const float* A,
+                     int lda,
+                     const float* packedB,
+                     size_t M,
+                     size_t N,
+                     size_t K,
+                     float alpha,
+                     float beta) {
+  activeKernelTable().gemmPackedB(
+      C, ldc, A, lda, packedB, M, N, K, alpha, beta);
+}
+
+void gemmInt8Impl(float* C,
+                  int ldc,
+                  const int8_t* A,
+                  int lda,
+                  const float* scaleA,
+                  const int8_t* packedB,
+                  const int32_t* sumB,
+                  const float* scaleB,
+                  const float* bias,
+                  size_t M,
+                  size_t N,
+                  size_t K,
+                  float beta) {
+  activeKernelTable().gemmInt8(
+      C, ldc, A, lda, scaleA, packedB, sumB, scaleB, bias, M, N, K, beta);
+}
+
+void lstmForwardImpl(const LstmValue<float>& value,
+                     size_t frameSize,
+                     size_t batchSize,
+                     Activation activeNode,
+                     Activation activeState) {
+  activeKernelTable().lstmForward(
+      value, frameSize, batchSize, activeNode, activeState);
+}
+
+void lstmBackwardImpl(const LstmValue<float>& value,
+                      const LstmGrad<float>& grad,
+                      size_t frameSize,
+                      size_t batchSize,
+                      Activation activeNode,
+                      Activation activeState) {
+  activeKernelTable().lstmBackward(
+      value, grad, frameSize, batchSize, activeNode, activeState);
+}
+
+void gruResetOutputImpl(float* gate,
+                        const float* prevOut,
+                        float* resetOutput,
+                        size_t frameSize,
+                        size_t batchSize) {
+  activeKernelTable().gruResetOutput(
+      gate, prevOut, resetOutput, frameSize, batchSize);
+}
+
+void gruFinalOutputImpl(float* gate,
+                        const float* prevOut,
+                        float* output,
+                        size_t frameSize,
+                        size_t batchSize,
+                        Activation activeNode) {
+  activeKernelTable().gruFinalOutput(
+      gate, prevOut, output, frameSize, batchSize, activeNode);
+}
+
+void gruStateGradImpl(const float* gate,
+                      float* gateGrad,
+                      const float* prevOut,
+                      float* prevOutGrad,
+                      const float* outputGrad,
+                      size_t frameSize,
+                      size_t batchSize,
+                      Activation activeNode) {
+  activeKernelTable().gruStateGrad(gate,
+                                   gateGrad,
+                                   prevOut,
+                                   prevOutGrad,
+                                   outputGrad,
+                                   frameSize,
+                                   batchSize,
+                                   activeNode);
+}
+
+void gruResetGradImpl(const float* gate,
+                      float* gateGrad,
+                      const float* prevOut,
+                      float* prevOutGrad,
+                      const float* resetOutputGrad,
+                      size_t frameSize,
+                      size_t batchSize) {
+  activeKernelTable().gruResetGrad(gate,
+                                   gateGrad,
+                                   prevOut,
+                                   prevOutGrad,
+                                   resetOutputGrad,
+                                   frameSize,
+                                   batchSize);
 }
-#endif
 
+#endif  // __SSE3__
 }  // namespace internal
 }  // namespace simd
 }  // namespace paddle
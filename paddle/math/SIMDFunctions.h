@@ -15,11 +15,133 @@ limitations under the License. */
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <cmath>
+#include <vector>
 
 namespace paddle {
 
 namespace simd {
 
+/// Columns in a panel of a B packed by packGemmB().
+const size_t kGemmPanelWidth = 16;
+
+/// Number of elements of a K x N matrix packed by packGemmB().
+inline size_t packedGemmBSize(size_t K, size_t N) {
+  return (N + kGemmPanelWidth - 1) / kGemmPanelWidth * kGemmPanelWidth * K;
+}
+
+/**
+ * Pack B, the K x N right operand of a gemm, into panels of kGemmPanelWidth
+ * columns. A panel holds its K rows of kGemmPanelWidth elements one after
+ * another, the columns past N are zero. When transB is set, B is stored as
+ * a N x K matrix.
+ */
+template <typename Type>
+inline void packGemmB(
+    Type* packed, const Type* B, int ldb, bool transB, size_t K, size_t N) {
+  for (size_t j0 = 0; j0 < N; j0 += kGemmPanelWidth) {
+    for (size_t k = 0; k < K; ++k) {
+      for (size_t j = j0; j < j0 + kGemmPanelWidth; ++j) {
+        *packed++ = j >= N ? 0 : (transB ? B[j * ldb + k] : B[k * ldb + j]);
+      }
+    }
+  }
+}
+
+/// Columns in a panel of an int8 B packed by packGemmInt8B().
+const size_t kInt8PanelWidth = 16;
+/// Rows of an int8 B stored next to each other for every column.
+const size_t kInt8GroupSize = 4;
+
+/// K rounded up to whole groups of rows, the row length of an int8 A.
+inline size_t int8GroupedK(size_t K) {
+  return (K + kInt8GroupSize - 1) / kInt8GroupSize * kInt8GroupSize;
+}
+
+/// Bytes of a K x N int8 matrix packed by packGemmInt8B().
+inline size_t packedGemmInt8BSize(size_t K, size_t N) {
+  return (N + kInt8PanelWidth - 1) / kInt8PanelWidth * kInt8PanelWidth *
+         int8GroupedK(K);
+}
+
+/**
+ * Pack the K x N int8 B into panels of kInt8PanelWidth columns. A panel
+ * holds int8GroupedK(K) / kInt8GroupSize groups, and a group stores the
+ * kInt8GroupSize rows of each column one after another, as the dot product
+ * instructions read them. The rows past K and the columns past N are zero.
+ * sums receives the sum of every column of B. When transB is set, B is
+ * stored as a N x K matrix.
+ */
+inline void packGemmInt8B(int8_t* packed,
+                          int32_t* sums,
+                          const int8_t* B,
+                          int ldb,
+                          bool transB,
+                          size_t K,
+                          size_t N) {
+  size_t groupedK = int8GroupedK(K);
+  for (size_t j0 = 0; j0 < N; j0 += kInt8PanelWidth) {
+    for (size_t k0 = 0; k0 < groupedK; k0 += kInt8GroupSize) {
+      for (size_t j = j0; j < j0 + kInt8PanelWidth; ++j) {
+        for (size_t k = k0; k < k0 + kInt8GroupSize; ++k) {
+          *packed++ = (j >= N || k >= K)
+                          ? 0
+                          : (transB ? B[j * ldb + k] : B[k * ldb + j]);
+        }
+      }
+    }
+  }
+  for (size_t j = 0; j < N; ++j) {
+    sums[j] = 0;
+    for (size_t k = 0; k < K; ++k) {
+      sums[j] += transB ? B[j * ldb + k] : B[k * ldb + j];
+    }
+  }
+}
+
+/// Activations of the recurrent kernels, numbered as hl_activation_mode_t.
+enum Activation {
+  kActSigmoid = 0,
+  kActRelu = 1,
+  kActTanh = 2,
+  kActLinear = 3,
+};
+
+/**
+ * A batch of lstm steps, as hl_lstm_value. A row of gate holds the frame
+ * input and the input, forget and output gates of a sample, frameSize
+ * values each, the other rows hold frameSize values. prevState is nullptr
+ * at the first step. The peephole weights checkI, checkF and checkO are
+ * shared by all the rows.
+ */
+template <typename Type>
+struct LstmValue {
+  Type* gate;
+  const Type* prevState;
+  Type* state;
+  Type* stateActive;
+  Type* output;
+  const Type* checkI;
+  const Type* checkF;
+  const Type* checkO;
+};
+
+/**
+ * The gradients of a batch of lstm steps, as hl_lstm_grad. prevState and
+ * the gradients of the peephole weights may be nullptr. The latter are
+ * summed over the rows.
+ */
+template <typename Type>
+struct LstmGrad {
+  Type* gate;
+  Type* prevState;
+  Type* state;
+  const Type* output;
+  Type* checkI;
+  Type* checkF;
+  Type* checkO;
+};
+
 namespace naive {
 template <typename Type>
 inline void addTo(Type* a, const Type* b, size_t len) {
@@ -37,6 +159,37 @@ inline void batchAddTo(Type* a, const Type* b[], int batch, size_t len) {
   }
 }
 
+/**
+ * a += scale[0] * b[0] + ... + scale[batch - 1] * b[batch - 1],
+ * scale may be nullptr, which means all of them are 1.
+ */
+template <typename Type>
+inline void batchAxpy(
+    Type* a, const Type* b[], const Type* scale, int batch, size_t len) {
+  for (int i = 0; i < batch; ++i) {
+    Type s = scale ? scale[i] : (Type)1;
+    for (size_t j = 0; j < len; ++j) {
+      a[j] += s * b[i][j];
+    }
+  }
+}
+
+/**
+ * r[i] = <a, b[i]> for i < batch. Each load of a is shared by the products
+ * with several rows of b.
+ */
+template <typename Type>
+inline void batchDot(
+    Type* r, const Type* a, const Type* b[], int batch, size_t len) {
+  for (int i = 0; i < batch; ++i) {
+    Type sum = 0;
+    for (size_t j = 0; j < len; ++j) {
+      sum += a[j] * b[i][j];
+    }
+    r[i] = sum;
+  }
+}
+
 /**
  * @note this method is unused in paddle.
  */
@@ -75,6 +228,384 @@ inline void decayL1(Type* dst, Type* src, Type lambda, size_t len) {
     }
   }
 }
+
+template <typename Type>
+inline void vExp(Type* r, const Type* a, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    r[i] = std::exp(a[i]);
+  }
+}
+
+template <typename Type>
+inline void vLog(Type* r, const Type* a, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    r[i] = std::log(a[i]);
+  }
+}
+
+template <typename Type>
+inline void vLog1p(Type* r, const Type* a, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    r[i] = std::log1p(a[i]);
+  }
+}
+
+/**
+ * r = 2 / (1 + exp(-2a)) - 1, with -2a clipped to 40 so that exp does not
+ * overflow.
+ */
+template <typename Type>
+inline void vTanh(Type* r, const Type* a, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    Type t = -2 * a[i];
+    t = t > 40 ? 40 : t;
+    r[i] = 2 / (1 + std::exp(t)) - 1;
+  }
+}
+
+/**
+ * r = 1 / (1 + exp(-a)), with a clipped to [-40, 13] so that 0 < r < 1.
+ */
+template <typename Type>
+inline void vSigmoid(Type* r, const Type* a, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    Type t = a[i] < -40 ? -40 : (a[i] > 13 ? 13 : a[i]);
+    r[i] = 1 / (1 + std::exp(-t));
+  }
+}
+
+/**
+ * dst = src^T. src is height x width with a row stride of ldSrc, dst is
+ * width x height with a row stride of ldDst. A negative stride walks the
+ * rows of a matrix backwards, from the row the pointer points to.
+ */
+template <typename Type>
+inline void transpose(Type* dst,
+                      int ldDst,
+                      const Type* src,
+                      int ldSrc,
+                      size_t height,
+                      size_t width) {
+  for (size_t i = 0; i < height; ++i) {
+    for (size_t j = 0; j < width; ++j) {
+      dst[(ptrdiff_t)j * ldDst + i] = src[(ptrdiff_t)i * ldSrc + j];
+    }
+  }
+}
+
+/**
+ * C = alpha * A * B + beta * C, A is M x K and B was packed by packGemmB().
+ * C is not read when beta is 0.
+ */
+template <typename Type>
+inline void gemmPackedB(Type* C,
+                        int ldc,
+                        const Type* A,
+                        int lda,
+                        const Type* packedB,
+                        size_t M,
+                        size_t N,
+                        size_t K,
+                        Type alpha,
+                        Type beta) {
+  for (size_t i = 0; i < M; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      const Type* panel = packedB + j / kGemmPanelWidth * kGemmPanelWidth * K +
+                          j % kGemmPanelWidth;
+      Type sum = 0;
+      for (size_t k = 0; k < K; ++k) {
+        sum += A[i * lda + k] * panel[k * kGemmPanelWidth];
+      }
+      Type& c = C[i * ldc + j];
+      c = beta == 0 ? alpha * sum : alpha * sum + beta * c;
+    }
+  }
+}
+
+/**
+ * C = scaleA[i] * scaleB[j] * (A * B)[i][j] + bias[j] + beta * C, where the
+ * products of the int8 A and B are summed exactly in int32. A is M x K with
+ * rows of lda bytes that are zero from K to int8GroupedK(K). B was packed
+ * by packGemmInt8B() into packedB and sumB. bias may be nullptr. C is not
+ * read when beta is 0.
+ */
+inline void gemmInt8(float* C,
+                     int ldc,
+                     const int8_t* A,
+                     int lda,
+                     const float* scaleA,
+                     const int8_t* packedB,
+                     const int32_t* sumB,
+                     const float* scaleB,
+                     const float* bias,
+                     size_t M,
+                     size_t N,
+                     size_t K,
+                     float beta) {
+  size_t groupedK = int8GroupedK(K);
+  for (size_t i = 0; i < M; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      const int8_t* panel = packedB +
+                            j / kInt8PanelWidth * kInt8PanelWidth * groupedK +
+                            j % kInt8PanelWidth * kInt8GroupSize;
+      int32_t sum = 0;
+      for (size_t k = 0; k < K; ++k) {
+        sum += A[i * lda + k] *
+               panel[k / kInt8GroupSize * kInt8PanelWidth * kInt8GroupSize +
+                     k % kInt8GroupSize];
+      }
+      float y = (float)sum * scaleA[i] * scaleB[j];
+      if (bias) {
+        y += bias[j];
+      }
+      float& c = C[i * ldc + j];
+      c = beta == 0 ? y : y + beta * c;
+    }
+  }
+}
+
+/// y = act(x), as the hppl activations.
+template <typename Type>
+inline Type activation(Activation act, Type x) {
+  switch (act) {
+    case kActSigmoid:
+      x = x < -40 ? -40 : (x > 13 ? 13 : x);
+      return 1 / (1 + std::exp(-x));
+    case kActRelu:
+      return x > 0 ? x : 0;
+    case kActTanh:
+      x = -2 * x > 40 ? 40 : -2 * x;
+      return 2 / (1 + std::exp(x)) - 1;
+    default:
+      return x;
+  }
+}
+
+/// The gradient of x, from the gradient of y = act(x) and y.
+template <typename Type>
+inline Type activationGrad(Activation act, Type grad, Type y) {
+  switch (act) {
+    case kActSigmoid:
+      return grad * y * (1 - y);
+    case kActRelu:
+      return y > 0 ? grad : 0;
+    case kActTanh:
+      return grad * (1 - y * y);
+    default:
+      return grad;
+  }
+}
+
+/**
+ * batchSize lstm steps, with sigmoid gates:
+ *   in = activeNode(in)
+ *   ig = sigmoid(ig + prevState * checkI)
+ *   fg = sigmoid(fg + prevState * checkF)
+ *   state = in * ig + prevState * fg
+ *   og = sigmoid(og + state * checkO)
+ *   stateActive = activeState(state)
+ *   output = og * stateActive
+ */
+template <typename Type>
+inline void lstmForward(const LstmValue<Type>& value,
+                        size_t frameSize,
+                        size_t batchSize,
+                        Activation activeNode,
+                        Activation activeState) {
+  for (size_t b = 0; b < batchSize; ++b) {
+    Type* gate = value.gate + b * frameSize * 4;
+    for (size_t i = 0; i < frameSize; ++i) {
+      size_t k = b * frameSize + i;
+      Type prev = value.prevState ? value.prevState[k] : 0;
+      Type in = activation(activeNode, gate[i]);
+      Type ig = activation(kActSigmoid,
+                           gate[i + frameSize] + prev * value.checkI[i]);
+      Type fg = activation(kActSigmoid,
+                           gate[i + frameSize * 2] + prev * value.checkF[i]);
+      Type state = in * ig + prev * fg;
+      Type og = activation(kActSigmoid,
+                           gate[i + frameSize * 3] + state * value.checkO[i]);
+      gate[i] = in;
+      gate[i + frameSize] = ig;
+      gate[i + frameSize * 2] = fg;
+      gate[i + frameSize * 3] = og;
+      value.state[k] = state;
+      value.stateActive[k] = activation(activeState, state);
+      value.output[k] = og * value.stateActive[k];
+    }
+  }
+}
+
+/**
+ * The gradients of lstmForward(). grad.state holds the gradient of the
+ * state from the next step and receives the total one.
+ */
+template <typename Type>
+inline void lstmBackward(const LstmValue<Type>& value,
+                         const LstmGrad<Type>& grad,
+                         size_t frameSize,
+                         size_t batchSize,
+                         Activation activeNode,
+                         Activation activeState) {
+  for (size_t b = 0; b < batchSize; ++b) {
+    const Type* gate = value.gate + b * frameSize * 4;
+    Type* gateGrad = grad.gate + b * frameSize * 4;
+    for (size_t i = 0; i < frameSize; ++i) {
+      size_t k = b * frameSize + i;
+      Type prev = value.prevState ? value.prevState[k] : 0;
+      Type in = gate[i];
+      Type ig = gate[i + frameSize];
+      Type fg = gate[i + frameSize * 2];
+      Type og = gate[i + frameSize * 3];
+      Type outGrad = grad.output[k];
+      Type ogGrad = activationGrad(
+          kActSigmoid, outGrad * value.stateActive[k], og);
+      Type stateGrad = grad.state[k] +
+                       (activationGrad(activeState,
+                                       outGrad * og,
+                                       value.stateActive[k]) +
+                        ogGrad * value.checkO[i]);
+      Type inGrad = activationGrad(activeNode, stateGrad * ig, in);
+      Type igGrad = activationGrad(kActSigmoid, stateGrad * in, ig);
+      Type fgGrad = activationGrad(kActSigmoid, stateGrad * prev, fg);
+      gateGrad[i] = inGrad;
+      gateGrad[i + frameSize] = igGrad;
+      gateGrad[i + frameSize * 2] = fgGrad;
+      gateGrad[i + frameSize * 3] = ogGrad;
+      grad.state[k] = stateGrad;
+      if (grad.prevState) {
+        grad.prevState[k] = igGrad * value.checkI[i] +
+                            fgGrad * value.checkF[i] + stateGrad * fg;
+      }
+      if (value.prevState && grad.checkI) {
+        grad.checkI[i] += igGrad * prev;
+      }
+      if (value.prevState && grad.checkF) {
+        grad.checkF[i] += fgGrad * prev;
+      }
+      if (grad.checkO) {
+        grad.checkO[i] += ogGrad * value.state[k];
+      }
+    }
+  }
+}
+
+/**
+ * The first half of batchSize gru steps, with sigmoid gates. A row of gate
+ * holds the update gate, the reset gate and the frame state of a sample,
+ * frameSize values each. prevOut is nullptr at the first step.
+ *   u = sigmoid(u)
+ *   r = sigmoid(r)
+ *   resetOutput = prevOut * r
+ */
+template <typename Type>
+inline void gruResetOutput(Type* gate,
+                           const Type* prevOut,
+                           Type* resetOutput,
+                           size_t frameSize,
+                           size_t batchSize) {
+  for (size_t b = 0; b < batchSize; ++b) {
+    Type* u = gate + b * frameSize * 3;
+    Type* r = u + frameSize;
+    for (size_t i = 0; i < frameSize; ++i) {
+      size_t k = b * frameSize + i;
+      u[i] = activation(kActSigmoid, u[i]);
+      r[i] = activation(kActSigmoid, r[i]);
+      resetOutput[k] = (prevOut ? prevOut[k] : 0) * r[i];
+    }
+  }
+}
+
+/**
+ * The second half of batchSize gru steps, after the frame state received
+ * resetOutput * stateWeight:
+ *   fs = activeNode(fs)
+ *   output = prevOut - u * prevOut + u * fs
+ */
+template <typename Type>
+inline void gruFinalOutput(Type* gate,
+                           const Type* prevOut,
+                           Type* output,
+                           size_t frameSize,
+                           size_t batchSize,
+                           Activation activeNode) {
+  for (size_t b = 0; b < batchSize; ++b) {
+    const Type* u = gate + b * frameSize * 3;
+    Type* fs = gate + b * frameSize * 3 + frameSize * 2;
+    for (size_t i = 0; i < frameSize; ++i) {
+      size_t k = b * frameSize + i;
+      Type prev = prevOut ? prevOut[k] : 0;
+      fs[i] = activation(activeNode, fs[i]);
+      output[k] = prev - u[i] * prev + u[i] * fs[i];
+    }
+  }
+}
+
+/**
+ * The gradients of gruFinalOutput(): the update gate and the frame state
+ * of gateGrad receive theirs, and prevOutGrad, unless nullptr, is added
+ * the one through output.
+ */
+template <typename Type>
+inline void gruStateGrad(const Type* gate,
+                         Type* gateGrad,
+                         const Type* prevOut,
+                         Type* prevOutGrad,
+                         const Type* outputGrad,
+                         size_t frameSize,
+                         size_t batchSize,
+                         Activation activeNode) {
+  for (size_t b = 0; b < batchSize; ++b) {
+    const Type* u = gate + b * frameSize * 3;
+    const Type* fs = u + frameSize * 2;
+    Type* uGrad = gateGrad + b * frameSize * 3;
+    Type* fsGrad = uGrad + frameSize * 2;
+    for (size_t i = 0; i < frameSize; ++i) {
+      size_t k = b * frameSize + i;
+      Type prev = prevOut ? prevOut[k] : 0;
+      Type outGrad = outputGrad[k];
+      uGrad[i] = outGrad * fs[i] - outGrad * prev;
+      if (prevOutGrad) {
+        prevOutGrad[k] = prevOutGrad[k] - outGrad * u[i] + outGrad;
+      }
+      fsGrad[i] = activationGrad(activeNode, outGrad * u[i], fs[i]);
+    }
+  }
+}
+
+/**
+ * The gradients of gruResetOutput(), after resetOutputGrad received the
+ * gradient through the frame state: the update gate and the reset gate of
+ * gateGrad receive the gradients of their inputs, and prevOutGrad, unless
+ * nullptr, is added the one through resetOutput.
+ */
+template <typename Type>
+inline void gruResetGrad(const Type* gate,
+                         Type* gateGrad,
+                         const Type* prevOut,
+                         Type* prevOutGrad,
+                         const Type* resetOutputGrad,
+                         size_t frameSize,
+                         size_t batchSize) {
+  for (size_t b = 0; b < batchSize; ++b) {
+    const Type* u = gate + b * frameSize * 3;
+    const Type* r = u + frameSize;
+    Type* uGrad = gateGrad + b * frameSize * 3;
+    Type* rGrad = uGrad + frameSize;
+    for (size_t i = 0; i < frameSize; ++i) {
+      size_t k = b * frameSize + i;
+      Type resetGrad = 0;
+      rGrad[i] = 0;
+      if (prevOut && prevOutGrad) {
+        resetGrad = resetOutputGrad[k];
+        rGrad[i] = resetGrad * prevOut[k];
+        prevOutGrad[k] += resetGrad * r[i];
+      }
+      uGrad[i] = activationGrad(kActSigmoid, uGrad[i], u[i]);
+      rGrad[i] = activationGrad(kActSigmoid, rGrad[i], r[i]);
+    }
+  }
+}
 }  // namespace naive
 
 template <typename Type>
@@ -87,6 +618,18 @@ inline void batchAddTo(Type* a, const Type* b[], int batch, size_t len) {
   naive::batchAddTo(a, b, batch, len);
 }
 
+template <typename Type>
+inline void batchAxpy(
+    Type* a, const Type* b[], const Type* scale, int batch, size_t len) {
+  naive::batchAxpy(a, b, scale, batch, len);
+}
+
+template <typename Type>
+inline void batchDot(
+    Type* r, const Type* a, const Type* b[], int batch, size_t len) {
+  naive::batchDot(r, a, b, batch, len);
+}
+
 template <typename Type>
 inline void colMax(Type* result, const Type* data, int dim, int numSamples) {
   naive::colMax(result, data, dim, numSamples);
@@ -102,6 +645,145 @@ inline void decayL1(Type* dst, Type* src, Type lambda, size_t len) {
   naive::decayL1(dst, src, lambda, len);
 }
 
+/**
+ * @brief Elementwise transcendental functions, r may be equal to a.
+ *
+ * The float versions are polynomial approximations evaluated with SSE3,
+ * AVX2+FMA or AVX-512 instructions. Against the double precision results
+ * their errors stay within the bounds below, which test_SIMDFunctions checks
+ * for every kernel table.
+ *
+ * - vExp:     2 ulp. Inputs above 88.72 give exp(88.72) instead of inf.
+ * - vLog:     2 ulp. Denormal inputs are treated as FLT_MIN.
+ * - vLog1p:   3 ulp.
+ * - vTanh:    2^-22 absolute, it uses the same formula as the naive version.
+ * - vSigmoid: 3 ulp.
+ */
+template <typename Type>
+inline void vExp(Type* r, const Type* a, size_t len) {
+  naive::vExp(r, a, len);
+}
+
+template <typename Type>
+inline void vLog(Type* r, const Type* a, size_t len) {
+  naive::vLog(r, a, len);
+}
+
+template <typename Type>
+inline void vLog1p(Type* r, const Type* a, size_t len) {
+  naive::vLog1p(r, a, len);
+}
+
+template <typename Type>
+inline void vTanh(Type* r, const Type* a, size_t len) {
+  naive::vTanh(r, a, len);
+}
+
+template <typename Type>
+inline void vSigmoid(Type* r, const Type* a, size_t len) {
+  naive::vSigmoid(r, a, len);
+}
+
+template <typename Type>
+inline void transpose(Type* dst,
+                      int ldDst,
+                      const Type* src,
+                      int ldSrc,
+                      size_t height,
+                      size_t width) {
+  naive::transpose(dst, ldDst, src, ldSrc, height, width);
+}
+
+template <typename Type>
+inline void gemmPackedB(Type* C,
+                        int ldc,
+                        const Type* A,
+                        int lda,
+                        const Type* packedB,
+                        size_t M,
+                        size_t N,
+                        size_t K,
+                        Type alpha,
+                        Type beta) {
+  naive::gemmPackedB(C, ldc, A, lda, packedB, M, N, K, alpha, beta);
+}
+
+template <typename Type>
+inline void lstmForward(const LstmValue<Type>& value,
+                        size_t frameSize,
+                        size_t batchSize,
+                        Activation activeNode,
+                        Activation activeState) {
+  naive::lstmForward(value, frameSize, batchSize, activeNode, activeState);
+}
+
+template <typename Type>
+inline void lstmBackward(const LstmValue<Type>& value,
+                         const LstmGrad<Type>& grad,
+                         size_t frameSize,
+                         size_t batchSize,
+                         Activation activeNode,
+                         Activation activeState) {
+  naive::lstmBackward(
+      value, grad, frameSize, batchSize, activeNode, activeState);
+}
+
+template <typename Type>
+inline void gruResetOutput(Type* gate,
+                           const Type* prevOut,
+                           Type* resetOutput,
+                           size_t frameSize,
+                           size_t batchSize) {
+  naive::gruResetOutput(gate, prevOut, resetOutput, frameSize, batchSize);
+}
+
+template <typename Type>
+inline void gruFinalOutput(Type* gate,
+                           const Type* prevOut,
+                           Type* output,
+                           size_t frameSize,
+                           size_t batchSize,
+                           Activation activeNode) {
+  naive::gruFinalOutput(
+      gate, prevOut, output, frameSize, batchSize, activeNode);
+}
+
+template <typename Type>
+inline void gruStateGrad(const Type* gate,
+                         Type* gateGrad,
+                         const Type* prevOut,
+                         Type* prevOutGrad,
+                         const Type* outputGrad,
+                         size_t frameSize,
+                         size_t batchSize,
+                         Activation activeNode) {
+  naive::gruStateGrad(gate,
+                      gateGrad,
+                      prevOut,
+                      prevOutGrad,
+                      outputGrad,
+                      frameSize,
+                      batchSize,
+                      activeNode);
+}
+
+template <typename Type>
+inline void gruResetGrad(const Type* gate,
+                         Type* gateGrad,
+                         const Type* prevOut,
+                         Type* prevOutGrad,
+                         const Type* resetOutputGrad,
+                         size_t frameSize,
+                         size_t batchSize) {
+  naive::gruResetGrad(gate,
+                      gateGrad,
+                      prevOut,
+                      prevOutGrad,
+                      resetOutputGrad,
+                      frameSize,
+                      batchSize);
+}
+
 template <size_t AlignSize>
 inline bool isPointerAlign(void* ptr) {
   return reinterpret_cast<uintptr_t>(ptr) % AlignSize == 0;
@@ -116,14 +798,191 @@ inline bool vec_check(size_t len) {
 }
 
 namespace internal {
+
+/**
+ * @brief Function table of one instruction set variant of the float kernels.
+ *
+ * Every variant is compiled into the library from its own files, each built
+ * with the flags of its instruction set, so a single binary carries SSE3,
+ * AVX, AVX2+FMA and AVX-512 code. The best variant the running CPU supports
+ * (see SIMDFlags) is picked once, on first use.
+ */
+struct KernelTable {
+  const char* name;
+  void (*addTo)(float* a, const float* b, size_t len);
+  void (*batchAddTo)(float* a, const float* b[], int batch, size_t len);
+  void (*batchAxpy)(
+      float* a, const float* b[], const float* scale, int batch, size_t len);
+  void (*batchDot)(
+      float* r, const float* a, const float* b[], int batch, size_t len);
+  void (*colMax)(float* result, const float* data, int dim, int numSamples);
+  void (*decayL1)(float* dst, float* src, float lambda, size_t len);
+  void (*decayL1WithLR)(
+      float* dst, float* src, float* lr, float lambda, size_t len);
+  void (*vExp)(float* r, const float* a, size_t len);
+  void (*vLog)(float* r, const float* a, size_t len);
+  void (*vLog1p)(float* r, const float* a, size_t len);
+  void (*vTanh)(float* r, const float* a, size_t len);
+  void (*vSigmoid)(float* r, const float* a, size_t len);
+  void (*transpose)(float* dst,
+                    int ldDst,
+                    const float* src,
+                    int ldSrc,
+                    size_t height,
+                    size_t width);
+  void (*gemmPackedB)(float* C,
+                      int ldc,
+                      const float* A,
+                      int lda,
+                      const float* packedB,
+                      size_t M,
+                      size_t N,
+                      size_t K,
+                      float alpha,
+                      float beta);
+  void (*gemmInt8)(float* C,
+                   int ldc,
+                   const int8_t* A,
+                   int lda,
+                   const float* scaleA,
+                   const int8_t* packedB,
+                   const int32_t* sumB,
+                   const float* scaleB,
+                   const float* bias,
+                   size_t M,
+                   size_t N,
+                   size_t K,
+                   float beta);
+  void (*lstmForward)(const LstmValue<float>& value,
+                      size_t frameSize,
+                      size_t batchSize,
+                      Activation activeNode,
+                      Activation activeState);
+  void (*lstmBackward)(const LstmValue<float>& value,
+                       const LstmGrad<float>& grad,
+                       size_t frameSize,
+                       size_t batchSize,
+                       Activation activeNode,
+                       Activation activeState);
+  void (*gruResetOutput)(float* gate,
+                         const float* prevOut,
+                         float* resetOutput,
+                         size_t frameSize,
+                         size_t batchSize);
+  void (*gruFinalOutput)(float* gate,
+                         const float* prevOut,
+                         float* output,
+                         size_t frameSize,
+                         size_t batchSize,
+                         Activation activeNode);
+  void (*gruStateGrad)(const float* gate,
+                       float* gateGrad,
+                       const float* prevOut,
+                       float* prevOutGrad,
+                       const float* outputGrad,
+                       size_t frameSize,
+                       size_t batchSize,
+                       Activation activeNode);
+  void (*gruResetGrad)(const float* gate,
+                       float* gateGrad,
+                       const float* prevOut,
+                       float* prevOutGrad,
+                       const float* resetOutputGrad,
+                       size_t frameSize,
+                       size_t batchSize);
+};
+
+/**
+ * @brief All kernel tables the running CPU can execute, from the most
+ *        basic to the most capable one.
+ */
+std::vector<const KernelTable*> supportedKernelTables();
+
+/**
+ * @brief The kernel table used by the float specializations below.
+ */
+const KernelTable& activeKernelTable();
+
 void addToImpl(float* a, const float* b, size_t len);
 void batchAddToImpl(float* a, const float* b[], int batch, size_t len);
+void batchAxpyImpl(
+    float* a, const float* b[], const float* scale, int batch, size_t len);
+void batchDotImpl(
+    float* r, const float* a, const float* b[], int batch, size_t len);
 void colMaxImpl(float* result, const float* data, int dim, int numSamples);
-#ifdef __AVX__
-void decayL1AvxImpl(float* dst, float* src, float lambda, size_t len);
-void decayL1AvxImpl(
-    float* dst, float* src, float* lr, float lambda, size_t len);
-#endif
+void decayL1Impl(float* dst, float* src, float lambda, size_t len);
+void decayL1Impl(float* dst, float* src, float* lr, float lambda, size_t len);
+void vExpImpl(float* r, const float* a, size_t len);
+void vLogImpl(float* r, const float* a, size_t len);
+void vLog1pImpl(float* r, const float* a, size_t len);
+void vTanhImpl(float* r, const float* a, size_t len);
+void vSigmoidImpl(float* r, const float* a, size_t len);
+void transposeImpl(float* dst,
+                   int ldDst,
+                   const float* src,
+                   int ldSrc,
+                   size_t height,
+                   size_t width);
+void gemmPackedBImpl(float* C,
+                     int ldc,
+                     const float* A,
+                     int lda,
+                     const float* packedB,
+                     size_t M,
+                     size_t N,
+                     size_t K,
+                     float alpha,
+                     float beta);
+void gemmInt8Impl(float* C,
+                  int ldc,
+                  const int8_t* A,
+                  int lda,
+                  const float* scaleA,
+                  const int8_t* packedB,
+                  const int32_t* sumB,
+                  const float* scaleB,
+                  const float* bias,
+                  size_t M,
+                  size_t N,
+                  size_t K,
+                  float beta);
+void lstmForwardImpl(const LstmValue<float>& value,
+                     size_t frameSize,
+                     size_t batchSize,
+                     Activation activeNode,
+                     Activation activeState);
+void lstmBackwardImpl(const LstmValue<float>& value,
+                      const LstmGrad<float>& grad,
+                      size_t frameSize,
+                      size_t batchSize,
+                      Activation activeNode,
+                      Activation activeState);
+void gruResetOutputImpl(float* gate,
+                        const float* prevOut,
+                        float* resetOutput,
+                        size_t frameSize,
+                        size_t batchSize);
+void gruFinalOutputImpl(float* gate,
+                        const float* prevOut,
+                        float* output,
+                        size_t frameSize,
+                        size_t batchSize,
+                        Activation activeNode);
+void gruStateGradImpl(const float* gate,
+                      float* gateGrad,
+                      const float* prevOut,
+                      float* prevOutGrad,
+                      const float* outputGrad,
+                      size_t frameSize,
+                      size_t batchSize,
+                      Activation activeNode);
+void gruResetGradImpl(const float* gate,
+                      float* gateGrad,
+                      const float* prevOut,
+                      float* prevOutGrad,
+                      const float* resetOutputGrad,
+                      size_t frameSize,
+                      size_t batchSize);
 }  // namespace internal
 
 template <>
@@ -144,6 +1003,26 @@ inline void batchAddTo(float* a, const float* b[], int batch, size_t len) {
 #endif
 }
 
+template <>
+inline void batchAxpy(
+    float* a, const float* b[], const float* scale, int batch, size_t len) {
+#ifdef __SSE3__
+  internal::batchAxpyImpl(a, b, scale, batch, len);
+#else
+  naive::batchAxpy(a, b, scale, batch, len);
+#endif
+}
+
+template <>
+inline void batchDot(
+    float* r, const float* a, const float* b[], int batch, size_t len) {
+#ifdef __SSE3__
+  internal::batchDotImpl(r, a, b, batch, len);
+#else
+  naive::batchDot(r, a, b, batch, len);
+#endif
+}
+
 template <>
 inline void colMax(float* result, const float* data, int dim, int numSamples) {
 #ifdef __SSE3__
@@ -155,8 +1034,8 @@ inline void colMax(float* result, const float* data, int dim, int numSamples) {
 
 template <>
 inline void decayL1(float* dst, float* src, float lambda, size_t len) {
-#ifdef __AVX__
-  internal::decayL1AvxImpl(dst, src, lambda, len);
+#ifdef __SSE3__
+  internal::decayL1Impl(dst, src, lambda, len);
 #else
   naive::decayL1(dst, src, lambda, len);
 #endif
@@ -165,13 +1044,229 @@ inline void decayL1(float* dst, float* src, float lambda, size_t len) {
 template <>
 inline void decayL1(
     float* dst, float* src, float* lr, float lambda, size_t len) {
-#ifdef __AVX__
-  internal::decayL1AvxImpl(dst, src, lr, lambda, len);
+#ifdef __SSE3__
+  internal::decayL1Impl(dst, src, lr, lambda, len);
 #else
   naive::decayL1(dst, src, lr, lambda, len);
 #endif
 }
 
+template <>
+inline void vExp(float* r, const float* a, size_t len) {
+#ifdef __SSE3__
+  internal::vExpImpl(r, a, len);
+#else
+  naive::vExp(r, a, len);
+#endif
+}
+
+template <>
+inline void vLog(float* r, const float* a, size_t len) {
+#ifdef __SSE3__
+  internal::vLogImpl(r, a, len);
+#else
+  naive::vLog(r, a, len);
+#endif
+}
+
+template <>
+inline void vLog1p(float* r, const float* a, size_t len) {
+#ifdef __SSE3__
+  internal::vLog1pImpl(r, a, len);
+#else
+  naive::vLog1p(r, a, len);
+#endif
+}
+
+template <>
+inline void vTanh(float* r, const float* a, size_t len) {
+#ifdef __SSE3__
+  internal::vTanhImpl(r, a, len);
+#else
+  naive::vTanh(r, a, len);
+#endif
+}
+
+template <>
+inline void vSigmoid(float* r, const float* a, size_t len) {
+#ifdef __SSE3__
+  internal::vSigmoidImpl(r, a, len);
+#else
+  naive::vSigmoid(r, a, len);
+#endif
+}
+
+template <>
+inline void transpose(float* dst,
+                      int ldDst,
+                      const float* src,
+                      int ldSrc,
+                      size_t height,
+                      size_t width) {
+#ifdef __SSE3__
+  internal::transposeImpl(dst, ldDst, src, ldSrc, height, width);
+#else
+  naive::transpose(dst, ldDst, src, ldSrc, height, width);
+#endif
+}
+
+template <>
+inline void gemmPackedB(float* C,
+                        int ldc,
+                        const float* A,
+                        int lda,
+                        const float* packedB,
+                        size_t M,
+                        size_t N,
+                        size_t K,
+                        float alpha,
+                        float beta) {
+#ifdef __SSE3__
+  internal::gemmPackedBImpl(C, ldc, A, lda, packedB, M, N, K, alpha, beta);
+#else
+  naive::gemmPackedB(C, ldc, A, lda, packedB, M, N, K, alpha, beta);
+#endif
+}
+
+inline void gemmInt8(float* C,
+                     int ldc,
+                     const int8_t* A,
+                     int lda,
+                     const float* scaleA,
+                     const int8_t* packedB,
+                     const int32_t* sumB,
+                     const float* scaleB,
+                     const float* bias,
+                     size_t M,
+                     size_t N,
+                     size_t K,
+                     float beta) {
+#ifdef __SSE3__
+  internal::gemmInt8Impl(
+      C, ldc, A, lda, scaleA, packedB, sumB, scaleB, bias, M, N, K, beta);
+#else
+  naive::gemmInt8(
+      C, ldc, A, lda, scaleA, packedB, sumB, scaleB, bias, M, N, K, beta);
+#endif
+}
+
+template <>
+inline void lstmForward(const LstmValue<float>& value,
+                        size_t frameSize,
+                        size_t batchSize,
+                        Activation activeNode,
+                        Activation activeState) {
+#ifdef __SSE3__
+  internal::lstmForwardImpl(
+      value, frameSize, batchSize, activeNode, activeState);
+#else
+  naive::lstmForward(value, frameSize, batchSize, activeNode, activeState);
+#endif
+}
+
+template <>
+inline void lstmBackward(const LstmValue<float>& value,
+                         const LstmGrad<float>& grad,
+                         size_t frameSize,
+                         size_t batchSize,
+                         Activation activeNode,
+                         Activation activeState) {
+#ifdef __SSE3__
+  internal::lstmBackwardImpl(
+      value, grad, frameSize, batchSize, activeNode, activeState);
+#else
+  naive::lstmBackward(
+      value, grad, frameSize, batchSize, activeNode, activeState);
+#endif
+}
+
+template <>
+inline void gruResetOutput(float* gate,
+                           const float* prevOut,
+                           float* resetOutput,
+                           size_t frameSize,
+                           size_t batchSize) {
+#ifdef __SSE3__
+  internal::gruResetOutputImpl(
+      gate, prevOut, resetOutput, frameSize, batchSize);
+#else
+  naive::gruResetOutput(gate, prevOut, resetOutput, frameSize, batchSize);
+#endif
+}
+
+template <>
+inline void gruFinalOutput(float* gate,
+                           const float* prevOut,
+                           float* output,
+                           size_t frameSize,
+                           size_t batchSize,
+                           Activation activeNode) {
+#ifdef __SSE3__
+  internal::gruFinalOutputImpl(
+      gate, prevOut, output, frameSize, batchSize, activeNode);
+#else
+  naive::gruFinalOutput(
+      gate, prevOut, output, frameSize, batchSize, activeNode);
+#endif
+}
+
+template <>
+inline void gruStateGrad(const float* gate,
+                         float* gateGrad,
+                         const float* prevOut,
+                         float* prevOutGrad,
+                         const float* outputGrad,
+                         size_t frameSize,
+                         size_t batchSize,
+                         Activation activeNode) {
+#ifdef __SSE3__
+  internal::gruStateGradImpl(gate,
+                             gateGrad,
+                             prevOut,
+                             prevOutGrad,
+                             outputGrad,
+                             frameSize,
+                             batchSize,
+                             activeNode);
+#else
+  naive::gruStateGrad(gate,
+                      gateGrad,
+                      prevOut,
+                      prevOutGrad,
+                      outputGrad,
+                      frameSize,
+                      batchSize,
+                      activeNode);
+#endif
+}
+
+template <>
+inline void gruResetGrad(const float* gate,
+                         float* gateGrad,
+                         const float* prevOut,
+                         float* prevOutGrad,
+                         const float* resetOutputGrad,
+                         size_t frameSize,
+                         size_t batchSize) {
+#ifdef __SSE3__
+  internal::gruResetGradImpl(gate,
+                             gateGrad,
+                             prevOut,
+                             prevOutGrad,
+                             resetOutputGrad,
+                             frameSize,
+                             batchSize);
+#else
+  naive::gruResetGrad(gate,
+                      gateGrad,
+                      prevOut,
+                      prevOutGrad,
+                      resetOutputGrad,
+                      frameSize,
+                      batchSize);
+#endif
+}
+
 }  // namespace simd
 
 }  // namespace paddle
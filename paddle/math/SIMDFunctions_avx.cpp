@@ -0,0 +1,383 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SIMDKernels.h"
+
+#ifdef PADDLE_SIMD_DISPATCH
+#if !defined(__AVX__)
+#error "SIMDFunctions_avx.cpp must be compiled with -mavx"
+#endif
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+void addto_avx(float* a, const float* b, size_t len) {
+  int offset = len % 32;
+
+  __m256 ma0, ma1, ma2, ma3;
+  __m256 mb0, mb1, mb2, mb3;
+
+  for (unsigned int k = 0; k < len / 32; k++, a += 32, b += 32) {
+    ma0 = _mm256_loadu_ps(a);
+    ma1 = _mm256_loadu_ps(a + 8);
+    ma2 = _mm256_loadu_ps(a + 16);
+    ma3 = _mm256_loadu_ps(a + 24);
+
+    mb0 = _mm256_loadu_ps(b);
+    mb1 = _mm256_loadu_ps(b + 8);
+    mb2 = _mm256_loadu_ps(b + 16);
+    mb3 = _mm256_loadu_ps(b + 24);
+
+    ma0 = _mm256_add_ps(ma0, mb0);
+    ma1 = _mm256_add_ps(ma1, mb1);
+    ma2 = _mm256_add_ps(ma2, mb2);
+    ma3 = _mm256_add_ps(ma3, mb3);
+
+    _mm256_storeu_ps(a, ma0);
+    _mm256_storeu_ps(a + 8, ma1);
+    _mm256_storeu_ps(a + 16, ma2);
+    _mm256_storeu_ps(a + 24, ma3);
+  }
+
+  for (int i = 0; i < offset; i++) a[i] += b[i];
+
+  return;
+}
+
+void batch_addto_avx(float* a, const float* b[], int batch, size_t len) {
+  int offset = len % 32;
+
+  __m256 ma0, ma1, ma2, ma3;
+  __m256 mb0, mb1, mb2, mb3;
+
+  for (unsigned int k = 0; k < len / 32; k++, a += 32) {
+    ma0 = _mm256_loadu_ps(a);
+    ma1 = _mm256_loadu_ps(a + 8);
+    ma2 = _mm256_loadu_ps(a + 16);
+    ma3 = _mm256_loadu_ps(a + 24);
+
+    for (int i = 0; i < batch; i++) {
+      mb0 = _mm256_loadu_ps(b[i]);
+      mb1 = _mm256_loadu_ps(b[i] + 8);
+      mb2 = _mm256_loadu_ps(b[i] + 16);
+      mb3 = _mm256_loadu_ps(b[i] + 24);
+      ma0 = _mm256_add_ps(ma0, mb0);
+      ma1 = _mm256_add_ps(ma1, mb1);
+      ma2 = _mm256_add_ps(ma2, mb2);
+      ma3 = _mm256_add_ps(ma3, mb3);
+      b[i] += 32;
+    }
+
+    _mm256_storeu_ps(a, ma0);
+    _mm256_storeu_ps(a + 8, ma1);
+    _mm256_storeu_ps(a + 16, ma2);
+    _mm256_storeu_ps(a + 24, ma3);
+  }
+
+  for (int i = 0; i < offset; i++) {
+    for (int k = 0; k < batch; k++) a[i] += b[k][i];
+  }
+  return;
+}
+
+void batch_axpy_avx(
+    float* a, const float* b[], const float* scale, int batch, size_t len) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256 ma0 = _mm256_loadu_ps(a + i);
+    __m256 ma1 = _mm256_loadu_ps(a + i + 8);
+    __m256 ma2 = _mm256_loadu_ps(a + i + 16);
+    __m256 ma3 = _mm256_loadu_ps(a + i + 24);
+    for (int k = 0; k < batch; k++) {
+      __m256 ms = _mm256_set1_ps(scale ? scale[k] : 1.0f);
+      const float* bk = b[k] + i;
+      ma0 = _mm256_add_ps(ma0, _mm256_mul_ps(ms, _mm256_loadu_ps(bk)));
+      ma1 = _mm256_add_ps(ma1, _mm256_mul_ps(ms, _mm256_loadu_ps(bk + 8)));
+      ma2 = _mm256_add_ps(ma2, _mm256_mul_ps(ms, _mm256_loadu_ps(bk + 16)));
+      ma3 = _mm256_add_ps(ma3, _mm256_mul_ps(ms, _mm256_loadu_ps(bk + 24)));
+    }
+    _mm256_storeu_ps(a + i, ma0);
+    _mm256_storeu_ps(a + i + 8, ma1);
+    _mm256_storeu_ps(a + i + 16, ma2);
+    _mm256_storeu_ps(a + i + 24, ma3);
+  }
+  for (; i + 8 <= len; i += 8) {
+    __m256 ma = _mm256_loadu_ps(a + i);
+    for (int k = 0; k < batch; k++) {
+      __m256 ms = _mm256_set1_ps(scale ? scale[k] : 1.0f);
+      ma = _mm256_add_ps(ma, _mm256_mul_ps(ms, _mm256_loadu_ps(b[k] + i)));
+    }
+    _mm256_storeu_ps(a + i, ma);
+  }
+  for (; i < len; i++) {
+    float sum = a[i];
+    for (int k = 0; k < batch; k++) {
+      sum += (scale ? scale[k] : 1.0f) * b[k][i];
+    }
+    a[i] = sum;
+  }
+}
+
+template <int ROWS>
+static inline void dot_rows_avx(float* r,
+                                const float* a,
+                                const float* const* b,
+                                size_t len) {
+  __m256 sum[ROWS];
+  for (int k = 0; k < ROWS; k++) sum[k] = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 ma = _mm256_loadu_ps(a + i);
+    for (int k = 0; k < ROWS; k++) {
+      sum[k] =
+          _mm256_add_ps(sum[k], _mm256_mul_ps(ma, _mm256_loadu_ps(b[k] + i)));
+    }
+  }
+  for (int k = 0; k < ROWS; k++) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum[k]),
+                          _mm256_extractf128_ps(sum[k], 1));
+    s = _mm_hadd_ps(s, s);
+    float dot = _mm_cvtss_f32(_mm_hadd_ps(s, s));
+    for (size_t j = i; j < len; j++) dot += a[j] * b[k][j];
+    r[k] = dot;
+  }
+}
+
+void batch_dot_avx(
+    float* r, const float* a, const float* b[], int batch, size_t len) {
+  int k = 0;
+  for (; k + 4 <= batch; k += 4) dot_rows_avx<4>(r + k, a, b + k, len);
+  for (; k < batch; k++) dot_rows_avx<1>(r + k, a, b + k, len);
+}
+
+void col_max_avx(float* result,
+                        const float* data,
+                        int dim,
+                        int numSamples) {
+  // first sample, direct copy
+  for (int d = 0; d < dim; ++d) {
+    result[d] = data[d];
+  }
+  int offset = dim % 32;
+  __m256 ma0, ma1, ma2, ma3;
+  __m256 mb0, mb1, mb2, mb3;
+  // first 16n dims
+  for (int k = 0; k < dim / 32; k++, result += 32, data += 32) {
+    ma0 = _mm256_loadu_ps(result);
+    ma1 = _mm256_loadu_ps(result + 8);
+    ma2 = _mm256_loadu_ps(result + 16);
+    ma3 = _mm256_loadu_ps(result + 24);
+    for (int i = 1; i < numSamples; i++) {
+      mb0 = _mm256_loadu_ps(data + i * dim);
+      mb1 = _mm256_loadu_ps(data + i * dim + 8);
+      mb2 = _mm256_loadu_ps(data + i * dim + 16);
+      mb3 = _mm256_loadu_ps(data + i * dim + 24);
+      ma0 = _mm256_max_ps(ma0, mb0);
+      ma1 = _mm256_max_ps(ma1, mb1);
+      ma2 = _mm256_max_ps(ma2, mb2);
+      ma3 = _mm256_max_ps(ma3, mb3);
+    }
+    _mm256_storeu_ps(result, ma0);
+    _mm256_storeu_ps(result + 8, ma1);
+    _mm256_storeu_ps(result + 16, ma2);
+    _mm256_storeu_ps(result + 24, ma3);
+  }
+  // last dims
+  for (int d = 0; d < offset; ++d) {
+    float sm = data[d];
+    for (int i = 1; i < numSamples; ++i) {
+      sm = max_float(sm, data[i * dim + d]);
+    }
+    result[d] = sm;
+  }
+}
+
+void decayL1_avx(float* dst, float* src, float lambda, size_t sz) {
+  int64_t i;
+  int64_t size = sz;
+  float src_val;
+
+  __m256 ymm1, ymm2, ymm3, ymm4, ymm5, ymm6, ymm7, ymm8;
+  //  __m256 ymm9, ymm10;
+
+  ymm1 = _mm256_set1_ps(lambda);
+  ymm2 = _mm256_setzero_ps();
+
+  for (i = 0; i <= size - 16; i += 16) {
+    ymm3 = _mm256_loadu_ps(src + i);
+    ymm6 = _mm256_loadu_ps(src + i + 8);
+
+    ymm4 = _mm256_sub_ps(ymm3, ymm1);
+    ymm7 = _mm256_sub_ps(ymm6, ymm1);
+
+    ymm5 = _mm256_add_ps(ymm3, ymm1);
+    ymm8 = _mm256_add_ps(ymm6, ymm1);
+
+    ymm4 = _mm256_max_ps(ymm4, ymm2);
+    ymm7 = _mm256_max_ps(ymm7, ymm2);
+
+    ymm5 = _mm256_min_ps(ymm5, ymm2);
+    ymm8 = _mm256_min_ps(ymm8, ymm2);
+
+    ymm5 = _mm256_or_ps(ymm4, ymm5);
+    ymm8 = _mm256_or_ps(ymm7, ymm8);
+
+    _mm256_storeu_ps(dst + i, ymm5);
+    _mm256_storeu_ps(dst + i + 8, ymm8);
+  }
+  if (i <= size - 8) {
+    ymm3 = _mm256_loadu_ps(src + i);
+    ymm4 = _mm256_sub_ps(ymm3, ymm1);
+    ymm5 = _mm256_add_ps(ymm3, ymm1);
+    ymm4 = _mm256_max_ps(ymm4, ymm2);
+    ymm5 = _mm256_min_ps(ymm5, ymm2);
+    ymm5 = _mm256_or_ps(ymm4, ymm5);
+    _mm256_storeu_ps(dst + i, ymm5);
+
+    i += 8;
+  }
+  for (; i < size; i++) {
+    src_val = src[i];
+    if (src_val > 0) {
+      dst[i] = ((src_val > lambda) ? (src_val - lambda) : 0);
+    } else {
+      dst[i] = ((-src_val > lambda) ? (src_val + lambda) : 0);
+    }
+  }
+}
+
+void decayL1_avx(
+    float* dst, float* src, float* lr, float lambda, size_t sz) {
+  int64_t i;
+  int64_t size = sz;
+  float src_val;
+
+  __m256 ymm1, ymm2, ymm3, ymm4, ymm5, ymm6, ymm7, ymm8;
+  __m256 ymm9, ymm10;
+
+  ymm1 = _mm256_set1_ps(lambda);
+  ymm2 = _mm256_setzero_ps();
+
+  for (i = 0; i <= size - 16; i += 16) {
+    ymm9 = _mm256_loadu_ps(lr + i);
+    ymm10 = _mm256_loadu_ps(lr + i + 8);
+
+    ymm3 = _mm256_loadu_ps(src + i);
+    ymm6 = _mm256_loadu_ps(src + i + 8);
+
+    ymm9 = _mm256_mul_ps(ymm9, ymm1);
+    ymm10 = _mm256_mul_ps(ymm10, ymm1);
+
+    ymm4 = _mm256_sub_ps(ymm3, ymm9);
+    ymm7 = _mm256_sub_ps(ymm6, ymm10);
+
+    ymm5 = _mm256_add_ps(ymm3, ymm9);
+    ymm8 = _mm256_add_ps(ymm6, ymm10);
+
+    ymm4 = _mm256_max_ps(ymm4, ymm2);
+    ymm7 = _mm256_max_ps(ymm7, ymm2);
+
+    ymm5 = _mm256_min_ps(ymm5, ymm2);
+    ymm8 = _mm256_min_ps(ymm8, ymm2);
+
+    ymm5 = _mm256_or_ps(ymm4, ymm5);
+    ymm8 = _mm256_or_ps(ymm7, ymm8);
+
+    _mm256_storeu_ps(dst + i, ymm5);
+    _mm256_storeu_ps(dst + i + 8, ymm8);
+  }
+  if (i <= size - 8) {
+    ymm3 = _mm256_loadu_ps(src + i);
+    ymm9 = _mm256_loadu_ps(lr + i);
+    ymm9 = _mm256_mul_ps(ymm9, ymm1);
+    ymm4 = _mm256_sub_ps(ymm3, ymm9);
+    ymm5 = _mm256_add_ps(ymm3, ymm9);
+    ymm4 = _mm256_max_ps(ymm4, ymm2);
+    ymm5 = _mm256_min_ps(ymm5, ymm2);
+    ymm5 = _mm256_or_ps(ymm4, ymm5);
+    _mm256_storeu_ps(dst + i, ymm5);
+
+    i += 8;
+  }
+  for (; i < size; i++) {
+    src_val = src[i];
+    float nlambda = lr[i] * lambda;
+    if (src_val > 0) {
+      dst[i] = ((src_val > nlambda) ? (src_val - nlambda) : 0);
+    } else {
+      dst[i] = ((-src_val > nlambda) ? (src_val + nlambda) : 0);
+    }
+  }
+}
+
+
+/**
+ * Also used by the AVX-512 table, the transpose is bound by memory traffic
+ * rather than by the width of the registers.
+ */
+void transpose_avx(float* dst,
+                          int ldDst,
+                          const float* src,
+                          int ldSrc,
+                          size_t height,
+                          size_t width) {
+  for (size_t i0 = 0; i0 < height; i0 += kTransposeTile) {
+    size_t i1 = min_size(i0 + kTransposeTile, height);
+    for (size_t j0 = 0; j0 < width; j0 += kTransposeTile) {
+      size_t j1 = min_size(j0 + kTransposeTile, width);
+      size_t i = i0;
+      for (; i + 8 <= i1; i += 8) {
+        const float* s = src + (ptrdiff_t)i * ldSrc;
+        size_t j = j0;
+        for (; j + 8 <= j1; j += 8) {
+          __m256 r[8], t[8];
+          for (int k = 0; k < 8; ++k) {
+            r[k] = _mm256_loadu_ps(s + k * ldSrc + j);
+          }
+          // interleave pairs of rows, then pairs of pairs; the last step
+          // swaps the 128-bit halves across rows k and k + 4.
+          for (int k = 0; k < 8; k += 2) {
+            t[k] = _mm256_unpacklo_ps(r[k], r[k + 1]);
+            t[k + 1] = _mm256_unpackhi_ps(r[k], r[k + 1]);
+          }
+          for (int k = 0; k < 8; k += 4) {
+            r[k] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(1, 0, 1, 0));
+            r[k + 1] =
+                _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(3, 2, 3, 2));
+            r[k + 2] =
+                _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(1, 0, 1, 0));
+            r[k + 3] =
+                _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(3, 2, 3, 2));
+          }
+          float* d = dst + (ptrdiff_t)j * ldDst + i;
+          for (int k = 0; k < 4; ++k) {
+            _mm256_storeu_ps(d + k * ldDst,
+                             _mm256_permute2f128_ps(r[k], r[k + 4], 0x20));
+            _mm256_storeu_ps(d + (k + 4) * ldDst,
+                             _mm256_permute2f128_ps(r[k], r[k + 4], 0x31));
+          }
+        }
+        transpose_edge(dst, ldDst, src, ldSrc, i, i + 8, j, j1);
+      }
+      transpose_edge(dst, ldDst, src, ldSrc, i, i1, j0, j1);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
+
+#endif  // PADDLE_SIMD_DISPATCH
@@ -0,0 +1,182 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SIMDKernels.h"
+#include "SIMDMath_avx2.h"
+
+#ifdef PADDLE_SIMD_DISPATCH
+#if !defined(__AVX2__) || !defined(__FMA__)
+#error "SIMDFunctions_avx2.cpp must be compiled with -mavx2 -mfma"
+#endif
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+void decayL1_avx2_fma(
+    float* dst, float* src, float* lr, float lambda, size_t sz) {
+  int64_t i;
+  int64_t size = sz;
+  float src_val;
+
+  __m256 ymm1 = _mm256_set1_ps(lambda);
+  __m256 ymm2 = _mm256_setzero_ps();
+  __m256 ymm3, ymm4, ymm5, ymm6, ymm7, ymm8;
+  __m256 ymm9, ymm10;
+
+  for (i = 0; i <= size - 16; i += 16) {
+    ymm9 = _mm256_loadu_ps(lr + i);
+    ymm10 = _mm256_loadu_ps(lr + i + 8);
+
+    ymm3 = _mm256_loadu_ps(src + i);
+    ymm6 = _mm256_loadu_ps(src + i + 8);
+
+    // src - lr * lambda and src + lr * lambda, one rounding each.
+    ymm4 = _mm256_fnmadd_ps(ymm9, ymm1, ymm3);
+    ymm7 = _mm256_fnmadd_ps(ymm10, ymm1, ymm6);
+
+    ymm5 = _mm256_fmadd_ps(ymm9, ymm1, ymm3);
+    ymm8 = _mm256_fmadd_ps(ymm10, ymm1, ymm6);
+
+    ymm4 = _mm256_max_ps(ymm4, ymm2);
+    ymm7 = _mm256_max_ps(ymm7, ymm2);
+
+    ymm5 = _mm256_min_ps(ymm5, ymm2);
+    ymm8 = _mm256_min_ps(ymm8, ymm2);
+
+    ymm5 = _mm256_or_ps(ymm4, ymm5);
+    ymm8 = _mm256_or_ps(ymm7, ymm8);
+
+    _mm256_storeu_ps(dst + i, ymm5);
+    _mm256_storeu_ps(dst + i + 8, ymm8);
+  }
+  for (; i < size; i++) {
+    src_val = src[i];
+    float nlambda = lr[i] * lambda;
+    if (src_val > 0) {
+      dst[i] = ((src_val > nlambda) ? (src_val - nlambda) : 0);
+    } else {
+      dst[i] = ((-src_val > nlambda) ? (src_val + nlambda) : 0);
+    }
+  }
+}
+
+void batch_axpy_avx2_fma(
+    float* a, const float* b[], const float* scale, int batch, size_t len) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256 ma0 = _mm256_loadu_ps(a + i);
+    __m256 ma1 = _mm256_loadu_ps(a + i + 8);
+    __m256 ma2 = _mm256_loadu_ps(a + i + 16);
+    __m256 ma3 = _mm256_loadu_ps(a + i + 24);
+    for (int k = 0; k < batch; k++) {
+      __m256 ms = _mm256_set1_ps(scale ? scale[k] : 1.0f);
+      const float* bk = b[k] + i;
+      ma0 = _mm256_fmadd_ps(ms, _mm256_loadu_ps(bk), ma0);
+      ma1 = _mm256_fmadd_ps(ms, _mm256_loadu_ps(bk + 8), ma1);
+      ma2 = _mm256_fmadd_ps(ms, _mm256_loadu_ps(bk + 16), ma2);
+      ma3 = _mm256_fmadd_ps(ms, _mm256_loadu_ps(bk + 24), ma3);
+    }
+    _mm256_storeu_ps(a + i, ma0);
+    _mm256_storeu_ps(a + i + 8, ma1);
+    _mm256_storeu_ps(a + i + 16, ma2);
+    _mm256_storeu_ps(a + i + 24, ma3);
+  }
+  for (; i + 8 <= len; i += 8) {
+    __m256 ma = _mm256_loadu_ps(a + i);
+    for (int k = 0; k < batch; k++) {
+      __m256 ms = _mm256_set1_ps(scale ? scale[k] : 1.0f);
+      ma = _mm256_fmadd_ps(ms, _mm256_loadu_ps(b[k] + i), ma);
+    }
+    _mm256_storeu_ps(a + i, ma);
+  }
+  for (; i < len; i++) {
+    float sum = a[i];
+    for (int k = 0; k < batch; k++) {
+      sum += (scale ? scale[k] : 1.0f) * b[k][i];
+    }
+    a[i] = sum;
+  }
+}
+
+template <int ROWS>
+static inline void dot_rows_avx2_fma(float* r,
+                                     const float* a,
+                                     const float* const* b,
+                                     size_t len) {
+  __m256 sum[ROWS];
+  for (int k = 0; k < ROWS; k++) sum[k] = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    __m256 ma = _mm256_loadu_ps(a + i);
+    for (int k = 0; k < ROWS; k++) {
+      sum[k] = _mm256_fmadd_ps(ma, _mm256_loadu_ps(b[k] + i), sum[k]);
+    }
+  }
+  for (int k = 0; k < ROWS; k++) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum[k]),
+                          _mm256_extractf128_ps(sum[k], 1));
+    s = _mm_hadd_ps(s, s);
+    float dot = _mm_cvtss_f32(_mm_hadd_ps(s, s));
+    for (size_t j = i; j < len; j++) dot += a[j] * b[k][j];
+    r[k] = dot;
+  }
+}
+
+void batch_dot_avx2_fma(
+    float* r, const float* a, const float* b[], int batch, size_t len) {
+  int k = 0;
+  for (; k + 4 <= batch; k += 4) dot_rows_avx2_fma<4>(r + k, a, b + k, len);
+  for (; k < batch; k++) dot_rows_avx2_fma<1>(r + k, a, b + k, len);
+}
+
+template <__m256 (*Func)(__m256)>
+static void unary_avx2(float* r, const float* a, size_t len) {
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    _mm256_storeu_ps(r + i, Func(_mm256_loadu_ps(a + i)));
+  }
+  if (i < len) {
+    float buf[8] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+    memcpy(buf, a + i, (len - i) * sizeof(float));
+    _mm256_storeu_ps(buf, Func(_mm256_loadu_ps(buf)));
+    memcpy(r + i, buf, (len - i) * sizeof(float));
+  }
+}
+
+void vexp_avx2(float* r, const float* a, size_t len) {
+  unary_avx2<exp_avx2>(r, a, len);
+}
+
+void vlog_avx2(float* r, const float* a, size_t len) {
+  unary_avx2<log_avx2>(r, a, len);
+}
+
+void vlog1p_avx2(float* r, const float* a, size_t len) {
+  unary_avx2<log1p_avx2>(r, a, len);
+}
+
+void vtanh_avx2(float* r, const float* a, size_t len) {
+  unary_avx2<tanh_avx2>(r, a, len);
+}
+
+void vsigmoid_avx2(float* r, const float* a, size_t len) {
+  unary_avx2<sigmoid_avx2>(r, a, len);
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
+
+#endif  // PADDLE_SIMD_DISPATCH
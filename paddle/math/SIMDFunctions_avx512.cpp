@@ -0,0 +1,227 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SIMDKernels.h"
+
+#ifdef PADDLE_SIMD_DISPATCH
+#if !defined(__AVX512F__)
+#error "SIMDFunctions_avx512.cpp must be compiled with -mavx512f"
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// GCC reports a false -Wmaybe-uninitialized from _mm512_undefined_ps(),
+// which the AVX-512 intrinsics use as the pass-through operand.
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include "SIMDMath_avx512.h"
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+void addto_avx512(float* a, const float* b, size_t len) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m512 ma0 = _mm512_loadu_ps(a + i);
+    __m512 ma1 = _mm512_loadu_ps(a + i + 16);
+    __m512 mb0 = _mm512_loadu_ps(b + i);
+    __m512 mb1 = _mm512_loadu_ps(b + i + 16);
+    _mm512_storeu_ps(a + i, _mm512_add_ps(ma0, mb0));
+    _mm512_storeu_ps(a + i + 16, _mm512_add_ps(ma1, mb1));
+  }
+  for (; i < len; i += 16) {
+    __mmask16 m = len - i >= 16 ? 0xFFFF : tail_mask_avx512(len - i);
+    __m512 ma = _mm512_maskz_loadu_ps(m, a + i);
+    __m512 mb = _mm512_maskz_loadu_ps(m, b + i);
+    _mm512_mask_storeu_ps(a + i, m, _mm512_add_ps(ma, mb));
+  }
+}
+
+void batch_addto_avx512(float* a,
+                               const float* b[],
+                               int batch,
+                               size_t len) {
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m512 ma0 = _mm512_loadu_ps(a + i);
+    __m512 ma1 = _mm512_loadu_ps(a + i + 16);
+    for (int k = 0; k < batch; k++) {
+      ma0 = _mm512_add_ps(ma0, _mm512_loadu_ps(b[k] + i));
+      ma1 = _mm512_add_ps(ma1, _mm512_loadu_ps(b[k] + i + 16));
+    }
+    _mm512_storeu_ps(a + i, ma0);
+    _mm512_storeu_ps(a + i + 16, ma1);
+  }
+  for (; i < len; i += 16) {
+    __mmask16 m = len - i >= 16 ? 0xFFFF : tail_mask_avx512(len - i);
+    __m512 ma = _mm512_maskz_loadu_ps(m, a + i);
+    for (int k = 0; k < batch; k++) {
+      ma = _mm512_add_ps(ma, _mm512_maskz_loadu_ps(m, b[k] + i));
+    }
+    _mm512_mask_storeu_ps(a + i, m, ma);
+  }
+}
+
+void batch_axpy_avx512(
+    float* a, const float* b[], const float* scale, int batch, size_t len) {
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m512 ma0 = _mm512_loadu_ps(a + i);
+    __m512 ma1 = _mm512_loadu_ps(a + i + 16);
+    __m512 ma2 = _mm512_loadu_ps(a + i + 32);
+    __m512 ma3 = _mm512_loadu_ps(a + i + 48);
+    for (int k = 0; k < batch; k++) {
+      __m512 ms = _mm512_set1_ps(scale ? scale[k] : 1.0f);
+      const float* bk = b[k] + i;
+      ma0 = _mm512_fmadd_ps(ms, _mm512_loadu_ps(bk), ma0);
+      ma1 = _mm512_fmadd_ps(ms, _mm512_loadu_ps(bk + 16), ma1);
+      ma2 = _mm512_fmadd_ps(ms, _mm512_loadu_ps(bk + 32), ma2);
+      ma3 = _mm512_fmadd_ps(ms, _mm512_loadu_ps(bk + 48), ma3);
+    }
+    _mm512_storeu_ps(a + i, ma0);
+    _mm512_storeu_ps(a + i + 16, ma1);
+    _mm512_storeu_ps(a + i + 32, ma2);
+    _mm512_storeu_ps(a + i + 48, ma3);
+  }
+  for (; i < len; i += 16) {
+    __mmask16 m = len - i >= 16 ? 0xFFFF : tail_mask_avx512(len - i);
+    __m512 ma = _mm512_maskz_loadu_ps(m, a + i);
+    for (int k = 0; k < batch; k++) {
+      __m512 ms = _mm512_set1_ps(scale ? scale[k] : 1.0f);
+      ma = _mm512_fmadd_ps(ms, _mm512_maskz_loadu_ps(m, b[k] + i), ma);
+    }
+    _mm512_mask_storeu_ps(a + i, m, ma);
+  }
+}
+
+template <int ROWS>
+static inline void dot_rows_avx512(float* r,
+                                   const float* a,
+                                   const float* const* b,
+                                   size_t len) {
+  __m512 sum[ROWS];
+  for (int k = 0; k < ROWS; k++) sum[k] = _mm512_setzero_ps();
+  for (size_t i = 0; i < len; i += 16) {
+    __mmask16 m = len - i >= 16 ? 0xFFFF : tail_mask_avx512(len - i);
+    __m512 ma = _mm512_maskz_loadu_ps(m, a + i);
+    for (int k = 0; k < ROWS; k++) {
+      sum[k] = _mm512_fmadd_ps(ma, _mm512_maskz_loadu_ps(m, b[k] + i), sum[k]);
+    }
+  }
+  for (int k = 0; k < ROWS; k++) {
+    r[k] = _mm512_reduce_add_ps(sum[k]);
+  }
+}
+
+void batch_dot_avx512(
+    float* r, const float* a, const float* b[], int batch, size_t len) {
+  int k = 0;
+  for (; k + 4 <= batch; k += 4) dot_rows_avx512<4>(r + k, a, b + k, len);
+  for (; k < batch; k++) dot_rows_avx512<1>(r + k, a, b + k, len);
+}
+
+void col_max_avx512(float* result,
+                           const float* data,
+                           int dim,
+                           int numSamples) {
+  int d = 0;
+  for (; d + 32 <= dim; d += 32) {
+    __m512 ma0 = _mm512_loadu_ps(data + d);
+    __m512 ma1 = _mm512_loadu_ps(data + d + 16);
+    for (int i = 1; i < numSamples; i++) {
+      ma0 = _mm512_max_ps(ma0, _mm512_loadu_ps(data + i * dim + d));
+      ma1 = _mm512_max_ps(ma1, _mm512_loadu_ps(data + i * dim + d + 16));
+    }
+    _mm512_storeu_ps(result + d, ma0);
+    _mm512_storeu_ps(result + d + 16, ma1);
+  }
+  for (; d < dim; d += 16) {
+    __mmask16 m = dim - d >= 16 ? 0xFFFF : tail_mask_avx512(dim - d);
+    __m512 ma = _mm512_maskz_loadu_ps(m, data + d);
+    for (int i = 1; i < numSamples; i++) {
+      ma = _mm512_mask_max_ps(
+          ma, m, ma, _mm512_maskz_loadu_ps(m, data + i * dim + d));
+    }
+    _mm512_mask_storeu_ps(result + d, m, ma);
+  }
+}
+
+void decayL1_avx512(float* dst, float* src, float lambda, size_t sz) {
+  __m512 zmm1 = _mm512_set1_ps(lambda);
+  __m512 zmm2 = _mm512_setzero_ps();
+  for (size_t i = 0; i < sz; i += 16) {
+    __mmask16 m = sz - i >= 16 ? 0xFFFF : tail_mask_avx512(sz - i);
+    __m512 zmm3 = _mm512_maskz_loadu_ps(m, src + i);
+    __m512 zmm4 = _mm512_max_ps(_mm512_sub_ps(zmm3, zmm1), zmm2);
+    __m512 zmm5 = _mm512_min_ps(_mm512_add_ps(zmm3, zmm1), zmm2);
+    // At most one of zmm4 and zmm5 is non-zero, so the sum is exact.
+    _mm512_mask_storeu_ps(dst + i, m, _mm512_add_ps(zmm4, zmm5));
+  }
+}
+
+void decayL1_avx512(
+    float* dst, float* src, float* lr, float lambda, size_t sz) {
+  __m512 zmm1 = _mm512_set1_ps(lambda);
+  __m512 zmm2 = _mm512_setzero_ps();
+  for (size_t i = 0; i < sz; i += 16) {
+    __mmask16 m = sz - i >= 16 ? 0xFFFF : tail_mask_avx512(sz - i);
+    __m512 zmm3 = _mm512_maskz_loadu_ps(m, src + i);
+    __m512 zmm9 = _mm512_maskz_loadu_ps(m, lr + i);
+    __m512 zmm4 = _mm512_max_ps(_mm512_fnmadd_ps(zmm9, zmm1, zmm3), zmm2);
+    __m512 zmm5 = _mm512_min_ps(_mm512_fmadd_ps(zmm9, zmm1, zmm3), zmm2);
+    _mm512_mask_storeu_ps(dst + i, m, _mm512_add_ps(zmm4, zmm5));
+  }
+}
+
+template <__m512 (*Func)(__m512)>
+static void unary_avx512(float* r, const float* a, size_t len) {
+  for (size_t i = 0; i < len; i += 16) {
+    __mmask16 m = len - i >= 16 ? 0xFFFF : tail_mask_avx512(len - i);
+    // the masked off lanes are ones, which no function raises on.
+    __m512 x = _mm512_mask_loadu_ps(_mm512_set1_ps(1.0f), m, a + i);
+    _mm512_mask_storeu_ps(r + i, m, Func(x));
+  }
+}
+
+void vexp_avx512(float* r, const float* a, size_t len) {
+  unary_avx512<exp_avx512>(r, a, len);
+}
+
+void vlog_avx512(float* r, const float* a, size_t len) {
+  unary_avx512<log_avx512>(r, a, len);
+}
+
+void vlog1p_avx512(float* r, const float* a, size_t len) {
+  unary_avx512<log1p_avx512>(r, a, len);
+}
+
+void vtanh_avx512(float* r, const float* a, size_t len) {
+  unary_avx512<tanh_avx512>(r, a, len);
+}
+
+void vsigmoid_avx512(float* r, const float* a, size_t len) {
+  unary_avx512<sigmoid_avx512>(r, a, len);
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // PADDLE_SIMD_DISPATCH
@@ -0,0 +1,230 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SIMDKernels.h"
+
+#ifdef PADDLE_SIMD_DISPATCH
+#if !defined(__AVX2__) || !defined(__FMA__)
+#error "SIMDGemm_avx2.cpp must be compiled with -mavx2 -mfma"
+#endif
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+template <int ROWS>
+static inline void gemm_packed_tile_avx2(float* C,
+                                         int ldc,
+                                         const float* A,
+                                         int lda,
+                                         const float* panel,
+                                         size_t K,
+                                         size_t cols,
+                                         float alpha,
+                                         float beta) {
+  __m256 acc[ROWS][2];
+  for (int r = 0; r < ROWS; ++r) {
+    acc[r][0] = _mm256_setzero_ps();
+    acc[r][1] = _mm256_setzero_ps();
+  }
+  for (size_t k = 0; k < K; ++k, panel += kGemmPanel) {
+    __m256 b0 = _mm256_loadu_ps(panel);
+    __m256 b1 = _mm256_loadu_ps(panel + 8);
+    for (int r = 0; r < ROWS; ++r) {
+      __m256 a = _mm256_broadcast_ss(A + r * lda + k);
+      acc[r][0] = _mm256_fmadd_ps(a, b0, acc[r][0]);
+      acc[r][1] = _mm256_fmadd_ps(a, b1, acc[r][1]);
+    }
+  }
+  __m256 va = _mm256_set1_ps(alpha);
+  __m256 vb = _mm256_set1_ps(beta);
+  for (int r = 0; r < ROWS; ++r) {
+    float* c = C + r * ldc;
+    if (cols < kGemmPanel) {
+      float buf[kGemmPanel];
+      _mm256_storeu_ps(buf, acc[r][0]);
+      _mm256_storeu_ps(buf + 8, acc[r][1]);
+      gemm_store_edge(c, buf, cols, alpha, beta);
+      continue;
+    }
+    for (int v = 0; v < 2; ++v) {
+      __m256 y = _mm256_mul_ps(va, acc[r][v]);
+      if (beta != 0) {
+        y = _mm256_fmadd_ps(vb, _mm256_loadu_ps(c + 8 * v), y);
+      }
+      _mm256_storeu_ps(c + 8 * v, y);
+    }
+  }
+}
+
+void gemm_packed_avx2_fma(float* C,
+                                 int ldc,
+                                 const float* A,
+                                 int lda,
+                                 const float* packedB,
+                                 size_t M,
+                                 size_t N,
+                                 size_t K,
+                                 float alpha,
+                                 float beta) {
+  for (size_t j = 0; j < N; j += kGemmPanel) {
+    const float* panel = packedB + j * K;
+    size_t cols = min_size(kGemmPanel, N - j);
+    size_t i = 0;
+    for (; i + 4 <= M; i += 4) {
+      gemm_packed_tile_avx2<4>(
+          C + i * ldc + j, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+    }
+    if (M - i >= 2) {
+      gemm_packed_tile_avx2<2>(
+          C + i * ldc + j, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+      i += 2;
+    }
+    if (i < M) {
+      gemm_packed_tile_avx2<1>(
+          C + i * ldc + j, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+    }
+  }
+}
+
+/**
+ * AVX2 has no int8 dot product that does not saturate, so the groups are
+ * widened to int16 and multiplied by pmaddwd, which sums pairs of products
+ * into int32. A tile is ROWS rows by half a panel, 8 columns; each column
+ * has two partial sums, of the even and the odd pairs of its rows, which
+ * are added when the tile is stored.
+ */
+template <int ROWS>
+static inline void gemm_int8_tile_avx2(float* C,
+                                       int ldc,
+                                       const int8_t* A,
+                                       int lda,
+                                       const float* scaleA,
+                                       const int8_t* panel,
+                                       const float* scaleB,
+                                       const float* bias,
+                                       size_t groupedK,
+                                       size_t cols,
+                                       float beta) {
+  __m256i acc[ROWS][2];
+  for (int r = 0; r < ROWS; ++r) {
+    acc[r][0] = _mm256_setzero_si256();
+    acc[r][1] = _mm256_setzero_si256();
+  }
+  for (size_t k = 0; k < groupedK;
+       k += kInt8Group, panel += kInt8Panel * kInt8Group) {
+    __m256i b0 = _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(panel)));
+    __m256i b1 = _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(panel + 16)));
+    for (int r = 0; r < ROWS; ++r) {
+      __m256i a = _mm256_cvtepi8_epi16(
+          _mm_set1_epi32(load_int8_group(A + r * lda + k)));
+      acc[r][0] = _mm256_add_epi32(acc[r][0], _mm256_madd_epi16(a, b0));
+      acc[r][1] = _mm256_add_epi32(acc[r][1], _mm256_madd_epi16(a, b1));
+    }
+  }
+  for (int r = 0; r < ROWS; ++r) {
+    float* c = C + r * ldc;
+    // columns 0 1 4 5 | 2 3 6 7, reordered by 64-bit lanes.
+    __m256i sum = _mm256_permute4x64_epi64(
+        _mm256_hadd_epi32(acc[r][0], acc[r][1]), 0xD8);
+    if (cols < 8) {
+      int32_t buf[8];
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf), sum);
+      int8_store_edge(c, buf, scaleA[r], scaleB, bias, cols, beta);
+      continue;
+    }
+    __m256 y = _mm256_mul_ps(
+        _mm256_mul_ps(_mm256_cvtepi32_ps(sum), _mm256_set1_ps(scaleA[r])),
+        _mm256_loadu_ps(scaleB));
+    if (bias) {
+      y = _mm256_add_ps(y, _mm256_loadu_ps(bias));
+    }
+    if (beta != 0) {
+      y = _mm256_fmadd_ps(_mm256_set1_ps(beta), _mm256_loadu_ps(c), y);
+    }
+    _mm256_storeu_ps(c, y);
+  }
+}
+
+void gemm_int8_avx2_fma(float* C,
+                               int ldc,
+                               const int8_t* A,
+                               int lda,
+                               const float* scaleA,
+                               const int8_t* packedB,
+                               const int32_t* sumB,
+                               const float* scaleB,
+                               const float* bias,
+                               size_t M,
+                               size_t N,
+                               size_t K,
+                               float beta) {
+  size_t groupedK = int8_grouped_k(K);
+  for (size_t j = 0; j < N; j += 8) {
+    // the second half of a panel starts 8 columns into each group.
+    const int8_t* panel = packedB + j / kInt8Panel * kInt8Panel * groupedK +
+                          j % kInt8Panel * kInt8Group;
+    const float* b = bias ? bias + j : nullptr;
+    size_t cols = min_size((size_t)8, N - j);
+    size_t i = 0;
+    for (; i + 4 <= M; i += 4) {
+      gemm_int8_tile_avx2<4>(C + i * ldc + j,
+                             ldc,
+                             A + i * lda,
+                             lda,
+                             scaleA + i,
+                             panel,
+                             scaleB + j,
+                             b,
+                             groupedK,
+                             cols,
+                             beta);
+    }
+    if (M - i >= 2) {
+      gemm_int8_tile_avx2<2>(C + i * ldc + j,
+                             ldc,
+                             A + i * lda,
+                             lda,
+                             scaleA + i,
+                             panel,
+                             scaleB + j,
+                             b,
+                             groupedK,
+                             cols,
+                             beta);
+      i += 2;
+    }
+    if (i < M) {
+      gemm_int8_tile_avx2<1>(C + i * ldc + j,
+                             ldc,
+                             A + i * lda,
+                             lda,
+                             scaleA + i,
+                             panel,
+                             scaleB + j,
+                             b,
+                             groupedK,
+                             cols,
+                             beta);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
+
+#endif  // PADDLE_SIMD_DISPATCH
@@ -0,0 +1,154 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SIMDKernels.h"
+
+#ifdef PADDLE_SIMD_DISPATCH
+#if !defined(__AVX512F__)
+#error "SIMDGemm_avx512.cpp must be compiled with -mavx512f"
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// GCC reports a false -Wmaybe-uninitialized from _mm512_undefined_ps(),
+// which the AVX-512 intrinsics use as the pass-through operand.
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include "SIMDMath_avx512.h"
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+/**
+ * Holds ROWS rows by PANELS panels, so that one broadcast of A feeds PANELS
+ * fmas.
+ */
+template <int ROWS, int PANELS>
+static inline void gemm_packed_tile_avx512(float* C,
+                                           int ldc,
+                                           const float* A,
+                                           int lda,
+                                           const float* panel,
+                                           size_t K,
+                                           size_t cols,
+                                           float alpha,
+                                           float beta) {
+  __m512 acc[ROWS][PANELS];
+  for (int r = 0; r < ROWS; ++r) {
+    for (int p = 0; p < PANELS; ++p) {
+      acc[r][p] = _mm512_setzero_ps();
+    }
+  }
+  const size_t panelSize = K * kGemmPanel;
+  for (size_t k = 0; k < K; ++k, panel += kGemmPanel) {
+    __m512 b[PANELS];
+    for (int p = 0; p < PANELS; ++p) {
+      b[p] = _mm512_loadu_ps(panel + p * panelSize);
+    }
+    for (int r = 0; r < ROWS; ++r) {
+      __m512 a = _mm512_set1_ps(A[r * lda + k]);
+      for (int p = 0; p < PANELS; ++p) {
+        acc[r][p] = _mm512_fmadd_ps(a, b[p], acc[r][p]);
+      }
+    }
+  }
+  __m512 va = _mm512_set1_ps(alpha);
+  __m512 vb = _mm512_set1_ps(beta);
+  for (int p = 0; p < PANELS; ++p) {
+    // only the last panel may be partial.
+    size_t rem = cols - p * kGemmPanel;
+    __mmask16 m = rem >= 16 ? 0xFFFF : tail_mask_avx512(rem);
+    for (int r = 0; r < ROWS; ++r) {
+      float* c = C + r * ldc + p * kGemmPanel;
+      __m512 y = _mm512_mul_ps(va, acc[r][p]);
+      if (beta != 0) {
+        y = _mm512_fmadd_ps(vb, _mm512_maskz_loadu_ps(m, c), y);
+      }
+      _mm512_mask_storeu_ps(c, m, y);
+    }
+  }
+}
+
+template <int PANELS>
+static inline void gemm_packed_panels_avx512(float* C,
+                                             int ldc,
+                                             const float* A,
+                                             int lda,
+                                             const float* panel,
+                                             size_t M,
+                                             size_t K,
+                                             size_t cols,
+                                             float alpha,
+                                             float beta) {
+  size_t i = 0;
+  for (; i + 8 <= M; i += 8) {
+    gemm_packed_tile_avx512<8, PANELS>(
+        C + i * ldc, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+  }
+  if (M - i >= 4) {
+    gemm_packed_tile_avx512<4, PANELS>(
+        C + i * ldc, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+    i += 4;
+  }
+  if (M - i >= 2) {
+    gemm_packed_tile_avx512<2, PANELS>(
+        C + i * ldc, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+    i += 2;
+  }
+  if (i < M) {
+    gemm_packed_tile_avx512<1, PANELS>(
+        C + i * ldc, ldc, A + i * lda, lda, panel, K, cols, alpha, beta);
+  }
+}
+
+void gemm_packed_avx512(float* C,
+                               int ldc,
+                               const float* A,
+                               int lda,
+                               const float* packedB,
+                               size_t M,
+                               size_t N,
+                               size_t K,
+                               float alpha,
+                               float beta) {
+  size_t j = 0;
+  for (; j + kGemmPanel < N; j += 2 * kGemmPanel) {
+    gemm_packed_panels_avx512<2>(C + j,
+                                 ldc,
+                                 A,
+                                 lda,
+                                 packedB + j * K,
+                                 M,
+                                 K,
+                                 min_size(2 * kGemmPanel, N - j),
+                                 alpha,
+                                 beta);
+  }
+  if (j < N) {
+    gemm_packed_panels_avx512<1>(
+        C + j, ldc, A, lda, packedB + j * K, M, K, N - j, alpha, beta);
+  }
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // PADDLE_SIMD_DISPATCH
@@ -0,0 +1,159 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SIMDKernels.h"
+
+#ifdef PADDLE_SIMD_DISPATCH
+#if !defined(__AVX512F__) || !defined(__AVX512VNNI__)
+#error "SIMDGemm_avx512vnni.cpp must be compiled with -mavx512f -mavx512vnni"
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// GCC reports a false -Wmaybe-uninitialized from _mm512_undefined_ps(),
+// which the AVX-512 intrinsics use as the pass-through operand.
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include "SIMDMath_avx512.h"
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+/**
+ * vpdpbusd multiplies unsigned by signed int8 and sums groups of four
+ * products into int32 without saturation. A is made unsigned by adding 128
+ * to it, and 128 times the column sums of B are subtracted again at the
+ * store. A tile is ROWS rows by one panel.
+ */
+template <int ROWS>
+static inline void gemm_int8_tile_vnni(float* C,
+                                       int ldc,
+                                       const int8_t* A,
+                                       int lda,
+                                       const float* scaleA,
+                                       const int8_t* panel,
+                                       const int32_t* sumB,
+                                       const float* scaleB,
+                                       const float* bias,
+                                       size_t groupedK,
+                                       size_t cols,
+                                       float beta) {
+  __m512i acc[ROWS];
+  for (int r = 0; r < ROWS; ++r) {
+    acc[r] = _mm512_setzero_si512();
+  }
+  const __m512i flip = _mm512_set1_epi32(0x80808080);
+  for (size_t k = 0; k < groupedK;
+       k += kInt8Group, panel += kInt8Panel * kInt8Group) {
+    __m512i b = _mm512_loadu_si512(panel);
+    for (int r = 0; r < ROWS; ++r) {
+      __m512i a = _mm512_xor_si512(
+          _mm512_set1_epi32(load_int8_group(A + r * lda + k)), flip);
+      acc[r] = _mm512_dpbusd_epi32(acc[r], a, b);
+    }
+  }
+  __mmask16 m = cols >= 16 ? 0xFFFF : tail_mask_avx512(cols);
+  __m512i offset = _mm512_slli_epi32(_mm512_maskz_loadu_epi32(m, sumB), 7);
+  __m512 sb = _mm512_maskz_loadu_ps(m, scaleB);
+  __m512 vbias = bias ? _mm512_maskz_loadu_ps(m, bias) : _mm512_setzero_ps();
+  for (int r = 0; r < ROWS; ++r) {
+    float* c = C + r * ldc;
+    __m512 y = _mm512_cvtepi32_ps(_mm512_sub_epi32(acc[r], offset));
+    y = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(y, _mm512_set1_ps(scaleA[r])),
+                                    sb),
+                      vbias);
+    if (beta != 0) {
+      y = _mm512_fmadd_ps(
+          _mm512_set1_ps(beta), _mm512_maskz_loadu_ps(m, c), y);
+    }
+    _mm512_mask_storeu_ps(c, m, y);
+  }
+}
+
+void gemm_int8_vnni(float* C,
+                           int ldc,
+                           const int8_t* A,
+                           int lda,
+                           const float* scaleA,
+                           const int8_t* packedB,
+                           const int32_t* sumB,
+                           const float* scaleB,
+                           const float* bias,
+                           size_t M,
+                           size_t N,
+                           size_t K,
+                           float beta) {
+  size_t groupedK = int8_grouped_k(K);
+  for (size_t j = 0; j < N; j += kInt8Panel) {
+    const int8_t* panel = packedB + j * groupedK;
+    const float* b = bias ? bias + j : nullptr;
+    size_t cols = min_size(kInt8Panel, N - j);
+    size_t i = 0;
+    for (; i + 8 <= M; i += 8) {
+      gemm_int8_tile_vnni<8>(C + i * ldc + j,
+                             ldc,
+                             A + i * lda,
+                             lda,
+                             scaleA + i,
+                             panel,
+                             sumB + j,
+                             scaleB + j,
+                             b,
+                             groupedK,
+                             cols,
+                             beta);
+    }
+    if (M - i >= 4) {
+      gemm_int8_tile_vnni<4>(C + i * ldc + j,
+                             ldc,
+                             A + i * lda,
+                             lda,
+                             scaleA + i,
+                             panel,
+                             sumB + j,
+                             scaleB + j,
+                             b,
+                             groupedK,
+                             cols,
+                             beta);
+      i += 4;
+    }
+    for (; i < M; ++i) {
+      gemm_int8_tile_vnni<1>(C + i * ldc + j,
+                             ldc,
+                             A + i * lda,
+                             lda,
+                             scaleA + i,
+                             panel,
+                             sumB + j,
+                             scaleB + j,
+                             b,
+                             groupedK,
+                             cols,
+                             beta);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // PADDLE_SIMD_DISPATCH
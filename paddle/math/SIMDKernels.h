@@ -0,0 +1,408 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <float.h>
+#include <string.h>
+#include "SIMDFunctions.h"
+#ifdef __SSE3__
+#include <immintrin.h>
+#endif
+
+/**
+ * The kernels of every instruction set live in their own translation units,
+ * each compiled with the flags of its instruction set only, see
+ * paddle/math/CMakeLists.txt. SIMDFunctions.cpp is compiled with the flags
+ * of the whole library; it holds the SSE3 kernels and picks the kernel table
+ * of the running CPU, so that the library still runs on CPUs without the
+ * wider instructions.
+ *
+ * The wider translation units only call functions with internal linkage,
+ * like the static helpers below, and their own kernels. An inline function
+ * or a template shared with the rest of the library, std::min included,
+ * could be emitted there with the wider instructions and then be picked by
+ * the linker for every caller.
+ */
+#if defined(__SSE3__) && (defined(__GNUC__) || defined(__clang__))
+#define PADDLE_SIMD_DISPATCH
+#endif
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+/**
+ * The transcendental kernels use the Cephes expf/logf approximations.
+ *
+ * exp(x) = 2^n * exp(r) with n = round(x / ln2) and |r| <= ln2 / 2, where
+ * ln2 is split in two parts so that n * kLn2Hi is exact. 2^n is applied in
+ * two halves so that n may be 128 or go down into the denormals.
+ *
+ * log(x) = e * ln2 + log(m) with sqrt(0.5) <= m < sqrt(2).
+ */
+static const float kExpHi = 88.72f;
+static const float kExpLo = -103.9f;
+static const float kLog2e = 1.44269504088896341f;
+static const float kLn2Hi = 0.693359375f;
+static const float kLn2Lo = -2.12194440e-4f;
+static const float kExpP[] = {1.9875691500e-4f,
+                              1.3981999507e-3f,
+                              8.3334519073e-3f,
+                              4.1665795894e-2f,
+                              1.6666665459e-1f,
+                              5.0000001201e-1f};
+static const float kSqrtHalf = 0.707106781186547524f;
+static const float kLogP[] = {7.0376836292e-2f,
+                              -1.1514610310e-1f,
+                              1.1676998740e-1f,
+                              -1.2420140846e-1f,
+                              1.4249322787e-1f,
+                              -1.6668057665e-1f,
+                              2.0000714765e-1f,
+                              -2.4999993993e-1f,
+                              3.3333331174e-1f};
+/// sigmoid and tanh clip their inputs as hl_base.h does.
+static const float kTanhMaxExpInput = 40.0f;
+static const float kSigmoidMin = -40.0f;
+static const float kSigmoidMax = 13.0f;
+
+/**
+ * The transposes work on kTransposeTile x kTransposeTile tiles, whose rows
+ * of the source and of the destination both stay in L1. Within a tile,
+ * blocks are transposed in registers; the edges of a tile that do not fill
+ * a block are copied one element at a time.
+ */
+static const size_t kTransposeTile = 32;
+
+static inline void transpose_edge(float* dst,
+                                  int ldDst,
+                                  const float* src,
+                                  int ldSrc,
+                                  size_t rowBegin,
+                                  size_t rowEnd,
+                                  size_t colBegin,
+                                  size_t colEnd) {
+  for (size_t i = rowBegin; i < rowEnd; ++i) {
+    for (size_t j = colBegin; j < colEnd; ++j) {
+      dst[(ptrdiff_t)j * ldDst + i] = src[(ptrdiff_t)i * ldSrc + j];
+    }
+  }
+}
+
+/**
+ * The packed gemms hold a tile of ROWS rows of C by one panel of
+ * kGemmPanel columns in registers for the whole K, loading each row of the
+ * panel once per tile. The panels are the outer loop so that a panel stays
+ * in cache while it is reused by every tile of rows.
+ */
+static const size_t kGemmPanel = paddle::simd::kGemmPanelWidth;
+
+/// Writes one row of a tile into a panel of C that has fewer than
+/// kGemmPanel columns.
+static inline void gemm_store_edge(
+    float* c, const float* acc, size_t cols, float alpha, float beta) {
+  for (size_t j = 0; j < cols; ++j) {
+    c[j] = beta == 0 ? alpha * acc[j] : alpha * acc[j] + beta * c[j];
+  }
+}
+
+/**
+ * The int8 gemms keep the exact int32 sums of a tile in registers and turn
+ * them into floats only when the tile is stored. int8_store_edge() writes one
+ * row of a tile that is cut by the last column of C.
+ */
+static const size_t kInt8Panel = paddle::simd::kInt8PanelWidth;
+static const size_t kInt8Group = paddle::simd::kInt8GroupSize;
+
+/// int8GroupedK(), which is an inline function of the library.
+static inline size_t int8_grouped_k(size_t K) {
+  return (K + kInt8Group - 1) / kInt8Group * kInt8Group;
+}
+
+static inline void int8_store_edge(float* c,
+                                   const int32_t* acc,
+                                   float scaleA,
+                                   const float* scaleB,
+                                   const float* bias,
+                                   size_t cols,
+                                   float beta) {
+  for (size_t j = 0; j < cols; ++j) {
+    float y = (float)acc[j] * scaleA * scaleB[j];
+    if (bias) {
+      y += bias[j];
+    }
+    c[j] = beta == 0 ? y : y + beta * c[j];
+  }
+}
+
+/// Four int8 of a row of A, as one int32.
+static inline int32_t load_int8_group(const int8_t* a) {
+  int32_t group;
+  memcpy(&group, a, sizeof(group));
+  return group;
+}
+
+/// std::min and std::max for the wider translation units.
+static inline size_t min_size(size_t a, size_t b) { return a < b ? a : b; }
+
+static inline float max_float(float a, float b) { return a < b ? b : a; }
+
+/**
+ * The recurrent kernels fuse all the elementwise work of an lstm or gru
+ * step: a block of frame values is loaded once, goes through every gate,
+ * and its results are stored once. Their activations are template
+ * arguments, so that they are inlined; ActivationDispatch turns the modes
+ * chosen at runtime into them.
+ */
+/// Kernel::run<Modes..., modes[0], ..., modes[N - 1]>(args...).
+template <class Kernel, int N, int... Modes>
+struct ActivationDispatch {
+  template <class... Args>
+  static void run(const Activation* modes, const Args&... args) {
+    switch (modes[0]) {
+      case kActSigmoid:
+        ActivationDispatch<Kernel, N - 1, Modes..., kActSigmoid>::run(
+            modes + 1, args...);
+        break;
+      case kActRelu:
+        ActivationDispatch<Kernel, N - 1, Modes..., kActRelu>::run(modes + 1,
+                                                                   args...);
+        break;
+      case kActTanh:
+        ActivationDispatch<Kernel, N - 1, Modes..., kActTanh>::run(modes + 1,
+                                                                   args...);
+        break;
+      default:
+        ActivationDispatch<Kernel, N - 1, Modes..., kActLinear>::run(
+            modes + 1, args...);
+        break;
+    }
+  }
+};
+
+template <class Kernel, int... Modes>
+struct ActivationDispatch<Kernel, 0, Modes...> {
+  template <class... Args>
+  static void run(const Activation*, const Args&... args) {
+    Kernel::template run<Modes...>(args...);
+  }
+};
+
+/// The rows of value and grad of sample b.
+static inline LstmValue<float> lstm_row(const LstmValue<float>& value,
+                                        size_t b,
+                                        size_t frameSize) {
+  LstmValue<float> row = value;
+  row.gate += b * frameSize * 4;
+  row.prevState = value.prevState ? value.prevState + b * frameSize : nullptr;
+  row.state += b * frameSize;
+  row.stateActive += b * frameSize;
+  row.output += b * frameSize;
+  return row;
+}
+
+static inline LstmGrad<float> lstm_row(const LstmGrad<float>& grad,
+                                       size_t b,
+                                       size_t frameSize) {
+  LstmGrad<float> row = grad;
+  row.gate += b * frameSize * 4;
+  row.prevState = grad.prevState ? grad.prevState + b * frameSize : nullptr;
+  row.state += b * frameSize;
+  row.output += b * frameSize;
+  return row;
+}
+
+#ifdef PADDLE_SIMD_DISPATCH
+// SIMDFunctions_avx.cpp
+void addto_avx(float* a, const float* b, size_t len);
+void batch_addto_avx(float* a, const float* b[], int batch, size_t len);
+void batch_axpy_avx(
+    float* a, const float* b[], const float* scale, int batch, size_t len);
+void batch_dot_avx(
+    float* r, const float* a, const float* b[], int batch, size_t len);
+void col_max_avx(float* result, const float* data, int dim, int numSamples);
+void decayL1_avx(float* dst, float* src, float lambda, size_t len);
+void decayL1_avx(float* dst, float* src, float* lr, float lambda, size_t len);
+void transpose_avx(float* dst,
+                   int ldDst,
+                   const float* src,
+                   int ldSrc,
+                   size_t height,
+                   size_t width);
+
+// SIMDFunctions_avx2.cpp
+void decayL1_avx2_fma(
+    float* dst, float* src, float* lr, float lambda, size_t len);
+void batch_axpy_avx2_fma(
+    float* a, const float* b[], const float* scale, int batch, size_t len);
+void batch_dot_avx2_fma(
+    float* r, const float* a, const float* b[], int batch, size_t len);
+void vexp_avx2(float* r, const float* a, size_t len);
+void vlog_avx2(float* r, const float* a, size_t len);
+void vlog1p_avx2(float* r, const float* a, size_t len);
+void vtanh_avx2(float* r, const float* a, size_t len);
+void vsigmoid_avx2(float* r, const float* a, size_t len);
+
+// SIMDGemm_avx2.cpp
+void gemm_packed_avx2_fma(float* C,
+                          int ldc,
+                          const float* A,
+                          int lda,
+                          const float* packedB,
+                          size_t M,
+                          size_t N,
+                          size_t K,
+                          float alpha,
+                          float beta);
+void gemm_int8_avx2_fma(float* C,
+                        int ldc,
+                        const int8_t* A,
+                        int lda,
+                        const float* scaleA,
+                        const int8_t* packedB,
+                        const int32_t* sumB,
+                        const float* scaleB,
+                        const float* bias,
+                        size_t M,
+                        size_t N,
+                        size_t K,
+                        float beta);
+
+// SIMDRecurrent_avx2.cpp
+void lstm_forward_avx2_fma(const LstmValue<float>& value,
+                           size_t frameSize,
+                           size_t batchSize,
+                           Activation activeNode,
+                           Activation activeState);
+void lstm_backward_avx2_fma(const LstmValue<float>& value,
+                            const LstmGrad<float>& grad,
+                            size_t frameSize,
+                            size_t batchSize,
+                            Activation activeNode,
+                            Activation activeState);
+void gru_reset_output_avx2_fma(float* gate,
+                               const float* prevOut,
+                               float* resetOutput,
+                               size_t frameSize,
+                               size_t batchSize);
+void gru_final_output_avx2_fma(float* gate,
+                               const float* prevOut,
+                               float* output,
+                               size_t frameSize,
+                               size_t batchSize,
+                               Activation activeNode);
+void gru_state_grad_avx2_fma(const float* gate,
+                             float* gateGrad,
+                             const float* prevOut,
+                             float* prevOutGrad,
+                             const float* outputGrad,
+                             size_t frameSize,
+                             size_t batchSize,
+                             Activation activeNode);
+void gru_reset_grad_avx2_fma(const float* gate,
+                             float* gateGrad,
+                             const float* prevOut,
+                             float* prevOutGrad,
+                             const float* resetOutputGrad,
+                             size_t frameSize,
+                             size_t batchSize);
+
+// SIMDFunctions_avx512.cpp
+void addto_avx512(float* a, const float* b, size_t len);
+void batch_addto_avx512(float* a, const float* b[], int batch, size_t len);
+void batch_axpy_avx512(
+    float* a, const float* b[], const float* scale, int batch, size_t len);
+void batch_dot_avx512(
+    float* r, const float* a, const float* b[], int batch, size_t len);
+void col_max_avx512(float* result, const float* data, int dim, int numSamples);
+void decayL1_avx512(float* dst, float* src, float lambda, size_t len);
+void decayL1_avx512(
+    float* dst, float* src, float* lr, float lambda, size_t len);
+void vexp_avx512(float* r, const float* a, size_t len);
+void vlog_avx512(float* r, const float* a, size_t len);
+void vlog1p_avx512(float* r, const float* a, size_t len);
+void vtanh_avx512(float* r, const float* a, size_t len);
+void vsigmoid_avx512(float* r, const float* a, size_t len);
+
+// SIMDGemm_avx512.cpp
+void gemm_packed_avx512(float* C,
+                        int ldc,
+                        const float* A,
+                        int lda,
+                        const float* packedB,
+                        size_t M,
+                        size_t N,
+                        size_t K,
+                        float alpha,
+                        float beta);
+
+// SIMDGemm_avx512vnni.cpp
+void gemm_int8_vnni(float* C,
+                    int ldc,
+                    const int8_t* A,
+                    int lda,
+                    const float* scaleA,
+                    const int8_t* packedB,
+                    const int32_t* sumB,
+                    const float* scaleB,
+                    const float* bias,
+                    size_t M,
+                    size_t N,
+                    size_t K,
+                    float beta);
+
+// SIMDRecurrent_avx512.cpp
+void lstm_forward_avx512(const LstmValue<float>& value,
+                         size_t frameSize,
+                         size_t batchSize,
+                         Activation activeNode,
+                         Activation activeState);
+void lstm_backward_avx512(const LstmValue<float>& value,
+                          const LstmGrad<float>& grad,
+                          size_t frameSize,
+                          size_t batchSize,
+                          Activation activeNode,
+                          Activation activeState);
+void gru_reset_output_avx512(float* gate,
+                             const float* prevOut,
+                             float* resetOutput,
+                             size_t frameSize,
+                             size_t batchSize);
+void gru_final_output_avx512(float* gate,
+                             const float* prevOut,
+                             float* output,
+                             size_t frameSize,
+                             size_t batchSize,
+                             Activation activeNode);
+void gru_state_grad_avx512(const float* gate,
+                           float* gateGrad,
+                           const float* prevOut,
+                           float* prevOutGrad,
+                           const float* outputGrad,
+                           size_t frameSize,
+                           size_t batchSize,
+                           Activation activeNode);
+void gru_reset_grad_avx512(const float* gate,
+                           float* gateGrad,
+                           const float* prevOut,
+                           float* prevOutGrad,
+                           const float* resetOutputGrad,
+                           size_t frameSize,
+                           size_t batchSize);
+#endif  // PADDLE_SIMD_DISPATCH
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
@@ -0,0 +1,113 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include "SIMDKernels.h"
+
+/// The vector math of the AVX2 kernels, only for the files compiled with
+/// -mavx2 -mfma.
+#if !defined(__AVX2__) || !defined(__FMA__)
+#error "SIMDMath_avx2.h needs -mavx2 -mfma"
+#endif
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+static inline __m256 exp_avx2(__m256 x) {
+  x = _mm256_max_ps(_mm256_set1_ps(kExpLo),
+                    _mm256_min_ps(_mm256_set1_ps(kExpHi), x));
+  __m256i n = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(kLog2e)));
+  __m256 fn = _mm256_cvtepi32_ps(n);
+  __m256 r = _mm256_fnmadd_ps(fn, _mm256_set1_ps(kLn2Hi), x);
+  r = _mm256_fnmadd_ps(fn, _mm256_set1_ps(kLn2Lo), r);
+  __m256 p = _mm256_set1_ps(kExpP[0]);
+  for (int i = 1; i < 6; ++i) {
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(kExpP[i]));
+  }
+  p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), r);
+  p = _mm256_add_ps(p, _mm256_set1_ps(1.0f));
+  __m256i half = _mm256_srai_epi32(n, 1);
+  __m256i bias = _mm256_set1_epi32(127);
+  __m256 s1 =
+      _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(half, bias), 23));
+  __m256 s2 = _mm256_castsi256_ps(_mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_sub_epi32(n, half), bias), 23));
+  return _mm256_mul_ps(_mm256_mul_ps(p, s1), s2);
+}
+
+static inline __m256 log_avx2(__m256 x) {
+  __m256 zero = _mm256_setzero_ps();
+  __m256 invalid = _mm256_cmp_ps(x, zero, _CMP_NGE_UQ);
+  __m256 isZero = _mm256_cmp_ps(x, zero, _CMP_EQ_OQ);
+  __m256 isInf = _mm256_cmp_ps(x, _mm256_set1_ps(INFINITY), _CMP_EQ_OQ);
+
+  __m256i bits = _mm256_castps_si256(_mm256_max_ps(x, _mm256_set1_ps(FLT_MIN)));
+  __m256 e = _mm256_cvtepi32_ps(
+      _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+  __m256 m = _mm256_castsi256_ps(
+      _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                      _mm256_set1_epi32(0x3f000000)));
+  __m256 one = _mm256_set1_ps(1.0f);
+  __m256 small = _mm256_cmp_ps(m, _mm256_set1_ps(kSqrtHalf), _CMP_LT_OQ);
+  e = _mm256_sub_ps(e, _mm256_and_ps(small, one));
+  m = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(small, m));
+
+  __m256 z = _mm256_mul_ps(m, m);
+  __m256 p = _mm256_set1_ps(kLogP[0]);
+  for (int i = 1; i < 9; ++i) {
+    p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(kLogP[i]));
+  }
+  p = _mm256_mul_ps(_mm256_mul_ps(p, m), z);
+  p = _mm256_fmadd_ps(e, _mm256_set1_ps(kLn2Lo), p);
+  p = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), p);
+  __m256 y = _mm256_fmadd_ps(e, _mm256_set1_ps(kLn2Hi), _mm256_add_ps(m, p));
+
+  y = _mm256_blendv_ps(y, _mm256_set1_ps(-INFINITY), isZero);
+  y = _mm256_blendv_ps(y, x, isInf);
+  return _mm256_or_ps(y, invalid);
+}
+
+static inline __m256 log1p_avx2(__m256 x) {
+  __m256 one = _mm256_set1_ps(1.0f);
+  __m256 u = _mm256_add_ps(x, one);
+  __m256 d = _mm256_sub_ps(u, one);
+  __m256 isOne = _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_EQ_OQ);
+  __m256 isInf = _mm256_cmp_ps(u, _mm256_set1_ps(INFINITY), _CMP_EQ_OQ);
+  d = _mm256_blendv_ps(d, one, _mm256_or_ps(isOne, isInf));
+  __m256 y = _mm256_mul_ps(log_avx2(u), _mm256_div_ps(x, d));
+  y = _mm256_blendv_ps(y, x, isOne);
+  return _mm256_blendv_ps(y, u, isInf);
+}
+
+static inline __m256 tanh_avx2(__m256 x) {
+  __m256 t = _mm256_mul_ps(x, _mm256_set1_ps(-2.0f));
+  t = exp_avx2(_mm256_min_ps(_mm256_set1_ps(kTanhMaxExpInput), t));
+  __m256 one = _mm256_set1_ps(1.0f);
+  __m256 two = _mm256_set1_ps(2.0f);
+  return _mm256_sub_ps(_mm256_div_ps(two, _mm256_add_ps(one, t)), one);
+}
+
+static inline __m256 sigmoid_avx2(__m256 x) {
+  x = _mm256_max_ps(_mm256_set1_ps(kSigmoidMin),
+                    _mm256_min_ps(_mm256_set1_ps(kSigmoidMax), x));
+  __m256 one = _mm256_set1_ps(1.0f);
+  __m256 t = exp_avx2(_mm256_sub_ps(_mm256_setzero_ps(), x));
+  return _mm256_div_ps(one, _mm256_add_ps(one, t));
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
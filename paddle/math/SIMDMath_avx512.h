@@ -0,0 +1,125 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include "SIMDKernels.h"
+
+/// The vector math of the AVX-512 kernels, only for the files compiled with
+/// -mavx512f.
+#if !defined(__AVX512F__)
+#error "SIMDMath_avx512.h needs -mavx512f"
+#endif
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+/**
+ * AVX-512 variants handle the tail with masked loads and stores, so there is
+ * no scalar remainder loop. Only AVX512F instructions are used.
+ */
+static inline __mmask16 tail_mask_avx512(size_t rem) {
+  return static_cast<__mmask16>((1U << rem) - 1);
+}
+
+static inline __m512 exp_avx512(__m512 x) {
+  x = _mm512_max_ps(_mm512_set1_ps(kExpLo),
+                    _mm512_min_ps(_mm512_set1_ps(kExpHi), x));
+  __m512i n = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(kLog2e)));
+  __m512 fn = _mm512_cvtepi32_ps(n);
+  __m512 r = _mm512_fnmadd_ps(fn, _mm512_set1_ps(kLn2Hi), x);
+  r = _mm512_fnmadd_ps(fn, _mm512_set1_ps(kLn2Lo), r);
+  __m512 p = _mm512_set1_ps(kExpP[0]);
+  for (int i = 1; i < 6; ++i) {
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(kExpP[i]));
+  }
+  p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), r);
+  p = _mm512_add_ps(p, _mm512_set1_ps(1.0f));
+  __m512i half = _mm512_srai_epi32(n, 1);
+  __m512i bias = _mm512_set1_epi32(127);
+  __m512 s1 =
+      _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(half, bias), 23));
+  __m512 s2 = _mm512_castsi512_ps(_mm512_slli_epi32(
+      _mm512_add_epi32(_mm512_sub_epi32(n, half), bias), 23));
+  return _mm512_mul_ps(_mm512_mul_ps(p, s1), s2);
+}
+
+static inline __m512 log_avx512(__m512 x) {
+  __m512 zero = _mm512_setzero_ps();
+  __mmask16 invalid = _mm512_cmp_ps_mask(x, zero, _CMP_NGE_UQ);
+  __mmask16 isZero = _mm512_cmp_ps_mask(x, zero, _CMP_EQ_OQ);
+  __mmask16 isInf =
+      _mm512_cmp_ps_mask(x, _mm512_set1_ps(INFINITY), _CMP_EQ_OQ);
+
+  __m512i bits = _mm512_castps_si512(_mm512_max_ps(x, _mm512_set1_ps(FLT_MIN)));
+  __m512 e = _mm512_cvtepi32_ps(
+      _mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+  __m512 m = _mm512_castsi512_ps(
+      _mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)),
+                      _mm512_set1_epi32(0x3f000000)));
+  __m512 one = _mm512_set1_ps(1.0f);
+  __mmask16 small =
+      _mm512_cmp_ps_mask(m, _mm512_set1_ps(kSqrtHalf), _CMP_LT_OQ);
+  e = _mm512_mask_sub_ps(e, small, e, one);
+  __m512 m1 = _mm512_sub_ps(m, one);
+  m = _mm512_mask_add_ps(m1, small, m1, m);
+
+  __m512 z = _mm512_mul_ps(m, m);
+  __m512 p = _mm512_set1_ps(kLogP[0]);
+  for (int i = 1; i < 9; ++i) {
+    p = _mm512_fmadd_ps(p, m, _mm512_set1_ps(kLogP[i]));
+  }
+  p = _mm512_mul_ps(_mm512_mul_ps(p, m), z);
+  p = _mm512_fmadd_ps(e, _mm512_set1_ps(kLn2Lo), p);
+  p = _mm512_fnmadd_ps(z, _mm512_set1_ps(0.5f), p);
+  __m512 y = _mm512_fmadd_ps(e, _mm512_set1_ps(kLn2Hi), _mm512_add_ps(m, p));
+
+  y = _mm512_mask_blend_ps(isZero, y, _mm512_set1_ps(-INFINITY));
+  y = _mm512_mask_blend_ps(isInf, y, x);
+  return _mm512_mask_blend_ps(invalid, y, _mm512_set1_ps(NAN));
+}
+
+static inline __m512 log1p_avx512(__m512 x) {
+  __m512 one = _mm512_set1_ps(1.0f);
+  __m512 u = _mm512_add_ps(x, one);
+  __m512 d = _mm512_sub_ps(u, one);
+  __mmask16 isOne = _mm512_cmp_ps_mask(d, _mm512_setzero_ps(), _CMP_EQ_OQ);
+  __mmask16 isInf =
+      _mm512_cmp_ps_mask(u, _mm512_set1_ps(INFINITY), _CMP_EQ_OQ);
+  d = _mm512_mask_blend_ps(isOne | isInf, d, one);
+  __m512 y = _mm512_mul_ps(log_avx512(u), _mm512_div_ps(x, d));
+  y = _mm512_mask_blend_ps(isOne, y, x);
+  return _mm512_mask_blend_ps(isInf, y, u);
+}
+
+static inline __m512 tanh_avx512(__m512 x) {
+  __m512 t = _mm512_mul_ps(x, _mm512_set1_ps(-2.0f));
+  t = exp_avx512(_mm512_min_ps(_mm512_set1_ps(kTanhMaxExpInput), t));
+  __m512 one = _mm512_set1_ps(1.0f);
+  __m512 two = _mm512_set1_ps(2.0f);
+  return _mm512_sub_ps(_mm512_div_ps(two, _mm512_add_ps(one, t)), one);
+}
+
+static inline __m512 sigmoid_avx512(__m512 x) {
+  x = _mm512_max_ps(_mm512_set1_ps(kSigmoidMin),
+                    _mm512_min_ps(_mm512_set1_ps(kSigmoidMax), x));
+  __m512 one = _mm512_set1_ps(1.0f);
+  __m512 t = exp_avx512(_mm512_sub_ps(_mm512_setzero_ps(), x));
+  return _mm512_div_ps(one, _mm512_add_ps(one, t));
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
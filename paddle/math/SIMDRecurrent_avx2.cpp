@@ -0,0 +1,504 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SIMDKernels.h"
+#include "SIMDMath_avx2.h"
+
+#ifdef PADDLE_SIMD_DISPATCH
+#if !defined(__AVX2__) || !defined(__FMA__)
+#error "SIMDRecurrent_avx2.cpp must be compiled with -mavx2 -mfma"
+#endif
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+/**
+ * The AVX2 recurrent kernels process a row in blocks of 8 values, the last
+ * block with masked loads and stores.
+ */
+static inline __m256i tail_mask_avx2(size_t rem) {
+  return _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(rem)),
+                            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+template <bool MASKED>
+static inline __m256 load_avx2(const float* p, __m256i mask) {
+  return MASKED ? _mm256_maskload_ps(p, mask) : _mm256_loadu_ps(p);
+}
+
+/// Zero when p is nullptr.
+template <bool MASKED>
+static inline __m256 load_or_zero_avx2(const float* p, __m256i mask) {
+  return p ? load_avx2<MASKED>(p, mask) : _mm256_setzero_ps();
+}
+
+template <bool MASKED>
+static inline void store_avx2(float* p, __m256 v, __m256i mask) {
+  if (MASKED) {
+    _mm256_maskstore_ps(p, mask, v);
+  } else {
+    _mm256_storeu_ps(p, v);
+  }
+}
+
+/// forward(x) = act(x), backward(grad, y) = the gradient of x.
+template <int ACT>
+struct ActivationAvx2;
+
+template <>
+struct ActivationAvx2<kActSigmoid> {
+  static inline __m256 forward(__m256 x) {
+    return sigmoid_avx2(x);
+  }
+  static inline __m256 backward(__m256 grad, __m256 y) {
+    __m256 one = _mm256_set1_ps(1.0f);
+    return _mm256_mul_ps(_mm256_mul_ps(grad, y), _mm256_sub_ps(one, y));
+  }
+};
+
+template <>
+struct ActivationAvx2<kActRelu> {
+  static inline __m256 forward(__m256 x) {
+    return _mm256_max_ps(x, _mm256_setzero_ps());
+  }
+  static inline __m256 backward(__m256 grad, __m256 y) {
+    return _mm256_and_ps(grad,
+                         _mm256_cmp_ps(y, _mm256_setzero_ps(), _CMP_GT_OQ));
+  }
+};
+
+template <>
+struct ActivationAvx2<kActTanh> {
+  static inline __m256 forward(__m256 x) {
+    return tanh_avx2(x);
+  }
+  static inline __m256 backward(__m256 grad, __m256 y) {
+    return _mm256_mul_ps(grad,
+                         _mm256_fnmadd_ps(y, y, _mm256_set1_ps(1.0f)));
+  }
+};
+
+template <>
+struct ActivationAvx2<kActLinear> {
+  static inline __m256 forward(__m256 x) {
+    return x;
+  }
+  static inline __m256 backward(__m256 grad, __m256) {
+    return grad;
+  }
+};
+
+typedef ActivationAvx2<kActSigmoid> GateAvx2;
+
+template <int NODE, int STATE, bool MASKED>
+static inline void lstm_forward_block_avx2(const LstmValue<float>& v,
+                                           size_t i,
+                                           size_t frameSize,
+                                           __m256i mask) {
+  float* gate = v.gate + i;
+  __m256 prev = load_or_zero_avx2<MASKED>(
+      v.prevState ? v.prevState + i : nullptr, mask);
+  __m256 in =
+      ActivationAvx2<NODE>::forward(load_avx2<MASKED>(gate, mask));
+  __m256 ig = GateAvx2::forward(
+      _mm256_fmadd_ps(prev,
+                      load_avx2<MASKED>(v.checkI + i, mask),
+                      load_avx2<MASKED>(gate + frameSize, mask)));
+  __m256 fg = GateAvx2::forward(
+      _mm256_fmadd_ps(prev,
+                      load_avx2<MASKED>(v.checkF + i, mask),
+                      load_avx2<MASKED>(gate + frameSize * 2, mask)));
+  __m256 state = _mm256_fmadd_ps(in, ig, _mm256_mul_ps(prev, fg));
+  __m256 og = GateAvx2::forward(
+      _mm256_fmadd_ps(state,
+                      load_avx2<MASKED>(v.checkO + i, mask),
+                      load_avx2<MASKED>(gate + frameSize * 3, mask)));
+  __m256 stateActive = ActivationAvx2<STATE>::forward(state);
+  store_avx2<MASKED>(gate, in, mask);
+  store_avx2<MASKED>(gate + frameSize, ig, mask);
+  store_avx2<MASKED>(gate + frameSize * 2, fg, mask);
+  store_avx2<MASKED>(gate + frameSize * 3, og, mask);
+  store_avx2<MASKED>(v.state + i, state, mask);
+  store_avx2<MASKED>(v.stateActive + i, stateActive, mask);
+  store_avx2<MASKED>(v.output + i, _mm256_mul_ps(og, stateActive), mask);
+}
+
+struct LstmForwardAvx2 {
+  template <int NODE, int STATE>
+  static void run(const LstmValue<float>& value,
+                  size_t frameSize,
+                  size_t batchSize) {
+    __m256i mask = tail_mask_avx2(frameSize % 8);
+    for (size_t b = 0; b < batchSize; ++b) {
+      LstmValue<float> row = lstm_row(value, b, frameSize);
+      size_t i = 0;
+      for (; i + 8 <= frameSize; i += 8) {
+        lstm_forward_block_avx2<NODE, STATE, false>(row, i, frameSize, mask);
+      }
+      if (i < frameSize) {
+        lstm_forward_block_avx2<NODE, STATE, true>(row, i, frameSize, mask);
+      }
+    }
+  }
+};
+
+/// check += grad * x, for a peephole gradient that may be nullptr.
+template <bool MASKED>
+static inline void add_check_grad_avx2(float* check,
+                                       __m256 grad,
+                                       __m256 x,
+                                       __m256i mask) {
+  if (check) {
+    store_avx2<MASKED>(
+        check,
+        _mm256_fmadd_ps(grad, x, load_avx2<MASKED>(check, mask)),
+        mask);
+  }
+}
+
+template <int NODE, int STATE, bool MASKED>
+static inline void lstm_backward_block_avx2(const LstmValue<float>& v,
+                                            const LstmGrad<float>& g,
+                                            size_t i,
+                                            size_t frameSize,
+                                            __m256i mask) {
+  const float* gate = v.gate + i;
+  float* gateGrad = g.gate + i;
+  __m256 prev = load_or_zero_avx2<MASKED>(
+      v.prevState ? v.prevState + i : nullptr, mask);
+  __m256 in = load_avx2<MASKED>(gate, mask);
+  __m256 ig = load_avx2<MASKED>(gate + frameSize, mask);
+  __m256 fg = load_avx2<MASKED>(gate + frameSize * 2, mask);
+  __m256 og = load_avx2<MASKED>(gate + frameSize * 3, mask);
+  __m256 stateActive = load_avx2<MASKED>(v.stateActive + i, mask);
+  __m256 checkI = load_avx2<MASKED>(v.checkI + i, mask);
+  __m256 checkF = load_avx2<MASKED>(v.checkF + i, mask);
+  __m256 outGrad = load_avx2<MASKED>(g.output + i, mask);
+
+  __m256 ogGrad =
+      GateAvx2::backward(_mm256_mul_ps(outGrad, stateActive), og);
+  __m256 stateGrad = _mm256_add_ps(
+      load_avx2<MASKED>(g.state + i, mask),
+      _mm256_fmadd_ps(
+          ogGrad,
+          load_avx2<MASKED>(v.checkO + i, mask),
+          ActivationAvx2<STATE>::backward(_mm256_mul_ps(outGrad, og),
+                                          stateActive)));
+  __m256 inGrad =
+      ActivationAvx2<NODE>::backward(_mm256_mul_ps(stateGrad, ig), in);
+  __m256 igGrad = GateAvx2::backward(_mm256_mul_ps(stateGrad, in), ig);
+  __m256 fgGrad = GateAvx2::backward(_mm256_mul_ps(stateGrad, prev), fg);
+  store_avx2<MASKED>(gateGrad, inGrad, mask);
+  store_avx2<MASKED>(gateGrad + frameSize, igGrad, mask);
+  store_avx2<MASKED>(gateGrad + frameSize * 2, fgGrad, mask);
+  store_avx2<MASKED>(gateGrad + frameSize * 3, ogGrad, mask);
+  store_avx2<MASKED>(g.state + i, stateGrad, mask);
+  if (g.prevState) {
+    __m256 prevGrad = _mm256_fmadd_ps(
+        igGrad,
+        checkI,
+        _mm256_fmadd_ps(fgGrad, checkF, _mm256_mul_ps(stateGrad, fg)));
+    store_avx2<MASKED>(g.prevState + i, prevGrad, mask);
+  }
+  if (v.prevState) {
+    add_check_grad_avx2<MASKED>(
+        g.checkI ? g.checkI + i : nullptr, igGrad, prev, mask);
+    add_check_grad_avx2<MASKED>(
+        g.checkF ? g.checkF + i : nullptr, fgGrad, prev, mask);
+  }
+  add_check_grad_avx2<MASKED>(g.checkO ? g.checkO + i : nullptr,
+                              ogGrad,
+                              load_avx2<MASKED>(v.state + i, mask),
+                              mask);
+}
+
+struct LstmBackwardAvx2 {
+  template <int NODE, int STATE>
+  static void run(const LstmValue<float>& value,
+                  const LstmGrad<float>& grad,
+                  size_t frameSize,
+                  size_t batchSize) {
+    __m256i mask = tail_mask_avx2(frameSize % 8);
+    for (size_t b = 0; b < batchSize; ++b) {
+      LstmValue<float> v = lstm_row(value, b, frameSize);
+      LstmGrad<float> g = lstm_row(grad, b, frameSize);
+      size_t i = 0;
+      for (; i + 8 <= frameSize; i += 8) {
+        lstm_backward_block_avx2<NODE, STATE, false>(v, g, i, frameSize, mask);
+      }
+      if (i < frameSize) {
+        lstm_backward_block_avx2<NODE, STATE, true>(v, g, i, frameSize, mask);
+      }
+    }
+  }
+};
+
+void lstm_forward_avx2_fma(const LstmValue<float>& value,
+                                  size_t frameSize,
+                                  size_t batchSize,
+                                  Activation activeNode,
+                                  Activation activeState) {
+  Activation modes[] = {activeNode, activeState};
+  ActivationDispatch<LstmForwardAvx2, 2>::run(
+      modes, value, frameSize, batchSize);
+}
+
+void lstm_backward_avx2_fma(const LstmValue<float>& value,
+                                   const LstmGrad<float>& grad,
+                                   size_t frameSize,
+                                   size_t batchSize,
+                                   Activation activeNode,
+                                   Activation activeState) {
+  Activation modes[] = {activeNode, activeState};
+  ActivationDispatch<LstmBackwardAvx2, 2>::run(
+      modes, value, grad, frameSize, batchSize);
+}
+
+template <bool MASKED>
+static inline void gru_reset_output_block_avx2(float* gate,
+                                               const float* prevOut,
+                                               float* resetOutput,
+                                               size_t frameSize,
+                                               __m256i mask) {
+  __m256 u = GateAvx2::forward(load_avx2<MASKED>(gate, mask));
+  __m256 r = GateAvx2::forward(load_avx2<MASKED>(gate + frameSize, mask));
+  store_avx2<MASKED>(gate, u, mask);
+  store_avx2<MASKED>(gate + frameSize, r, mask);
+  store_avx2<MASKED>(
+      resetOutput,
+      _mm256_mul_ps(load_or_zero_avx2<MASKED>(prevOut, mask), r),
+      mask);
+}
+
+void gru_reset_output_avx2_fma(float* gate,
+                                      const float* prevOut,
+                                      float* resetOutput,
+                                      size_t frameSize,
+                                      size_t batchSize) {
+  __m256i mask = tail_mask_avx2(frameSize % 8);
+  for (size_t b = 0; b < batchSize; ++b) {
+    float* g = gate + b * frameSize * 3;
+    const float* p = prevOut ? prevOut + b * frameSize : nullptr;
+    float* r = resetOutput + b * frameSize;
+    size_t i = 0;
+    for (; i + 8 <= frameSize; i += 8) {
+      gru_reset_output_block_avx2<false>(
+          g + i, p ? p + i : nullptr, r + i, frameSize, mask);
+    }
+    if (i < frameSize) {
+      gru_reset_output_block_avx2<true>(
+          g + i, p ? p + i : nullptr, r + i, frameSize, mask);
+    }
+  }
+}
+
+template <int NODE, bool MASKED>
+static inline void gru_final_output_block_avx2(float* gate,
+                                               const float* prevOut,
+                                               float* output,
+                                               size_t frameSize,
+                                               __m256i mask) {
+  __m256 u = load_avx2<MASKED>(gate, mask);
+  __m256 fs = ActivationAvx2<NODE>::forward(
+      load_avx2<MASKED>(gate + frameSize * 2, mask));
+  __m256 prev = load_or_zero_avx2<MASKED>(prevOut, mask);
+  store_avx2<MASKED>(gate + frameSize * 2, fs, mask);
+  store_avx2<MASKED>(
+      output, _mm256_fmadd_ps(u, _mm256_sub_ps(fs, prev), prev), mask);
+}
+
+struct GruFinalOutputAvx2 {
+  template <int NODE>
+  static void run(float* gate,
+                  const float* prevOut,
+                  float* output,
+                  size_t frameSize,
+                  size_t batchSize) {
+    __m256i mask = tail_mask_avx2(frameSize % 8);
+    for (size_t b = 0; b < batchSize; ++b) {
+      float* g = gate + b * frameSize * 3;
+      const float* p = prevOut ? prevOut + b * frameSize : nullptr;
+      float* o = output + b * frameSize;
+      size_t i = 0;
+      for (; i + 8 <= frameSize; i += 8) {
+        gru_final_output_block_avx2<NODE, false>(
+            g + i, p ? p + i : nullptr, o + i, frameSize, mask);
+      }
+      if (i < frameSize) {
+        gru_final_output_block_avx2<NODE, true>(
+            g + i, p ? p + i : nullptr, o + i, frameSize, mask);
+      }
+    }
+  }
+};
+
+void gru_final_output_avx2_fma(float* gate,
+                                      const float* prevOut,
+                                      float* output,
+                                      size_t frameSize,
+                                      size_t batchSize,
+                                      Activation activeNode) {
+  ActivationDispatch<GruFinalOutputAvx2, 1>::run(
+      &activeNode, gate, prevOut, output, frameSize, batchSize);
+}
+
+template <int NODE, bool MASKED>
+static inline void gru_state_grad_block_avx2(const float* gate,
+                                             float* gateGrad,
+                                             const float* prevOut,
+                                             float* prevOutGrad,
+                                             const float* outputGrad,
+                                             size_t frameSize,
+                                             __m256i mask) {
+  __m256 u = load_avx2<MASKED>(gate, mask);
+  __m256 fs = load_avx2<MASKED>(gate + frameSize * 2, mask);
+  __m256 prev = load_or_zero_avx2<MASKED>(prevOut, mask);
+  __m256 outGrad = load_avx2<MASKED>(outputGrad, mask);
+  store_avx2<MASKED>(
+      gateGrad, _mm256_mul_ps(outGrad, _mm256_sub_ps(fs, prev)), mask);
+  if (prevOutGrad) {
+    __m256 prevGrad = load_avx2<MASKED>(prevOutGrad, mask);
+    prevGrad = _mm256_add_ps(_mm256_fnmadd_ps(outGrad, u, prevGrad), outGrad);
+    store_avx2<MASKED>(prevOutGrad, prevGrad, mask);
+  }
+  store_avx2<MASKED>(
+      gateGrad + frameSize * 2,
+      ActivationAvx2<NODE>::backward(_mm256_mul_ps(outGrad, u), fs),
+      mask);
+}
+
+struct GruStateGradAvx2 {
+  template <int NODE>
+  static void run(const float* gate,
+                  float* gateGrad,
+                  const float* prevOut,
+                  float* prevOutGrad,
+                  const float* outputGrad,
+                  size_t frameSize,
+                  size_t batchSize) {
+    __m256i mask = tail_mask_avx2(frameSize % 8);
+    for (size_t b = 0; b < batchSize; ++b) {
+      const float* g = gate + b * frameSize * 3;
+      float* gg = gateGrad + b * frameSize * 3;
+      const float* p = prevOut ? prevOut + b * frameSize : nullptr;
+      float* pg = prevOutGrad ? prevOutGrad + b * frameSize : nullptr;
+      const float* og = outputGrad + b * frameSize;
+      size_t i = 0;
+      for (; i + 8 <= frameSize; i += 8) {
+        gru_state_grad_block_avx2<NODE, false>(g + i,
+                                               gg + i,
+                                               p ? p + i : nullptr,
+                                               pg ? pg + i : nullptr,
+                                               og + i,
+                                               frameSize,
+                                               mask);
+      }
+      if (i < frameSize) {
+        gru_state_grad_block_avx2<NODE, true>(g + i,
+                                              gg + i,
+                                              p ? p + i : nullptr,
+                                              pg ? pg + i : nullptr,
+                                              og + i,
+                                              frameSize,
+                                              mask);
+      }
+    }
+  }
+};
+
+void gru_state_grad_avx2_fma(const float* gate,
+                                    float* gateGrad,
+                                    const float* prevOut,
+                                    float* prevOutGrad,
+                                    const float* outputGrad,
+                                    size_t frameSize,
+                                    size_t batchSize,
+                                    Activation activeNode) {
+  ActivationDispatch<GruStateGradAvx2, 1>::run(&activeNode,
+                                               gate,
+                                               gateGrad,
+                                               prevOut,
+                                               prevOutGrad,
+                                               outputGrad,
+                                               frameSize,
+                                               batchSize);
+}
+
+template <bool MASKED>
+static inline void gru_reset_grad_block_avx2(const float* gate,
+                                             float* gateGrad,
+                                             const float* prevOut,
+                                             float* prevOutGrad,
+                                             const float* resetOutputGrad,
+                                             size_t frameSize,
+                                             __m256i mask) {
+  __m256 u = load_avx2<MASKED>(gate, mask);
+  __m256 r = load_avx2<MASKED>(gate + frameSize, mask);
+  __m256 uGrad = load_avx2<MASKED>(gateGrad, mask);
+  __m256 rGrad = _mm256_setzero_ps();
+  if (prevOut && prevOutGrad) {
+    __m256 resetGrad = load_avx2<MASKED>(resetOutputGrad, mask);
+    rGrad = _mm256_mul_ps(resetGrad, load_avx2<MASKED>(prevOut, mask));
+    store_avx2<MASKED>(
+        prevOutGrad,
+        _mm256_fmadd_ps(resetGrad, r, load_avx2<MASKED>(prevOutGrad, mask)),
+        mask);
+  }
+  store_avx2<MASKED>(gateGrad, GateAvx2::backward(uGrad, u), mask);
+  store_avx2<MASKED>(
+      gateGrad + frameSize, GateAvx2::backward(rGrad, r), mask);
+}
+
+void gru_reset_grad_avx2_fma(const float* gate,
+                                    float* gateGrad,
+                                    const float* prevOut,
+                                    float* prevOutGrad,
+                                    const float* resetOutputGrad,
+                                    size_t frameSize,
+                                    size_t batchSize) {
+  __m256i mask = tail_mask_avx2(frameSize % 8);
+  for (size_t b = 0; b < batchSize; ++b) {
+    const float* g = gate + b * frameSize * 3;
+    float* gg = gateGrad + b * frameSize * 3;
+    const float* p = prevOut ? prevOut + b * frameSize : nullptr;
+    float* pg = prevOutGrad ? prevOutGrad + b * frameSize : nullptr;
+    const float* rg = resetOutputGrad + b * frameSize;
+    size_t i = 0;
+    for (; i + 8 <= frameSize; i += 8) {
+      gru_reset_grad_block_avx2<false>(g + i,
+                                       gg + i,
+                                       p ? p + i : nullptr,
+                                       pg ? pg + i : nullptr,
+                                       rg + i,
+                                       frameSize,
+                                       mask);
+    }
+    if (i < frameSize) {
+      gru_reset_grad_block_avx2<true>(g + i,
+                                      gg + i,
+                                      p ? p + i : nullptr,
+                                      pg ? pg + i : nullptr,
+                                      rg + i,
+                                      frameSize,
+                                      mask);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
+
+#endif  // PADDLE_SIMD_DISPATCH
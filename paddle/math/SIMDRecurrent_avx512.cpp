@@ -0,0 +1,390 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SIMDKernels.h"
+
+#ifdef PADDLE_SIMD_DISPATCH
+#if !defined(__AVX512F__)
+#error "SIMDRecurrent_avx512.cpp must be compiled with -mavx512f"
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+// GCC reports a false -Wmaybe-uninitialized from _mm512_undefined_ps(),
+// which the AVX-512 intrinsics use as the pass-through operand.
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include "SIMDMath_avx512.h"
+
+namespace paddle {
+namespace simd {
+namespace internal {
+
+/// The AVX-512 recurrent kernels mask every block of 16 values of a row.
+static inline __m512 load_avx512(const float* p, __mmask16 m) {
+  return _mm512_maskz_loadu_ps(m, p);
+}
+
+/// Zero when p is nullptr.
+static inline __m512 load_or_zero_avx512(const float* p, __mmask16 m) {
+  return p ? _mm512_maskz_loadu_ps(m, p) : _mm512_setzero_ps();
+}
+
+static inline __mmask16 block_mask_avx512(size_t i, size_t frameSize) {
+  return frameSize - i >= 16 ? 0xFFFF : tail_mask_avx512(frameSize - i);
+}
+
+template <int ACT>
+struct ActivationAvx512;
+
+template <>
+struct ActivationAvx512<kActSigmoid> {
+  static inline __m512 forward(__m512 x) {
+    return sigmoid_avx512(x);
+  }
+  static inline __m512 backward(__m512 grad, __m512 y) {
+    __m512 one = _mm512_set1_ps(1.0f);
+    return _mm512_mul_ps(_mm512_mul_ps(grad, y), _mm512_sub_ps(one, y));
+  }
+};
+
+template <>
+struct ActivationAvx512<kActRelu> {
+  static inline __m512 forward(__m512 x) {
+    return _mm512_max_ps(x, _mm512_setzero_ps());
+  }
+  static inline __m512 backward(__m512 grad, __m512 y) {
+    return _mm512_maskz_mov_ps(
+        _mm512_cmp_ps_mask(y, _mm512_setzero_ps(), _CMP_GT_OQ), grad);
+  }
+};
+
+template <>
+struct ActivationAvx512<kActTanh> {
+  static inline __m512 forward(__m512 x) {
+    return tanh_avx512(x);
+  }
+  static inline __m512 backward(__m512 grad, __m512 y) {
+    return _mm512_mul_ps(grad,
+                         _mm512_fnmadd_ps(y, y, _mm512_set1_ps(1.0f)));
+  }
+};
+
+template <>
+struct ActivationAvx512<kActLinear> {
+  static inline __m512 forward(__m512 x) {
+    return x;
+  }
+  static inline __m512 backward(__m512 grad, __m512) {
+    return grad;
+  }
+};
+
+typedef ActivationAvx512<kActSigmoid> GateAvx512;
+
+struct LstmForwardAvx512 {
+  template <int NODE, int STATE>
+  static void run(const LstmValue<float>& value,
+                  size_t frameSize,
+                  size_t batchSize) {
+    for (size_t b = 0; b < batchSize; ++b) {
+      LstmValue<float> v = lstm_row(value, b, frameSize);
+      for (size_t i = 0; i < frameSize; i += 16) {
+        __mmask16 m = block_mask_avx512(i, frameSize);
+        float* gate = v.gate + i;
+        __m512 prev =
+            load_or_zero_avx512(v.prevState ? v.prevState + i : nullptr, m);
+        __m512 in = ActivationAvx512<NODE>::forward(load_avx512(gate, m));
+        __m512 ig = GateAvx512::forward(
+            _mm512_fmadd_ps(prev,
+                            load_avx512(v.checkI + i, m),
+                            load_avx512(gate + frameSize, m)));
+        __m512 fg = GateAvx512::forward(
+            _mm512_fmadd_ps(prev,
+                            load_avx512(v.checkF + i, m),
+                            load_avx512(gate + frameSize * 2, m)));
+        __m512 state = _mm512_fmadd_ps(in, ig, _mm512_mul_ps(prev, fg));
+        __m512 og = GateAvx512::forward(
+            _mm512_fmadd_ps(state,
+                            load_avx512(v.checkO + i, m),
+                            load_avx512(gate + frameSize * 3, m)));
+        __m512 stateActive = ActivationAvx512<STATE>::forward(state);
+        _mm512_mask_storeu_ps(gate, m, in);
+        _mm512_mask_storeu_ps(gate + frameSize, m, ig);
+        _mm512_mask_storeu_ps(gate + frameSize * 2, m, fg);
+        _mm512_mask_storeu_ps(gate + frameSize * 3, m, og);
+        _mm512_mask_storeu_ps(v.state + i, m, state);
+        _mm512_mask_storeu_ps(v.stateActive + i, m, stateActive);
+        _mm512_mask_storeu_ps(
+            v.output + i, m, _mm512_mul_ps(og, stateActive));
+      }
+    }
+  }
+};
+
+/// check += grad * x, for a peephole gradient that may be nullptr.
+static inline void add_check_grad_avx512(float* check,
+                                         __m512 grad,
+                                         __m512 x,
+                                         __mmask16 m) {
+  if (check) {
+    _mm512_mask_storeu_ps(
+        check, m, _mm512_fmadd_ps(grad, x, load_avx512(check, m)));
+  }
+}
+
+struct LstmBackwardAvx512 {
+  template <int NODE, int STATE>
+  static void run(const LstmValue<float>& value,
+                  const LstmGrad<float>& grad,
+                  size_t frameSize,
+                  size_t batchSize) {
+    for (size_t b = 0; b < batchSize; ++b) {
+      LstmValue<float> v = lstm_row(value, b, frameSize);
+      LstmGrad<float> g = lstm_row(grad, b, frameSize);
+      for (size_t i = 0; i < frameSize; i += 16) {
+        __mmask16 m = block_mask_avx512(i, frameSize);
+        const float* gate = v.gate + i;
+        float* gateGrad = g.gate + i;
+        __m512 prev =
+            load_or_zero_avx512(v.prevState ? v.prevState + i : nullptr, m);
+        __m512 in = load_avx512(gate, m);
+        __m512 ig = load_avx512(gate + frameSize, m);
+        __m512 fg = load_avx512(gate + frameSize * 2, m);
+        __m512 og = load_avx512(gate + frameSize * 3, m);
+        __m512 stateActive = load_avx512(v.stateActive + i, m);
+        __m512 outGrad = load_avx512(g.output + i, m);
+
+        __m512 ogGrad =
+            GateAvx512::backward(_mm512_mul_ps(outGrad, stateActive), og);
+        __m512 stateGrad = _mm512_add_ps(
+            load_avx512(g.state + i, m),
+            _mm512_fmadd_ps(
+                ogGrad,
+                load_avx512(v.checkO + i, m),
+                ActivationAvx512<STATE>::backward(_mm512_mul_ps(outGrad, og),
+                                                  stateActive)));
+        __m512 inGrad =
+            ActivationAvx512<NODE>::backward(_mm512_mul_ps(stateGrad, ig), in);
+        __m512 igGrad =
+            GateAvx512::backward(_mm512_mul_ps(stateGrad, in), ig);
+        __m512 fgGrad =
+            GateAvx512::backward(_mm512_mul_ps(stateGrad, prev), fg);
+        _mm512_mask_storeu_ps(gateGrad, m, inGrad);
+        _mm512_mask_storeu_ps(gateGrad + frameSize, m, igGrad);
+        _mm512_mask_storeu_ps(gateGrad + frameSize * 2, m, fgGrad);
+        _mm512_mask_storeu_ps(gateGrad + frameSize * 3, m, ogGrad);
+        _mm512_mask_storeu_ps(g.state + i, m, stateGrad);
+        if (g.prevState) {
+          __m512 prevGrad = _mm512_fmadd_ps(
+              igGrad,
+              load_avx512(v.checkI + i, m),
+              _mm512_fmadd_ps(fgGrad,
+                              load_avx512(v.checkF + i, m),
+                              _mm512_mul_ps(stateGrad, fg)));
+          _mm512_mask_storeu_ps(g.prevState + i, m, prevGrad);
+        }
+        if (v.prevState) {
+          add_check_grad_avx512(
+              g.checkI ? g.checkI + i : nullptr, igGrad, prev, m);
+          add_check_grad_avx512(
+              g.checkF ? g.checkF + i : nullptr, fgGrad, prev, m);
+        }
+        add_check_grad_avx512(g.checkO ? g.checkO + i : nullptr,
+                              ogGrad,
+                              load_avx512(v.state + i, m),
+                              m);
+      }
+    }
+  }
+};
+
+void lstm_forward_avx512(const LstmValue<float>& value,
+                                size_t frameSize,
+                                size_t batchSize,
+                                Activation activeNode,
+                                Activation activeState) {
+  Activation modes[] = {activeNode, activeState};
+  ActivationDispatch<LstmForwardAvx512, 2>::run(
+      modes, value, frameSize, batchSize);
+}
+
+void lstm_backward_avx512(const LstmValue<float>& value,
+                                 const LstmGrad<float>& grad,
+                                 size_t frameSize,
+                                 size_t batchSize,
+                                 Activation activeNode,
+                                 Activation activeState) {
+  Activation modes[] = {activeNode, activeState};
+  ActivationDispatch<LstmBackwardAvx512, 2>::run(
+      modes, value, grad, frameSize, batchSize);
+}
+
+void gru_reset_output_avx512(float* gate,
+                                    const float* prevOut,
+                                    float* resetOutput,
+                                    size_t frameSize,
+                                    size_t batchSize) {
+  for (size_t b = 0; b < batchSize; ++b) {
+    float* g = gate + b * frameSize * 3;
+    const float* p = prevOut ? prevOut + b * frameSize : nullptr;
+    float* ro = resetOutput + b * frameSize;
+    for (size_t i = 0; i < frameSize; i += 16) {
+      __mmask16 m = block_mask_avx512(i, frameSize);
+      __m512 u = GateAvx512::forward(load_avx512(g + i, m));
+      __m512 r = GateAvx512::forward(load_avx512(g + frameSize + i, m));
+      _mm512_mask_storeu_ps(g + i, m, u);
+      _mm512_mask_storeu_ps(g + frameSize + i, m, r);
+      _mm512_mask_storeu_ps(
+          ro + i,
+          m,
+          _mm512_mul_ps(load_or_zero_avx512(p ? p + i : nullptr, m), r));
+    }
+  }
+}
+
+struct GruFinalOutputAvx512 {
+  template <int NODE>
+  static void run(float* gate,
+                  const float* prevOut,
+                  float* output,
+                  size_t frameSize,
+                  size_t batchSize) {
+    for (size_t b = 0; b < batchSize; ++b) {
+      const float* u = gate + b * frameSize * 3;
+      float* fs = gate + b * frameSize * 3 + frameSize * 2;
+      const float* p = prevOut ? prevOut + b * frameSize : nullptr;
+      float* o = output + b * frameSize;
+      for (size_t i = 0; i < frameSize; i += 16) {
+        __mmask16 m = block_mask_avx512(i, frameSize);
+        __m512 f = ActivationAvx512<NODE>::forward(load_avx512(fs + i, m));
+        __m512 prev = load_or_zero_avx512(p ? p + i : nullptr, m);
+        _mm512_mask_storeu_ps(fs + i, m, f);
+        _mm512_mask_storeu_ps(
+            o + i,
+            m,
+            _mm512_fmadd_ps(
+                load_avx512(u + i, m), _mm512_sub_ps(f, prev), prev));
+      }
+    }
+  }
+};
+
+void gru_final_output_avx512(float* gate,
+                                    const float* prevOut,
+                                    float* output,
+                                    size_t frameSize,
+                                    size_t batchSize,
+                                    Activation activeNode) {
+  ActivationDispatch<GruFinalOutputAvx512, 1>::run(
+      &activeNode, gate, prevOut, output, frameSize, batchSize);
+}
+
+struct GruStateGradAvx512 {
+  template <int NODE>
+  static void run(const float* gate,
+                  float* gateGrad,
+                  const float* prevOut,
+                  float* prevOutGrad,
+                  const float* outputGrad,
+                  size_t frameSize,
+                  size_t batchSize) {
+    for (size_t b = 0; b < batchSize; ++b) {
+      const float* g = gate + b * frameSize * 3;
+      float* gg = gateGrad + b * frameSize * 3;
+      const float* p = prevOut ? prevOut + b * frameSize : nullptr;
+      float* pg = prevOutGrad ? prevOutGrad + b * frameSize : nullptr;
+      const float* og = outputGrad + b * frameSize;
+      for (size_t i = 0; i < frameSize; i += 16) {
+        __mmask16 m = block_mask_avx512(i, frameSize);
+        __m512 u = load_avx512(g + i, m);
+        __m512 fs = load_avx512(g + frameSize * 2 + i, m);
+        __m512 prev = load_or_zero_avx512(p ? p + i : nullptr, m);
+        __m512 outGrad = load_avx512(og + i, m);
+        _mm512_mask_storeu_ps(
+            gg + i, m, _mm512_mul_ps(outGrad, _mm512_sub_ps(fs, prev)));
+        if (pg) {
+          __m512 prevGrad = _mm512_add_ps(
+              _mm512_fnmadd_ps(outGrad, u, load_avx512(pg + i, m)), outGrad);
+          _mm512_mask_storeu_ps(pg + i, m, prevGrad);
+        }
+        _mm512_mask_storeu_ps(
+            gg + frameSize * 2 + i,
+            m,
+            ActivationAvx512<NODE>::backward(_mm512_mul_ps(outGrad, u), fs));
+      }
+    }
+  }
+};
+
+void gru_state_grad_avx512(const float* gate,
+                                  float* gateGrad,
+                                  const float* prevOut,
+                                  float* prevOutGrad,
+                                  const float* outputGrad,
+                                  size_t frameSize,
+                                  size_t batchSize,
+                                  Activation activeNode) {
+  ActivationDispatch<GruStateGradAvx512, 1>::run(&activeNode,
+                                                 gate,
+                                                 gateGrad,
+                                                 prevOut,
+                                                 prevOutGrad,
+                                                 outputGrad,
+                                                 frameSize,
+                                                 batchSize);
+}
+
+void gru_reset_grad_avx512(const float* gate,
+                                  float* gateGrad,
+                                  const float* prevOut,
+                                  float* prevOutGrad,
+                                  const float* resetOutputGrad,
+                                  size_t frameSize,
+                                  size_t batchSize) {
+  for (size_t b = 0; b < batchSize; ++b) {
+    const float* g = gate + b * frameSize * 3;
+    float* gg = gateGrad + b * frameSize * 3;
+    const float* p = prevOut ? prevOut + b * frameSize : nullptr;
+    float* pg = prevOutGrad ? prevOutGrad + b * frameSize : nullptr;
+    const float* rg = resetOutputGrad + b * frameSize;
+    for (size_t i = 0; i < frameSize; i += 16) {
+      __mmask16 m = block_mask_avx512(i, frameSize);
+      __m512 u = load_avx512(g + i, m);
+      __m512 r = load_avx512(g + frameSize + i, m);
+      __m512 rGrad = _mm512_setzero_ps();
+      if (p && pg) {
+        __m512 resetGrad = load_avx512(rg + i, m);
+        rGrad = _mm512_mul_ps(resetGrad, load_avx512(p + i, m));
+        _mm512_mask_storeu_ps(
+            pg + i, m, _mm512_fmadd_ps(resetGrad, r, load_avx512(pg + i, m)));
+      }
+      _mm512_mask_storeu_ps(
+          gg + i, m, GateAvx512::backward(load_avx512(gg + i, m), u));
+      _mm512_mask_storeu_ps(
+          gg + frameSize + i, m, GateAvx512::backward(rGrad, r));
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace simd
+}  // namespace paddle
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // PADDLE_SIMD_DISPATCH
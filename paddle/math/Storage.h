@@ -18,9 +18,12 @@ limitations under the License. */
 #include <vector>
 #include "PoolAllocator.h"
 #include "paddle/utils/Locks.h"
+#include "paddle/utils/ThreadLocal.h"
 
 namespace paddle {
 
+class MemoryArena;
+
 /**
  * @brief Storage manager for multiple devices.
  */
@@ -41,12 +44,26 @@ public:
    */
   PoolAllocator* getCpuAllocator();
 
+  /**
+   * @return the arena bound to the calling thread, or nullptr.
+   *
+   * Temporary cpu matrices (Matrix::create(..., tmp = true)) are allocated
+   * from it.
+   */
+  MemoryArena* getCpuArena() { return *cpuArena_; }
+
+  /**
+   * @brief Bind arena to the calling thread, nullptr unbinds.
+   */
+  void setCpuArena(MemoryArena* arena) { *cpuArena_ = arena; }
+
 protected:
   StorageEngine();
   ~StorageEngine();
   RWLock lock_;
   std::vector<PoolAllocator*> gpuAllocator_;
   PoolAllocator* cpuAllocator_;
+  ThreadLocal<MemoryArena*> cpuArena_;
 };
 
 }  // namespace paddle
@@ -38,6 +38,15 @@ public:
   INLINE size_t getHeight() const { return height_; }
   INLINE bool isContiguous() const { return stride_ == width_ || height_ == 1; }
   INLINE bool useGpu() const { return useGpu_; }
+  /// Whether some element read is at another position of the view (data,
+  /// stride) of the same shape. Reading the same view is not an overlap.
+  INLINE bool overlaps(const T* data, size_t stride) const {
+    if (height_ == 0 || (data == data_ && stride == stride_)) {
+      return false;
+    }
+    return data_ < data + (height_ - 1) * stride + width_ &&
+           data < data_ + (height_ - 1) * stride_ + width_;
+  }
 
   T* data_;
   size_t stride_;
@@ -67,6 +76,15 @@ public:
   INLINE size_t getHeight() const { return height_; }
   INLINE bool isContiguous() const { return stride_ == width_ || height_ == 1; }
   INLINE bool useGpu() const { return useGpu_; }
+  /// Whether some element read is at another position of the view (data,
+  /// stride) of the same shape. Reading the same view is not an overlap.
+  INLINE bool overlaps(const T* data, size_t stride) const {
+    if (height_ == 0 || (data == data_ && stride == stride_)) {
+      return false;
+    }
+    return data_ < data + (height_ - 1) * stride + width_ &&
+           data < data_ + (height_ - 1) * stride_ + width_;
+  }
 
   const T* data_;
   size_t stride_;
@@ -88,6 +106,9 @@ public:
   INLINE size_t getHeight() const { return expr_.getHeight(); }
   INLINE bool isContiguous() const { return expr_.isContiguous(); }
   INLINE bool useGpu() const { return expr_.useGpu(); }
+  INLINE bool overlaps(const T* data, size_t stride) const {
+    return expr_.overlaps(data, stride);
+  }
 
   TensorApply<const Derived, T> expr_;
 };
@@ -108,6 +129,9 @@ public:
   INLINE size_t getHeight() const { return expr_.getHeight(); }
   INLINE bool isContiguous() const { return expr_.isContiguous(); }
   INLINE bool useGpu() const { return expr_.useGpu(); }
+  INLINE bool overlaps(const T* data, size_t stride) const {
+    return expr_.overlaps(data, stride);
+  }
 
   const OP op_;
   TensorApply<ArgType, T> expr_;
@@ -142,6 +166,9 @@ public:
     return lhs_.isContiguous() && rhs_.isContiguous();
   }
   INLINE bool useGpu() const { return lhs_.useGpu(); }
+  INLINE bool overlaps(const T* data, size_t stride) const {
+    return lhs_.overlaps(data, stride) || rhs_.overlaps(data, stride);
+  }
 
   const OP op_;
   TensorApply<LhsType, T> lhs_;
@@ -181,6 +208,10 @@ public:
            expr3_.isContiguous();
   }
   INLINE bool useGpu() const { return expr1_.useGpu(); }
+  INLINE bool overlaps(const T* data, size_t stride) const {
+    return expr1_.overlaps(data, stride) || expr2_.overlaps(data, stride) ||
+           expr3_.overlaps(data, stride);
+  }
 
   TensorApply<ArgType1, T> expr1_;
   TensorApply<ArgType2, T> expr2_;
@@ -203,6 +234,7 @@ public:
   INLINE size_t getHeight() const { return expr_.getHeight(); }
   INLINE bool isContiguous() const { return true; }
   INLINE bool useGpu() const { return expr_.useGpu(); }
+  INLINE bool overlaps(const T* data, size_t stride) const { return false; }
 
   const OP op_;
   TensorApply<ArgType, T> expr_;
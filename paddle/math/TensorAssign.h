@@ -48,6 +48,13 @@ public:
     return lhs_.isContiguous() && rhs_.isContiguous();
   }
   INLINE bool useGpu() const { return lhs_.useGpu(); }
+  /// Whether the elements read or written overlap the view (data, stride)
+  /// other than as the same view, see TensorApply::overlaps().
+  INLINE bool overlaps(const T* data, size_t stride) const {
+    return lhs_.overlaps(data, stride) || rhs_.overlaps(data, stride);
+  }
+  INLINE const T* getData() const { return lhs_.data_; }
+  INLINE size_t getStride() const { return lhs_.stride_; }
 
 private:
   TensorApply<LhsType, T> lhs_;
@@ -58,21 +65,38 @@ template <typename Assign, typename... AssignOp>
 void AssignCpuEvaluate(int height,
                        int width,
                        bool isContiguous,
+                       bool isOverlapping,
                        Assign&& assign,
                        AssignOp&&... args) {
-  if (isContiguous) {
-    int size = height * width;
-    for (int index = 0; index < size; index++) {
-      assign.apply(index);
-      __attribute__((unused)) int dummy[] = {(((args)).apply(index), 0)...};
-    }
-  } else {
+  if (isOverlapping) {
+    // some element read or written is written by an assignment at another
+    // position, so the loop keeps its order on the calling thread.
     for (int i = 0; i < height; i++) {
       for (int j = 0; j < width; j++) {
         assign.apply(i, j);
         __attribute__((unused)) int dummy[] = {(((args)).apply(i, j), 0)...};
       }
     }
+  } else if (isContiguous) {
+    int size = height * width;
+    tensorCpuParallelFor(
+        size, 1, kTensorCpuGrain, [&](size_t begin, size_t end) {
+          for (int index = begin; index < (int)end; index++) {
+            assign.apply(index);
+            __attribute__((unused)) int dummy[] = {
+                (((args)).apply(index), 0)...};
+          }
+        });
+  } else {
+    tensorCpuParallelFor(height, width, 1, [&](size_t begin, size_t end) {
+      for (int i = begin; i < (int)end; i++) {
+        for (int j = 0; j < width; j++) {
+          assign.apply(i, j);
+          __attribute__((unused)) int dummy[] = {
+              (((args)).apply(i, j), 0)...};
+        }
+      }
+    });
   }
 }
 
@@ -151,7 +175,20 @@ void AssignEvaluate(Assign&& assign, AssignOp&&... args) {
     CHECK_SYNC("AssignEvaluate failed");
 #endif
   } else {
-    AssignCpuEvaluate(height, width, isContiguous_, assign, args...);
+    decltype(assign.getData()) packData[] = {assign.getData(),
+                                             ((args)).getData()...};
+    const size_t packStride[] = {assign.getStride(), ((args)).getStride()...};
+    bool isOverlapping = false;
+    for (int i = 0; i <= packSize && !isOverlapping; i++) {
+      const bool packOverlaps[] = {
+          ((args)).overlaps(packData[i], packStride[i])...};
+      isOverlapping = assign.overlaps(packData[i], packStride[i]);
+      for (int k = 0; k < packSize; k++) {
+        isOverlapping = isOverlapping || packOverlaps[k];
+      }
+    }
+    AssignCpuEvaluate(
+        height, width, isContiguous_, isOverlapping, assign, args...);
   }
 }
 
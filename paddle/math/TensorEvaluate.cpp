@@ -0,0 +1,69 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "TensorExpression.h"
+#include <memory>
+#include "paddle/utils/Flags.h"
+#include "paddle/utils/Thread.h"
+#include "paddle/utils/ThreadLocal.h"
+
+DEFINE_int32(tensor_apply_threads,
+             1,
+             "Number of threads used by one cpu elementwise apply of a "
+             "tensor expression or a BaseMatrix op, and by one cpu "
+             "transpose. Every thread doing an apply gets its own pool of "
+             "threads.");
+
+namespace paddle {
+
+namespace {
+/// Below this many elements an apply is not split across threads.
+const size_t kMinParallelElements = 1 << 16;
+
+ThreadLocal<std::unique_ptr<SyncThreadPool>> applyThreadPool;
+}  // namespace
+
+void tensorCpuParallelFor(size_t numItems,
+                          size_t itemSize,
+                          size_t grain,
+                          const std::function<void(size_t, size_t)>& job) {
+  CHECK_GT(grain, 0UL);
+  size_t numGrains = (numItems + grain - 1) / grain;
+  if (FLAGS_tensor_apply_threads <= 1 || numGrains < 2 ||
+      numItems * itemSize < kMinParallelElements) {
+    job(0, numItems);
+    return;
+  }
+
+  std::unique_ptr<SyncThreadPool>& pool = *applyThreadPool;
+  if (!pool ||
+      pool->getNumThreads() + 1 != (size_t)FLAGS_tensor_apply_threads) {
+    pool.reset(new SyncThreadPool(FLAGS_tensor_apply_threads - 1));
+  }
+  size_t numParts = std::min(pool->getNumThreads() + 1, numGrains);
+
+  pool->execPlusOwner([&](int tid, size_t numThreads) {
+    (void)numThreads;
+    if ((size_t)tid >= numParts) {
+      return;
+    }
+    size_t begin = numGrains * tid / numParts * grain;
+    size_t end = std::min(numGrains * (tid + 1) / numParts * grain, numItems);
+    if (begin < end) {
+      job(begin, end);
+    }
+  });
+}
+
+}  // namespace paddle
@@ -15,11 +15,39 @@ limitations under the License. */
 #pragma once
 
 #include <algorithm>
+#include <functional>
 #include "hl_base.h"
 #include "paddle/utils/Logging.h"
 
 namespace paddle {
 
+/**
+ * \brief Tells the compiler that the iterations of an elementwise loop are
+ * independent, so that it vectorizes them although the destination could
+ * alias the pointers held by the evaluators. Only for loops whose rhs does
+ * not overlap the lhs, see TensorApply::overlaps().
+ */
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__NVCC__)
+#define TENSOR_CPU_IVDEP _Pragma("GCC ivdep")
+#else
+#define TENSOR_CPU_IVDEP
+#endif
+
+/**
+ * \brief Split [0, numItems) into contiguous ranges whose bounds are
+ * multiples of grain and run job(begin, end) on them. The ranges run on the
+ * pool of the calling thread when --tensor_apply_threads > 1 and the
+ * numItems * itemSize elements are enough to pay for it, otherwise
+ * job(0, numItems) runs on the calling thread.
+ */
+void tensorCpuParallelFor(size_t numItems,
+                          size_t itemSize,
+                          size_t grain,
+                          const std::function<void(size_t, size_t)>& job);
+
+/// Contiguous ranges are split at multiples of a cache line of elements.
+const size_t kTensorCpuGrain = 16;
+
 /**
  * \brief The tensor cpu evaluate api.
  */
@@ -33,17 +61,32 @@ inline void TensorCpuApply(LeftType& lhs, const RightType& rhs) {
 
   int height = lhs_.getHeight();
   int width = lhs_.getWidth();
-  if (lhs_.isContiguous() && rhs_.isContiguous()) {
-    int size = height * width;
-    for (int index = 0; index < size; index++) {
-      lhs_.applyRef(index) = rhs_.apply(index);
-    }
-  } else {
+  if (rhs_.overlaps(lhs_.data_, lhs_.stride_)) {
+    // rhs reads elements which an earlier iteration may have written, so
+    // the loop keeps its order: neither ivdep nor split across threads.
     for (int i = 0; i < height; i++) {
       for (int j = 0; j < width; j++) {
         lhs_.applyRef(i, j) = rhs_.apply(i, j);
       }
     }
+  } else if (lhs_.isContiguous() && rhs_.isContiguous()) {
+    int size = height * width;
+    tensorCpuParallelFor(
+        size, 1, kTensorCpuGrain, [&](size_t begin, size_t end) {
+          TENSOR_CPU_IVDEP
+          for (int index = begin; index < (int)end; index++) {
+            lhs_.applyRef(index) = rhs_.apply(index);
+          }
+        });
+  } else {
+    tensorCpuParallelFor(height, width, 1, [&](size_t begin, size_t end) {
+      for (int i = begin; i < (int)end; i++) {
+        TENSOR_CPU_IVDEP
+        for (int j = 0; j < width; j++) {
+          lhs_.applyRef(i, j) = rhs_.apply(i, j);
+        }
+      }
+    });
   }
 }
 
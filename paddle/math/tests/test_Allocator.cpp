@@ -13,19 +13,32 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include <gtest/gtest.h>
+#include <future>
+#include <thread>
 #include "paddle/utils/Logging.h"
 #include "paddle/utils/Util.h"
 #define private public
 #include "paddle/math/Allocator.h"
+#include "paddle/math/Matrix.h"
+#include "paddle/math/MemoryArena.h"
 #include "paddle/math/MemoryHandle.h"
 #include "paddle/math/PoolAllocator.h"
+#include "paddle/math/Storage.h"
 
 using namespace paddle;  // NOLINT
 
 template <typename Allocator>
 void testPoolAllocator() {
   PoolAllocator* pool =
-      new PoolAllocator(new Allocator(), /* sizeLimit */ 1024);
+      new PoolAllocator(new Allocator(), /* sizeLimit */ 1 << 20);
+  auto sizeClass = PoolAllocator::sizeClass;
+  constexpr size_t half = PoolAllocator::kMagazineSize / 2;
+
+  /* requests of similar sizes share one size class */
+  EXPECT_EQ(sizeClass(1), sizeClass(10));
+  EXPECT_EQ(sizeClass(210), sizeClass(200));
+  EXPECT_LE((size_t)200, sizeClass(200));
+  EXPECT_GT((size_t)250, sizeClass(200));
 
   /* alloc from system memory */
   void* ptr1 = pool->alloc(10);
@@ -35,33 +48,81 @@ void testPoolAllocator() {
   pool->free(ptr2, 200);
   pool->free(ptr3, 200);
   pool->printAll();
-  EXPECT_EQ((size_t)2, pool->pool_.size());
-  EXPECT_EQ((size_t)1, pool->pool_[10].size());
-  EXPECT_EQ((size_t)2, pool->pool_[200].size());
-  EXPECT_EQ(ptr1, pool->pool_[10][0]);
-  EXPECT_EQ(ptr2, pool->pool_[200][0]);
-  EXPECT_EQ(ptr3, pool->pool_[200][1]);
+  auto& magazines = pool->threadCache()->magazines;
+  EXPECT_EQ((size_t)1, magazines[sizeClass(10)].size());
+  EXPECT_EQ((size_t)2, magazines[sizeClass(200)].size());
+  EXPECT_EQ((size_t)0, pool->pool_.size());
+  EXPECT_EQ((size_t)0, pool->poolMemorySize_);
 
-  /* alloc from pool */
-  void* ptr4 = pool->alloc(10);
-  void* ptr5 = pool->alloc(200);
-  pool->printAll();
-  EXPECT_EQ((size_t)0, pool->pool_[10].size());
-  EXPECT_EQ((size_t)1, pool->pool_[200].size());
+  /* alloc from the thread cache, any size of the same class */
+  void* ptr4 = pool->alloc(8);
+  void* ptr5 = pool->alloc(210);
+  EXPECT_EQ((size_t)0, magazines[sizeClass(10)].size());
+  EXPECT_EQ((size_t)1, magazines[sizeClass(200)].size());
   EXPECT_EQ(ptr1, ptr4);
   EXPECT_EQ(ptr3, ptr5);
-  pool->free(ptr4, 10);
-  pool->free(ptr5, 200);
-
-  /* alloc size > sizeLimit */
-  void* ptr6 = pool->alloc(1024);
-  pool->free(ptr6, 1024);
-  EXPECT_LE((size_t)1024, pool->poolMemorySize_);
+  pool->free(ptr4, 8);
+  pool->free(ptr5, 210);
 
-  void* ptr7 = pool->alloc(1);
+  /* a full magazine is flushed to the shared pool in a batch */
+  std::vector<void*> bufs;
+  for (size_t i = 0; i <= PoolAllocator::kMagazineSize; ++i) {
+    bufs.push_back(pool->alloc(1000));
+  }
+  for (auto buf : bufs) {
+    pool->free(buf, 1000);
+  }
+  EXPECT_EQ(half, pool->pool_[sizeClass(1000)].size());
+  EXPECT_EQ(half + 1, magazines[sizeClass(1000)].size());
+
+  /* another thread refills from the shared pool and returns its cache */
+  std::thread([&]() {
+    void* ptr = pool->alloc(1000);
+    EXPECT_EQ(bufs[half - 1], ptr);
+    EXPECT_EQ((size_t)0, pool->pool_[sizeClass(1000)].size());
+    pool->free(ptr, 1000);
+  }).join();
+  EXPECT_EQ(half, pool->pool_[sizeClass(1000)].size());
+
+  /* large buffers bypass the thread cache */
+  size_t large = PoolAllocator::kMaxThreadCacheSize + 1;
+  void* ptr6 = pool->alloc(large);
+  pool->free(ptr6, large);
+  EXPECT_EQ((size_t)1, pool->pool_[sizeClass(large)].size());
+  EXPECT_LE((size_t)(1 << 20), pool->poolMemorySize_);
+
+  /* a miss over sizeLimit releases the shared pool and the magazines */
+  void* ptr7 = pool->alloc(3000);
   EXPECT_EQ((size_t)0, pool->poolMemorySize_);
   EXPECT_EQ((size_t)0, pool->pool_.size());
-  pool->free(ptr7, 1);
+  EXPECT_EQ((size_t)0, pool->threadCacheMemorySize_);
+  EXPECT_EQ((size_t)0, magazines[sizeClass(1000)].size());
+  pool->free(ptr7, 3000);
+
+  delete pool;
+
+  /* the magazines of a running thread count against sizeLimit, and are
+     released by a miss of another thread */
+  pool = new PoolAllocator(new Allocator(), /* sizeLimit */ 4096);
+  std::promise<void> cached;
+  std::promise<void> released;
+  std::thread thread([&]() {
+    void* ptr8 = pool->alloc(2048);
+    void* ptr9 = pool->alloc(2048);
+    pool->free(ptr8, 2048);
+    pool->free(ptr9, 2048);
+    cached.set_value();
+    released.get_future().wait();
+    EXPECT_EQ((size_t)0, pool->threadCache()->magazines[2048].size());
+  });
+  cached.get_future().wait();
+  EXPECT_EQ((size_t)4096, pool->threadCacheMemorySize_);
+  EXPECT_EQ((size_t)0, pool->poolMemorySize_);
+  void* ptr10 = pool->alloc(100);
+  EXPECT_EQ((size_t)0, pool->threadCacheMemorySize_);
+  released.set_value();
+  thread.join();
+  pool->free(ptr10, 100);
 
   delete pool;
 }
@@ -92,6 +153,59 @@ TEST(MemoryHandle, Cpu) {
   EXPECT_EQ(ptr1, ptr2);
 }
 
+TEST(MemoryArena, Cpu) {
+  MemoryArena arena(1024);
+  EXPECT_EQ((size_t)1024, arena.getCapacity());
+
+  /* blocks are aligned and carved out of one chunk */
+  char* ptr1 = static_cast<char*>(arena.alloc(10));
+  char* ptr2 = static_cast<char*>(arena.alloc(100));
+  EXPECT_EQ(0UL, reinterpret_cast<size_t>(ptr1) % MemoryArena::kAlignment);
+  EXPECT_EQ(ptr1 + MemoryArena::kAlignment, ptr2);
+  EXPECT_EQ(MemoryArena::kAlignment * 5, arena.getUsedSize());
+
+  /* the arena grows beyond the first chunk */
+  arena.alloc(2000);
+  EXPECT_EQ(MemoryArena::kAlignment * 5 + 2016, arena.getUsedSize());
+  EXPECT_LT((size_t)1024, arena.getCapacity());
+
+  /* reset merges the chunks and rewinds */
+  size_t capacity = arena.getCapacity();
+  arena.reset();
+  EXPECT_EQ((size_t)1, arena.chunks_.size());
+  EXPECT_EQ(capacity, arena.getCapacity());
+  EXPECT_EQ((size_t)0, arena.getUsedSize());
+  EXPECT_EQ(MemoryArena::kAlignment * 5 + 2016, arena.getPeakSize());
+
+  /* the merged chunk is reused by the next batch */
+  ptr1 = static_cast<char*>(arena.alloc(10));
+  arena.alloc(2000);
+  arena.reset();
+  EXPECT_EQ((size_t)1, arena.chunks_.size());
+  EXPECT_EQ(ptr1, arena.alloc(10));
+}
+
+TEST(MemoryArena, TmpMatrix) {
+  MemoryArena arena;
+  /* without a bound arena temporaries come from the pool */
+  MatrixPtr mat = Matrix::create(10, 20, false, false, /* tmp= */ true);
+  EXPECT_EQ(nullptr, std::dynamic_pointer_cast<ArenaMemoryHandle>(
+                         mat->getMemoryHandle()));
+
+  StorageEngine::singleton()->setCpuArena(&arena);
+  mat = Matrix::create(10, 20, false, false, /* tmp= */ true);
+  EXPECT_NE(nullptr, std::dynamic_pointer_cast<ArenaMemoryHandle>(
+                         mat->getMemoryHandle()));
+  EXPECT_EQ(10 * 20 * sizeof(real), arena.getUsedSize());
+  MatrixPtr notTmp = Matrix::create(10, 20, false, false);
+  EXPECT_EQ(10 * 20 * sizeof(real), arena.getUsedSize());
+  StorageEngine::singleton()->setCpuArena(nullptr);
+
+  mat.reset();
+  arena.reset();
+  EXPECT_EQ(10 * 20 * sizeof(real), arena.getPeakSize());
+}
+
 #ifndef PADDLE_ONLY_CPU
 TEST(MemoryHandle, Gpu) {
   int numGpu = hl_get_device_count();
@@ -0,0 +1,175 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+/**
+ * The cpu elementwise applies of tensor expressions, lazyAssign and
+ * BaseMatrix ops with --tensor_apply_threads > 1 are compared with the
+ * single thread ones, and timed on a 512 x 4096 activation.
+ */
+
+#include <gtest/gtest.h>
+#include "PerfUtils.h"
+#include "TensorCheck.h"
+#include "paddle/math/Matrix.h"
+#include "paddle/math/TensorAssign.h"
+
+using paddle::CpuMatrix;
+using paddle::CpuMatrixPtr;
+using paddle::real;
+using autotest::TensorCheckEqual;
+
+DECLARE_int32(tensor_apply_threads);
+
+typedef std::function<void(CpuMatrix& a,
+                           CpuMatrix& b,
+                           CpuMatrix& c,
+                           CpuMatrix& d)>
+    ApplyFunc;
+
+void expressionApply(CpuMatrix& a, CpuMatrix& b, CpuMatrix& c, CpuMatrix& d) {
+  a = b * c + d;
+  a = (a > 0.5f).condition(a, b.sqrt());
+}
+
+void lazyAssignApply(CpuMatrix& a, CpuMatrix& b, CpuMatrix& c, CpuMatrix& d) {
+  auto expr1 = c.lazyAssign(c * 0.3f - d * (b + a * 0.5f) * 0.2f);
+  auto expr2 = a.lazyAssign(a + c);
+  AssignEvaluate(expr1, expr2);
+}
+
+void baseMatrixApply(CpuMatrix& a, CpuMatrix& b, CpuMatrix& c, CpuMatrix& d) {
+  a.sgdUpdate(b, c, d, 0.2f, 0.3f, 0.5f);
+  a.tanh(b);
+  CpuMatrix bias(1, a.getWidth());
+  for (size_t j = 0; j < a.getWidth(); ++j) {
+    bias.getData()[j] = 0.1f * (j % 7);
+  }
+  CpuMatrix scale(a.getHeight(), 1);
+  for (size_t i = 0; i < a.getHeight(); ++i) {
+    scale.getData()[i] = 0.2f * (i % 5);
+  }
+  b.addBias(bias, 0.5f);
+  c.mulRowVector(bias);
+  d.mulColVector(scale);
+  // accumulates into a column vector.
+  CpuMatrix error(a.getHeight(), 1);
+  error.zeroMem();
+  error.binaryClassificationError2(0, a, b, 0.5f);
+  d.addColVector(error);
+}
+
+void testApply(size_t height, size_t width, bool contiguous, ApplyFunc apply) {
+  // the sub matrices do not keep the memory of the full ones.
+  std::vector<CpuMatrixPtr> full, serial, parallel;
+  for (int i = 0; i < 4; ++i) {
+    size_t padding = contiguous ? 0 : 7;
+    full.push_back(std::make_shared<CpuMatrix>(height, width + padding));
+    full.back()->randomizeUniform();
+    serial.push_back(std::dynamic_pointer_cast<CpuMatrix>(
+        full.back()->subMatrix(0, height, padding, width + padding)));
+    full.push_back(std::make_shared<CpuMatrix>(height, width + padding));
+    full.back()->copyFrom(*full[full.size() - 2]);
+    parallel.push_back(std::dynamic_pointer_cast<CpuMatrix>(
+        full.back()->subMatrix(0, height, padding, width + padding)));
+  }
+
+  FLAGS_tensor_apply_threads = 1;
+  apply(*serial[0], *serial[1], *serial[2], *serial[3]);
+  FLAGS_tensor_apply_threads = 4;
+  apply(*parallel[0], *parallel[1], *parallel[2], *parallel[3]);
+  FLAGS_tensor_apply_threads = 1;
+  for (int i = 0; i < 4; ++i) {
+    TensorCheckEqual(*serial[i], *parallel[i]);
+  }
+}
+
+TEST(CpuParallelApply, compareSerial) {
+  for (auto height : {1, 7, 512}) {
+    for (auto width : {1, 33, 4096, 100000}) {
+      if (height * width > (1 << 22)) {
+        continue;
+      }
+      for (bool contiguous : {true, false}) {
+        VLOG(3) << height << " x " << width << " contiguous=" << contiguous;
+        testApply(height, width, contiguous, expressionApply);
+        testApply(height, width, contiguous, lazyAssignApply);
+        testApply(height, width, contiguous, baseMatrixApply);
+      }
+    }
+  }
+}
+
+TEST(CpuParallelApply, overlappingViews) {
+  // a[i + 1] = a[i] + 1 in order, which a vectorized or split loop would
+  // compute from the old values.
+  const size_t width = 4096;
+  CpuMatrix full(1, width + 1);
+  full.zeroMem();
+  CpuMatrix lhs(full.getData() + 1, 1, width);
+  CpuMatrix rhs(full.getData(), 1, width);
+  FLAGS_tensor_apply_threads = 4;
+  lhs = rhs + 1.0f;
+  FLAGS_tensor_apply_threads = 1;
+  for (size_t i = 0; i <= width; ++i) {
+    ASSERT_EQ(static_cast<real>(i), full.getData()[i]);
+  }
+
+  // an in place apply reads the same view, which is not an overlap.
+  typedef paddle::TensorApply<const CpuMatrix, real> Apply;
+  CpuMatrix a(7, 33);
+  EXPECT_FALSE(Apply(a).overlaps(a.getData(), a.getStride()));
+  EXPECT_TRUE(Apply(rhs).overlaps(lhs.getData(), lhs.getStride()));
+}
+
+TEST(CpuParallelApply, overlappingAssign) {
+  // the shifted apply of overlappingViews, as the second lazyAssign of an
+  // AssignEvaluate.
+  const size_t width = 4096;
+  CpuMatrix full(1, width + 1);
+  full.zeroMem();
+  CpuMatrix lhs(full.getData() + 1, 1, width);
+  CpuMatrix rhs(full.getData(), 1, width);
+  CpuMatrix c(1, width);
+  c.zeroMem();
+  auto expr1 = c.lazyAssign(c + 1.0f);
+  auto expr2 = lhs.lazyAssign(rhs + 1.0f);
+  FLAGS_tensor_apply_threads = 4;
+  AssignEvaluate(expr1, expr2);
+  FLAGS_tensor_apply_threads = 1;
+  for (size_t i = 0; i <= width; ++i) {
+    ASSERT_EQ(static_cast<real>(i), full.getData()[i]);
+  }
+  EXPECT_FALSE(expr1.overlaps(c.getData(), c.getStride()));
+  EXPECT_TRUE(expr2.overlaps(lhs.getData(), lhs.getStride()));
+  EXPECT_FALSE(expr1.overlaps(lhs.getData(), lhs.getStride()));
+}
+
+TEST(CpuParallelApply, benchmark) {
+  const size_t height = 512, width = 4096;
+  CpuMatrix a(height, width), b(height, width), c(height, width),
+      d(height, width);
+  a.randomizeUniform();
+  b.randomizeUniform();
+  c.randomizeUniform();
+  d.randomizeUniform();
+  for (auto threads : {1, 2, 4}) {
+    FLAGS_tensor_apply_threads = threads;
+    LOG(INFO) << "tensor_apply_threads=" << threads;
+    EXPRESSION_PERFORMANCE(a = b * c + d);
+    EXPRESSION_PERFORMANCE(lazyAssignApply(a, b, c, d));
+    EXPRESSION_PERFORMANCE(a.sgdUpdate(b, c, d, 0.2f, 0.3f, 0.5f));
+    EXPRESSION_PERFORMANCE(a.tanh(b));
+  }
+  FLAGS_tensor_apply_threads = 1;
+}
@@ -0,0 +1,313 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+/**
+ * BitCodeBatch is compared with a scalar walk over the code of every
+ * sample, for the complete tree, a Huffman tree and sparse row weights,
+ * and both are timed on a large vocabulary.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <set>
+#include "TensorCheck.h"
+#include "paddle/math/MatrixBitCode.h"
+#include "paddle/math/SparseRowMatrix.h"
+
+using namespace paddle;  // NOLINT
+using autotest::TensorCheckErr;
+
+/// The scalar code: every bit of every sample in turn.
+struct NaiveBitCode {
+  NaiveBitCode(const BitCodeTree& tree, const IVector& labels)
+      : length(tree.getMaxCodeLength()) {
+    for (size_t i = 0; i < labels.getSize(); ++i) {
+      std::vector<int> n(length);
+      std::vector<uint8_t> b(length);
+      n.resize(tree.getCode(labels.getData()[i], n.data(), b.data()));
+      nodes.push_back(n);
+      bits.push_back(b);
+    }
+  }
+
+  void forward(CpuMatrix& tmat,
+               CpuMatrix& weight,
+               CpuMatrix& bias,
+               CpuMatrix& input,
+               CpuMatrix& sum) {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      real s = 0;
+      for (size_t j = 0; j < nodes[i].size(); ++j) {
+        real& t = tmat.getData()[i * length + j];
+        t += bias.getData()[nodes[i][j]];
+        for (size_t k = 0; k < input.getWidth(); ++k) {
+          t += weight.getRow(nodes[i][j])[k] * input.getRow(i)[k];
+        }
+        s += bits[i][j] ? t : 0;
+      }
+      sum.getData()[i] = -s;
+    }
+  }
+
+  void backward(CpuMatrix& tmat,
+                CpuMatrix& weight,
+                CpuMatrix& weightGrad,
+                CpuMatrix& biasGrad,
+                CpuMatrix& input,
+                CpuMatrix& inputGrad) {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      for (size_t j = 0; j < nodes[i].size(); ++j) {
+        real& t = tmat.getData()[i * length + j];
+        t -= bits[i][j];
+        biasGrad.getData()[nodes[i][j]] += t;
+        for (size_t k = 0; k < input.getWidth(); ++k) {
+          weightGrad.getRow(nodes[i][j])[k] += t * input.getRow(i)[k];
+          inputGrad.getRow(i)[k] += t * weight.getRow(nodes[i][j])[k];
+        }
+      }
+    }
+  }
+
+  int length;
+  std::vector<std::vector<int>> nodes;
+  std::vector<std::vector<uint8_t>> bits;
+};
+
+IVectorPtr randomLabels(size_t batchSize, size_t numClasses) {
+  IVectorPtr labels = IVector::create(batchSize, false);
+  labels->rand(numClasses);
+  return labels;
+}
+
+void testTree(const BitCodeTree& tree, size_t batchSize, size_t dim) {
+  size_t numNodes = tree.getNumClasses() - 1;
+  int length = tree.getMaxCodeLength();
+  IVectorPtr labels = randomLabels(batchSize, tree.getNumClasses());
+  CpuMatrix weight(numNodes, dim), bias(1, numNodes), input(batchSize, dim);
+  weight.randomizeUniform();
+  bias.randomizeUniform();
+  input.randomizeUniform();
+
+  NaiveBitCode naive(tree, *labels);
+  CpuMatrix tmat1(batchSize, length), sum1(batchSize, 1);
+  tmat1.zeroMem();
+  naive.forward(tmat1, weight, bias, input, sum1);
+
+  BitCodeBatch codes;
+  codes.reset(tree, *labels);
+  CpuMatrix tmat2(batchSize, length), sum2(batchSize, 1);
+  tmat2.zeroMem();
+  codes.addByBitCode(tmat2, bias);
+  codes.mulByBitCode(tmat2, weight, input);
+  codes.sumByBitCode(tmat2, sum2, -1);
+  TensorCheckErr(tmat1, tmat2);
+  TensorCheckErr(sum1, sum2);
+
+  CpuMatrix weightGrad1(numNodes, dim), biasGrad1(1, numNodes);
+  CpuMatrix inputGrad1(batchSize, dim);
+  weightGrad1.zeroMem();
+  biasGrad1.zeroMem();
+  inputGrad1.zeroMem();
+  naive.backward(tmat1, weight, weightGrad1, biasGrad1, input, inputGrad1);
+
+  CpuMatrix weightGrad2(numNodes, dim), biasGrad2(1, numNodes);
+  CpuMatrix inputGrad2(batchSize, dim);
+  weightGrad2.zeroMem();
+  biasGrad2.zeroMem();
+  inputGrad2.zeroMem();
+  codes.subByBitCode(tmat2);
+  codes.addByBitCodeBackward(tmat2, biasGrad2);
+  codes.mulByBitCodeBackwardWeight(tmat2, weightGrad2, input);
+  codes.mulByBitCodeBackwardError(tmat2, weight, inputGrad2);
+  TensorCheckErr(tmat1, tmat2);
+  TensorCheckErr(biasGrad1, biasGrad2);
+  TensorCheckErr(weightGrad1, weightGrad2);
+  TensorCheckErr(inputGrad1, inputGrad2);
+
+  std::set<int> used;
+  for (auto& nodes : naive.nodes) {
+    used.insert(nodes.begin(), nodes.end());
+  }
+  EXPECT_EQ(std::vector<int>(used.begin(), used.end()), codes.getNodes());
+
+  // a sparse gradient receives the same rows.
+  if (codes.getNodes().size() * 2 > numNodes) return;
+  SparseAutoGrowRowCpuMatrix sparseGrad(numNodes, dim);
+  sparseGrad.zeroMem();
+  codes.mulByBitCodeBackwardWeight(tmat2, sparseGrad, input);
+  for (int node : codes.getNodes()) {
+    for (size_t k = 0; k < dim; ++k) {
+      EXPECT_NEAR(
+          weightGrad1.getRow(node)[k], sparseGrad.getRow(node)[k], 1e-3);
+    }
+  }
+}
+
+TEST(BitCode, completeTree) {
+  for (size_t numClasses : {2, 3, 7, 8, 100, 1025}) {
+    BitCodeTree tree(numClasses);
+    EXPECT_EQ(findLastSet(numClasses - 1), tree.getMaxCodeLength());
+    std::vector<int> nodes(tree.getMaxCodeLength());
+    std::vector<uint8_t> bits(tree.getMaxCodeLength());
+    for (size_t c = 0; c < numClasses; ++c) {
+      size_t code = c + numClasses;
+      int length = tree.getCode(c, nodes.data(), bits.data());
+      EXPECT_EQ(findLastSet(code) - 1, length);
+      for (int j = 0; j < length; ++j) {
+        EXPECT_EQ((int)(code >> (j + 1)) - 1, nodes[j]);
+        EXPECT_EQ((code & (1 << j)) != 0, bits[j] != 0);
+      }
+    }
+    for (size_t dim : {1, 13, 64}) {
+      testTree(tree, 50, dim);
+    }
+  }
+}
+
+/// Whether the codes are the paths of a binary tree, and their lengths.
+std::vector<int> checkTree(const BitCodeTree& tree) {
+  size_t numClasses = tree.getNumClasses();
+  std::vector<int> nodes(tree.getMaxCodeLength());
+  std::vector<uint8_t> bits(tree.getMaxCodeLength());
+  std::vector<int> lengths;
+  // the child of every (node, bit), which is a leaf or an internal node.
+  std::map<std::pair<int, int>, int> children;
+  for (size_t c = 0; c < numClasses; ++c) {
+    int length = tree.getCode(c, nodes.data(), bits.data());
+    lengths.push_back(length);
+    int child = -1 - (int)c;
+    for (int j = 0; j < length; ++j) {
+      auto key = std::make_pair(nodes[j], (int)bits[j]);
+      auto it = children.find(key);
+      if (j == 0) {
+        EXPECT_TRUE(it == children.end()) << "Two leaves share a place";
+      } else if (it != children.end()) {
+        EXPECT_EQ(it->second, child);
+      }
+      children[key] = child;
+      child = nodes[j];
+    }
+  }
+  // every internal node has two children.
+  EXPECT_EQ(2 * (numClasses - 1), children.size());
+  return lengths;
+}
+
+TEST(BitCode, huffman) {
+  std::vector<int64_t> counts;
+  for (int c = 0; c < 1000; ++c) {
+    counts.push_back(100000 / (c + 1) + c % 3);
+  }
+  BitCodeTreePtr tree = BitCodeTree::createHuffman(counts);
+  ASSERT_EQ(counts.size(), tree->getNumClasses());
+  std::vector<int> lengths = checkTree(*tree);
+  for (size_t c = 1; c < counts.size(); ++c) {
+    if (counts[c] < counts[c - 1]) {
+      EXPECT_LE(lengths[c - 1], lengths[c]);
+    }
+  }
+  EXPECT_LT(lengths.front(), findLastSet(counts.size() - 1));
+  testTree(*tree, 64, 31);
+
+  checkTree(*BitCodeTree::createHuffman({5, 5}));
+  checkTree(*BitCodeTree::createHuffman({1, 1, 1, 1, 1}));
+}
+
+TEST(BitCode, load) {
+  std::string path = "/tmp/test_MatrixBitCode_tree";
+  std::vector<int64_t> counts = {10, 3, 3, 7, 1, 25};
+  {
+    std::ofstream out(path);
+    for (auto count : counts) {
+      out << count << "\n";
+    }
+  }
+  BitCodeTreePtr huffman = BitCodeTree::createHuffman(counts);
+  BitCodeTreePtr loaded = BitCodeTree::load(path);
+  ASSERT_EQ(huffman->getNumClasses(), loaded->getNumClasses());
+  ASSERT_EQ(huffman->getMaxCodeLength(), loaded->getMaxCodeLength());
+  int length = huffman->getMaxCodeLength();
+  for (size_t c = 0; c < counts.size(); ++c) {
+    std::vector<int> nodes1(length), nodes2(length);
+    std::vector<uint8_t> bits1(length), bits2(length);
+    ASSERT_EQ(huffman->getCode(c, nodes1.data(), bits1.data()),
+              loaded->getCode(c, nodes2.data(), bits2.data()));
+    EXPECT_EQ(nodes1, nodes2);
+    EXPECT_EQ(bits1, bits2);
+  }
+
+  // a right comb of 4 classes: 0, 10, 110, 111 read from the root.
+  {
+    std::ofstream out(path);
+    out << "0 0\n1 0 0 1\n2 0 1 1 0 1\n2 1 1 1 0 1\n";
+  }
+  BitCodeTreePtr comb = BitCodeTree::load(path);
+  ASSERT_EQ(4UL, comb->getNumClasses());
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 3}), checkTree(*comb));
+  testTree(*comb, 20, 9);
+  remove(path.c_str());
+}
+
+/// Time the scalar walk of the codes against BitCodeBatch.
+TEST(BitCode, benchmark) {
+  const size_t numClasses = 100000, dim = 128, batchSize = 256;
+  BitCodeTree tree(numClasses);
+  CpuMatrix weight(numClasses - 1, dim), weightGrad(numClasses - 1, dim);
+  CpuMatrix bias(1, numClasses - 1), biasGrad(1, numClasses - 1);
+  CpuMatrix input(batchSize, dim), inputGrad(batchSize, dim);
+  CpuMatrix tmat(batchSize, tree.getMaxCodeLength()), sum(batchSize, 1);
+  weight.randomizeUniform();
+  bias.randomizeUniform();
+  input.randomizeUniform();
+  IVectorPtr labels = randomLabels(batchSize, numClasses);
+
+  double seconds[2];
+  for (int batched = 0; batched < 2; ++batched) {
+    auto start = std::chrono::steady_clock::now();
+    for (int iter = 0; iter < 10; ++iter) {
+      tmat.zeroMem();
+      if (batched) {
+        BitCodeBatch codes;
+        codes.reset(tree, *labels);
+        codes.addByBitCode(tmat, bias);
+        codes.mulByBitCode(tmat, weight, input);
+        codes.sumByBitCode(tmat, sum, -1);
+        codes.subByBitCode(tmat);
+        codes.addByBitCodeBackward(tmat, biasGrad);
+        codes.mulByBitCodeBackwardWeight(tmat, weightGrad, input);
+        codes.mulByBitCodeBackwardError(tmat, weight, inputGrad);
+      } else {
+        NaiveBitCode naive(tree, *labels);
+        naive.forward(tmat, weight, bias, input, sum);
+        naive.backward(tmat, weight, weightGrad, biasGrad, input, inputGrad);
+      }
+    }
+    seconds[batched] = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count() /
+                       10;
+  }
+  LOG(INFO) << "classes=" << numClasses << " dim=" << dim
+            << " batch=" << batchSize << " scalar=" << seconds[0] * 1e3
+            << "ms batched=" << seconds[1] * 1e3 << "ms";
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  initMain(argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+/**
+ * CpuMatrix::mul by a weight packed with packForMul() is compared with the
+ * cblas gemm, and both are timed over the small batches of inference.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include "TensorCheck.h"
+#include "paddle/math/Matrix.h"
+
+using paddle::CpuMatrix;
+using paddle::MatrixPtr;
+using autotest::TensorCheckErr;
+
+DECLARE_int32(tensor_apply_threads);
+
+void testPackedMul(size_t batchSize, size_t K, size_t N, bool transW) {
+  CpuMatrix input(batchSize, K);
+  input.randomizeUniform();
+  CpuMatrix w(transW ? N : K, transW ? K : N);
+  w.randomizeUniform();
+  MatrixPtr weight =
+      transW ? w.getTranspose() : CpuMatrix::create(w.getData(), K, N);
+  CpuMatrix& cpuWeight = static_cast<CpuMatrix&>(*weight);
+
+  CpuMatrix expected(batchSize, N), out(batchSize, N);
+  expected.randomizeUniform();
+  out.copyFrom(expected);
+  expected.mul(input, *weight, 1.0, 0.5);
+  cpuWeight.packForMul();
+  ASSERT_TRUE(cpuWeight.isPackedForMul());
+  out.mul(input, *weight, 1.0, 0.5);
+  TensorCheckErr(expected, out);
+
+  // the pack is a copy; it follows the weight only when packed again.
+  w.mulScalar(2.0);
+  cpuWeight.releasePackedForMul();
+  EXPECT_FALSE(cpuWeight.isPackedForMul());
+  expected.mul(input, *weight, 1.0, 0);
+  cpuWeight.packForMul();
+  out.mul(input, *weight, 1.0, 0);
+  TensorCheckErr(expected, out);
+}
+
+TEST(PackedGemm, compareCblas) {
+  for (auto threads : {1, 4}) {
+    FLAGS_tensor_apply_threads = threads;
+    for (auto batchSize : {1, 3, 8, 32, 100}) {
+      for (auto K : {1, 64, 300}) {
+        for (auto N : {1, 16, 33, 1000}) {
+          for (bool transW : {false, true}) {
+            VLOG(3) << batchSize << " x " << K << " x " << N
+                    << " transW=" << transW;
+            testPackedMul(batchSize, K, N, transW);
+          }
+        }
+      }
+    }
+  }
+  FLAGS_tensor_apply_threads = 1;
+}
+
+TEST(PackedGemm, benchmark) {
+  const size_t K = 1024, N = 1024;
+  CpuMatrix weight(K, N);
+  weight.randomizeUniform();
+  for (auto batchSize : {1, 2, 4, 8, 16, 32}) {
+    CpuMatrix input(batchSize, K), out(batchSize, N);
+    input.randomizeUniform();
+    double seconds[2];
+    for (bool packed : {false, true}) {
+      if (packed) {
+        weight.packForMul();
+      } else {
+        weight.releasePackedForMul();
+      }
+      out.mul(input, weight, 1.0, 0);
+      const int repeat = 50;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < repeat; ++i) {
+        out.mul(input, weight, 1.0, 0);
+      }
+      seconds[packed] = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count() /
+                        repeat;
+    }
+    LOG(INFO) << "batch=" << batchSize << " cblas=" << seconds[0] * 1e3
+              << "ms packed=" << seconds[1] * 1e3 << "ms GFLOPS cblas="
+              << 2.0 * batchSize * K * N / seconds[0] * 1e-9
+              << " packed=" << 2.0 * batchSize * K * N / seconds[1] * 1e-9;
+  }
+  weight.releasePackedForMul();
+}
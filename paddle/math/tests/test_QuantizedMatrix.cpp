@@ -0,0 +1,133 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+/**
+ * QuantizedMatrix::mul is compared with CpuMatrix::mul, exactly on values
+ * that int8 represents and within the rounding error otherwise, and both
+ * are timed over the small batches of inference.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include "TensorCheck.h"
+#include "paddle/math/QuantizedMatrix.h"
+
+using namespace paddle;  // NOLINT
+
+DECLARE_int32(tensor_apply_threads);
+
+#ifndef PADDLE_TYPE_DOUBLE
+
+/// Integers in [-127, 127], with 127 in every row, or every column.
+void randomInt8Values(CpuMatrix& mat, bool perRow) {
+  std::uniform_int_distribution<int> dist(-127, 127);
+  auto& eng = ThreadLocalRandomEngine::get();
+  for (size_t i = 0; i < mat.getHeight(); ++i) {
+    for (size_t j = 0; j < mat.getWidth(); ++j) {
+      mat.getData()[i * mat.getStride() + j] = dist(eng);
+    }
+  }
+  size_t n = perRow ? mat.getHeight() : mat.getWidth();
+  for (size_t i = 0; i < n; ++i) {
+    size_t j = i % (perRow ? mat.getWidth() : mat.getHeight());
+    mat.getData()[perRow ? i * mat.getStride() + j
+                         : j * mat.getStride() + i] = 127;
+  }
+}
+
+void testExact(size_t M, size_t K, size_t N, bool trans) {
+  CpuMatrix input(M, K);
+  randomInt8Values(input, true);
+  CpuMatrix w(trans ? N : K, trans ? K : N);
+  randomInt8Values(w, trans);
+  CpuMatrix bias(1, N);
+  bias.randomizeUniform();
+
+  QuantizedMatrix quantized(w.getData(), w.getStride(), trans, K, N);
+  CpuMatrix expected(M, N), out(M, N);
+  expected.randomizeUniform();
+  out.copyFrom(expected);
+  MatrixPtr weight =
+      trans ? w.getTranspose() : CpuMatrix::create(w.getData(), K, N);
+  expected.mul(input, *weight, 1, 0.5);
+  expected.addBias(bias, 1);
+  quantized.mul(out, input, &bias, 0.5);
+  autotest::TensorCheckErr(expected, out);
+}
+
+TEST(QuantizedMatrix, exact) {
+  for (auto threads : {1, 4}) {
+    FLAGS_tensor_apply_threads = threads;
+    for (auto M : {1, 3, 8, 33}) {
+      for (auto K : {1, 5, 64, 130}) {
+        for (auto N : {1, 16, 37, 300}) {
+          for (bool trans : {false, true}) {
+            testExact(M, K, N, trans);
+          }
+        }
+      }
+    }
+  }
+  FLAGS_tensor_apply_threads = 1;
+}
+
+TEST(QuantizedMatrix, roundingError) {
+  const size_t M = 16, K = 512, N = 256;
+  CpuMatrix input(M, K), weight(K, N), expected(M, N), out(M, N);
+  input.randomizeUniform();
+  input.add(-0.5);
+  weight.randomizeUniform();
+  weight.add(-0.5);
+  expected.mul(input, weight, 1, 0);
+  QuantizedMatrix quantized(weight.getData(), N, false, K, N);
+  quantized.mul(out, input, nullptr, 0);
+  double err = 0, norm = 0;
+  for (size_t i = 0; i < M * N; ++i) {
+    err += std::pow(out.getData()[i] - expected.getData()[i], 2);
+    norm += std::pow(expected.getData()[i], 2);
+  }
+  EXPECT_LT(std::sqrt(err / norm), 0.01);
+}
+
+TEST(QuantizedMatrix, benchmark) {
+  const size_t K = 1024, N = 1024;
+  CpuMatrix weight(K, N);
+  weight.randomizeUniform();
+  QuantizedMatrix quantized(weight.getData(), N, false, K, N);
+  for (auto batchSize : {1, 4, 16, 64}) {
+    CpuMatrix input(batchSize, K), out(batchSize, N);
+    input.randomizeUniform();
+    double seconds[2];
+    for (bool int8 : {false, true}) {
+      const int repeat = 50;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < repeat; ++i) {
+        if (int8) {
+          quantized.mul(out, input, nullptr, 0);
+        } else {
+          out.mul(input, weight, 1, 0);
+        }
+      }
+      seconds[int8] = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count() /
+                      repeat;
+    }
+    LOG(INFO) << "batch=" << batchSize << " cblas=" << seconds[0] * 1e3
+              << "ms int8=" << seconds[1] * 1e3 << "ms";
+  }
+}
+
+#endif
@@ -18,12 +18,17 @@ limitations under the License. */
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <random>
+#include <string>
+#include <vector>
 
+#include <float.h>
 #include <stdlib.h>
 #include <time.h>
+#include <cmath>
 
 static constexpr size_t VECTOR_LEN = 3072;
 static constexpr size_t BATCH_SIZE = 64;
@@ -169,3 +174,677 @@ TEST(SIMDFunction, decayL1_WithoutLR) {
     ASSERT_NEAR(dest[i], simd_dest[i], EPSILON);
   }
 }
+
+TEST(SIMDFunction, allKernelTables) {
+  // Every variant the running CPU supports must agree with the naive code,
+  // not only the one picked by activeKernelTable().
+  constexpr size_t len = VECTOR_LEN + 5;
+  for (auto* table : paddle::simd::internal::supportedKernelTables()) {
+    auto A = NewRandomVector(len);
+    auto B = NewRandomVector(len);
+    auto lr = NewRandomVector(len);
+    auto naiveResult = NewVector(len);
+    auto simdResult = NewVector(len);
+
+    memcpy(naiveResult.get(), A.get(), len * sizeof(float));
+    memcpy(simdResult.get(), A.get(), len * sizeof(float));
+    paddle::simd::naive::addTo(naiveResult.get(), B.get(), len);
+    table->addTo(simdResult.get(), B.get(), len);
+    for (size_t i = 0; i < len; ++i) {
+      ASSERT_NEAR(naiveResult[i], simdResult[i], EPSILON) << table->name;
+    }
+
+    const float* batch[] = {A.get(), B.get(), lr.get()};
+    const float* batchCopy[] = {A.get(), B.get(), lr.get()};
+    memset(naiveResult.get(), 0, len * sizeof(float));
+    memset(simdResult.get(), 0, len * sizeof(float));
+    paddle::simd::naive::batchAddTo(naiveResult.get(), batch, 3, len);
+    table->batchAddTo(simdResult.get(), batchCopy, 3, len);
+    for (size_t i = 0; i < len; ++i) {
+      ASSERT_NEAR(naiveResult[i], simdResult[i], EPSILON) << table->name;
+    }
+
+    // unaligned rows and a length with every kind of tail.
+    const float* rows[] = {A.get() + 1, B.get() + 3, lr.get()};
+    const float scale[] = {0.5f, -2.0f, 1.5f};
+    for (const float* s : {scale, (const float*)nullptr}) {
+      memcpy(naiveResult.get(), A.get(), len * sizeof(float));
+      memcpy(simdResult.get(), A.get(), len * sizeof(float));
+      paddle::simd::naive::batchAxpy(naiveResult.get(), rows, s, 3, len - 3);
+      table->batchAxpy(simdResult.get(), rows, s, 3, len - 3);
+      for (size_t i = 0; i < len; ++i) {
+        ASSERT_NEAR(naiveResult[i], simdResult[i], 1e-3) << table->name;
+      }
+    }
+
+    // every count of rows left over by the groups of the kernels.
+    const float* dotRows[] = {B.get() + 1, lr.get(), A.get() + 2, B.get(),
+                              lr.get() + 3, A.get(), B.get() + 2};
+    for (int batch = 1; batch <= 7; batch++) {
+      float naiveDot[7];
+      float simdDot[7];
+      paddle::simd::naive::batchDot(naiveDot, A.get() + 1, dotRows, batch,
+                                    len - 3);
+      table->batchDot(simdDot, A.get() + 1, dotRows, batch, len - 3);
+      for (int k = 0; k < batch; ++k) {
+        ASSERT_NEAR(naiveDot[k], simdDot[k], 1e-4 * std::abs(naiveDot[k]) + 1)
+            << table->name;
+      }
+    }
+
+    paddle::simd::naive::colMax(naiveResult.get(), A.get(), 64, len / 64);
+    table->colMax(simdResult.get(), A.get(), 64, len / 64);
+    for (size_t i = 0; i < 64; ++i) {
+      ASSERT_NEAR(naiveResult[i], simdResult[i], EPSILON) << table->name;
+    }
+
+    paddle::simd::naive::decayL1(naiveResult.get(), A.get(), 0.23f, len);
+    table->decayL1(simdResult.get(), A.get(), 0.23f, len);
+    for (size_t i = 0; i < len; ++i) {
+      ASSERT_NEAR(naiveResult[i], simdResult[i], EPSILON) << table->name;
+    }
+
+    paddle::simd::naive::decayL1(
+        naiveResult.get(), A.get(), lr.get(), 0.23f, len);
+    table->decayL1WithLR(simdResult.get(), A.get(), lr.get(), 0.23f, len);
+    for (size_t i = 0; i < len; ++i) {
+      ASSERT_NEAR(naiveResult[i], simdResult[i], 1e-3) << table->name;
+    }
+
+    // odd shapes, a padded source and a source read from its last row up.
+    for (int ldSrc : {67, -67}) {
+      const float* src = ldSrc > 0 ? A.get() : A.get() + 40 * 67;
+      memset(naiveResult.get(), 0, len * sizeof(float));
+      memset(simdResult.get(), 0, len * sizeof(float));
+      paddle::simd::naive::transpose(naiveResult.get(), 41, src, ldSrc, 41, 61);
+      table->transpose(simdResult.get(), 41, src, ldSrc, 41, 61);
+      for (size_t i = 0; i < 41 * 61; ++i) {
+        ASSERT_EQ(naiveResult[i], simdResult[i]) << table->name;
+      }
+    }
+  }
+}
+
+TEST(SIMDFunction, gemmPackedB) {
+  using paddle::simd::packedGemmBSize;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  auto generator = std::bind(dist, RandomEngine);
+  const size_t K = 67, lda = 70, ldc = 40;
+  auto A = NewVector(33 * lda);
+  auto B = NewVector(K * 37);
+  std::generate_n(A.get(), 33 * lda, generator);
+  std::generate_n(B.get(), K * 37, generator);
+  auto packed = NewVector(packedGemmBSize(K, 37));
+  auto naiveResult = NewVector(33 * ldc);
+  auto simdResult = NewVector(33 * ldc);
+  for (auto* table : paddle::simd::internal::supportedKernelTables()) {
+    for (size_t M : {1, 2, 3, 5, 7, 8, 15, 33}) {
+      for (size_t N : {1, 16, 37}) {
+        for (bool transB : {false, true}) {
+          paddle::simd::packGemmB(
+              packed.get(), B.get(), transB ? K : N, transB, K, N);
+          // C is not read with a beta of 0, whatever it holds.
+          for (float beta : {0.0f, 0.5f}) {
+            std::generate_n(naiveResult.get(), 33 * ldc, generator);
+            memcpy(simdResult.get(),
+                   naiveResult.get(),
+                   33 * ldc * sizeof(float));
+            if (beta == 0) {
+              std::fill_n(simdResult.get(), 33 * ldc, NAN);
+            }
+            paddle::simd::naive::gemmPackedB(naiveResult.get(),
+                                             ldc,
+                                             A.get(),
+                                             lda,
+                                             packed.get(),
+                                             M,
+                                             N,
+                                             K,
+                                             1.5f,
+                                             beta);
+            table->gemmPackedB(simdResult.get(),
+                               ldc,
+                               A.get(),
+                               lda,
+                               packed.get(),
+                               M,
+                               N,
+                               K,
+                               1.5f,
+                               beta);
+            for (size_t i = 0; i < M; ++i) {
+              for (size_t j = 0; j < N; ++j) {
+                ASSERT_NEAR(naiveResult[i * ldc + j],
+                            simdResult[i * ldc + j],
+                            1e-4)
+                    << table->name << " M=" << M << " N=" << N;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(SIMDFunction, gemmInt8) {
+  using paddle::simd::int8GroupedK;
+  using paddle::simd::packedGemmInt8BSize;
+  std::uniform_int_distribution<int> intDist(-128, 127);
+  std::uniform_real_distribution<float> dist(0.01f, 1.0f);
+  auto generator = std::bind(dist, RandomEngine);
+  const size_t maxM = 33, maxN = 37, ldc = 40;
+  for (size_t K : {1, 4, 67}) {
+    size_t lda = int8GroupedK(K) + 4;
+    std::vector<int8_t> A(maxM * lda), B(K * maxN);
+    for (size_t i = 0; i < maxM; ++i) {
+      for (size_t k = 0; k < lda; ++k) {
+        A[i * lda + k] = k < K ? intDist(RandomEngine) : 0;
+      }
+    }
+    for (auto& b : B) {
+      b = intDist(RandomEngine);
+    }
+    std::vector<int8_t> packed(packedGemmInt8BSize(K, maxN));
+    std::vector<int32_t> sums(maxN);
+    auto scaleA = NewVector(maxM);
+    auto scaleB = NewVector(maxN);
+    auto bias = NewVector(maxN);
+    std::generate_n(scaleA.get(), maxM, generator);
+    std::generate_n(scaleB.get(), maxN, generator);
+    std::generate_n(bias.get(), maxN, generator);
+    auto naiveResult = NewVector(maxM * ldc);
+    auto simdResult = NewVector(maxM * ldc);
+    for (auto* table : paddle::simd::internal::supportedKernelTables()) {
+      for (size_t M : {1, 2, 3, 5, 8, 13, 33}) {
+        for (size_t N : {1, 8, 16, 37}) {
+          for (bool transB : {false, true}) {
+            paddle::simd::packGemmInt8B(packed.data(),
+                                        sums.data(),
+                                        B.data(),
+                                        transB ? K : N,
+                                        transB,
+                                        K,
+                                        N);
+            for (float beta : {0.0f, 0.5f}) {
+              for (const float* b : {(const float*)nullptr,
+                                     (const float*)bias.get()}) {
+                std::generate_n(naiveResult.get(), maxM * ldc, generator);
+                memcpy(simdResult.get(),
+                       naiveResult.get(),
+                       maxM * ldc * sizeof(float));
+                if (beta == 0) {
+                  std::fill_n(simdResult.get(), maxM * ldc, NAN);
+                }
+                paddle::simd::naive::gemmInt8(naiveResult.get(),
+                                              ldc,
+                                              A.data(),
+                                              lda,
+                                              scaleA.get(),
+                                              packed.data(),
+                                              sums.data(),
+                                              scaleB.get(),
+                                              b,
+                                              M,
+                                              N,
+                                              K,
+                                              beta);
+                table->gemmInt8(simdResult.get(),
+                                ldc,
+                                A.data(),
+                                lda,
+                                scaleA.get(),
+                                packed.data(),
+                                sums.data(),
+                                scaleB.get(),
+                                b,
+                                M,
+                                N,
+                                K,
+                                beta);
+                for (size_t i = 0; i < M; ++i) {
+                  for (size_t j = 0; j < N; ++j) {
+                    float expected = naiveResult[i * ldc + j];
+                    ASSERT_NEAR(expected,
+                                simdResult[i * ldc + j],
+                                1e-5 * std::max(1.0f, std::abs(expected)))
+                        << table->name << " M=" << M << " N=" << N
+                        << " K=" << K;
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/// Random values in [-2, 2], around the range of the gate inputs.
+static std::vector<float> randomValues(size_t len) {
+  std::uniform_real_distribution<float> dist(-2.0f, 2.0f);
+  std::vector<float> values(len);
+  for (auto& v : values) {
+    v = dist(RandomEngine);
+  }
+  return values;
+}
+
+static void expectNear(const std::vector<float>& expected,
+                       const std::vector<float>& actual,
+                       const std::string& what) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_NEAR(expected[i],
+                actual[i],
+                2e-5 * std::max(1.0f, std::abs(expected[i])))
+        << what << " " << i;
+  }
+}
+
+TEST(SIMDFunction, lstm) {
+  using paddle::simd::Activation;
+  using paddle::simd::internal::KernelTable;
+  struct Buffers {
+    std::vector<float> gate, state, stateActive, output;
+    std::vector<float> gateGrad, stateGrad, prevStateGrad, checkGrad;
+  };
+  const size_t batchSize = 3;
+  for (size_t frameSize : {1, 7, 8, 16, 37}) {
+    size_t len = batchSize * frameSize;
+    auto gate = randomValues(len * 4);
+    auto prevState = randomValues(len);
+    auto check = randomValues(frameSize * 3);
+    auto outputGrad = randomValues(len);
+    auto stateGrad = randomValues(len);
+    for (int node = 0; node < 4; ++node) {
+      for (int state = 0; state < 4; ++state) {
+        for (bool first : {false, true}) {
+          // a step and its gradients, with the naive kernels if no table.
+          auto run = [&](const KernelTable* table) {
+            Buffers b;
+            b.gate = gate;
+            b.state.resize(len);
+            b.stateActive.resize(len);
+            b.output.resize(len);
+            b.gateGrad.resize(len * 4);
+            b.stateGrad = stateGrad;
+            b.prevStateGrad.resize(len);
+            b.checkGrad.assign(frameSize * 3, 0.5f);
+            paddle::simd::LstmValue<float> value = {
+                b.gate.data(),
+                first ? nullptr : prevState.data(),
+                b.state.data(),
+                b.stateActive.data(),
+                b.output.data(),
+                check.data(),
+                check.data() + frameSize,
+                check.data() + frameSize * 2};
+            paddle::simd::LstmGrad<float> grad = {
+                b.gateGrad.data(),
+                first ? nullptr : b.prevStateGrad.data(),
+                b.stateGrad.data(),
+                outputGrad.data(),
+                b.checkGrad.data(),
+                b.checkGrad.data() + frameSize,
+                b.checkGrad.data() + frameSize * 2};
+            Activation activeNode = static_cast<Activation>(node);
+            Activation activeState = static_cast<Activation>(state);
+            if (table) {
+              table->lstmForward(
+                  value, frameSize, batchSize, activeNode, activeState);
+              table->lstmBackward(
+                  value, grad, frameSize, batchSize, activeNode, activeState);
+            } else {
+              paddle::simd::naive::lstmForward(
+                  value, frameSize, batchSize, activeNode, activeState);
+              paddle::simd::naive::lstmBackward(
+                  value, grad, frameSize, batchSize, activeNode, activeState);
+            }
+            return b;
+          };
+          Buffers expected = run(nullptr);
+          for (auto* table : paddle::simd::internal::supportedKernelTables()) {
+            Buffers actual = run(table);
+            std::string what = std::string(table->name) + " frameSize=" +
+                               std::to_string(frameSize) + " node=" +
+                               std::to_string(node) + " state=" +
+                               std::to_string(state) + " first=" +
+                               std::to_string(first);
+            expectNear(expected.gate, actual.gate, what + " gate");
+            expectNear(expected.state, actual.state, what + " state");
+            expectNear(expected.stateActive,
+                       actual.stateActive,
+                       what + " stateActive");
+            expectNear(expected.output, actual.output, what + " output");
+            expectNear(expected.gateGrad, actual.gateGrad, what + " gateGrad");
+            expectNear(
+                expected.stateGrad, actual.stateGrad, what + " stateGrad");
+            expectNear(expected.prevStateGrad,
+                       actual.prevStateGrad,
+                       what + " prevStateGrad");
+            expectNear(
+                expected.checkGrad, actual.checkGrad, what + " checkGrad");
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(SIMDFunction, gru) {
+  using paddle::simd::Activation;
+  using paddle::simd::internal::KernelTable;
+  struct Buffers {
+    std::vector<float> gate, resetOutput, output, gateGrad, prevOutGrad;
+  };
+  const size_t batchSize = 3;
+  for (size_t frameSize : {1, 7, 8, 16, 37}) {
+    size_t len = batchSize * frameSize;
+    auto gate = randomValues(len * 3);
+    auto prevOut = randomValues(len);
+    auto outputGrad = randomValues(len);
+    auto resetOutputGrad = randomValues(len);
+    auto prevOutGrad = randomValues(len);
+    for (int node = 0; node < 4; ++node) {
+      for (bool first : {false, true}) {
+        auto run = [&](const KernelTable* table) {
+          Buffers b;
+          b.gate = gate;
+          b.resetOutput.resize(len);
+          b.output.resize(len);
+          b.gateGrad.resize(len * 3);
+          b.prevOutGrad = prevOutGrad;
+          const float* prev = first ? nullptr : prevOut.data();
+          float* prevGrad = first ? nullptr : b.prevOutGrad.data();
+          Activation activeNode = static_cast<Activation>(node);
+          if (table) {
+            table->gruResetOutput(b.gate.data(),
+                                  prev,
+                                  b.resetOutput.data(),
+                                  frameSize,
+                                  batchSize);
+            table->gruFinalOutput(b.gate.data(),
+                                  prev,
+                                  b.output.data(),
+                                  frameSize,
+                                  batchSize,
+                                  activeNode);
+            table->gruStateGrad(b.gate.data(),
+                                b.gateGrad.data(),
+                                prev,
+                                prevGrad,
+                                outputGrad.data(),
+                                frameSize,
+                                batchSize,
+                                activeNode);
+            table->gruResetGrad(b.gate.data(),
+                                b.gateGrad.data(),
+                                prev,
+                                prevGrad,
+                                resetOutputGrad.data(),
+                                frameSize,
+                                batchSize);
+          } else {
+            paddle::simd::naive::gruResetOutput(b.gate.data(),
+                                                prev,
+                                                b.resetOutput.data(),
+                                                frameSize,
+                                                batchSize);
+            paddle::simd::naive::gruFinalOutput(b.gate.data(),
+                                                prev,
+                                                b.output.data(),
+                                                frameSize,
+                                                batchSize,
+                                                activeNode);
+            paddle::simd::naive::gruStateGrad(b.gate.data(),
+                                              b.gateGrad.data(),
+                                              prev,
+                                              prevGrad,
+                                              outputGrad.data(),
+                                              frameSize,
+                                              batchSize,
+                                              activeNode);
+            paddle::simd::naive::gruResetGrad(b.gate.data(),
+                                              b.gateGrad.data(),
+                                              prev,
+                                              prevGrad,
+                                              resetOutputGrad.data(),
+                                              frameSize,
+                                              batchSize);
+          }
+          return b;
+        };
+        Buffers expected = run(nullptr);
+        for (auto* table : paddle::simd::internal::supportedKernelTables()) {
+          Buffers actual = run(table);
+          std::string what = std::string(table->name) + " frameSize=" +
+                             std::to_string(frameSize) + " node=" +
+                             std::to_string(node) + " first=" +
+                             std::to_string(first);
+          expectNear(expected.gate, actual.gate, what + " gate");
+          expectNear(
+              expected.resetOutput, actual.resetOutput, what + " resetOutput");
+          expectNear(expected.output, actual.output, what + " output");
+          expectNear(expected.gateGrad, actual.gateGrad, what + " gateGrad");
+          expectNear(
+              expected.prevOutGrad, actual.prevOutGrad, what + " prevOutGrad");
+        }
+      }
+    }
+  }
+}
+
+/// distance in units in the last place between a float and the exact value.
+static double ulpError(float actual, double expected) {
+  if (std::isinf(expected) || std::isnan(expected)) {
+    return actual == expected || (std::isnan(actual) && std::isnan(expected))
+               ? 0
+               : INFINITY;
+  }
+  // in double, float denormals may be flushed to zero.
+  double e = std::fabs(static_cast<float>(expected));
+  double ulp = std::nextafter(static_cast<float>(e), INFINITY) - e;
+  return std::fabs(actual - expected) / std::max(ulp, 1e-45);
+}
+
+TEST(SIMDFunction, transcendentalAccuracy) {
+  typedef void (*KernelType)(float*, const float*, size_t);
+  struct Case {
+    const char* name;
+    KernelType (*kernel)(const paddle::simd::internal::KernelTable*);
+    std::function<double(double)> exact;
+    float lo, hi;
+    double maxUlp;     // relative error bound
+    double maxAbsErr;  // or absolute error bound
+  };
+  auto sigmoid = [](double x) {
+    x = std::min(std::max(x, -40.0), 13.0);
+    return 1 / (1 + std::exp(-x));
+  };
+  const Case cases[] = {
+      {"exp",
+       [](const paddle::simd::internal::KernelTable* t) { return t->vExp; },
+       [](double x) { return std::exp(x); },
+       -87.0f,
+       88.7f,
+       2,
+       0},
+      {"log",
+       [](const paddle::simd::internal::KernelTable* t) { return t->vLog; },
+       [](double x) { return std::log(x); },
+       FLT_MIN,
+       FLT_MAX,
+       2,
+       0},
+      {"log1p",
+       [](const paddle::simd::internal::KernelTable* t) { return t->vLog1p; },
+       [](double x) { return std::log1p(x); },
+       -0.999f,
+       1e6f,
+       3,
+       0},
+      {"tanh",
+       [](const paddle::simd::internal::KernelTable* t) { return t->vTanh; },
+       [](double x) { return std::tanh(x); },
+       -30.0f,
+       30.0f,
+       0,
+       2.4e-7},
+      {"sigmoid",
+       [](const paddle::simd::internal::KernelTable* t) {
+         return t->vSigmoid;
+       },
+       sigmoid,
+       -50.0f,
+       50.0f,
+       3,
+       0},
+  };
+
+  // a dense sweep and values spread over every binade of the range.
+  constexpr size_t len = (1 << 16) + 7;
+  auto a = NewVector(len);
+  auto r = NewVector(len);
+  for (auto& c : cases) {
+    bool logScale = c.lo > 0 || c.hi / std::max(-c.lo, 1.0f) > 1e4;
+    for (size_t i = 0; i < len; ++i) {
+      double t = (double)i / (len - 1);
+      a[i] = logScale ? c.lo * std::pow((double)c.hi / c.lo, t)
+                      : c.lo + (c.hi - c.lo) * t;
+      if (!logScale || c.lo > 0) {
+        continue;
+      }
+      // log1p: both sides of zero, down to tiny magnitudes.
+      a[i] = (i % 2 ? -c.lo : c.hi) * std::pow(1e-30, t * t);
+      a[i] = i % 2 ? -a[i] : a[i];
+    }
+    for (auto* table : paddle::simd::internal::supportedKernelTables()) {
+      c.kernel(table)(r.get(), a.get(), len);
+      double worstUlp = 0, worstAbs = 0;
+      for (size_t i = 0; i < len; ++i) {
+        double exact = c.exact(a[i]);
+        worstUlp = std::max(worstUlp, ulpError(r[i], exact));
+        worstAbs = std::max(worstAbs, std::fabs(r[i] - exact));
+      }
+      LOG(INFO) << c.name << " " << table->name << ": " << worstUlp
+                << " ulp, " << worstAbs << " absolute";
+      if (c.maxUlp > 0) {
+        EXPECT_LE(worstUlp, c.maxUlp) << c.name << " " << table->name;
+      } else {
+        EXPECT_LE(worstAbs, c.maxAbsErr) << c.name << " " << table->name;
+      }
+    }
+  }
+}
+
+TEST(SIMDFunction, transcendentalSpecialValues) {
+  const float in[] = {0.0f, -0.0f, 1.0f, -1.0f, -90.0f, 90.0f,
+                      1e-30f, -1e-30f, INFINITY, -INFINITY, 1e-40f, 200.0f};
+  constexpr size_t len = sizeof(in) / sizeof(in[0]);
+  float r[len];
+  for (auto* table : paddle::simd::internal::supportedKernelTables()) {
+    table->vExp(r, in, len);
+    EXPECT_EQ(1.0f, r[0]) << table->name;
+    EXPECT_EQ(0.0f, r[4]) << table->name;
+    EXPECT_GT(r[5], 3e38f) << table->name;
+    EXPECT_EQ(0.0f, r[9]) << table->name;
+
+    table->vLog(r, in, len);
+    EXPECT_EQ(-INFINITY, r[0]) << table->name;
+    EXPECT_EQ(0.0f, r[2]) << table->name;
+    EXPECT_TRUE(std::isnan(r[3])) << table->name;
+    EXPECT_EQ(INFINITY, r[8]) << table->name;
+    EXPECT_TRUE(std::isnan(r[9])) << table->name;
+
+    table->vLog1p(r, in, len);
+    EXPECT_EQ(0.0f, r[0]) << table->name;
+    EXPECT_EQ(-INFINITY, r[3]) << table->name;
+    EXPECT_EQ(1e-30f, r[6]) << table->name;
+    EXPECT_EQ(-1e-30f, r[7]) << table->name;
+    EXPECT_EQ(INFINITY, r[8]) << table->name;
+
+    table->vTanh(r, in, len);
+    EXPECT_EQ(-1.0f, r[4]) << table->name;
+    EXPECT_EQ(1.0f, r[5]) << table->name;
+    EXPECT_EQ(-1.0f, r[9]) << table->name;
+
+    table->vSigmoid(r, in, len);
+    EXPECT_EQ(0.5f, r[0]) << table->name;
+    EXPECT_GT(r[4], 0.0f) << table->name;
+    EXPECT_LT(r[5], 1.0f) << table->name;
+    EXPECT_LT(r[11], 1.0f) << table->name;
+  }
+}
+
+TEST(SIMDFunction, bandwidth) {
+  constexpr size_t len = 1 << 20;
+  constexpr int repeat = 50;
+  auto A = NewRandomVector(len);
+  auto B = NewRandomVector(len);
+  auto C = NewVector(len);
+  // activations, mostly within the range where exp neither over- nor
+  // underflows.
+  auto X = NewVector(len);
+  for (size_t i = 0; i < len; ++i) {
+    X[i] = A[i] * 0.1f;
+  }
+
+  auto gbps = [](size_t bytes, std::chrono::steady_clock::duration d) {
+    return bytes * repeat /
+           std::chrono::duration_cast<std::chrono::duration<double>>(d)
+               .count() /
+           1e9;
+  };
+
+  LOG(INFO) << "active kernels: "
+            << paddle::simd::internal::activeKernelTable().name;
+  for (auto* table : paddle::simd::internal::supportedKernelTables()) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+      table->addTo(A.get(), B.get(), len);
+    }
+    // read a, read b, write a
+    double addTo = gbps(3 * len * sizeof(float),
+                        std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+      table->colMax(C.get(), A.get(), 1024, len / 1024);
+    }
+    double colMax =
+        gbps(len * sizeof(float), std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+      table->decayL1WithLR(C.get(), A.get(), B.get(), 0.23f, len);
+    }
+    // read src, read lr, write dst
+    double decayL1 = gbps(3 * len * sizeof(float),
+                          std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+      table->vExp(C.get(), X.get(), len);
+    }
+    double exp = gbps(len, std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeat; ++i) {
+      table->vSigmoid(C.get(), X.get(), len);
+    }
+    double sigmoid = gbps(len, std::chrono::steady_clock::now() - start);
+
+    LOG(INFO) << table->name << ": addTo " << addTo << " GB/s, colMax "
+              << colMax << " GB/s, decayL1 " << decayL1 << " GB/s, exp "
+              << exp << " G/s, sigmoid " << sigmoid << " G/s";
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    paddle::simd::naive::vExp(C.get(), X.get(), len);
+  }
+  LOG(INFO) << "libm: exp "
+            << gbps(len, std::chrono::steady_clock::now() - start) << " G/s";
+}
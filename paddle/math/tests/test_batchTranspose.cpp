@@ -12,11 +12,15 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
+#include <chrono>
 #include "hl_batch_transpose.h"
+#include "paddle/math/MathUtils.h"
 #include "test_matrixUtil.h"
 
 using namespace paddle;  // NOLINT
 
+DECLARE_int32(tensor_apply_threads);
+
 #ifndef PADDLE_ONLY_CPU
 TEST(MatrixBatchTransTest, test_batch_matrix_transpose) {
   const int nx = 100;
@@ -53,3 +57,107 @@ TEST(MatrixBatchTransTest, test_batch_matrix_transpose) {
   checkMatrixEqual(cBatchTransMat, cMat_d2h);
 }
 #endif
+
+TEST(MatrixBatchTransTest, test_cpu_batch_matrix_transpose) {
+  const int nx = 100;
+  const int ny = 50;
+  const int numSamples = 50;
+
+  MatrixPtr cMat = Matrix::create(numSamples, nx * ny, false, false);
+  MatrixPtr gold = Matrix::create(numSamples, nx * ny, false, false);
+  MatrixPtr cBatchTransMat = Matrix::create(numSamples, nx * ny, false, false);
+  cMat->randomizeUniform();
+  real* cData = cMat->getData();
+  for (int sample_id = 0; sample_id < numSamples; ++sample_id)
+    for (int j = 0; j < ny; j++)
+      for (int i = 0; i < nx; i++)
+        gold->getData()[sample_id * nx * ny + i * ny + j] =
+            cData[sample_id * nx * ny + j * nx + i];
+
+  for (auto threads : {1, 4}) {
+    FLAGS_tensor_apply_threads = threads;
+    cBatchTransMat->zeroMem();
+    cpuBatchTranspose(
+        cMat->getData(), cBatchTransMat->getData(), nx, ny, numSamples);
+    checkMatrixEqual(gold, cBatchTransMat);
+  }
+  FLAGS_tensor_apply_threads = 1;
+}
+
+TEST(MatrixTransTest, test_cpu_transpose_rotate) {
+  for (auto threads : {1, 4}) {
+    FLAGS_tensor_apply_threads = threads;
+    for (auto height : {1, 7, 33, 600}) {
+      for (auto width : {1, 3, 65, 1000}) {
+        // a sub matrix whose rows are padded.
+        MatrixPtr full = Matrix::create(height, width + 5, false, false);
+        full->randomizeUniform();
+        MatrixPtr mat = full->subMatrix(0, height, 5, width + 5);
+        MatrixPtr trans;
+        mat->transpose(trans, true);
+        MatrixPtr gold = Matrix::create(width, height, false, false);
+        for (int i = 0; i < height; ++i) {
+          for (int j = 0; j < width; ++j) {
+            gold->getData()[j * height + i] = mat->getElement(i, j);
+          }
+        }
+        checkMatrixEqual(gold, trans);
+
+        MatrixPtr rot;
+        MatrixPtr contiguous = Matrix::create(height, width, false, false);
+        contiguous->copyFrom(*mat);
+        for (bool clockWise : {true, false}) {
+          contiguous->rotate(rot, true, clockWise);
+          for (int i = 0; i < height; ++i) {
+            for (int j = 0; j < width; ++j) {
+              gold->getData()[j * height + i] =
+                  clockWise ? contiguous->getElement(height - i - 1, j)
+                            : contiguous->getElement(i, width - j - 1);
+            }
+          }
+          checkMatrixEqual(gold, rot);
+        }
+      }
+    }
+  }
+  FLAGS_tensor_apply_threads = 1;
+}
+
+TEST(MatrixTransTest, bandwidth) {
+  const size_t height = 4096, width = 4096;
+  const int repeat = 5;
+  MatrixPtr mat = Matrix::create(height, width, false, false);
+  MatrixPtr trans = Matrix::create(width, height, false, false);
+  mat->randomizeUniform();
+
+  // read and write every element once.
+  auto gbps = [&](std::chrono::steady_clock::time_point start) {
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    return 2.0 * height * width * sizeof(real) * repeat / seconds / 1e9;
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < repeat; ++k) {
+    real* data = mat->getData();
+    real* dataTrans = trans->getData();
+    for (size_t i = 0; i < height; i++) {
+      for (size_t j = 0; j < width; j++) {
+        dataTrans[j * height + i] = data[i * width + j];
+      }
+    }
+  }
+  LOG(INFO) << "naive transpose: " << gbps(start) << " GB/s";
+
+  for (auto threads : {1, 2, 4}) {
+    FLAGS_tensor_apply_threads = threads;
+    start = std::chrono::steady_clock::now();
+    for (int k = 0; k < repeat; ++k) {
+      mat->transpose(trans, false);
+    }
+    LOG(INFO) << "transpose, " << threads << " threads: " << gbps(start)
+              << " GB/s";
+  }
+  FLAGS_tensor_apply_threads = 1;
+}
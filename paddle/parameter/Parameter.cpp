@@ -48,7 +48,9 @@ Parameter::Parameter(const ParameterConfig& config, bool useGpu, bool doInit)
       deviceId_(-1),
       sharedCount_(0),
       updateCounter_(0),
-      updated_(false) {
+      updated_(false),
+      valueVersion_(0),
+      valueCache_(std::make_shared<ValueCache>()) {
   setID(-1); /* capture uninitialized id */
   if (useGpu_ && FLAGS_parallel_nn) {
     /* gpu environment is specified by device property */
@@ -141,6 +143,51 @@ void Parameter::zeroMem() {
   LOG(INFO) << getName() << " set to 0";
 }
 
+CpuMemHandlePtr Parameter::getPackedValue(size_t height, size_t width) {
+  CHECK(!useGpu_);
+  CHECK_EQ(height * width, getSize());
+  std::lock_guard<std::mutex> guard(valueCache_->mutex);
+  ValueCache& cache = *valueCache_;
+  if (!cache.packed || cache.packedHeight != height ||
+      cache.packedWidth != width) {
+    CpuMatrix value(bufs_[PARAMETER_VALUE]->getData(), height, width);
+    value.packForMul();
+    cache.packed = value.getPackedForMul();
+    cache.packedHeight = height;
+    cache.packedWidth = width;
+  }
+  return cache.packed;
+}
+
+std::shared_ptr<const Parameter::QuantizedBlocks>
+Parameter::getQuantizedValue(size_t K, size_t N, bool trans) {
+  CHECK(!useGpu_);
+  size_t numBlocks = getSize() / (K * N);
+  CHECK_EQ(numBlocks * K * N, getSize());
+  std::lock_guard<std::mutex> guard(valueCache_->mutex);
+  ValueCache& cache = *valueCache_;
+  if (!cache.quantized || cache.quantizedK != K || cache.quantizedN != N ||
+      cache.quantizedTrans != trans) {
+    auto blocks = std::make_shared<QuantizedBlocks>();
+    const real* value = bufs_[PARAMETER_VALUE]->getData();
+    for (size_t i = 0; i < numBlocks; ++i) {
+      blocks->push_back(std::make_shared<QuantizedMatrix>(
+          value + i * K * N, trans ? K : N, trans, K, N));
+    }
+    cache.quantized = blocks;
+    cache.quantizedK = K;
+    cache.quantizedN = N;
+    cache.quantizedTrans = trans;
+  }
+  return cache.quantized;
+}
+
+void Parameter::clearValueCache() {
+  std::lock_guard<std::mutex> guard(valueCache_->mutex);
+  valueCache_->packed.reset();
+  valueCache_->quantized.reset();
+}
+
 bool Parameter::isGradShared(size_t* blockNum) {
   if (!useGpu_ && !isStatic() && FLAGS_enable_grad_share > 0 &&
       !isGradSparseUpdate() &&
@@ -16,7 +16,9 @@ limitations under the License. */
 
 #include <stdint.h>
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -25,6 +27,7 @@ limitations under the License. */
 
 #include "ParameterUpdaterHook.h"
 #include "paddle/math/Matrix.h"
+#include "paddle/math/QuantizedMatrix.h"
 #include "paddle/math/Vector.h"
 #include "paddle/utils/Common.h"
 #include "paddle/utils/GlobalConstants.h"
@@ -185,7 +188,45 @@ public:
 
   const MatrixPtr& getMat(ParameterType pType) const { return mats_[pType]; }
 
-  void setValueUpdated() { updated_ = true; }
+  /// Every change of the value is followed by a call to setValueUpdated(),
+  /// which also drops the copies of getPackedValue() and
+  /// getQuantizedValue().
+  void setValueUpdated() {
+    updated_ = true;
+    ++valueVersion_;
+    clearValueCache();
+  }
+
+  /**
+   * @brief The cpu value as a height x width matrix packed by
+   *        CpuMatrix::packForMul().
+   *
+   * It is built by the first call after setValueUpdated(), and shared by
+   * the weights of every layer, and of every machine sharing the value
+   * through shareValueCache().
+   */
+  CpuMemHandlePtr getPackedValue(size_t height, size_t width);
+
+  typedef std::vector<QuantizedMatrixPtr> QuantizedBlocks;
+
+  /**
+   * @brief The int8 copies of the consecutive K x N blocks of the cpu value,
+   *        which are stored as N x K when trans is set.
+   *
+   * Built and shared as getPackedValue().
+   */
+  std::shared_ptr<const QuantizedBlocks> getQuantizedValue(size_t K,
+                                                           size_t N,
+                                                           bool trans);
+
+  /// Share the copies of getPackedValue() and getQuantizedValue() with the
+  /// parameter whose value this one shares.
+  void shareValueCache(const Parameter& other) {
+    valueCache_ = other.valueCache_;
+  }
+
+  /// Changes on every call to setValueUpdated().
+  uint64_t getValueVersion() const { return valueVersion_; }
 
   void clearValueUpdated() { updated_ = false; }
 
@@ -319,6 +360,21 @@ protected:
   int updateCounter_;
 
   bool updated_;
+  std::atomic<uint64_t> valueVersion_;
+
+  /// Copies of the value in the layout of the inference kernels.
+  struct ValueCache {
+    std::mutex mutex;
+    CpuMemHandlePtr packed;
+    size_t packedHeight;
+    size_t packedWidth;
+    std::shared_ptr<const QuantizedBlocks> quantized;
+    size_t quantizedK;
+    size_t quantizedN;
+    bool quantizedTrans;
+  };
+  std::shared_ptr<ValueCache> valueCache_;
+  void clearValueCache();
   SparseFormat format_;
 
   std::vector<std::shared_ptr<IParameterUpdaterHook>> updaterHooks_;
@@ -13,8 +13,21 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include "Weight.h"
+#include "paddle/utils/Flags.h"
 #include "paddle/utils/Logging.h"
 
+DEFINE_bool(pack_inference_weights,
+            false,
+            "Pack the cpu weights of an inference-only network once, so "
+            "that the fc layers multiply by them without cblas. Helps small "
+            "batches.");
+DEFINE_bool(quantize_inference_weights,
+            false,
+            "Round the cpu weights of the fc and exconv layers of an "
+            "inference-only network to int8, and multiply by them in int8. "
+            "Trades some accuracy for a quarter of the weight bandwidth. "
+            "The default of GradientMachine::setQuantizeWeights().");
+
 namespace paddle {
 
 Weight::Weight(size_t height, size_t width, ParameterPtr param) {
@@ -81,4 +94,39 @@ Weight::Weight(size_t height, size_t width, ParameterPtr param, size_t offset) {
 
 const ParameterPtr& Weight::getParameterPtr() { return parameter_; }
 void Weight::setParameterPtr(ParameterPtr param) { parameter_ = param; }
+
+void Weight::preparePackedW(PassType passType) {
+#ifndef PADDLE_TYPE_DOUBLE
+  // the derived cpu matrices do not keep their rows in getData().
+  if (!weight_ || typeid(*weight_) != typeid(CpuMatrix)) {
+    return;
+  }
+  auto cpuWeight = std::static_pointer_cast<CpuMatrix>(weight_);
+  // a weight at an offset is not the whole value.
+  if (!FLAGS_pack_inference_weights || passType != PASS_TEST || weightGrad_ ||
+      weight_->getData() != parameter_->getBuf(PARAMETER_VALUE)->getData()) {
+    cpuWeight->releasePackedForMul();
+    return;
+  }
+  cpuWeight->setPackedForMul(
+      parameter_->getPackedValue(weight_->getHeight(), weight_->getWidth()));
+#endif
+}
+
+bool Weight::prepareQuantizedW(
+    bool quantize, PassType passType, size_t K, size_t N, bool trans) {
+#ifndef PADDLE_TYPE_DOUBLE
+  // a weight at an offset is not the whole value.
+  if (!quantize || passType != PASS_TEST || weightGrad_ || !weight_ ||
+      typeid(*weight_) != typeid(CpuMatrix) ||
+      weight_->getData() != parameter_->getBuf(PARAMETER_VALUE)->getData()) {
+    quantized_.reset();
+    return false;
+  }
+  quantized_ = parameter_->getQuantizedValue(K, N, trans);
+  return true;
+#else
+  return false;
+#endif
+}
 }  // namespace paddle
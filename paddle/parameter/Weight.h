@@ -17,6 +17,7 @@ limitations under the License. */
 #include <vector>
 
 #include "paddle/math/Matrix.h"
+#include "paddle/math/QuantizedMatrix.h"
 #include "paddle/math/SparseRowMatrix.h"
 #include "paddle/parameter/Parameter.h"
 
@@ -27,6 +28,8 @@ private:
   MatrixPtr weight_;
   MatrixPtr weightGrad_;
   ParameterPtr parameter_;
+  /// int8 copies of the blocks of weight_, see prepareQuantizedW().
+  std::shared_ptr<const Parameter::QuantizedBlocks> quantized_;
 
 public:
   Weight(size_t height, size_t width, ParameterPtr parameter);
@@ -41,6 +44,30 @@ public:
   }
 
   void setParameterPtr(ParameterPtr param);
+
+  /**
+   * With --pack_inference_weights, makes a cpu weight that has no gradient
+   * multiply by the packed value of its parameter (getPackedValue) in a
+   * PASS_TEST forward, which is packed again whenever the value changed.
+   * Layers call it before multiplying by getW().
+   */
+  void preparePackedW(PassType passType);
+
+  /**
+   * If quantize is set, makes a cpu weight that has no gradient multiply
+   * by the int8 value of its parameter (getQuantizedValue) in a PASS_TEST
+   * forward, which is rounded again whenever the value changed. The weight
+   * is cut into consecutive blocks of K x N values, stored as N x K when
+   * trans is set, which the layer multiplies separately. Returns whether
+   * the layer should multiply by getQuantizedW() instead of getW().
+   */
+  bool prepareQuantizedW(
+      bool quantize, PassType passType, size_t K, size_t N, bool trans);
+
+  /// The int8 copy of a block, after prepareQuantizedW() returned true.
+  const QuantizedMatrix& getQuantizedW(size_t block = 0) const {
+    return *(*quantized_)[block];
+  }
 };
 
 typedef std::vector<std::unique_ptr<Weight>> WeightList;
@@ -14,6 +14,8 @@ limitations under the License. */
 
 #pragma once
 
+#include <deque>
+
 #include "ParameterService.pb.h"
 #include "paddle/math/Matrix.h"
 #include "paddle/pserver/ProtoServer.h"
@@ -47,6 +49,8 @@ protected:
     SendRequest parallelRequests;
     /// store data, such as features for metric learning
     SendDataRequestVec parallelDataRequests;
+    /// store the encoded gradient blocks of parallelInputIovs
+    std::deque<std::vector<real>> encodedBlocks;
   };
 
 public:
@@ -0,0 +1,198 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "BlockPlacement.h"
+
+#include <algorithm>
+
+#include "paddle/utils/Logging.h"
+
+namespace paddle {
+
+namespace {
+
+/// the finalizer of splitmix64, the same on every machine unlike std::hash
+uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+/// heavier blocks first, so that the last blocks placed fill the gaps
+bool heavierFirst(const BlockPlacement::Block& a,
+                  const BlockPlacement::Block& b) {
+  if (a.weight != b.weight) {
+    return a.weight > b.weight;
+  }
+  if (a.paraId != b.paraId) {
+    return a.paraId < b.paraId;
+  }
+  return a.blockId < b.blockId;
+}
+
+}  // namespace
+
+BlockPlacement::BlockPlacement(int numServers, double loadSlack)
+    : numServers_(numServers), loadSlack_(loadSlack), version_(0) {
+  CHECK_GT(numServers_, 0);
+  CHECK_GE(loadSlack_, 0);
+  ring_.reserve(numServers_ * kVirtualNodes);
+  for (int serverId = 0; serverId < numServers_; ++serverId) {
+    for (int i = 0; i < kVirtualNodes; ++i) {
+      uint64_t point = mix(mix(serverId + 1) ^ (i + 0x9e3779b97f4a7c15ULL));
+      ring_.push_back(std::make_pair(point, serverId));
+    }
+  }
+  std::sort(ring_.begin(), ring_.end());
+}
+
+uint64_t BlockPlacement::hashBlock(uint64_t paraId, uint64_t blockId) {
+  return mix(mix(paraId) + blockId);
+}
+
+double BlockPlacement::getCapacity(const std::vector<Block>& blocks) const {
+  double totalWeight = 0;
+  for (const auto& block : blocks) {
+    totalWeight += block.weight;
+  }
+  return (1 + loadSlack_) * totalWeight / numServers_;
+}
+
+int BlockPlacement::findServer(const Block& block,
+                               const std::vector<double>& loads,
+                               double capacity,
+                               int excludedServer) const {
+  uint64_t point = hashBlock(block.paraId, block.blockId);
+  size_t begin =
+      std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(point, 0)) -
+      ring_.begin();
+  std::vector<bool> visited(numServers_, false);
+  int numVisited = 0;
+  for (size_t i = 0; i < ring_.size() && numVisited < numServers_; ++i) {
+    int serverId = ring_[(begin + i) % ring_.size()].second;
+    if (visited[serverId]) {
+      continue;
+    }
+    visited[serverId] = true;
+    ++numVisited;
+    if (serverId != excludedServer &&
+        loads[serverId] + block.weight <= capacity) {
+      return serverId;
+    }
+  }
+  return -1;
+}
+
+void BlockPlacement::init(const std::vector<Block>& blocks) {
+  serverIds_.clear();
+  version_ = 0;
+
+  std::vector<Block> sorted = blocks;
+  std::sort(sorted.begin(), sorted.end(), heavierFirst);
+  double capacity = getCapacity(blocks);
+  std::vector<double> loads(numServers_, 0);
+  for (const auto& block : sorted) {
+    int serverId = findServer(block, loads, capacity, -1);
+    if (serverId < 0) {
+      /// a block heavier than the bound
+      serverId = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    }
+    serverIds_[BlockKey(block.paraId, block.blockId)] = serverId;
+    loads[serverId] += block.weight;
+  }
+}
+
+int BlockPlacement::getServerId(uint64_t paraId, uint64_t blockId) const {
+  auto it = serverIds_.find(BlockKey(paraId, blockId));
+  return it == serverIds_.end() ? -1 : it->second;
+}
+
+void BlockPlacement::setServerId(uint64_t paraId,
+                                 uint64_t blockId,
+                                 int serverId) {
+  CHECK(serverId >= 0 && serverId < numServers_) << "server id: " << serverId;
+  serverIds_[BlockKey(paraId, blockId)] = serverId;
+}
+
+std::vector<double> BlockPlacement::getLoads(
+    const std::vector<Block>& blocks) const {
+  std::vector<double> loads(numServers_, 0);
+  for (const auto& block : blocks) {
+    int serverId = getServerId(block.paraId, block.blockId);
+    if (serverId >= 0) {
+      loads[serverId] += block.weight;
+    }
+  }
+  return loads;
+}
+
+std::vector<BlockPlacement::Move> BlockPlacement::rebalance(
+    const std::vector<Block>& blocks) {
+  double capacity = getCapacity(blocks);
+  std::vector<double> loads = getLoads(blocks);
+  std::vector<std::vector<Block>> serverBlocks(numServers_);
+  for (const auto& block : blocks) {
+    int serverId = getServerId(block.paraId, block.blockId);
+    CHECK_GE(serverId, 0) << "block is not placed: para " << block.paraId
+                          << " block " << block.blockId;
+    serverBlocks[serverId].push_back(block);
+  }
+
+  std::vector<int> serverIds(numServers_);
+  for (int i = 0; i < numServers_; ++i) {
+    serverIds[i] = i;
+  }
+  /// the most loaded pservers first, as they have the widest choice
+  std::stable_sort(serverIds.begin(), serverIds.end(), [&](int a, int b) {
+    return loads[a] > loads[b];
+  });
+
+  std::vector<Move> moves;
+  for (int serverId : serverIds) {
+    if (loads[serverId] <= capacity) {
+      continue;
+    }
+    auto& candidates = serverBlocks[serverId];
+    std::sort(candidates.begin(), candidates.end(), heavierFirst);
+    for (const auto& block : candidates) {
+      if (loads[serverId] <= capacity) {
+        break;
+      }
+      int toServer = findServer(block, loads, capacity, serverId);
+      if (toServer < 0) {
+        /// no pserver stays under the bound, then the least loaded one if
+        /// the two of them are more balanced after the move
+        toServer =
+            std::min_element(loads.begin(), loads.end()) - loads.begin();
+        if (loads[toServer] + block.weight >= loads[serverId]) {
+          continue;
+        }
+      }
+      serverIds_[BlockKey(block.paraId, block.blockId)] = toServer;
+      loads[serverId] -= block.weight;
+      loads[toServer] += block.weight;
+      moves.push_back({block.paraId, block.blockId, serverId, toServer});
+    }
+  }
+
+  if (!moves.empty()) {
+    ++version_;
+  }
+  return moves;
+}
+
+}  // namespace paddle
@@ -0,0 +1,118 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace paddle {
+
+/**
+ * @brief the pserver of each dense parameter block
+ *
+ * @note  the blocks are placed by consistent hashing with bounded loads:
+ *        every pserver has kVirtualNodes points on a hash ring, and a block
+ *        goes to the first pserver after its own point whose load stays
+ *        under (1 + loadSlack) times the average load. The load of a block
+ *        is its weight, its size at first, so the bytes stored are balanced
+ *        whatever the sizes of the parameters are, and the placement only
+ *        depends on the blocks, the same on every trainer.
+ *
+ *        rebalance() takes new weights, from the traffic observed by the
+ *        pservers for instance, and only moves blocks off the pservers
+ *        which are loaded more than that bound, so that few blocks have to
+ *        be copied between two passes. A block goes to the next pserver on
+ *        the ring which stays under the bound, or else to the least loaded
+ *        pserver if that makes the two of them more balanced.
+ */
+class BlockPlacement {
+public:
+  struct Block {
+    uint64_t paraId;
+    uint64_t blockId;
+    double weight;
+  };
+
+  struct Move {
+    uint64_t paraId;
+    uint64_t blockId;
+    int fromServer;
+    int toServer;
+  };
+
+  BlockPlacement(int numServers, double loadSlack);
+
+  /// place the blocks, which are weighted by their sizes
+  void init(const std::vector<Block>& blocks);
+
+  /// the pserver of a block, -1 if the block is not placed
+  int getServerId(uint64_t paraId, uint64_t blockId) const;
+
+  /**
+   * @brief move blocks off the pservers whose load with the new weights of
+   *        the blocks is more than the bound
+   *
+   * @return the blocks moved, which are already placed on their new pserver
+   */
+  std::vector<Move> rebalance(const std::vector<Block>& blocks);
+
+  /// the load of every pserver with the weights of blocks
+  std::vector<double> getLoads(const std::vector<Block>& blocks) const;
+
+  /// the pserver of a block, as published by another placement
+  void setServerId(uint64_t paraId, uint64_t blockId, int serverId);
+
+  /// incremented by every rebalance() which moves some block
+  int64_t getVersion() const { return version_; }
+  void setVersion(int64_t version) { version_ = version; }
+
+  int getNumServers() const { return numServers_; }
+
+private:
+  typedef std::pair<uint64_t, uint64_t> BlockKey;
+  struct BlockKeyHash {
+    size_t operator()(const BlockKey& key) const {
+      return std::hash<uint64_t>()(key.first) * 31 + key.second;
+    }
+  };
+
+  static constexpr int kVirtualNodes = 64;
+
+  /// the point of a block on the ring
+  static uint64_t hashBlock(uint64_t paraId, uint64_t blockId);
+
+  /**
+   * @brief the first pserver after the point of the block whose load plus
+   *        weight is at most capacity, -1 if there is none
+   */
+  int findServer(const Block& block,
+                 const std::vector<double>& loads,
+                 double capacity,
+                 int excludedServer) const;
+
+  double getCapacity(const std::vector<Block>& blocks) const;
+
+  int numServers_;
+  double loadSlack_;
+  int64_t version_;
+  /// <point, pserver>, sorted by point
+  std::vector<std::pair<uint64_t, int>> ring_;
+  std::unordered_map<BlockKey, int, BlockKeyHash> serverIds_;
+};
+
+}  // namespace paddle
@@ -0,0 +1,253 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "GradientEncoding.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+
+#include "paddle/utils/Logging.h"
+
+namespace paddle {
+
+namespace {
+
+/// number of reals holding n items of type T
+template <typename T>
+size_t realsOf(size_t n) {
+  return (n * sizeof(T) + sizeof(real) - 1) / sizeof(real);
+}
+
+/// round to the nearest half, ties to even, with overflow to infinity
+uint16_t floatToHalf(float value) {
+  uint32_t x;
+  memcpy(&x, &value, sizeof(x));
+  uint16_t sign = (x >> 16) & 0x8000;
+  uint32_t absx = x & 0x7fffffff;
+  if (absx >= 0x7f800000) {
+    /// inf or nan
+    return sign | 0x7c00 | (absx > 0x7f800000 ? 0x200 : 0);
+  }
+  if (absx >= 0x477ff000) {
+    /// rounds to more than 65504
+    return sign | 0x7c00;
+  }
+  if (absx < 0x38800000) {
+    /// subnormal half, or zero
+    if (absx < 0x33000000) {
+      return sign;
+    }
+    uint32_t mant = (absx & 0x7fffff) | 0x800000;
+    int shift = 126 - (absx >> 23);
+    uint32_t half = mant >> shift;
+    uint32_t rest = mant & ((1u << shift) - 1);
+    uint32_t mid = 1u << (shift - 1);
+    if (rest > mid || (rest == mid && (half & 1))) {
+      ++half;
+    }
+    return sign | half;
+  }
+  uint32_t half = ((absx >> 13) - (112 << 10));
+  uint32_t rest = absx & 0x1fff;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return sign | half;
+}
+
+float halfToFloat(uint16_t half) {
+  uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+  uint32_t exp = (half >> 10) & 0x1f;
+  uint32_t mant = half & 0x3ff;
+  uint32_t x;
+  if (exp == 0x1f) {
+    x = sign | 0x7f800000 | (mant << 13);
+  } else if (exp != 0) {
+    x = sign | ((exp + 112) << 23) | (mant << 13);
+  } else if (mant == 0) {
+    x = sign;
+  } else {
+    /// subnormal half, normal float
+    exp = 113;
+    while (!(mant & 0x400)) {
+      mant <<= 1;
+      --exp;
+    }
+    x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+  }
+  float value;
+  memcpy(&value, &x, sizeof(value));
+  return value;
+}
+
+size_t getTopk(size_t size, real topkRatio) {
+  size_t k = (size_t)std::lround(topkRatio * size);
+  return std::min(std::max(k, (size_t)1), size);
+}
+
+}  // namespace
+
+GradientEncoding GradientEncoder::parse(const std::string& name) {
+  if (name == "none") {
+    return GRADIENT_ENCODING_NONE;
+  } else if (name == "fp16") {
+    return GRADIENT_ENCODING_FP16;
+  } else if (name == "int8") {
+    return GRADIENT_ENCODING_INT8;
+  } else if (name == "topk") {
+    return GRADIENT_ENCODING_TOPK;
+  }
+  LOG(FATAL) << "unknown gradient encoding: " << name;
+  return GRADIENT_ENCODING_NONE;
+}
+
+size_t GradientEncoder::getEncodedSize(GradientEncoding encoding,
+                                       size_t size,
+                                       real topkRatio) {
+  switch (encoding) {
+    case GRADIENT_ENCODING_NONE:
+      return size;
+    case GRADIENT_ENCODING_FP16:
+      return realsOf<uint16_t>(size);
+    case GRADIENT_ENCODING_INT8:
+      return 1 + realsOf<int8_t>(size);
+    case GRADIENT_ENCODING_TOPK: {
+      size_t k = getTopk(size, topkRatio);
+      return realsOf<int32_t>(1) + realsOf<int32_t>(k) + k;
+    }
+  }
+  LOG(FATAL) << "unknown gradient encoding: " << encoding;
+  return 0;
+}
+
+void GradientEncoder::encode(GradientEncoding encoding,
+                             const real* grad,
+                             size_t size,
+                             real* residual,
+                             real topkRatio,
+                             real* out) {
+  /// residual becomes the value to send, and then what was not sent
+  for (size_t i = 0; i < size; ++i) {
+    residual[i] += grad[i];
+  }
+  memset(out, 0, getEncodedSize(encoding, size, topkRatio) * sizeof(real));
+
+  switch (encoding) {
+    case GRADIENT_ENCODING_NONE:
+      memcpy(out, residual, size * sizeof(real));
+      memset(residual, 0, size * sizeof(real));
+      break;
+    case GRADIENT_ENCODING_FP16: {
+      uint16_t* halfs = reinterpret_cast<uint16_t*>(out);
+      for (size_t i = 0; i < size; ++i) {
+        halfs[i] = floatToHalf(residual[i]);
+        residual[i] -= halfToFloat(halfs[i]);
+      }
+      break;
+    }
+    case GRADIENT_ENCODING_INT8: {
+      real maxAbs = 0;
+      for (size_t i = 0; i < size; ++i) {
+        maxAbs = std::max(maxAbs, std::abs(residual[i]));
+      }
+      real scale = maxAbs / 127;
+      out[0] = scale;
+      if (scale == 0) {
+        break;
+      }
+      int8_t* values = reinterpret_cast<int8_t*>(out + 1);
+      for (size_t i = 0; i < size; ++i) {
+        long q = std::lround(residual[i] / scale);
+        values[i] = (int8_t)std::min(std::max(q, -127L), 127L);
+        residual[i] -= scale * values[i];
+      }
+      break;
+    }
+    case GRADIENT_ENCODING_TOPK: {
+      size_t k = getTopk(size, topkRatio);
+      std::vector<int32_t> order(size);
+      for (size_t i = 0; i < size; ++i) {
+        order[i] = i;
+      }
+      std::nth_element(order.begin(),
+                       order.begin() + (k - 1),
+                       order.end(),
+                       [residual](int32_t a, int32_t b) {
+                         return std::abs(residual[a]) > std::abs(residual[b]);
+                       });
+      /// sent in increasing offsets for the locality of decode()
+      std::sort(order.begin(), order.begin() + k);
+      int32_t* header = reinterpret_cast<int32_t*>(out);
+      header[0] = k;
+      int32_t* offsets = reinterpret_cast<int32_t*>(out + realsOf<int32_t>(1));
+      real* values = out + realsOf<int32_t>(1) + realsOf<int32_t>(k);
+      for (size_t j = 0; j < k; ++j) {
+        offsets[j] = order[j];
+        values[j] = residual[order[j]];
+        residual[order[j]] = 0;
+      }
+      break;
+    }
+  }
+}
+
+void GradientEncoder::decode(GradientEncoding encoding,
+                             const real* data,
+                             size_t dataSize,
+                             real* out,
+                             size_t size) {
+  switch (encoding) {
+    case GRADIENT_ENCODING_NONE:
+      CHECK_EQ(dataSize, size);
+      memcpy(out, data, size * sizeof(real));
+      break;
+    case GRADIENT_ENCODING_FP16: {
+      CHECK_EQ(dataSize, realsOf<uint16_t>(size));
+      const uint16_t* halfs = reinterpret_cast<const uint16_t*>(data);
+      for (size_t i = 0; i < size; ++i) {
+        out[i] = halfToFloat(halfs[i]);
+      }
+      break;
+    }
+    case GRADIENT_ENCODING_INT8: {
+      CHECK_EQ(dataSize, 1 + realsOf<int8_t>(size));
+      real scale = data[0];
+      const int8_t* values = reinterpret_cast<const int8_t*>(data + 1);
+      for (size_t i = 0; i < size; ++i) {
+        out[i] = scale * values[i];
+      }
+      break;
+    }
+    case GRADIENT_ENCODING_TOPK: {
+      CHECK_GE(dataSize, realsOf<int32_t>(1));
+      size_t k = reinterpret_cast<const int32_t*>(data)[0];
+      CHECK_EQ(dataSize, realsOf<int32_t>(1) + realsOf<int32_t>(k) + k);
+      const int32_t* offsets =
+          reinterpret_cast<const int32_t*>(data + realsOf<int32_t>(1));
+      const real* values = data + realsOf<int32_t>(1) + realsOf<int32_t>(k);
+      memset(out, 0, size * sizeof(real));
+      for (size_t j = 0; j < k; ++j) {
+        CHECK_LT((size_t)offsets[j], size);
+        out[offsets[j]] = values[j];
+      }
+      break;
+    }
+    default:
+      LOG(FATAL) << "unknown gradient encoding: " << encoding;
+  }
+}
+
+}  // namespace paddle
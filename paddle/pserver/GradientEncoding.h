@@ -0,0 +1,72 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ParameterService.pb.h"
+#include "paddle/utils/Common.h"
+
+namespace paddle {
+
+/**
+ * @brief lossy encodings of the dense gradient blocks sent to pservers
+ *
+ * @note  the encodings keep the error of what was sent: the residual of a
+ *        block is added to its next gradient before it is encoded, so
+ *        the small values dropped by TOPK and the rounding of FP16 and
+ *        INT8 are sent later instead of being lost. The payloads are
+ *        padded to a multiple of sizeof(real), as the pserver reads the
+ *        blocks of a request as reals.
+ *
+ *        with TOPK a value waits about 1 / topkRatio steps before it is
+ *        sent, summed, so a small ratio needs a small learning rate and
+ *        momentum.
+ */
+class GradientEncoder {
+public:
+  /// parse "none", "fp16", "int8" or "topk"
+  static GradientEncoding parse(const std::string& name);
+
+  /// number of reals of the payload of a block of size reals
+  static size_t getEncodedSize(GradientEncoding encoding,
+                               size_t size,
+                               real topkRatio);
+
+  /**
+   * @brief encode size reals of grad into out
+   *
+   * @param residual  the residual of the block, size reals which are
+   *                  updated to (residual + grad) - decode(out)
+   * @param topkRatio the fraction of the values sent by TOPK
+   * @param out       getEncodedSize() reals
+   */
+  static void encode(GradientEncoding encoding,
+                     const real* grad,
+                     size_t size,
+                     real* residual,
+                     real topkRatio,
+                     real* out);
+
+  /// decode the payload of dataSize reals into the size reals of out
+  static void decode(GradientEncoding encoding,
+                     const real* data,
+                     size_t dataSize,
+                     real* out,
+                     size_t size);
+};
+
+}  // namespace paddle
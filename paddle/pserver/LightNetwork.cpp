@@ -18,6 +18,7 @@ limitations under the License. */
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <chrono>
 
 #include <arpa/inet.h>
@@ -28,6 +29,7 @@ limitations under the License. */
 
 #include "LightNetwork.h"
 #include "RDMANetwork.h"
+#include "SocketReactor.h"
 #include "paddle/utils/StringUtil.h"
 #include "paddle/utils/Util.h"
 
@@ -50,6 +52,23 @@ DEFINE_int32(sock_recv_buf_size,
              1024 * 1024 * 40,
              "restrict sock recv buff size");
 
+/// many trainers, each with --ports_num connections, would otherwise make
+/// thousands of threads mostly blocked in reading a connection
+DEFINE_int32(socket_worker_threads,
+             0,
+             "if > 0, the tcp server reads all the connections with epoll "
+             "and handles the requests with a pool of this number of "
+             "threads, instead of with one thread per connection");
+
+/// a synchronous pserver blocks a request of every trainer on its barriers
+DEFINE_int32(socket_max_worker_threads,
+             256,
+             "the pool of --socket_worker_threads starts extra threads, up "
+             "to this number of threads, while all of them are blocked. It "
+             "should be more than the number of requests which can block at "
+             "the same time, the number of trainers for a synchronous "
+             "pserver");
+
 namespace paddle {
 
 /**
@@ -123,10 +142,16 @@ void setOption(int sockfd) {
  *       server, and use --ports_num to build more connections to harness
  *       fat communication channel if necessary.
  *       each connection is controlled by single thread with blocking
- *       read and write.
+ *       read and write, or by a SocketReactor if --socket_worker_threads
+ *       is set.
  */
 SocketServer::SocketServer(const std::string &addr, int port, int rdmaCpu)
-    : port_(port), addr_(addr), stopping_(false) {
+    : port_(port),
+      addr_(addr),
+      numWorkerThreads_(FLAGS_socket_worker_threads),
+      maxWorkerThreads_(std::max(FLAGS_socket_worker_threads,
+                                 FLAGS_socket_max_worker_threads)),
+      stopping_(false) {
   if (rdmaCpu == -1) {
     tcpRdma_ = F_TCP;
     socket_ = 0;
@@ -158,7 +183,7 @@ SocketServer::~SocketServer() {
  * @brief start one tcp server which hosts parameter server
  *
  * @note do tcp socket bind and listen. it will spawn one thread
- *       for each connection
+ *       for each connection, or serve all of them with a SocketReactor
  */
 void SocketServer::tcpServer() {
   int newsockfd;
@@ -195,6 +220,15 @@ void SocketServer::tcpServer() {
   listen(socket_, maxPendingConnections_);
   clilen = sizeof(cli_addr);
 
+  if (numWorkerThreads_ > 0) {
+    SocketReactor reactor(this, numWorkerThreads_, maxWorkerThreads_);
+    reactor.run(socket_, stopping_);
+    close(socket_);
+    LOG(INFO) << "pserver epoll thread finish, addr=" << addr_
+              << " port=" << port_;
+    return;
+  }
+
   while (true) {
     /// Accept actual connection from the client
     newsockfd = accept(socket_, (struct sockaddr *)&cli_addr, &clilen);
@@ -69,6 +69,7 @@ protected:
   }
 
   friend class SocketWorker;
+  friend class SocketReactor;
 
 private:
   void rdmaServer();
@@ -87,6 +88,10 @@ protected:
   std::string addr_;
   int socket_;
   int maxPendingConnections_;
+  /// serve the tcp connections with a SocketReactor if > 0
+  int numWorkerThreads_;
+  /// the most threads of the SocketReactor, with its extra workers
+  int maxWorkerThreads_;
   bool stopping_;
 };
 
@@ -13,8 +13,10 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include <unistd.h>
+#include <map>
 
 #include "ParameterClient2.h"
+#include "GradientEncoding.h"
 #include "paddle/math/SparseRowMatrix.h"
 #include "paddle/utils/Flags.h"
 #include "paddle/utils/Stat.h"
@@ -22,6 +24,20 @@ limitations under the License. */
 
 DEFINE_string(pservers, "127.0.0.1", "Comma separated addresses of pservers");
 DEFINE_int32(parallel_thread_num, 1, "Thread number for parameter send");
+DEFINE_string(gradient_encoding,
+              "none",
+              "encoding of the dense gradients sent to pservers: "
+              "none, fp16, int8 or topk");
+DEFINE_double(gradient_topk_ratio,
+              0.01,
+              "fraction of the values of a block sent by the topk encoding");
+DEFINE_int32(gradient_encoding_min_size,
+             4096,
+             "the gradients of smaller parameters are not encoded");
+DEFINE_double(pserver_block_load_slack,
+              0.05,
+              "a pserver may store this fraction more than the average "
+              "size, or traffic after rebalancing, of the dense blocks");
 
 namespace paddle {
 
@@ -37,7 +53,10 @@ void copyToRepeatedField(google::protobuf::RepeatedField<T1>* dest,
 }
 
 ParameterClient2::ParameterClient2(bool separate, int port, int numPorts)
-    : BaseClient(separate, numPorts), port_(port) {
+    : BaseClient(separate, numPorts),
+      port_(port),
+      trainerId_(0),
+      gradientBytesSent_(0) {
 #ifndef PADDLE_DISABLE_TIMER
   forwardbackwordTime_ = 0;
 #endif
@@ -90,6 +109,10 @@ bool ParameterClient2::init(const std::vector<ParameterPtr>& parameters) {
     parameterMap_[para->getID()] = para;
   }
 
+  blockPlacement_.reset(
+      new BlockPlacement(serviceNum_, FLAGS_pserver_block_load_slack));
+  blockPlacement_->init(getDenseBlocks());
+
   allSegments_.reserve(parameters.size());
 
   for (auto& para : parameters) {
@@ -142,6 +165,7 @@ void ParameterClient2::destroy() {
   parameterMap_.clear();
   allSegments_.clear();
   clients_.clear();
+  gradientResiduals_.clear();
 }
 
 void ParameterClient2::sendParallel(int tid,
@@ -209,6 +233,9 @@ void ParameterClient2::prepareSendData(
     SendJob* sendJob) {
   sendJob->parallelRequests.resize(serviceNum_);
   sendJob->parallelInputIovs.resize(serviceNum_);
+  sendJob->encodedBlocks.clear();
+  GradientEncoding gradientEncoding =
+      GradientEncoder::parse(FLAGS_gradient_encoding);
 
   for (auto& request : sendJob->parallelRequests) {
 #ifndef PADDLE_DISABLE_TIMER
@@ -289,11 +316,26 @@ void ParameterClient2::prepareSendData(
     } else {  /// parameter set for dense and sparse
       real* buf =
           sendingPara ? parameter->getBuf(parameterType)->getPoint(0) : nullptr;
+      GradientEncoding encoding = GRADIENT_ENCODING_NONE;
+      real* residual = nullptr;
+      if (buf && parameterType == PARAMETER_GRADIENT &&
+          (updateMode == PSERVER_UPDATE_MODE_ADD_GRADIENT ||
+           updateMode == PSERVER_UPDATE_MODE_ASYNC_SGD) &&
+          paraSize >= (size_t)FLAGS_gradient_encoding_min_size) {
+        encoding = gradientEncoding;
+      }
+      if (encoding != GRADIENT_ENCODING_NONE) {
+        auto& residualVec = gradientResiduals_[segments.id];
+        residualVec.resize(paraSize, 0);
+        residual = residualVec.data();
+      }
       uint64_t endDim = 0;
       for (uint64_t beginDim = 0; beginDim < paraSize; beginDim = endDim) {
         endDim = std::min<int64_t>(beginDim + blockSize, paraSize);
         int64_t blockId = beginDim / blockSize;
-        int serverId = std::abs((blockId + nameHash) % serviceNum_);
+        int serverId = parameter->getConfig().sparse_remote_update()
+                           ? std::abs((blockId + nameHash) % serviceNum_)
+                           : blockPlacement_->getServerId(segments.id, blockId);
 
         auto& request = sendJob->parallelRequests[serverId];
         ParameterBlock* block = request.add_blocks();
@@ -301,9 +343,27 @@ void ParameterClient2::prepareSendData(
         block->set_block_id(blockId);
         block->set_begin_pos(beginDim);
         block->set_block_size(endDim - beginDim);
-        if (buf) {
+        if (encoding != GRADIENT_ENCODING_NONE) {
+          size_t size = endDim - beginDim;
+          sendJob->encodedBlocks.emplace_back(GradientEncoder::getEncodedSize(
+              encoding, size, FLAGS_gradient_topk_ratio));
+          auto& encoded = sendJob->encodedBlocks.back();
+          GradientEncoder::encode(encoding,
+                                  buf + beginDim,
+                                  size,
+                                  residual + beginDim,
+                                  FLAGS_gradient_topk_ratio,
+                                  encoded.data());
+          block->set_encoding(encoding);
+          sendJob->parallelInputIovs[serverId].push_back(
+              {encoded.data(), sizeof(real) * encoded.size()});
+          gradientBytesSent_ += sizeof(real) * encoded.size();
+        } else if (buf) {
           sendJob->parallelInputIovs[serverId].push_back(
               {buf + beginDim, sizeof(real) * ((size_t)(endDim - beginDim))});
+          if (parameterType == PARAMETER_GRADIENT) {
+            gradientBytesSent_ += sizeof(real) * (endDim - beginDim);
+          }
         }
       }
     }
@@ -312,6 +372,188 @@ void ParameterClient2::prepareSendData(
   sparseDistribution_->checkAndResetDistribution();
 }
 
+std::vector<BlockPlacement::Block> ParameterClient2::getDenseBlocks() const {
+  std::vector<BlockPlacement::Block> blocks;
+  for (const auto& idAndPara : parameterMap_) {
+    const ParameterConfig& config = idAndPara.second->getConfig();
+    if (config.sparse_remote_update()) {
+      continue;
+    }
+    uint64_t blockSize = config.parameter_block_size();
+    uint64_t paraSize = idAndPara.second->getSize();
+    for (uint64_t beginDim = 0; beginDim < paraSize; beginDim += blockSize) {
+      double size = std::min(blockSize, paraSize - beginDim);
+      blocks.push_back({idAndPara.first, beginDim / blockSize, size});
+    }
+  }
+  return blocks;
+}
+
+void ParameterClient2::setDenseBlock(uint64_t paraId,
+                                     uint64_t blockId,
+                                     ParameterBlock* block) const {
+  const auto it = parameterMap_.find(paraId);
+  CHECK(it != parameterMap_.end()) << "can not find parameter id: " << paraId;
+  uint64_t blockSize = it->second->getConfig().parameter_block_size();
+  uint64_t beginDim = blockId * blockSize;
+  uint64_t endDim = std::min<uint64_t>(beginDim + blockSize,
+                                       it->second->getSize());
+  block->set_para_id(paraId);
+  block->set_block_id(blockId);
+  block->set_begin_pos(beginDim);
+  block->set_block_size(endDim - beginDim);
+}
+
+size_t ParameterClient2::rebalanceBlocks() {
+  GetBlockTrafficRequest request;
+  std::vector<GetBlockTrafficResponse> responses;
+  multiCall("getBlockTraffic", request, &responses);
+
+  typedef std::pair<uint64_t, uint64_t> BlockKey;
+  /// <(para, block), (requests, bytes)>
+  std::map<BlockKey, std::pair<double, double>> traffics;
+  double totalRequests = 0;
+  double totalBytes = 0;
+  for (const auto& response : responses) {
+    for (const auto& traffic : response.blocks()) {
+      auto& sum = traffics[BlockKey(traffic.para_id(), traffic.block_id())];
+      sum.first += traffic.num_requests();
+      sum.second += traffic.num_bytes();
+      totalRequests += traffic.num_requests();
+      totalBytes += traffic.num_bytes();
+    }
+  }
+  if (totalRequests == 0 || totalBytes == 0) {
+    LOG(INFO) << "no traffic on the dense blocks, nothing to rebalance";
+    return 0;
+  }
+
+  std::vector<BlockPlacement::Block> blocks = getDenseBlocks();
+  for (auto& block : blocks) {
+    auto it = traffics.find(BlockKey(block.paraId, block.blockId));
+    block.weight = it == traffics.end()
+                       ? 0
+                       : it->second.first / totalRequests +
+                             it->second.second / totalBytes;
+  }
+  std::vector<double> oldLoads = blockPlacement_->getLoads(blocks);
+  std::vector<BlockPlacement::Move> moves = blockPlacement_->rebalance(blocks);
+  std::vector<double> newLoads = blockPlacement_->getLoads(blocks);
+  LOG(INFO) << "rebalance the dense blocks: max traffic share of a pserver "
+            << *std::max_element(oldLoads.begin(), oldLoads.end()) / 2
+            << " -> " << *std::max_element(newLoads.begin(), newLoads.end()) / 2
+            << ", " << moves.size() << " blocks moved";
+  if (moves.empty()) {
+    return 0;
+  }
+  moveBlocks(moves);
+
+  SetBlockPlacementRequest placementRequest;
+  placementRequest.set_version(blockPlacement_->getVersion());
+  for (const auto& block : blocks) {
+    PlacedBlock* placed = placementRequest.add_blocks();
+    placed->set_para_id(block.paraId);
+    placed->set_block_id(block.blockId);
+    placed->set_server_id(
+        blockPlacement_->getServerId(block.paraId, block.blockId));
+  }
+  std::vector<SetBlockPlacementResponse> placementResponses;
+  multiCall("setBlockPlacement", placementRequest, &placementResponses);
+  return moves.size();
+}
+
+void ParameterClient2::moveBlocks(
+    const std::vector<BlockPlacement::Move>& moves) {
+  std::vector<ExportBlocksRequest> exportRequests(serviceNum_);
+  std::vector<std::vector<int>> destinations(serviceNum_);
+  for (const auto& move : moves) {
+    setDenseBlock(move.paraId,
+                  move.blockId,
+                  exportRequests[move.fromServer].add_blocks());
+    destinations[move.fromServer].push_back(move.toServer);
+  }
+
+  for (int i = 0; i < serviceNum_; ++i) {
+    if (exportRequests[i].blocks_size()) {
+      clients_[i].send("exportBlocks", exportRequests[i]);
+    }
+  }
+  /// the data of all the blocks moved, kept until they are imported
+  std::vector<std::vector<real>> datas(serviceNum_);
+  std::vector<ImportBlocksRequest> importRequests(serviceNum_);
+  std::vector<std::vector<iovec>> importIovs(serviceNum_);
+  for (int i = 0; i < serviceNum_; ++i) {
+    if (!exportRequests[i].blocks_size()) {
+      continue;
+    }
+    ExportBlocksResponse response;
+    auto msgReader = clients_[i].recv(&response);
+    size_t numTypes = response.parameter_types_size();
+    CHECK_EQ(msgReader->getNumBlocks(),
+             (size_t)exportRequests[i].blocks_size() * numTypes);
+    datas[i].resize(msgReader->getTotalLength() / sizeof(real));
+    std::vector<void*> bufs;
+    bufs.reserve(msgReader->getNumBlocks());
+    size_t offset = 0;
+    for (int j = 0; j < exportRequests[i].blocks_size(); ++j) {
+      const ParameterBlock& block = exportRequests[i].blocks(j);
+      ImportBlocksRequest& importRequest = importRequests[destinations[i][j]];
+      *importRequest.add_blocks() = block;
+      if (!importRequest.parameter_types_size()) {
+        importRequest.mutable_parameter_types()->CopyFrom(
+            response.parameter_types());
+      }
+      CHECK_EQ((size_t)importRequest.parameter_types_size(), numTypes);
+      for (size_t k = 0; k < numTypes; ++k) {
+        CHECK_EQ(msgReader->getBlockLength(bufs.size()),
+                 sizeof(real) * block.block_size());
+        bufs.push_back(&datas[i][offset]);
+        importIovs[destinations[i][j]].push_back(
+            {&datas[i][offset], sizeof(real) * block.block_size()});
+        offset += block.block_size();
+      }
+    }
+    msgReader->readBlocks(bufs);
+  }
+
+  for (int i = 0; i < serviceNum_; ++i) {
+    if (importRequests[i].blocks_size()) {
+      clients_[i].send("importBlocks", importRequests[i], importIovs[i]);
+    }
+  }
+  for (int i = 0; i < serviceNum_; ++i) {
+    if (importRequests[i].blocks_size()) {
+      ImportBlocksResponse response;
+      clients_[i].recv(&response);
+    }
+  }
+}
+
+void ParameterClient2::updateBlockPlacement() {
+  GetBlockPlacementRequest request;
+  GetBlockPlacementResponse response;
+  clients_[0].sendAndRecv("getBlockPlacement", request, &response);
+  if (response.version() <= blockPlacement_->getVersion()) {
+    return;
+  }
+  for (const auto& placed : response.blocks()) {
+    blockPlacement_->setServerId(
+        placed.para_id(), placed.block_id(), placed.server_id());
+  }
+  blockPlacement_->setVersion(response.version());
+  LOG(INFO) << "use the placement " << response.version()
+            << " of the dense blocks";
+}
+
+size_t ParameterClient2::syncRebalanceBlocks() {
+  size_t numMoved = trainerId_ == 0 ? rebalanceBlocks() : 0;
+  synchronize();
+  if (trainerId_ != 0) {
+    updateBlockPlacement();
+  }
+  return numMoved;
+}
+
 void ParameterClient2::sendAndReceiveParameter(
     ParameterUpdateMode updateMode,
     ParameterType parameterType,
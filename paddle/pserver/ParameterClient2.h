@@ -23,6 +23,7 @@ limitations under the License. */
 #include "paddle/math/Vector.h"
 #include "paddle/parameter/Parameter.h"
 #include "paddle/pserver/BaseClient.h"
+#include "paddle/pserver/BlockPlacement.h"
 #include "paddle/utils/Common.h"
 #include "paddle/utils/Flags.h"
 #include "paddle/utils/Locks.h"
@@ -514,6 +515,39 @@ public:
   void setForwardbackwardTime(uint64_t delta) { forwardbackwordTime_ = delta; }
 #endif
 
+  /// bytes of the dense gradient blocks sent so far, after their encoding
+  int64_t getGradientBytesSent() const { return gradientBytesSent_; }
+
+  /**
+   * @brief move dense blocks between the pservers to balance the traffic
+   *        they had since the last call, and publish the new placement
+   *
+   * @note  the blocks are weighted by their share of the bytes and of the
+   *        requests seen by the pservers, see BlockPlacement::rebalance().
+   *        Only one trainer may call it, between two passes while no other
+   *        request is sent. The other trainers then call
+   *        updateBlockPlacement() before they send anything.
+   *
+   * @return the number of blocks moved
+   */
+  size_t rebalanceBlocks();
+
+  /// use the placement published by rebalanceBlocks(), if there is one
+  void updateBlockPlacement();
+
+  /**
+   * @brief rebalanceBlocks() on trainer 0, then every trainer uses the
+   *        placement it published
+   *
+   * @note  called by all the trainers at the end of a pass, it synchronizes
+   *        them so that none sends anything before the blocks are moved.
+   *
+   * @return the number of blocks moved, 0 on the other trainers
+   */
+  size_t syncRebalanceBlocks();
+
+  const BlockPlacement& getBlockPlacement() const { return *blockPlacement_; }
+
 protected:
   template <typename ProtoIn, typename ProtoOut>
   void multiCall(const char* funcName,
@@ -573,6 +607,17 @@ private:
   /// start necessary threads for threadPool
   void initThreads();
 
+  /// the blocks of the dense parameters, weighted by their sizes
+  std::vector<BlockPlacement::Block> getDenseBlocks() const;
+
+  /// the block of a dense parameter, as sent to its pserver
+  void setDenseBlock(uint64_t paraId,
+                     uint64_t blockId,
+                     ParameterBlock* block) const;
+
+  /// copy the moved blocks from their old pservers to the new ones
+  void moveBlocks(const std::vector<BlockPlacement::Move>& moves);
+
 protected:
   /// start port number of pserver
   /// it deduce all ports for dense and sparse with some rules
@@ -592,6 +637,15 @@ protected:
   /// module for sensing sparse parameters distribution on all pservers
   std::unique_ptr<SparseParameterDistribution> sparseDistribution_;
 
+  /// map id to the part of the gradient not sent yet by the lossy
+  /// encodings of --gradient_encoding
+  std::unordered_map<size_t, std::vector<real>> gradientResiduals_;
+  int64_t gradientBytesSent_;
+
+  /// the pservers of the dense blocks, the blocks of the sparse remote
+  /// parameters are spread by the hash of their parameter name
+  std::unique_ptr<BlockPlacement> blockPlacement_;
+
   /// thread pool for parallelizing all connections to pservers
   std::unique_ptr<SyncThreadPool> syncThreadPool_;
 
@@ -17,6 +17,7 @@ limitations under the License. */
 #include <algorithm>
 #include <fstream>
 
+#include "GradientEncoding.h"
 #include "paddle/math/SIMDFunctions.h"
 #include "paddle/parameter/AverageOptimizer.h"
 #include "paddle/parameter/FirstOrderOptimizer.h"
@@ -32,6 +33,17 @@ limitations under the License. */
 #include "paddle/utils/StringUtil.h"
 
 DEFINE_int32(pserver_num_threads, 1, "number of threads for sync op exec");
+DEFINE_bool(pserver_gradient_partial_sums,
+            false,
+            "sync sgd: the connection threads of a dense pserver add the "
+            "gradients to partial sums, which are merged once all the "
+            "trainers have sent them. It uses a copy of the "
+            "parameters per slot of trainers, and saves the lock of each "
+            "block");
+DEFINE_int32(pserver_num_gradient_partial_sums,
+             4,
+             "the most partial sums of --pserver_gradient_partial_sums, the "
+             "trainers share them by trainer id");
 DEFINE_double(async_lagged_ratio_min,
               1.0,
               "control config_.async_lagged_grad_discard_ratio() min value");
@@ -85,6 +97,11 @@ ParameterServer2::ParameterServer2(const std::string& addr,
   REGISTER_SERVICE_FUNCTION(ParameterServer2, asyncFinishPass);
   REGISTER_SERVICE_FUNCTION(ParameterServer2, loadValueVector);
   REGISTER_SERVICE_FUNCTION(ParameterServer2, saveValueVector);
+  REGISTER_SERVICE_FUNCTION(ParameterServer2, getBlockTraffic);
+  REGISTER_SERVICE_FUNCTION_EX(ParameterServer2, exportBlocks);
+  REGISTER_SERVICE_FUNCTION_EX(ParameterServer2, importBlocks);
+  REGISTER_SERVICE_FUNCTION(ParameterServer2, setBlockPlacement);
+  REGISTER_SERVICE_FUNCTION(ParameterServer2, getBlockPlacement);
 
   /// thread pool for parallelizing some computations
   if (FLAGS_pserver_num_threads > 1) {
@@ -260,7 +277,8 @@ void ParameterServer2::setParameter(const SendParameterRequest& request,
   LOG(INFO) << "pserver: setParameter";
   std::lock_guard<RWLock> guard(parameterMutex_);
 
-  int64_t numBlocks = blockIdMap_.size();
+  /// the ids of the blocks released by releaseBlocks() are not reused
+  int64_t numBlocks = blockInfos_.size();
   CHECK_EQ(blockIdMap_.size(), blockOffsetMap_.size());
   /// total bytes for all the added blocks
   int64_t totalSize = size_;
@@ -304,6 +322,8 @@ void ParameterServer2::setParameter(const SendParameterRequest& request,
 
   size_ = totalSize;
   LOG(INFO) << "pserver: new cpuvector: size=" << size_;
+  /// the partial sums are created again for the new blocks
+  gradientPartialSums_.clear();
   if (!vectors_[PARAMETER_VALUE]) {
     /// vectors_
     const auto types = sgdOptimizerGetTypes(config_, true /*inPserver*/);
@@ -344,6 +364,7 @@ void ParameterServer2::setParameter(const SendParameterRequest& request,
           << "width : " << width;
     }
     info.optimizer->init(1, info.config);
+    info.active = true;
     usedSegments_.push_back(std::make_pair(
         offsets[i], offsets[i] + request.blocks(i).block_size()));
   }
@@ -413,7 +434,18 @@ void ParameterServer2::addGradient(const SendParameterRequest& request,
 
   {
     REGISTER_TIMER_DYNAMIC("addGradCore", -1, *statSet_);
+#ifndef PADDLE_DISABLE_TIMER
+    struct timeval addGradCoreBegin;
+    gettimeofday(&addGradCoreBegin, nullptr);
+#endif
     ReadLockGuard guard(parameterMutex_);
+    GradientPartialSum* partialSum = nullptr;
+    std::unique_lock<std::mutex> partialSumGuard;
+    if (FLAGS_pserver_gradient_partial_sums && !isSparseServer_) {
+      partialSum = getGradientPartialSum(request.trainer_id());
+      partialSumGuard = std::unique_lock<std::mutex>(partialSum->lock);
+      partialSum->dirty = true;
+    }
     int bufferIndex = 0;
     for (const auto& block : request.blocks()) {
       int64_t offset = getBlockOffset(block);
@@ -441,6 +473,11 @@ void ParameterServer2::addGradient(const SendParameterRequest& request,
       } else {  // dense
         CHECK_LE(size, config.parameter_block_size());
       }
+      if (partialSum) {
+        simd::addTo(partialSum->values->getPoint(offset), gradientBuffer, size);
+        partialSum->dirtyBlocks[blockId] = true;
+        continue;
+      }
       std::lock_guard<std::mutex> guard(*info.lock);
       simd::addTo(gradientSumBuffer, gradientBuffer, size);
     }
@@ -452,6 +489,20 @@ void ParameterServer2::addGradient(const SendParameterRequest& request,
           FLAGS_num_gradient_servers,
           request.trainer_id(),
           isSparseServer_ ? "_sparseUpdater" : "_denseUpdater");
+#ifndef PADDLE_DISABLE_TIMER
+      struct timeval addGradCoreEnd;
+      gettimeofday(&addGradCoreEnd, nullptr);
+#endif
+      /// time of each trainer to add its gradients, including the wait
+      /// for the locks of the blocks
+      REGISTER_BARRIER_DELTA_SERVER_SET(
+          *statSet_,
+          "addGradCoreDelta",
+          FLAGS_num_gradient_servers,
+          request.trainer_id(),
+          timeToMicroSecond(addGradCoreEnd) -
+              timeToMicroSecond(addGradCoreBegin),
+          isSparseServer_ ? "_sparseUpdater" : "_denseUpdater");
     }
   }
   if (request.batch_status() == BATCH_FINISH ||
@@ -822,6 +873,37 @@ void ParameterServer2::readAllBlocks(
   msgReader->readBlocks(bufs);
 }
 
+void ParameterServer2::decodeGradientBlocks(
+    const SendParameterRequest& request,
+    std::vector<ParameterServer2::Buffer>* buffers) {
+  size_t numReals = 0;
+  for (const auto& block : request.blocks()) {
+    if (block.encoding() != GRADIENT_ENCODING_NONE) {
+      numReals += block.block_size();
+    }
+  }
+  if (!numReals) {
+    return;
+  }
+  CHECK_EQ((size_t)request.blocks_size(), buffers->size());
+
+  auto& buffer = *decodeBuffer_;
+  buffer.resize(numReals);
+  real* values = buffer.data();
+  for (int i = 0; i < request.blocks_size(); ++i) {
+    const ParameterBlock& block = request.blocks(i);
+    if (block.encoding() == GRADIENT_ENCODING_NONE) {
+      continue;
+    }
+    Buffer& input = (*buffers)[i];
+    size_t size = block.block_size();
+    GradientEncoder::decode(
+        block.encoding(), input.base, input.size, values, size);
+    input = {values, size};
+    values += size;
+  }
+}
+
 void ParameterServer2::sendParameter(const SendParameterRequest& request,
                                      std::unique_ptr<MsgReader> msgReader,
                                      ProtoResponseCallbackEx callback) {
@@ -830,6 +912,8 @@ void ParameterServer2::sendParameter(const SendParameterRequest& request,
   std::vector<Buffer> outputBuffers;
   readAllBlocks(msgReader.get(), &inputBuffers);
   msgReader.reset();
+  decodeGradientBlocks(request, &inputBuffers);
+  addBlockTraffic(request);
 
   switch (request.update_mode()) {
     case PSERVER_UPDATE_MODE_SET_PARAM:
@@ -1053,15 +1137,74 @@ void ParameterServer2::clearUnusedSegments(CpuVector* vec) {
 void ParameterServer2::parallelExecForEachBlock(ExecFunc func) {
   SyncThreadPool::execHelper(
       syncThreadPool_.get(), [&](int tid, size_t numThreads) {
-        int64_t numBlocks = blockIdMap_.size();
+        int64_t numBlocks = blockInfos_.size();
         VectorPtr* vecs = parameter::getThreadLocalBuffer();
         for (int64_t blockId = tid; blockId < numBlocks;
              blockId += numThreads) {
+          if (!blockInfos_[blockId].active) {
+            continue;
+          }
           func(blockId, vecs);
         }
       });
 }
 
+ParameterServer2::GradientPartialSum*
+ParameterServer2::getGradientPartialSum(int trainerId) {
+  std::lock_guard<std::mutex> guard(gradientPartialSumsLock_);
+  if (gradientPartialSums_.empty()) {
+    gradientPartialSums_.resize(std::max(
+        1,
+        std::min(FLAGS_pserver_num_gradient_partial_sums,
+                 FLAGS_num_gradient_servers)));
+  }
+  auto& partialSum =
+      gradientPartialSums_[trainerId % gradientPartialSums_.size()];
+  if (!partialSum) {
+    partialSum.reset(new GradientPartialSum);
+    partialSum->values.reset(new CpuVector(size_));
+    partialSum->values->zeroMem();
+    partialSum->dirtyBlocks.assign(blockInfos_.size(), false);
+    partialSum->dirty = false;
+  }
+  return partialSum.get();
+}
+
+void ParameterServer2::mergeGradientPartialSums() {
+  std::vector<GradientPartialSum*> partialSums;
+  {
+    std::lock_guard<std::mutex> guard(gradientPartialSumsLock_);
+    for (auto& sum : gradientPartialSums_) {
+      if (sum && sum->dirty) {
+        partialSums.push_back(sum.get());
+      }
+    }
+  }
+  if (partialSums.empty()) {
+    return;
+  }
+
+  REGISTER_TIMER_DYNAMIC("mergeGradient", -1, *statSet_);
+  parallelExecForEachBlock([&](int64_t blockId, const VectorPtr vecs[]) {
+    (void)vecs;
+    int64_t offset = blockInfos_[blockId].offset;
+    size_t size = getParameterConfig(blockId).parameter_block_size();
+    real* gradientSumBuffer = vectors_[PARAMETER_GRADIENT]->getPoint(offset);
+    for (auto partialSum : partialSums) {
+      if (!partialSum->dirtyBlocks[blockId]) {
+        continue;
+      }
+      real* values = partialSum->values->getPoint(offset);
+      simd::addTo(gradientSumBuffer, values, size);
+      memset(values, 0, sizeof(real) * size);
+      partialSum->dirtyBlocks[blockId] = false;
+    }
+  });
+  for (auto partialSum : partialSums) {
+    partialSum->dirty = false;
+  }
+}
+
 void ParameterServer2::blockTraverse(
     BlockInfo& info,
     const ParameterConfig& config,
@@ -1255,6 +1398,269 @@ void ParameterServer2::saveValueVector(const SaveValueRequest& request,
   callback(response);
 }
 
+void ParameterServer2::addBlockTraffic(const SendParameterRequest& request) {
+  if (isSparseServer_) {
+    return;
+  }
+  int64_t numCopies = 1;
+  switch (request.update_mode()) {
+    case PSERVER_UPDATE_MODE_ADD_GRADIENT:
+    case PSERVER_UPDATE_MODE_ASYNC_SGD:
+      numCopies = request.send_back_parameter() ? 2 : 1;
+      break;
+    case PSERVER_UPDATE_MODE_GET_PARAM:
+      break;
+    default:
+      return;
+  }
+  std::lock_guard<std::mutex> guard(blockTrafficLock_);
+  for (const auto& block : request.blocks()) {
+    auto& stat = blockTraffic_[BlockKey(block.para_id(), block.block_id())];
+    stat.numRequests += 1;
+    stat.numBytes += numCopies * sizeof(real) * block.block_size();
+  }
+}
+
+void ParameterServer2::getBlockTraffic(const GetBlockTrafficRequest& request,
+                                       ProtoResponseCallback callback) {
+  (void)request;
+  GetBlockTrafficResponse response;
+  {
+    std::lock_guard<std::mutex> guard(blockTrafficLock_);
+    for (const auto& keyAndStat : blockTraffic_) {
+      BlockTraffic* traffic = response.add_blocks();
+      traffic->set_para_id(keyAndStat.first.first);
+      traffic->set_block_id(keyAndStat.first.second);
+      traffic->set_num_requests(keyAndStat.second.numRequests);
+      traffic->set_num_bytes(keyAndStat.second.numBytes);
+    }
+    blockTraffic_.clear();
+  }
+  callback(response);
+}
+
+void ParameterServer2::addBlocks(
+    const google::protobuf::RepeatedPtrField<ParameterBlock>& blocks) {
+  CHECK(!isSparseServer_) << "only dense blocks can be added";
+  int64_t numBlocks = blockInfos_.size();
+  int64_t totalSize = size_;
+  std::vector<const ParameterBlock*> newBlocks;
+  size_t numReused = 0;
+  for (const auto& block : blocks) {
+    BlockKey key(block.para_id(), block.block_id());
+    if (blockIdMap_.count(key)) {
+      continue;
+    }
+    size_t blockSize = getParameterConfig(block).parameter_block_size();
+    auto it = std::find_if(
+        freeBlockIds_.begin(), freeBlockIds_.end(), [&](int64_t blockId) {
+          return getParameterConfig(blockId).parameter_block_size() ==
+                 blockSize;
+        });
+    if (it != freeBlockIds_.end()) {
+      blockOffsetMap_[key] = blockInfos_[*it].offset;
+      blockIdMap_[key] = *it;
+      freeBlockIds_.erase(it);
+      ++numReused;
+    } else {
+      blockOffsetMap_[key] = totalSize;
+      blockIdMap_[key] = numBlocks;
+      ++numBlocks;
+      totalSize += blockSize;
+    }
+    newBlocks.push_back(&block);
+  }
+  if (newBlocks.empty()) {
+    return;
+  }
+
+  LOG(INFO) << "pserver: add " << newBlocks.size() << " blocks, "
+            << numReused << " of them in released storage, new cpuvector: "
+            << "size=" << totalSize;
+  if (!vectors_[PARAMETER_VALUE]) {
+    const auto types = sgdOptimizerGetTypes(config_, true /*inPserver*/);
+    for (const auto type : types) {
+      vectors_[type].reset(new CpuVector(totalSize));
+      vectors_[type]->zeroMem();
+    }
+  } else if (totalSize > size_) {
+    /// including the vectors created by createVector()
+    for (auto& vec : vectors_) {
+      if (!vec) {
+        continue;
+      }
+      CHECK_EQ(vec->getSize(), (size_t)size_);
+      CpuVectorPtr grown = std::make_shared<CpuVector>(totalSize);
+      grown->zeroMem();
+      memcpy(grown->getData(), vec->getData(), sizeof(real) * size_);
+      vec = grown;
+    }
+  }
+  for (auto& partialSum : gradientPartialSums_) {
+    if (!partialSum) {
+      continue;
+    }
+    if (totalSize > size_) {
+      CpuVectorPtr grown = std::make_shared<CpuVector>(totalSize);
+      grown->zeroMem();
+      memcpy(grown->getData(),
+             partialSum->values->getData(),
+             sizeof(real) * size_);
+      partialSum->values = grown;
+    }
+    partialSum->dirtyBlocks.resize(numBlocks, false);
+  }
+  size_ = totalSize;
+
+  blockInfos_.resize(numBlocks);
+  for (const ParameterBlock* block : newBlocks) {
+    BlockInfo& info = blockInfos_[getBlockId(*block)];
+    const ParameterConfig& config = getParameterConfig(*block);
+    info.lock.reset(new std::mutex());
+    info.config = &config;
+    info.offset = getBlockOffset(*block);
+    info.optimizer.reset(sgdOptimizerCreate(
+        config_, config, config.sparse_remote_update(), true /*inPserver*/));
+    info.optimizer->init(1, info.config);
+    info.active = true;
+    /// the released storage still holds the block which was there
+    for (auto& vec : vectors_) {
+      if (vec) {
+        memset(vec->getPoint(info.offset),
+               0,
+               sizeof(real) * config.parameter_block_size());
+      }
+    }
+    usedSegments_.push_back(
+        std::make_pair(info.offset, info.offset + block->block_size()));
+  }
+  mergeSegments(&usedSegments_);
+}
+
+void ParameterServer2::releaseBlocks(const std::vector<BlockKey>& keys) {
+  if (keys.empty()) {
+    return;
+  }
+  for (const auto& key : keys) {
+    auto it = blockIdMap_.find(key);
+    CHECK(it != blockIdMap_.end());
+    int64_t blockId = it->second;
+    BlockInfo& info = blockInfos_[blockId];
+    info.active = false;
+    info.optimizer.reset();
+    for (auto& partialSum : gradientPartialSums_) {
+      if (partialSum) {
+        partialSum->dirtyBlocks[blockId] = false;
+      }
+    }
+    blockIdMap_.erase(it);
+    blockOffsetMap_.erase(key);
+    freeBlockIds_.push_back(blockId);
+  }
+
+  usedSegments_.clear();
+  for (const auto& keyAndId : blockIdMap_) {
+    const BlockInfo& info = blockInfos_[keyAndId.second];
+    uint64_t blockSize = info.config->parameter_block_size();
+    uint64_t begin = keyAndId.first.second * blockSize;
+    usedSegments_.push_back(std::make_pair(
+        info.offset,
+        info.offset + std::min(blockSize, info.config->size() - begin)));
+  }
+  mergeSegments(&usedSegments_);
+  LOG(INFO) << "pserver: release " << keys.size() << " blocks moved away, "
+            << freeBlockIds_.size() << " blocks of storage free";
+}
+
+void ParameterServer2::exportBlocks(const ExportBlocksRequest& request,
+                                    std::unique_ptr<MsgReader> msgReader,
+                                    ProtoResponseCallbackEx callback) {
+  msgReader.reset();
+  ExportBlocksResponse response;
+  std::vector<iovec> outputIovs;
+  ReadLockGuard guard(parameterMutex_);
+  /// the gradients are not kept from one batch to the next
+  for (int type = 0; type < NUM_PARAMETER_TYPES; ++type) {
+    if (type != PARAMETER_GRADIENT && vectors_[type]) {
+      response.add_parameter_types(type);
+    }
+  }
+  outputIovs.reserve(request.blocks_size() * response.parameter_types_size());
+  for (const auto& block : request.blocks()) {
+    int64_t offset = getBlockOffset(block);
+    CHECK_GE(offset, 0) << "Only existing parameter block is allowed: "
+                        << " id=" << block.para_id()
+                        << " block id=" << block.block_id();
+    for (int type : response.parameter_types()) {
+      outputIovs.push_back({vectors_[type]->getPoint(offset),
+                            sizeof(real) * block.block_size()});
+    }
+  }
+  callback(response, outputIovs);
+}
+
+void ParameterServer2::importBlocks(const ImportBlocksRequest& request,
+                                    std::unique_ptr<MsgReader> msgReader,
+                                    ProtoResponseCallbackEx callback) {
+  std::vector<Buffer> inputBuffers;
+  readAllBlocks(msgReader.get(), &inputBuffers);
+  msgReader.reset();
+  {
+    std::lock_guard<RWLock> guard(parameterMutex_);
+    addBlocks(request.blocks());
+    CHECK_EQ(inputBuffers.size(),
+             (size_t)request.blocks_size() * request.parameter_types_size());
+    size_t bufferIndex = 0;
+    for (const auto& block : request.blocks()) {
+      int64_t offset = getBlockOffset(block);
+      for (int type : request.parameter_types()) {
+        CHECK(type < NUM_PARAMETER_TYPES && vectors_[type])
+            << "parameter type " << type << " is not stored by pserver "
+            << serverId_;
+        Buffer buffer = inputBuffers[bufferIndex];
+        ++bufferIndex;
+        CHECK_EQ(buffer.size, block.block_size());
+        memcpy(vectors_[type]->getPoint(offset),
+               buffer.base,
+               sizeof(real) * buffer.size);
+      }
+    }
+  }
+  callback(ImportBlocksResponse(), {});
+}
+
+void ParameterServer2::setBlockPlacement(
+    const SetBlockPlacementRequest& request, ProtoResponseCallback callback) {
+  if (!isSparseServer_) {
+    std::lock_guard<RWLock> guard(parameterMutex_);
+    std::vector<BlockKey> departedKeys;
+    for (const auto& placed : request.blocks()) {
+      BlockKey key(placed.para_id(), placed.block_id());
+      if (placed.server_id() != serverId_ && blockIdMap_.count(key)) {
+        departedKeys.push_back(key);
+      }
+    }
+    releaseBlocks(departedKeys);
+  }
+  {
+    std::lock_guard<std::mutex> guard(blockPlacementLock_);
+    blockPlacement_.set_version(request.version());
+    blockPlacement_.mutable_blocks()->CopyFrom(request.blocks());
+  }
+  callback(SetBlockPlacementResponse());
+}
+
+void ParameterServer2::getBlockPlacement(
+    const GetBlockPlacementRequest& request, ProtoResponseCallback callback) {
+  (void)request;
+  GetBlockPlacementResponse response;
+  {
+    std::lock_guard<std::mutex> guard(blockPlacementLock_);
+    response = blockPlacement_;
+  }
+  callback(response);
+}
+
 void ParameterServer2::op_RESET(const Operation& operation,
                                 OperationResult* result) {
   (void)result;
@@ -1447,6 +1853,7 @@ void ParameterServer2::doOperation(const DoOperationRequest& request,
     /// wait gradient update
     gradientReadyBarrier_.wait();
     allClientPassFinish_ = numPassFinishClients_ == FLAGS_num_gradient_servers;
+    mergeGradientPartialSums();
   }
 
   DoOperationResponse response;
@@ -141,8 +141,13 @@ protected:
      * with multithreads.
      */
     std::unique_ptr<ParameterOptimizer> optimizer;
+    /// false once the block has moved to another pserver, its storage is
+    /// then kept in freeBlockIds_ and skipped by parallelExecForEachBlock()
+    bool active;
   };
   std::vector<BlockInfo> blockInfos_;
+  /// the blocks which have moved away, whose storage addBlocks() reuses
+  std::vector<int64_t> freeBlockIds_;
 
   typedef std::vector<std::pair<int64_t, int64_t>> BlockSegments;
   /// Because some blocks might not be fully used. We keep a
@@ -236,6 +241,8 @@ protected:
   /// to buffer the data from network for further processing to
   /// reduce redundant memory allocation.
   ThreadLocal<ReadWriteBuffer<real, ALIGN_HINT>> readWriteBuffer_;
+  /// the values of the encoded blocks of the request being handled
+  ThreadLocal<std::vector<real>> decodeBuffer_;
 
   /// size of the parameter
   int64_t size_;
@@ -248,6 +255,43 @@ protected:
   ThreadLocal<std::vector<SendParameterRequest>> requestVec_;
   ThreadLocal<std::vector<ProtoResponseCallbackEx>> callbackVec_;
 
+  /**
+   * @brief the gradients added by the trainers of one slot
+   *
+   * @note  with --pserver_gradient_partial_sums, addGradient() of a dense
+   *        pserver adds the blocks of a request to the partial sum of the
+   *        slot of its trainer, under the lock of the slot instead of the
+   *        lock of each block. There are at most
+   *        --pserver_num_gradient_partial_sums slots, shared by the trainers
+   *        by trainer id, so a trainer does not wait for another one when
+   *        there are as many slots as trainers. The blocks added to are
+   *        added to vectors_[PARAMETER_GRADIENT] once gradientReadyBarrier_
+   *        is passed, see mergeGradientPartialSums().
+   */
+  struct GradientPartialSum {
+    std::mutex lock;
+    CpuVectorPtr values;
+    /// by block id, whether the block was added to since the last merge
+    std::vector<char> dirtyBlocks;
+    /// some block is dirty
+    bool dirty;
+  };
+  /// by slot, created by the first addGradient() of the slot
+  std::vector<std::unique_ptr<GradientPartialSum>> gradientPartialSums_;
+  std::mutex gradientPartialSumsLock_;
+
+  /// requests and bytes of a dense block, see getBlockTraffic()
+  struct BlockTrafficStat {
+    int64_t numRequests;
+    int64_t numBytes;
+  };
+  std::unordered_map<BlockKey, BlockTrafficStat, BlockKeyHash> blockTraffic_;
+  std::mutex blockTrafficLock_;
+
+  /// the last placement published to this pserver
+  GetBlockPlacementResponse blockPlacement_;
+  std::mutex blockPlacementLock_;
+
   std::atomic<int> numPassFinishClients_;
   bool allClientPassFinish_;
 
@@ -456,6 +500,48 @@ public:
   void saveValueVector(const SaveValueRequest& request,
                        ProtoResponseCallback callback);
 
+  /**
+   * @brief the requests and bytes of each dense block since the last call
+   *
+   * @note  used by ParameterClient2::rebalanceBlocks() to weigh the blocks
+   */
+  void getBlockTraffic(const GetBlockTrafficRequest& request,
+                       ProtoResponseCallback callback);
+
+  /**
+   * @brief send back the value and the optimizer state of some blocks
+   *
+   * @note  used with importBlocks() to move blocks between pservers between
+   *        two passes, when no gradient is sent
+   */
+  void exportBlocks(const ExportBlocksRequest& request,
+                    std::unique_ptr<MsgReader> msgReader,
+                    ProtoResponseCallbackEx callback);
+
+  /**
+   * @brief store blocks exported by another pserver
+   *
+   * @note  the blocks which are not stored yet are added, in the storage
+   *        of the blocks which have moved away if possible, or else the
+   *        vectors of the pserver grow.
+   */
+  void importBlocks(const ImportBlocksRequest& request,
+                    std::unique_ptr<MsgReader> msgReader,
+                    ProtoResponseCallbackEx callback);
+
+  /**
+   * @brief store the placement of the blocks published by rebalanceBlocks()
+   *
+   * @note  it is published once the blocks are imported, so the blocks of
+   *        this pserver placed on another one are released then.
+   */
+  void setBlockPlacement(const SetBlockPlacementRequest& request,
+                         ProtoResponseCallback callback);
+
+  /// the placement stored by setBlockPlacement(), version 0 if none
+  void getBlockPlacement(const GetBlockPlacementRequest& request,
+                         ProtoResponseCallback callback);
+
 public:
   /**
    * @brief initialize parameter server
@@ -537,6 +623,13 @@ protected:
   /// set the unused segments to zero
   void clearUnusedSegments(CpuVector* vec);
 
+  /**
+   * @brief stop updating the blocks which have moved to another pserver
+   *        and keep their storage for addBlocks(), parameterMutex_ must be
+   *        locked
+   */
+  void releaseBlocks(const std::vector<BlockKey>& keys);
+
   // TODO(yanfei):
   // if read data and do optimization interleavely block by block,
   // the performance could be better for gaining less network congestion.
@@ -544,6 +637,22 @@ protected:
   void readAllBlocks(MsgReader* msgReader,
                      std::vector<ParameterServer2::Buffer>* buffers);
 
+  /// replace the encoded gradient blocks of inputBuffers by their values,
+  /// see GradientEncoder
+  void decodeGradientBlocks(const SendParameterRequest& request,
+                            std::vector<ParameterServer2::Buffer>* buffers);
+
+  /// count the dense blocks of a request for getBlockTraffic()
+  void addBlockTraffic(const SendParameterRequest& request);
+
+  /**
+   * @brief add the blocks which are not stored yet, reusing the storage of
+   *        freeBlockIds_ or growing vectors_ and blockInfos_,
+   *        parameterMutex_ must be locked
+   */
+  void addBlocks(
+      const google::protobuf::RepeatedPtrField<ParameterBlock>& blocks);
+
   const ParameterConfig& getParameterConfig(const ParameterBlock& block) {
     CHECK_LT(block.para_id(), -1UL) << "invalid parameter id:"
                                     << block.para_id();
@@ -653,6 +762,18 @@ protected:
    */
   typedef std::function<void(int64_t blockId, const VectorPtr vecs[])> ExecFunc;
   void parallelExecForEachBlock(ExecFunc func);
+
+  /// the partial sum of the slot of a trainer, sized for the blocks
+  GradientPartialSum* getGradientPartialSum(int trainerId);
+  /**
+   * @brief add the dirty blocks of all the partial sums to
+   *        vectors_[PARAMETER_GRADIENT] and clear them
+   *
+   * @note  the blocks are shared by the threads of syncThreadPool_, each
+   *        one adds all the partial sums of its blocks, so no lock is
+   *        needed. It must be called when no addGradient() is running.
+   */
+  void mergeGradientPartialSums();
   void blockTraverse(BlockInfo& info,
                      const ParameterConfig& config,
                      int64_t offset,
@@ -32,6 +32,8 @@ namespace paddle {
  * to accelerate bandwidth efficiency and harness multicore for pserver
  * optimization to reduce pserver latency, you could launch more port
  * for single NIC hardward with --port=N(N>1) for small cluster job.
+ * For large cluster jobs, --socket_worker_threads serves all the tcp
+ * connections with epoll and a pool of worker threads instead.
  */
 class ProtoServer : public SocketServer {
 public:
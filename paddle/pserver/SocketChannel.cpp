@@ -207,13 +207,41 @@ std::unique_ptr<MsgReader> SocketChannel::readMessage() {
 }
 
 MsgReader::MsgReader(SocketChannel* channel, size_t numBlocks)
-    : channel_(channel), blockLengths_(numBlocks), currentBlockIndex_(0) {
+    : channel_(channel),
+      blockLengths_(numBlocks),
+      currentBlockIndex_(0),
+      messagePos_(0) {
   size_t size = numBlocks * sizeof(blockLengths_[0]);
   PCHECK(channel_->read(&blockLengths_[0], size) == size);
 }
 
+MsgReader::MsgReader(std::string&& message)
+    : channel_(nullptr),
+      currentBlockIndex_(0),
+      message_(std::move(message)) {
+  typedef SocketChannel::MessageHeader MessageHeader;
+  CHECK_GE(message_.size(), sizeof(MessageHeader));
+  const MessageHeader* header =
+      reinterpret_cast<const MessageHeader*>(message_.data());
+  CHECK_EQ((size_t)header->totalLength, message_.size());
+  messagePos_ =
+      sizeof(MessageHeader) + header->numIovs * sizeof(blockLengths_[0]);
+  CHECK_LE(messagePos_, message_.size());
+  blockLengths_.assign(header->iovLengths,
+                       header->iovLengths + header->numIovs);
+  CHECK_EQ(messagePos_ + getTotalLength(), message_.size())
+      << " totalLength=" << getTotalLength()
+      << " numBlocks=" << getNumBlocks();
+}
+
 void MsgReader::readBlocks(const std::vector<void*>& bufs) {
   CHECK_LE(currentBlockIndex_ + bufs.size(), blockLengths_.size());
+  if (!channel_) {
+    for (void* buf : bufs) {
+      readNextBlock(buf);
+    }
+    return;
+  }
   std::vector<iovec> iovs;
   iovs.reserve(bufs.size());
   size_t totalLength = 0;
@@ -228,7 +256,12 @@ void MsgReader::readBlocks(const std::vector<void*>& bufs) {
 
 void MsgReader::readNextBlock(void* buf) {
   CHECK_LT(currentBlockIndex_, blockLengths_.size());
-  PCHECK(channel_->read(buf, getNextBlockLength()) == getNextBlockLength());
+  if (channel_) {
+    PCHECK(channel_->read(buf, getNextBlockLength()) == getNextBlockLength());
+  } else {
+    memcpy(buf, &message_[messagePos_], getNextBlockLength());
+    messagePos_ += getNextBlockLength();
+  }
   ++currentBlockIndex_;
 }
 
@@ -19,6 +19,7 @@ limitations under the License. */
 #include <sys/uio.h>
 
 #include <memory>
+#include <string>
 #include <vector>
 
 struct sxi_sock;
@@ -35,6 +36,13 @@ enum ChannelType {
 class MsgReader {
 public:
   MsgReader(SocketChannel* channel, size_t numIovs);
+
+  /**
+   * @brief read the blocks from message, a whole message already received,
+   *        header included, instead of from a channel.
+   */
+  explicit MsgReader(std::string&& message);
+
   ~MsgReader() {
     /// ensure all data blocks have been processed
     CHECK_EQ(currentBlockIndex_, blockLengths_.size());
@@ -76,9 +84,13 @@ public:
   void readNextBlock(void* buf);
 
 protected:
+  /// null if the blocks are read from message_
   SocketChannel* channel_;
   std::vector<size_t> blockLengths_;
   size_t currentBlockIndex_;
+  std::string message_;
+  /// offset of the next block in message_
+  size_t messagePos_;
 };
 
 /// APIs for reading and writing byte stream data or naive iov data
@@ -137,13 +149,13 @@ public:
   /// return null to indicate socket is closed
   std::unique_ptr<MsgReader> readMessage();
 
-protected:
   struct MessageHeader {
     int64_t totalLength;  /// include the header
     int64_t numIovs;
     int64_t iovLengths[0];
   };
 
+protected:
   int tcpSocket_;
   struct sxi_sock* rdmaSocket_;
   const std::string peerName_;
@@ -0,0 +1,281 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "SocketReactor.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "LightNetwork.h"
+#include "paddle/utils/Flags.h"
+
+DEFINE_int64(socket_max_message_size,
+             1LL << 32,
+             "the tcp server with epoll closes a connection which sends a "
+             "message of more than this number of bytes");
+
+namespace paddle {
+
+constexpr int SocketReactor::kBlockedMs;
+
+SocketReactor::SocketReactor(SocketServer* server,
+                             int numWorkers,
+                             int maxWorkers)
+    : server_(server),
+      maxWorkers_(maxWorkers),
+      numIdleWorkers_(0),
+      numExtraWorkers_(0),
+      stopping_(false) {
+  CHECK_GE(maxWorkers, numWorkers);
+  epoll_ = epoll_create1(0);
+  PCHECK(epoll_ >= 0) << "ERROR on epoll_create";
+  for (int i = 0; i < numWorkers; ++i) {
+    workers_.emplace_back([this]() { workerLoop(/* extra= */ false); });
+  }
+}
+
+SocketReactor::~SocketReactor() {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    stopping_ = true;
+  }
+  cond_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  {
+    std::unique_lock<std::mutex> guard(lock_);
+    cond_.wait(guard, [this]() { return numExtraWorkers_ == 0; });
+  }
+  close(epoll_);
+}
+
+void SocketReactor::run(int listenSocket, const bool& stopping) {
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  PCHECK(epoll_ctl(epoll_, EPOLL_CTL_ADD, listenSocket, &event) == 0);
+
+  constexpr int kMaxEvents = 64;
+  epoll_event events[kMaxEvents];
+  while (true) {
+    int numEvents = epoll_wait(epoll_, events, kMaxEvents, kBlockedMs);
+    startExtraWorkers();
+    if (numEvents < 0 && errno == EINTR) {
+      continue;
+    }
+    PCHECK(numEvents >= 0) << "ERROR on epoll_wait";
+    for (int i = 0; i < numEvents; ++i) {
+      Connection* conn = static_cast<Connection*>(events[i].data.ptr);
+      if (conn) {
+        if (!readConnection(conn)) {
+          closeConnection(conn);
+        }
+        continue;
+      }
+      accept(listenSocket);
+      if (stopping) {
+        return;
+      }
+    }
+  }
+}
+
+void SocketReactor::accept(int listenSocket) {
+  struct sockaddr_in cliAddr;
+  socklen_t cliLen = sizeof(cliAddr);
+  int sock = ::accept(listenSocket, (struct sockaddr*)&cliAddr, &cliLen);
+  PCHECK(sock >= 0) << "ERROR on accept";
+  constexpr int kPeerNameLen = 128;
+  char peerName[kPeerNameLen];
+  CHECK(inet_ntop(AF_INET, &cliAddr.sin_addr, peerName, kPeerNameLen));
+  LOG(INFO) << "connection accepted, peer = " << peerName;
+
+  std::unique_ptr<Connection> conn(new Connection);
+  conn->channel.reset(new SocketChannel(sock, peerName));
+  conn->socket = sock;
+  conn->received = 0;
+
+  epoll_event event;
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = conn.get();
+  PCHECK(epoll_ctl(epoll_, EPOLL_CTL_ADD, sock, &event) == 0);
+  connections_[conn.get()] = std::move(conn);
+}
+
+bool SocketReactor::readConnection(Connection* conn) {
+  typedef SocketChannel::MessageHeader MessageHeader;
+  while (true) {
+    if (conn->received < sizeof(MessageHeader)) {
+      conn->message.resize(sizeof(MessageHeader));
+    }
+    ssize_t len = recv(conn->socket,
+                       &conn->message[conn->received],
+                       conn->message.size() - conn->received,
+                       MSG_DONTWAIT);
+    if (len == 0) {
+      return false;
+    }
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        rearm(conn);
+        return true;
+      }
+      PLOG(WARNING) << "ERROR on recv, peer = "
+                    << conn->channel->getPeerName();
+      return false;
+    }
+
+    conn->received += len;
+    if (conn->received == sizeof(MessageHeader)) {
+      if (!checkMessage(*conn, /* complete= */ false)) {
+        return false;
+      }
+      auto header = reinterpret_cast<const MessageHeader*>(&conn->message[0]);
+      conn->message.resize(header->totalLength);
+    }
+    if (conn->received == conn->message.size()) {
+      if (!checkMessage(*conn, /* complete= */ true)) {
+        return false;
+      }
+      addJob(conn);
+      return true;
+    }
+  }
+}
+
+bool SocketReactor::checkMessage(const Connection& conn, bool complete) {
+  typedef SocketChannel::MessageHeader MessageHeader;
+  auto header = reinterpret_cast<const MessageHeader*>(&conn.message[0]);
+  int64_t totalLength = header->totalLength;
+  int64_t numIovs = header->numIovs;
+  int64_t bodyLength = totalLength - (int64_t)sizeof(MessageHeader);
+  if (totalLength < (int64_t)sizeof(MessageHeader) ||
+      totalLength > FLAGS_socket_max_message_size || numIovs < 0 ||
+      numIovs > bodyLength / (int64_t)sizeof(header->iovLengths[0])) {
+    LOG(ERROR) << "invalid message header, totalLength=" << totalLength
+               << " numIovs=" << numIovs
+               << " peer=" << conn.channel->getPeerName();
+    return false;
+  }
+  if (!complete) {
+    return true;
+  }
+  int64_t blocksLength =
+      bodyLength - numIovs * (int64_t)sizeof(header->iovLengths[0]);
+  for (int64_t i = 0; i < numIovs; ++i) {
+    int64_t iovLength = header->iovLengths[i];
+    if (iovLength < 0 || iovLength > blocksLength) {
+      blocksLength = -1;
+      break;
+    }
+    blocksLength -= iovLength;
+  }
+  if (blocksLength != 0) {
+    LOG(ERROR) << "the block lengths of a message do not add up to its "
+               << "totalLength=" << totalLength << " numIovs=" << numIovs
+               << " peer=" << conn.channel->getPeerName();
+    return false;
+  }
+  return true;
+}
+
+void SocketReactor::rearm(Connection* conn) {
+  epoll_event event;
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = conn;
+  PCHECK(epoll_ctl(epoll_, EPOLL_CTL_MOD, conn->socket, &event) == 0);
+}
+
+void SocketReactor::closeConnection(Connection* conn) {
+  LOG(INFO) << "connection closed, peer = " << conn->channel->getPeerName();
+  PCHECK(epoll_ctl(epoll_, EPOLL_CTL_DEL, conn->socket, nullptr) == 0);
+  connections_.erase(conn);
+}
+
+void SocketReactor::addJob(Connection* conn) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (jobs_.empty()) {
+    waitingSince_ = std::chrono::steady_clock::now();
+  }
+  jobs_.push_back(conn);
+  cond_.notify_one();
+}
+
+void SocketReactor::startExtraWorkers() {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (jobs_.empty() || numIdleWorkers_ > 0 ||
+      std::chrono::steady_clock::now() - waitingSince_ <
+          std::chrono::milliseconds(kBlockedMs)) {
+    return;
+  }
+  int numWorkers = workers_.size() + numExtraWorkers_;
+  int numNewWorkers = std::min((int)jobs_.size(), maxWorkers_ - numWorkers);
+  for (int i = 0; i < numNewWorkers; ++i) {
+    ++numExtraWorkers_;
+    std::thread([this]() { workerLoop(/* extra= */ true); }).detach();
+  }
+  if (numNewWorkers > 0) {
+    LOG(INFO) << "the workers are blocked, " << numWorkers + numNewWorkers
+              << " worker threads";
+  }
+}
+
+void SocketReactor::workerLoop(bool extra) {
+  while (true) {
+    Connection* conn;
+    {
+      std::unique_lock<std::mutex> guard(lock_);
+      if (!extra) {
+        ++numIdleWorkers_;
+        cond_.wait(guard, [this]() { return stopping_ || !jobs_.empty(); });
+        --numIdleWorkers_;
+      }
+      if (jobs_.empty()) {
+        if (extra) {
+          --numExtraWorkers_;
+          cond_.notify_all();
+        }
+        return;
+      }
+      conn = jobs_.front();
+      jobs_.pop_front();
+      waitingSince_ = std::chrono::steady_clock::now();
+    }
+    handleMessage(conn);
+  }
+}
+
+void SocketReactor::handleMessage(Connection* conn) {
+  std::unique_ptr<MsgReader> msgReader(new MsgReader(std::move(conn->message)));
+  conn->message.clear();
+  conn->received = 0;
+
+  auto callback = [conn](const std::vector<iovec>& outputIovs) {
+    conn->channel->writeMessage(outputIovs);
+  };
+  server_->handleRequest(std::move(msgReader), callback);
+
+  /// the next message of conn may be read now
+  rearm(conn);
+}
+
+}  // namespace paddle
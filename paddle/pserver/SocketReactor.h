@@ -0,0 +1,112 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "SocketChannel.h"
+
+namespace paddle {
+
+class SocketServer;
+
+/**
+ * @brief event driven tcp connections of a SocketServer
+ *
+ * @note  instead of a thread per connection blocked in readMessage(), one
+ *        epoll thread reads the messages of all the connections without
+ *        blocking, and a pool of workers runs handleRequest() on the
+ *        complete ones. The wire protocol is the one of SocketChannel.
+ *        A connection is not read while one of its messages is handled,
+ *        so its requests are still handled one by one and in order, and
+ *        the response is written by the worker.
+ *
+ *        A handler may block for long, on the barriers of a synchronous
+ *        ParameterServer2 for instance. When the complete messages have
+ *        waited for kBlockedMs without any worker taking one, the workers
+ *        are taken as blocked, and extra workers are started for the
+ *        messages, up to maxWorkers threads. An extra worker exits as soon
+ *        as there is no message left, so the pool goes back to numWorkers
+ *        threads, which are enough for the handlers which do not block.
+ *
+ *        A frame whose header is not consistent, or which is larger than
+ *        --socket_max_message_size, closes its connection.
+ */
+class SocketReactor {
+public:
+  SocketReactor(SocketServer* server, int numWorkers, int maxWorkers);
+  ~SocketReactor();
+
+  /**
+   * @brief accept the connections of listenSocket and serve them, until a
+   *        connection is accepted while stopping is true
+   */
+  void run(int listenSocket, const bool& stopping);
+
+private:
+  /// the time the jobs wait before the workers are taken as blocked
+  static constexpr int kBlockedMs = 20;
+
+  struct Connection {
+    std::unique_ptr<SocketChannel> channel;
+    int socket;
+    /// the message being received, header included
+    std::string message;
+    size_t received;
+  };
+
+  void accept(int listenSocket);
+  /// read what is available from conn, return false if it is closed
+  bool readConnection(Connection* conn);
+  /// whether the header of a frame, or all of it if complete, is valid
+  bool checkMessage(const Connection& conn, bool complete);
+  /// wait for the next event of conn
+  void rearm(Connection* conn);
+  void closeConnection(Connection* conn);
+
+  void addJob(Connection* conn);
+  /// start extra workers if the jobs wait for blocked workers
+  void startExtraWorkers();
+  /// an extra worker exits when there is no job left
+  void workerLoop(bool extra);
+  void handleMessage(Connection* conn);
+
+  SocketServer* server_;
+  int epoll_;
+  /// only used by the epoll thread
+  std::unordered_map<Connection*, std::unique_ptr<Connection>> connections_;
+
+  std::mutex lock_;
+  std::condition_variable cond_;
+  std::deque<Connection*> jobs_;
+  /// since when the first job waits for a worker
+  std::chrono::steady_clock::time_point waitingSince_;
+  std::vector<std::thread> workers_;
+  int maxWorkers_;
+  int numIdleWorkers_;
+  /// the extra workers are detached, the destructor waits for them
+  int numExtraWorkers_;
+  bool stopping_;
+};
+
+}  // namespace paddle
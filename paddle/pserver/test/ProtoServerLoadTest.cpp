@@ -0,0 +1,154 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "ParameterService.pb.h"
+#include "paddle/pserver/ProtoServer.h"
+#include "paddle/utils/Locks.h"
+#include "paddle/utils/Util.h"
+
+DEFINE_string(server_addr, "127.0.0.1", "Server address");
+DEFINE_int32(num_clients, 200, "number of client connections");
+DEFINE_int32(num_requests, 200, "number of requests of each connection");
+DEFINE_int32(payload_size, 4096, "bytes sent and echoed by each request");
+DEFINE_int32(load_test_workers, 8, "worker threads of the epoll server");
+DECLARE_int32(socket_worker_threads);
+
+using namespace paddle;  // NOLINT
+
+/**
+ * Loopback load test of ProtoServer: FLAGS_num_clients connections send
+ * FLAGS_num_requests echo requests each, as fast as they can, to a server
+ * with a thread per connection and then to a server with epoll and
+ * FLAGS_load_test_workers workers. The throughput, the latencies and the
+ * number of threads the server starts for the connections are printed.
+ */
+class EchoServer : public ProtoServer {
+public:
+  explicit EchoServer(int port) : ProtoServer(FLAGS_server_addr, port) {
+    REGISTER_SERVICE_FUNCTION_EX(EchoServer, echo);
+  }
+
+  void echo(const GetStatusRequest& request,
+            std::unique_ptr<MsgReader> msgReader,
+            ProtoResponseCallbackEx callback) {
+    (void)request;
+    std::string buffer(msgReader->getNextBlockLength(), 0);
+    msgReader->readNextBlock(&buffer[0]);
+    GetStatusResponse response;
+    response.set_status(PSERVER_STATUS_NOT_SET);
+    callback(response, {{&buffer[0], buffer.size()}});
+  }
+};
+
+/// the number of threads of this process
+int getNumThreads() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 8, "Threads:") == 0) {
+      return std::stoi(line.substr(8));
+    }
+  }
+  return 0;
+}
+
+void runClients(int port, const std::string& name) {
+  typedef std::chrono::steady_clock Clock;
+  int numThreadsBefore = getNumThreads();
+  std::vector<std::vector<double>> latencies(FLAGS_num_clients);
+  std::vector<std::unique_ptr<ProtoClient>> clients;
+  for (int i = 0; i < FLAGS_num_clients; ++i) {
+    clients.emplace_back(new ProtoClient(FLAGS_server_addr, port, F_TCP));
+  }
+
+  ThreadBarrier startBarrier(FLAGS_num_clients + 1);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < FLAGS_num_clients; ++i) {
+    threads.emplace_back([&, i]() {
+      std::string data(FLAGS_payload_size, 'x');
+      std::string result(FLAGS_payload_size, 0);
+      startBarrier.wait();
+      for (int k = 0; k < FLAGS_num_requests; ++k) {
+        auto start = Clock::now();
+        GetStatusRequest request;
+        GetStatusResponse response;
+        auto msgReader = clients[i]->sendAndRecv(
+            "echo", request, {{&data[0], data.size()}}, &response);
+        msgReader->readNextBlock(&result[0]);
+        latencies[i].push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start)
+                .count());
+      }
+    });
+  }
+
+  /// samples the threads while the clients run
+  std::atomic<bool> finished(false);
+  int maxNumThreads = 0;
+  std::thread monitor([&]() {
+    while (!finished) {
+      maxNumThreads = std::max(maxNumThreads, getNumThreads());
+      usleep(1000);
+    }
+  });
+
+  startBarrier.wait();
+  auto start = Clock::now();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  finished = true;
+  monitor.join();
+  /// neither the clients nor the monitor
+  int numServerThreads =
+      maxNumThreads - numThreadsBefore - FLAGS_num_clients - 1;
+
+  std::vector<double> all;
+  for (auto& l : latencies) {
+    all.insert(all.end(), l.begin(), l.end());
+  }
+  std::sort(all.begin(), all.end());
+  LOG(INFO) << name << ", " << FLAGS_num_clients << " connections: "
+            << all.size() / seconds << " requests/s"
+            << ", p50 latency " << all[all.size() / 2] << "us"
+            << ", p99 latency " << all[all.size() * 99 / 100] << "us"
+            << ", " << numServerThreads << " server threads started";
+}
+
+int main(int argc, char** argv) {
+  paddle::initMain(argc, argv);
+
+  FLAGS_socket_worker_threads = 0;
+  EchoServer threadServer(FLAGS_port);
+  threadServer.start();
+  FLAGS_socket_worker_threads = FLAGS_load_test_workers;
+  EchoServer epollServer(FLAGS_port + 1);
+  epollServer.start();
+  usleep(10000);
+
+  runClients(FLAGS_port, "thread per connection");
+  /// let the threads of the closed connections exit
+  usleep(100000);
+  runClients(FLAGS_port + 1, "epoll");
+  return 0;
+}
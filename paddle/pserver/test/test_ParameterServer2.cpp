@@ -12,7 +12,11 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
+#include <chrono>
+#include <thread>
+
 #include <gtest/gtest.h>
+#include <paddle/pserver/GradientEncoding.h>
 #include <paddle/pserver/ParameterClient2.h>
 #include <paddle/pserver/ParameterServer2.h>
 #include <paddle/utils/Flags.h>
@@ -22,6 +26,10 @@ using namespace paddle;  // NOLINT
 using namespace std;     // NOLINT
 
 DECLARE_int32(num_gradient_servers);
+DECLARE_string(gradient_encoding);
+DECLARE_double(gradient_topk_ratio);
+DECLARE_bool(pserver_gradient_partial_sums);
+DECLARE_int32(pserver_num_gradient_partial_sums);
 DEFINE_string(server_addr, "127.0.0.1", "assign server address");
 DEFINE_int32(server_cpu, 0, "assign server cpu");
 
@@ -33,7 +41,7 @@ public:
                          bool sepSendAndRecv = false)
       : ParameterServer2(serverAddr, port, rdmaCpu), client_(sepSendAndRecv) {}
   virtual ~ParameterServer2Tester() {}
-  void setup() {
+  void setup(bool withMomentum = true) {
     CHECK(ParameterServer2::init());
 
     parameters_.clear();
@@ -47,7 +55,7 @@ public:
       config.set_size(10000);
       config.set_device(-1);
       config.set_learning_rate(1.0);
-      config.set_momentum(0.9);
+      config.set_momentum(withMomentum ? 0.9 : 0);
     }
 
     {
@@ -57,7 +65,7 @@ public:
       config.set_size(5000);
       config.set_device(-1);
       config.set_learning_rate(0.5);
-      config.set_momentum(0.4);
+      config.set_momentum(withMomentum ? 0.4 : 0);
     }
 
     for (auto& config : clientConfigs_) {
@@ -87,6 +95,12 @@ public:
   void checkSegments(const BlockSegments& expected, const BlockSegments& segs);
   void waitPassFinishTest();
   void synchronizeTest();
+  void gradientEncodingTest();
+  void rebalanceBlocksTest(const vector<ParameterServer2Tester*>& servers);
+  size_t getNumGradientPartialSums() const {
+    return gradientPartialSums_.size();
+  }
+  vector<real> addGradientTest();
 
 protected:
   ParameterClient2 client_;
@@ -96,6 +110,245 @@ protected:
 
 std::unique_ptr<ParameterServer2Tester> g_server;
 
+void ParameterServer2Tester::gradientEncodingTest() {
+  /// minimize 0.5 * |value - target|^2 by async sgd with the gradients
+  /// sent by every encoding, and compare the error and the bytes sent.
+  /// The values left by topk are sent several steps later at once, which
+  /// the momentum of the pserver would amplify, so there is none.
+  const int numSteps = 200;
+  FLAGS_gradient_topk_ratio = 0.1;
+  vector<vector<real>> targets;
+  int64_t rawBytes = 0;
+  for (string name : {"none", "fp16", "int8", "topk"}) {
+    FLAGS_gradient_encoding = name;
+    setup(/* withMomentum= */ false);
+    if (targets.empty()) {
+      for (auto& config : clientConfigs_) {
+        targets.emplace_back(config.size());
+        for (auto& t : targets.back()) {
+          t = (real)rand() / RAND_MAX - 0.5;  // NOLINT
+        }
+      }
+    }
+    for (auto& para : parameters_) {
+      para->getBuf(PARAMETER_VALUE)->zeroMem();
+    }
+    client_.sendAndReceiveParameter(PSERVER_UPDATE_MODE_SET_PARAM,
+                                    PARAMETER_VALUE,
+                                    0,       // numSamples = 0
+                                    0,       // cost = 0
+                                    false);  // sendBackParameter = false
+
+    int64_t bytesBegin = client_.getGradientBytesSent();
+    for (int step = 0; step < numSteps; ++step) {
+      for (size_t i = 0; i < parameters_.size(); ++i) {
+        real* value = parameters_[i]->getBuf(PARAMETER_VALUE)->getData();
+        real* grad = parameters_[i]->getBuf(PARAMETER_GRADIENT)->getData();
+        for (size_t j = 0; j < targets[i].size(); ++j) {
+          grad[j] = value[j] - targets[i][j];
+        }
+      }
+      client_.sendAndReceiveParameter(PSERVER_UPDATE_MODE_ASYNC_SGD,
+                                      PARAMETER_GRADIENT,
+                                      1,      // numSamples = 1
+                                      0,      // cost = 0
+                                      true);  // sendBackParameter = true
+    }
+    int64_t bytes = client_.getGradientBytesSent() - bytesBegin;
+
+    real error = 0, norm = 0;
+    for (size_t i = 0; i < parameters_.size(); ++i) {
+      real* value = parameters_[i]->getBuf(PARAMETER_VALUE)->getData();
+      for (size_t j = 0; j < targets[i].size(); ++j) {
+        error += (value[j] - targets[i][j]) * (value[j] - targets[i][j]);
+        norm += targets[i][j] * targets[i][j];
+      }
+    }
+    LOG(INFO) << "gradient encoding " << name << ": " << bytes / numSteps
+              << " bytes per step, relative error "
+              << std::sqrt(error / norm) << " after " << numSteps
+              << " steps";
+
+    EXPECT_LT(std::sqrt(error / norm), 0.01) << name;
+    if (name == "none") {
+      rawBytes = bytes;
+    } else {
+      EXPECT_LT(bytes, rawBytes / 2 + 1024 * numSteps) << name;
+    }
+  }
+  FLAGS_gradient_encoding = "none";
+  FLAGS_gradient_topk_ratio = 0.01;
+}
+
+void ParameterServer2Tester::rebalanceBlocksTest(
+    const vector<ParameterServer2Tester*>& servers) {
+  setup();
+  auto randomize = [this](ParameterType type) {
+    for (auto& para : parameters_) {
+      real* data = para->getBuf(type)->getData();
+      for (size_t j = 0; j < para->getSize(); ++j) {
+        data[j] = (real)rand() / RAND_MAX - 0.5;  // NOLINT
+      }
+    }
+  };
+  auto getBuffers = [this](ParameterType sendBackParameterType) {
+    for (auto& para : parameters_) {
+      para->getBuf(PARAMETER_VALUE)->zeroMem();
+    }
+    client_.getParameter(PARAMETER_VALUE, sendBackParameterType);
+    vector<vector<real>> buffers;
+    for (auto& para : parameters_) {
+      real* data = para->getBuf(PARAMETER_VALUE)->getData();
+      buffers.emplace_back(data, data + para->getSize());
+    }
+    return buffers;
+  };
+
+  /// some momentum on the pservers, which has to move with the blocks
+  randomize(PARAMETER_VALUE);
+  client_.setParameter();
+  for (int i = 0; i < 3; ++i) {
+    randomize(PARAMETER_GRADIENT);
+    client_.sendAndReceiveParameter(PSERVER_UPDATE_MODE_ASYNC_SGD,
+                                    PARAMETER_GRADIENT,
+                                    1,      // numSamples = 1
+                                    0,      // cost = 0
+                                    true);  // sendBackParameter = true
+  }
+  auto values = getBuffers(PARAMETER_VALUE);
+  auto momentums = getBuffers(PARAMETER_MOMENTUM);
+
+  /// all the traffic on para0, whose blocks were placed by size only
+  vector<ParameterSegments> hotSegments = {{"para0", 0}};
+  for (int i = 0; i < 10; ++i) {
+    client_.sendAndReceiveParameter(PSERVER_UPDATE_MODE_GET_PARAM,
+                                    PARAMETER_VALUE,
+                                    hotSegments,
+                                    0,     // numSamples = 0
+                                    0,     // cost = 0
+                                    true,  // sendBackParameter = true
+                                    PARAMETER_VALUE,
+                                    PARAMETER_VALUE);
+  }
+  const BlockPlacement& placement = client_.getBlockPlacement();
+  int numServers = placement.getNumServers();
+  uint64_t blockSize = parameters_[0]->getConfig().parameter_block_size();
+  uint64_t numHotBlocks =
+      (parameters_[0]->getSize() + blockSize - 1) / blockSize;
+  auto countHotBlocks = [&]() {
+    vector<int> counts(numServers, 0);
+    for (uint64_t j = 0; j < numHotBlocks; ++j) {
+      ++counts[placement.getServerId(0, j)];
+    }
+    return *std::max_element(counts.begin(), counts.end());
+  };
+  auto makeHotBlock = [&](uint64_t j) {
+    ParameterBlock block;
+    block.set_para_id(0);
+    block.set_block_id(j);
+    block.set_begin_pos(j * blockSize);
+    block.set_block_size(
+        std::min(blockSize, parameters_[0]->getSize() - j * blockSize));
+    return block;
+  };
+  vector<int> oldServerIds;
+  vector<int64_t> oldOffsets;
+  for (uint64_t j = 0; j < numHotBlocks; ++j) {
+    oldServerIds.push_back(placement.getServerId(0, j));
+    oldOffsets.push_back(
+        servers[oldServerIds.back()]->getBlockOffset(makeHotBlock(j)));
+  }
+  int maxHotBlocks = countHotBlocks();
+
+  /// another trainer, which ends the pass with the first one
+  vector<ParameterPtr> parameters;
+  for (auto& config : clientConfigs_) {
+    parameters.emplace_back(new Parameter(config, /* useGpu= */ false));
+    parameters.back()->setID(parameters.size() - 1);
+  }
+  ParameterClient2 client(false);
+  CHECK(client.init(parameters));
+  client.setTrainerId(1);
+  size_t numMovedByTrainer1 = 0;
+  std::thread trainer1(
+      [&]() { numMovedByTrainer1 = client.syncRebalanceBlocks(); });
+  size_t numMoved = client_.syncRebalanceBlocks();
+  trainer1.join();
+  LOG(INFO) << numMoved << " blocks moved, at most " << maxHotBlocks
+            << " -> " << countHotBlocks() << " blocks of para0 per pserver";
+  EXPECT_GT(numMoved, 0UL);
+  EXPECT_EQ(0UL, numMovedByTrainer1);
+  EXPECT_EQ(1, placement.getVersion());
+  EXPECT_LT(countHotBlocks(), maxHotBlocks);
+
+  /// both trainers send every block to the same pserver
+  EXPECT_EQ(placement.getVersion(), client.getBlockPlacement().getVersion());
+  for (auto& para : parameters_) {
+    uint64_t size = para->getConfig().parameter_block_size();
+    for (uint64_t j = 0; j * size < para->getSize(); ++j) {
+      EXPECT_EQ(placement.getServerId(para->getID(), j),
+                client.getBlockPlacement().getServerId(para->getID(), j));
+    }
+  }
+
+  EXPECT_EQ(values, getBuffers(PARAMETER_VALUE));
+  EXPECT_EQ(momentums, getBuffers(PARAMETER_MOMENTUM));
+  client.getParameter();
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    real* data = parameters[i]->getBuf(PARAMETER_VALUE)->getData();
+    EXPECT_EQ(values[i], vector<real>(data, data + parameters[i]->getSize()));
+  }
+
+  /// the pserver a block moved off does not update it any more
+  uint64_t moved = 0;
+  while (placement.getServerId(0, moved) == oldServerIds[moved]) {
+    ++moved;
+  }
+  ParameterServer2Tester* oldServer = servers[oldServerIds[moved]];
+  ParameterBlock movedBlock = makeHotBlock(moved);
+  EXPECT_EQ(-1, oldServer->getBlockId(movedBlock));
+  size_t numFreeBlocks = oldServer->freeBlockIds_.size();
+  EXPECT_GT(numFreeBlocks, 0UL);
+  real* oldData =
+      oldServer->vectors_[PARAMETER_VALUE]->getPoint(oldOffsets[moved]);
+  vector<real> oldValue(oldData, oldData + movedBlock.block_size());
+
+  for (auto* c : {&client_, &client}) {
+    randomize(PARAMETER_GRADIENT);
+    for (auto& para : parameters) {
+      para->getBuf(PARAMETER_GRADIENT)->copyFrom(
+          *parameters_[para->getID()]->getBuf(PARAMETER_GRADIENT));
+    }
+    c->sendAndReceiveParameter(PSERVER_UPDATE_MODE_ASYNC_SGD,
+                               PARAMETER_GRADIENT,
+                               1,      // numSamples = 1
+                               0,      // cost = 0
+                               true);  // sendBackParameter = true
+  }
+  std::atomic<size_t> numUpdated(0);
+  oldServer->parallelExecForEachBlock(
+      [&](int64_t blockId, const VectorPtr vecs[]) { ++numUpdated; });
+  EXPECT_EQ(oldServer->blockIdMap_.size(), numUpdated.load());
+  Operation operation;
+  OperationResult result;
+  oldServer->op_randomize(operation, &result);
+  EXPECT_EQ(oldValue,
+            vector<real>(oldData, oldData + movedBlock.block_size()));
+  EXPECT_NE(values, getBuffers(PARAMETER_VALUE));
+
+  /// a block which comes back takes the storage it left
+  int64_t oldSize = oldServer->size_;
+  google::protobuf::RepeatedPtrField<ParameterBlock> blocks;
+  *blocks.Add() = movedBlock;
+  {
+    std::lock_guard<RWLock> guard(oldServer->parameterMutex_);
+    oldServer->addBlocks(blocks);
+  }
+  EXPECT_EQ(oldSize, oldServer->size_);
+  EXPECT_EQ(oldOffsets[moved], oldServer->getBlockOffset(movedBlock));
+  EXPECT_EQ(numFreeBlocks - 1, oldServer->freeBlockIds_.size());
+}
+
 void ParameterServer2Tester::setConfigTest() {
   setup();
 
@@ -327,6 +580,70 @@ void ParameterServer2Tester::mergeBlockSegmentTest() {
   }
 }
 
+vector<real> ParameterServer2Tester::addGradientTest() {
+  /// FLAGS_num_gradient_servers trainers send different gradients for a
+  /// few batches of sync sgd, return the values at the end. The momentums
+  /// of the pserver are kept by setup(), so there is none.
+  const int numBatches = 3;
+  setup(/* withMomentum= */ false);
+
+  int numTrainers = FLAGS_num_gradient_servers;
+  vector<vector<ParameterPtr>> trainerParameters(numTrainers);
+  vector<std::unique_ptr<ParameterClient2>> clients;
+  for (int t = 0; t < numTrainers; ++t) {
+    for (auto& para : parameters_) {
+      ParameterPtr copy(new Parameter(para->getConfig(), /* useGpu= */ false));
+      copy->setID(para->getID());
+      real* grad = copy->getBuf(PARAMETER_GRADIENT)->getData();
+      for (size_t j = 0; j < copy->getSize(); ++j) {
+        grad[j] = (t + 1) * 0.01 * ((int)(j % 7) - 3);
+      }
+      trainerParameters[t].push_back(copy);
+    }
+    clients.emplace_back(new ParameterClient2());
+    clients.back()->init(trainerParameters[t]);
+    clients.back()->setTrainerId(t);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  vector<std::thread> threads;
+  for (int t = 0; t < numTrainers; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int batch = 0; batch < numBatches; ++batch) {
+        clients[t]->sendAndReceiveParameter(PSERVER_UPDATE_MODE_ADD_GRADIENT,
+                                            PARAMETER_GRADIENT,
+                                            1,      // numSamples = 1
+                                            0,      // cost = 0
+                                            true);  // sendBackParameter = true
+      }
+    });
+  }
+  for (int batch = 0; batch < numBatches; ++batch) {
+    PreparedOperations ops;
+    ops.addOperation(PSERVER_OP_SGD);
+    client_.doOperation(ops,
+                        /* waitForGradient= */ true,
+                        /* sendBackarameter= */ true);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  LOG(INFO) << "pserver_gradient_partial_sums="
+            << FLAGS_pserver_gradient_partial_sums << ": " << numBatches
+            << " batches in "
+            << std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+                   .count()
+            << "ms";
+
+  vector<real> values;
+  for (auto& para : trainerParameters[0]) {
+    const real* data = para->getBuf(PARAMETER_VALUE)->getData();
+    values.insert(values.end(), data, data + para->getSize());
+  }
+  return values;
+}
+
 void ParameterServer2Tester::waitPassFinishTest() {
   ParameterClient2 client1;
   ParameterClient2 client2;
@@ -550,6 +867,174 @@ TEST(ParameterServer2, waitPassFinish) { g_server->waitPassFinishTest(); }
 
 TEST(ParameterServer2, synchronize) { g_server->synchronizeTest(); }
 
+TEST(ParameterServer2, addGradient) {
+  FLAGS_pserver_gradient_partial_sums = false;
+  vector<real> expected = g_server->addGradientTest();
+  FLAGS_pserver_gradient_partial_sums = true;
+  vector<real> actual = g_server->addGradientTest();
+  EXPECT_EQ((size_t)FLAGS_num_gradient_servers,
+            g_server->getNumGradientPartialSums());
+  /// the trainers share a single partial sum
+  int numPartialSums = FLAGS_pserver_num_gradient_partial_sums;
+  FLAGS_pserver_num_gradient_partial_sums = 1;
+  vector<real> shared = g_server->addGradientTest();
+  EXPECT_EQ(1UL, g_server->getNumGradientPartialSums());
+  FLAGS_pserver_num_gradient_partial_sums = numPartialSums;
+  FLAGS_pserver_gradient_partial_sums = false;
+
+  ASSERT_EQ(expected.size(), actual.size());
+  ASSERT_EQ(expected.size(), shared.size());
+  size_t numDiffs = 0;
+  size_t numSharedDiffs = 0;
+  real maxValue = 0;
+  for (size_t i = 0; i < expected.size(); ++i) {
+    numDiffs += expected[i] != actual[i];
+    numSharedDiffs += expected[i] != shared[i];
+    maxValue = std::max(maxValue, std::abs(expected[i]));
+  }
+  EXPECT_EQ(0UL, numDiffs);
+  EXPECT_EQ(0UL, numSharedDiffs);
+  /// the gradients did change the values
+  EXPECT_GT(maxValue, 0);
+}
+
+TEST(ParameterServer2, gradientEncoding) {
+  g_server->gradientEncodingTest();
+}
+
+TEST(GradientEncoder, encodeDecode) {
+  const size_t size = 1000;
+  const real topkRatio = 0.05;
+  vector<real> grad(size);
+  for (auto& g : grad) {
+    g = (real)rand() / RAND_MAX - 0.5;  // NOLINT
+  }
+  for (string name : {"none", "fp16", "int8", "topk"}) {
+    GradientEncoding encoding = GradientEncoder::parse(name);
+    vector<real> residual(size, 0);
+    vector<real> encoded(
+        GradientEncoder::getEncodedSize(encoding, size, topkRatio));
+    vector<real> decoded(size);
+    GradientEncoder::encode(encoding,
+                            grad.data(),
+                            size,
+                            residual.data(),
+                            topkRatio,
+                            encoded.data());
+    GradientEncoder::decode(
+        encoding, encoded.data(), encoded.size(), decoded.data(), size);
+
+    size_t numNonZeros = 0;
+    for (size_t i = 0; i < size; ++i) {
+      /// what is not sent is kept for the next gradient
+      EXPECT_NEAR(grad[i], decoded[i] + residual[i], 1e-6) << name;
+      numNonZeros += decoded[i] != 0;
+      if (encoding == GRADIENT_ENCODING_FP16) {
+        /// the subnormal halves below 6.1e-5 are 6e-8 apart
+        EXPECT_NEAR(grad[i], decoded[i], 1e-3 * std::abs(grad[i]) + 3e-8)
+            << name;
+      } else if (encoding == GRADIENT_ENCODING_INT8) {
+        EXPECT_NEAR(grad[i], decoded[i], 0.5 / 127 * 0.5 + 1e-6) << name;
+      }
+    }
+    if (encoding == GRADIENT_ENCODING_TOPK) {
+      EXPECT_EQ(size * topkRatio, numNonZeros);
+      real minSent = 1, maxKept = 0;
+      for (size_t i = 0; i < size; ++i) {
+        if (decoded[i] != 0) {
+          minSent = std::min(minSent, std::abs(decoded[i]));
+        } else {
+          maxKept = std::max(maxKept, std::abs(residual[i]));
+        }
+      }
+      EXPECT_LE(maxKept, minSent);
+    }
+  }
+}
+
+TEST(ParameterServer2, rebalanceBlocks) {
+  int oldFlagsPortsNum = FLAGS_ports_num;
+  int oldFlagsPort = FLAGS_port;
+  FLAGS_ports_num = 3;
+  FLAGS_port = FLAGS_port + 4;
+  vector<std::unique_ptr<ParameterServer2Tester>> servers;
+  for (int i = 0; i < FLAGS_ports_num; ++i) {
+    servers.emplace_back(
+        new ParameterServer2Tester(FLAGS_server_addr, FLAGS_port + i));
+    servers.back()->start();
+    servers.back()->init();
+  }
+  sleep(2);
+  vector<ParameterServer2Tester*> serverPtrs;
+  for (auto& server : servers) {
+    serverPtrs.push_back(server.get());
+  }
+  servers[0]->rebalanceBlocksTest(serverPtrs);
+  servers.clear();
+
+  FLAGS_ports_num = oldFlagsPortsNum;
+  FLAGS_port = oldFlagsPort;
+}
+
+TEST(BlockPlacement, balance) {
+  const int numServers = 7;
+  const double loadSlack = 0.05;
+  vector<BlockPlacement::Block> blocks;
+  for (uint64_t paraId = 0; paraId < 20; ++paraId) {
+    uint64_t numBlocks = 1 + paraId * 3;
+    for (uint64_t blockId = 0; blockId < numBlocks; ++blockId) {
+      double size = blockId + 1 < numBlocks ? 1024 : 100 + paraId;
+      blocks.push_back({paraId, blockId, size});
+    }
+  }
+  auto maxLoad = [&](const BlockPlacement& placement,
+                     const vector<BlockPlacement::Block>& blocks) {
+    auto loads = placement.getLoads(blocks);
+    return *std::max_element(loads.begin(), loads.end());
+  };
+  auto capacity = [&](const vector<BlockPlacement::Block>& blocks) {
+    double total = 0, maxWeight = 0;
+    for (auto& block : blocks) {
+      total += block.weight;
+      maxWeight = std::max(maxWeight, block.weight);
+    }
+    return (1 + loadSlack) * total / numServers + maxWeight;
+  };
+
+  /// the same placement on every trainer, balanced by size
+  BlockPlacement placement(numServers, loadSlack);
+  BlockPlacement other(numServers, loadSlack);
+  placement.init(blocks);
+  other.init(blocks);
+  for (auto& block : blocks) {
+    int serverId = placement.getServerId(block.paraId, block.blockId);
+    EXPECT_GE(serverId, 0);
+    EXPECT_EQ(serverId, other.getServerId(block.paraId, block.blockId));
+  }
+  EXPECT_LE(maxLoad(placement, blocks), capacity(blocks));
+  EXPECT_TRUE(placement.rebalance(blocks).empty());
+  EXPECT_EQ(0, placement.getVersion());
+
+  /// a few hot parameters, only some blocks move
+  vector<BlockPlacement::Block> hotBlocks = blocks;
+  for (auto& block : hotBlocks) {
+    if (block.paraId % 5 == 0) {
+      block.weight *= 10;
+    }
+  }
+  double oldMaxLoad = maxLoad(placement, hotBlocks);
+  auto moves = placement.rebalance(hotBlocks);
+  EXPECT_FALSE(moves.empty());
+  EXPECT_LT(moves.size(), blocks.size() / 2);
+  EXPECT_EQ(1, placement.getVersion());
+  EXPECT_LT(maxLoad(placement, hotBlocks), oldMaxLoad);
+  EXPECT_LE(maxLoad(placement, hotBlocks), capacity(hotBlocks));
+  for (auto& move : moves) {
+    EXPECT_NE(move.fromServer, move.toServer);
+    EXPECT_EQ(move.toServer, placement.getServerId(move.paraId, move.blockId));
+  }
+}
+
 TEST(ParameterServer2, sendData) {
   // Set gserver and pserver all 3, so that the test is sufficient.
   int oldFlagsPortsNUm = FLAGS_ports_num;
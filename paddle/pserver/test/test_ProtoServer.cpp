@@ -12,10 +12,16 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
+#include <arpa/inet.h>
 #include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 #include <memory>
+#include <thread>
 #include "ParameterService.pb.h"
 #include "paddle/math/Vector.h"
+#include "paddle/utils/Locks.h"
 #include "paddle/pserver/ProtoServer.h"
 #include "paddle/utils/Stat.h"
 #include "paddle/utils/Util.h"
@@ -24,17 +30,26 @@ DEFINE_string(server_addr, "127.0.0.1", "Server address");
 DEFINE_int64(dim, 50000000, "Data size");
 DEFINE_bool(test_proto_server, true, "whether to test ProtoServer");
 DEFINE_bool(benchmark, false, "Do benchmark. Skip some tests");
+DECLARE_int32(socket_worker_threads);
+DECLARE_int32(socket_max_worker_threads);
+DECLARE_int64(socket_max_message_size);
 
 using namespace paddle;  // NOLINT
 
+/// the requests which block the workers of the epoll server at once, more
+/// than its --socket_worker_threads
+const int kNumBlockingClients = 4;
+
 class MyServer : public ProtoServer {
 public:
   explicit MyServer(int port, int rdmaCpu = -1)
       : ProtoServer(FLAGS_server_addr, port, rdmaCpu),
-        status_(PSERVER_STATUS_NOT_SET) {
+        status_(PSERVER_STATUS_NOT_SET),
+        barrier_(kNumBlockingClients) {
     REGISTER_SERVICE_FUNCTION(MyServer, getStatus);
     REGISTER_SERVICE_FUNCTION(MyServer, setStatus);
     REGISTER_SERVICE_FUNCTION_EX(MyServer, getStatusEx);
+    REGISTER_SERVICE_FUNCTION(MyServer, waitBarrier);
   }
   void getStatus(const GetStatusRequest& request,
                  ProtoResponseCallback callback) {
@@ -50,9 +65,9 @@ public:
     (void)request;
     GetStatusResponse response;
     response.set_status(status_);
-    buffer_.resize(msgReader->getNextBlockLength());
-    msgReader->readNextBlock(&buffer_[0]);
-    callback(response, {{&buffer_[0], buffer_.size()}});
+    std::string buffer(msgReader->getNextBlockLength(), 0);
+    msgReader->readNextBlock(&buffer[0]);
+    callback(response, {{&buffer[0], buffer.size()}});
   }
 
   void setStatus(const SetStatusRequest& request,
@@ -62,17 +77,30 @@ public:
     callback(response);
   }
 
+  /// blocks until kNumBlockingClients requests wait, like a synchronous
+  /// ParameterServer2
+  void waitBarrier(const GetStatusRequest& request,
+                   ProtoResponseCallback callback) {
+    (void)request;
+    barrier_.wait();
+    GetStatusResponse response;
+    response.set_status(status_);
+    callback(response);
+  }
+
 protected:
   PServerStatus status_;
-  std::string buffer_;
+  ThreadBarrier barrier_;
 };
 
-TEST(ProtoServer, regular) {
+/// test the server with a thread per connection on FLAGS_port, and the
+/// tcp server with epoll on FLAGS_port + 1
+void testRegular(int port) {
   ProtoClient* client;
-  if (FLAGS_rdma_tcp == "rdma")
-    client = new ProtoClient(FLAGS_server_addr, FLAGS_port, F_RDMA);
+  if (FLAGS_rdma_tcp == "rdma" && port == FLAGS_port)
+    client = new ProtoClient(FLAGS_server_addr, port, F_RDMA);
   else
-    client = new ProtoClient(FLAGS_server_addr, FLAGS_port, F_TCP);
+    client = new ProtoClient(FLAGS_server_addr, port, F_TCP);
   {
     GetStatusRequest request;
     GetStatusResponse response;
@@ -98,6 +126,100 @@ TEST(ProtoServer, regular) {
   delete client;
 }
 
+TEST(ProtoServer, regular) { testRegular(FLAGS_port); }
+
+TEST(ProtoServer, epoll) {
+  testRegular(FLAGS_port + 1);
+
+  /// more connections than workers, each sending a large block
+  const int kNumClients = 8;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumClients; ++i) {
+    threads.emplace_back([i]() {
+      ProtoClient client(FLAGS_server_addr, FLAGS_port + 1, F_TCP);
+      std::vector<int> data(1 << 20), result(data.size());
+      for (int k = 0; k < 4; ++k) {
+        std::fill(data.begin(), data.end(), i * 10 + k);
+        GetStatusRequest request;
+        GetStatusResponse response;
+        auto msgReader =
+            client.sendAndRecv("getStatusEx",
+                               request,
+                               {{data.data(), data.size() * sizeof(int)}},
+                               &response);
+        EXPECT_EQ(msgReader->getNumBlocks(), (size_t)1);
+        EXPECT_EQ(msgReader->getNextBlockLength(), data.size() * sizeof(int));
+        msgReader->readNextBlock(result.data());
+        EXPECT_EQ(data, result);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(ProtoServer, epollBlockingHandlers) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumBlockingClients; ++i) {
+    threads.emplace_back([]() {
+      ProtoClient client(FLAGS_server_addr, FLAGS_port + 1, F_TCP);
+      GetStatusRequest request;
+      GetStatusResponse response;
+      client.sendAndRecv("waitBarrier", request, &response);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+/// send a raw frame to the epoll server, return whether it closed or
+/// reset the connection
+bool sendRawMessage(const std::vector<int64_t>& frame) {
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_GE(sock, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(FLAGS_port + 1);
+  CHECK_EQ(inet_pton(AF_INET, FLAGS_server_addr.c_str(), &addr.sin_addr), 1);
+  CHECK_EQ(connect(sock, (sockaddr*)&addr, sizeof(addr)), 0);
+  size_t size = frame.size() * sizeof(frame[0]);
+  CHECK_EQ(write(sock, frame.data(), size), (ssize_t)size);
+  char c;
+  bool closed = recv(sock, &c, 1, 0) <= 0;
+  close(sock);
+  return closed;
+}
+
+TEST(ProtoServer, epollInvalidMessage) {
+  const int64_t kHeaderSize = 2 * sizeof(int64_t);
+  /// larger than --socket_max_message_size
+  EXPECT_TRUE(sendRawMessage({FLAGS_socket_max_message_size + 1, 0}));
+  /// shorter than its header
+  EXPECT_TRUE(sendRawMessage({kHeaderSize - 1, 0}));
+  /// more iov lengths than the message holds
+  EXPECT_TRUE(sendRawMessage({kHeaderSize + 8, 2, 0}));
+  EXPECT_TRUE(sendRawMessage({kHeaderSize, -1}));
+  /// block lengths which do not add up to the total length
+  EXPECT_TRUE(sendRawMessage({kHeaderSize + 16, 1, 16, 0}));
+  EXPECT_TRUE(sendRawMessage({kHeaderSize + 16, 2, -8, 16}));
+
+  /// the server still serves the other connections
+  ProtoClient client(FLAGS_server_addr, FLAGS_port + 1, F_TCP);
+  std::vector<int> data(1024, 7), result(data.size());
+  GetStatusRequest request;
+  GetStatusResponse response;
+  auto msgReader =
+      client.sendAndRecv("getStatusEx",
+                         request,
+                         {{data.data(), data.size() * sizeof(int)}},
+                         &response);
+  msgReader->readNextBlock(result.data());
+  EXPECT_EQ(data, result);
+}
+
 TEST(ProtoServer, extended) {
 #ifndef PADDLE_ONLY_CPU
   ProtoClient* client;
@@ -163,6 +285,10 @@ int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   MyServer server(FLAGS_port, FLAGS_rdma_tcp == "rdma" ? 0 : -1);
   server.start();
+  FLAGS_socket_worker_threads = 2;
+  FLAGS_socket_max_worker_threads = kNumBlockingClients;
+  MyServer epollServer(FLAGS_port + 1);
+  epollServer.start();
   usleep(10000);
 
   return RUN_ALL_TESTS();
@@ -16,11 +16,16 @@ limitations under the License. */
 
 #include "ParamUtil.h"
 #include "Trainer.h"
+#include "paddle/gserver/gradientmachines/MappedModel.h"
 #include "paddle/pserver/ParameterServer2.h"
 #include "paddle/utils/PythonUtil.h"
 
 DEFINE_string(model_dir, "", "Directory for separated model files");
 DEFINE_string(model_file, "", "File for merged model file");
+DEFINE_bool(mapped_model,
+            false,
+            "Write a page-aligned model file, whose parameters are used in "
+            "place by paddle_gradient_machine_create_from_mapped_model()");
 
 using namespace paddle;  // NOLINT
 using namespace std;     // NOLINT
@@ -36,6 +41,13 @@ int main(int argc, char** argv) {
   unique_ptr<GradientMachine> gradientMachine(GradientMachine::create(*config));
   gradientMachine->loadParameters(FLAGS_model_dir);
 
+  if (FLAGS_mapped_model) {
+    MappedModel::write(FLAGS_model_file,
+                       config->getModelConfig(),
+                       gradientMachine->getParameters());
+    return 0;
+  }
+
   ofstream os(FLAGS_model_file);
 
   string buf;
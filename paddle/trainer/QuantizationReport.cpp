@@ -0,0 +1,139 @@
+/* Copyright (c) 2016 PaddlePaddle Authors. All Rights Reserve.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "ParamUtil.h"
+#include "Trainer.h"
+#include "paddle/gserver/dataproviders/DataProvider.h"
+#include "paddle/utils/PythonUtil.h"
+
+DEFINE_string(model_dir, "", "Directory of the trained model");
+DEFINE_int32(num_batches,
+             0,
+             "Compare the outputs of at most this many test batches, "
+             "all of them if 0");
+
+using namespace paddle;  // NOLINT
+using namespace std;     // NOLINT
+
+/// How far the outputs of one layer with int8 weights are from the real ones.
+struct OutputError {
+  string name;
+  double maxAbsError = 0;
+  double sumAbsError = 0;
+  double sumSquareError = 0;
+  double sumSquare = 0;
+  size_t numValues = 0;
+  size_t numRows = 0;
+  size_t numSameArgmax = 0;
+
+  void add(const CpuMatrix& expected, const CpuMatrix& actual) {
+    CHECK_EQ(expected.getHeight(), actual.getHeight());
+    CHECK_EQ(expected.getWidth(), actual.getWidth());
+    size_t width = expected.getWidth();
+    for (size_t i = 0; i < expected.getHeight(); ++i) {
+      const real* e = expected.getData() + i * expected.getStride();
+      const real* a = actual.getData() + i * actual.getStride();
+      for (size_t j = 0; j < width; ++j) {
+        double diff = std::abs(e[j] - a[j]);
+        maxAbsError = std::max(maxAbsError, diff);
+        sumAbsError += diff;
+        sumSquareError += diff * diff;
+        sumSquare += (double)e[j] * e[j];
+      }
+      numSameArgmax += std::max_element(e, e + width) - e ==
+                       std::max_element(a, a + width) - a;
+    }
+    numValues += expected.getElementCnt();
+    numRows += expected.getHeight();
+  }
+
+  void report() const {
+    LOG(INFO) << "Output " << name << ": max abs error=" << maxAbsError
+              << " mean abs error=" << sumAbsError / std::max(numValues, 1UL)
+              << " relative L2 error="
+              << std::sqrt(sumSquareError / std::max(sumSquare, 1e-30))
+              << " same argmax=" << numSameArgmax << "/" << numRows;
+  }
+};
+
+/// The values of the outputs, copied to the cpu.
+vector<CpuMatrixPtr> forward(GradientMachine& machine,
+                             const vector<Argument>& inArgs,
+                             bool quantized) {
+  CHECK(machine.setQuantizeWeights(quantized))
+      << "the gradient machine does not support quantized weights";
+  vector<Argument> outArgs;
+  machine.forward(inArgs, &outArgs, PASS_TEST);
+  vector<CpuMatrixPtr> values;
+  for (auto& arg : outArgs) {
+    CHECK(arg.value) << "Only outputs with values can be compared";
+    auto value = std::make_shared<CpuMatrix>(arg.value->getHeight(),
+                                             arg.value->getWidth());
+    value->copyFrom(*arg.value);
+    values.push_back(value);
+  }
+  return values;
+}
+
+/**
+ * Run the test data of a trained model with real and with int8 weights
+ * (GradientMachine::setQuantizeWeights), and report how much the outputs
+ * differ.
+ */
+int main(int argc, char** argv) {
+  initMain(argc, argv);
+  initPython(argc, argv);
+  // the int8 weights are only used on cpu.
+  FLAGS_use_gpu = false;
+  string confFile = TrainerConfigHelper::getConfigNameFromPath(FLAGS_model_dir);
+  auto config = std::make_shared<TrainerConfigHelper>(confFile);
+  CHECK(config->hasTestDataConfig()) << "The config has no test data";
+
+  unique_ptr<GradientMachine> machine(GradientMachine::create(
+      config->getModelConfig(), GradientMachine::kTesting, {PARAMETER_VALUE}));
+  machine->loadParameters(FLAGS_model_dir);
+  unique_ptr<DataProvider> dataProvider(
+      DataProvider::create(config->getTestDataConfig(), *config, false));
+  dataProvider->setSkipShuffle();
+  dataProvider->reset();
+
+  const ModelConfig& modelConfig = config->getModelConfig();
+  vector<OutputError> errors(modelConfig.output_layer_names_size());
+  for (size_t i = 0; i < errors.size(); ++i) {
+    errors[i].name = modelConfig.output_layer_names(i);
+  }
+
+  DataBatch dataBatch;
+  int64_t batchSize = config->getOptConfig().batch_size();
+  for (int batch = 0; FLAGS_num_batches == 0 || batch < FLAGS_num_batches;
+       ++batch) {
+    if (dataProvider->getNextBatch(batchSize, &dataBatch) == 0) break;
+    const vector<Argument>& inArgs = dataBatch.getStreams();
+    vector<CpuMatrixPtr> expected = forward(*machine, inArgs, false);
+    vector<CpuMatrixPtr> actual = forward(*machine, inArgs, true);
+    CHECK_EQ(expected.size(), errors.size());
+    for (size_t i = 0; i < errors.size(); ++i) {
+      errors[i].add(*expected[i], *actual[i]);
+    }
+  }
+
+  for (auto& error : errors) {
+    error.report();
+  }
+  return 0;
+}
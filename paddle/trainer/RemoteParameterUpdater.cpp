@@ -19,6 +19,16 @@ limitations under the License. */
 
 DECLARE_int32(trainer_id);
 DECLARE_string(save_dir);
+DEFINE_int32(remote_update_bucket_size,
+             64 * 1024,
+             "the gradients of consecutive parameters are sent to pservers "
+             "together until they reach this number of bytes, "
+             "0 to send each parameter alone");
+DEFINE_bool(rebalance_pserver_blocks,
+            false,
+            "move the dense parameter blocks between pservers after each "
+            "pass to balance the traffic they had during the pass, "
+            "can not be used with --loadsave_parameters_in_pserver");
 
 namespace paddle {
 
@@ -45,6 +55,12 @@ RemoteParameterUpdater::RemoteParameterUpdater(
 }
 
 void RemoteParameterUpdater::init(const std::vector<ParameterPtr>& parameters) {
+  // the pservers save and load their own blocks, which would not be
+  // the blocks of the saved placement once they have moved.
+  CHECK(!(FLAGS_rebalance_pserver_blocks &&
+          FLAGS_loadsave_parameters_in_pserver))
+      << "rebalance_pserver_blocks and loadsave_parameters_in_pserver "
+      << "can not both true";
   ParameterUpdater::init(parameters);
 
   if (localUpdater_) {
@@ -91,6 +107,10 @@ void RemoteParameterUpdater::init(const std::vector<ParameterPtr>& parameters) {
     parameterClient_->setStatus(PSERVER_STATUS_PARAMETER_READY);
   } else {
     parameterClient_->waitForStatus(PSERVER_STATUS_PARAMETER_READY);
+    if (FLAGS_rebalance_pserver_blocks) {
+      /// the blocks may have moved if this trainer was restarted
+      parameterClient_->updateBlockPlacement();
+    }
     parameterClient_->getParameter();
     copyParametersToDevice(PARAMETER_VALUE);
   }
@@ -329,6 +349,9 @@ bool RemoteParameterUpdater::finishPass() {
       }
     }
   }
+  if (FLAGS_rebalance_pserver_blocks) {
+    rebalanceBlocks();
+  }
   parameterClient_->getParameter();
   copyParametersToDevice(PARAMETER_VALUE);
 
@@ -336,6 +359,14 @@ bool RemoteParameterUpdater::finishPass() {
   return true;
 }
 
+void RemoteParameterUpdater::rebalanceBlocks() {
+  REGISTER_TIMER("rebalanceBlocks");
+  size_t numMoved = parameterClient_->syncRebalanceBlocks();
+  if (FLAGS_trainer_id == 0) {
+    LOG(INFO) << numMoved << " parameter blocks moved between pservers";
+  }
+}
+
 void RemoteParameterUpdater::apply() {
   if (useApplyInPserver_) {
     PreparedOperations ops;
@@ -374,7 +405,7 @@ ConcurrentRemoteParameterUpdater::~ConcurrentRemoteParameterUpdater() {
   stopping_ = true;
   sendQueue_.enqueue(0);
   sendThread_->join();
-  recvQueue_.enqueue(0);
+  recvQueue_.enqueue(std::vector<int>());
   recvThread_->join();
 }
 
@@ -405,8 +436,8 @@ void ConcurrentRemoteParameterUpdater::finishBatch(real cost) {
   }
 }
 
-// Use para=NULL to signal the end of one batch
-void ConcurrentRemoteParameterUpdater::send(Parameter* para) {
+// Use an empty bucket to signal the end of one batch
+void ConcurrentRemoteParameterUpdater::send(const std::vector<int>& bucket) {
   const std::string& algorithm = config_.algorithm();
   ParameterUpdateMode mode;
   if (algorithm == TrainAlgorithm::AsyncSGD) {
@@ -424,7 +455,7 @@ void ConcurrentRemoteParameterUpdater::send(Parameter* para) {
     sendType = PARAMETER_GRADIENT;
   }
   std::vector<ParameterSegments> paraSegment;
-  if (para == NULL) {
+  if (bucket.empty()) {
     parameterClient_->sendParameter(
         mode,
         sendType,
@@ -435,16 +466,29 @@ void ConcurrentRemoteParameterUpdater::send(Parameter* para) {
         batchStatus_);  // batchStatus_ = BATCH_FINISH
 
   } else {
-    ParameterSegments paraSegTemp;
-    paraSegment.reserve(1);
-    paraSegTemp.name = para->getName();
-    paraSegTemp.id = para->getID();
-    paraSegment.push_back(paraSegTemp);
+    paraSegment.reserve(bucket.size());
     {
-      SetDevice device(para->getDeviceId());
       REGISTER_TIMER("copySingleParaFromDevice");
-      copySingleParaFromDevice(para, sendType);
-      hl_stream_synchronize(kDeviceToHostStream);
+      // the copies of a bucket are waited for once per device
+      std::vector<int> deviceIds;
+      for (int pid : bucket) {
+        Parameter* para = parameters_[pid].get();
+        ParameterSegments paraSegTemp;
+        paraSegTemp.name = para->getName();
+        paraSegTemp.id = para->getID();
+        paraSegment.push_back(paraSegTemp);
+        SetDevice device(para->getDeviceId());
+        copySingleParaFromDevice(para, sendType);
+        if (std::find(deviceIds.begin(),
+                      deviceIds.end(),
+                      para->getDeviceId()) == deviceIds.end()) {
+          deviceIds.push_back(para->getDeviceId());
+        }
+      }
+      for (int deviceId : deviceIds) {
+        SetDevice device(deviceId);
+        hl_stream_synchronize(kDeviceToHostStream);
+      }
     }
     parameterClient_->sendParameter(mode,
                                     sendType,
@@ -456,9 +500,11 @@ void ConcurrentRemoteParameterUpdater::send(Parameter* para) {
     if (batchStatus_ == BATCH_START) batchStatus_ = BATCH_ON;
   }
 }
-void ConcurrentRemoteParameterUpdater::recv(Parameter* para) {
+
+void ConcurrentRemoteParameterUpdater::recv(const std::vector<int>& bucket) {
   parameterClient_->recvParameter();
-  if (para != NULL) {
+  for (int pid : bucket) {
+    Parameter* para = parameters_[pid].get();
     REGISTER_TIMER("copySingleParaToDevice");
     SetDevice device(para->getDeviceId());
     copySingleParaToDevice(para, PARAMETER_VALUE);
@@ -480,25 +526,20 @@ void ConcurrentRemoteParameterUpdater::recv() {
   StatPtr stat = getStat("recv");
   FOR_TIMING(Timer timer);
   while (true) {
-    int pid;
+    std::vector<int> bucket;
     {
       REGISTER_TIMER("recv_dequeue");
-      pid = recvQueue_.dequeue();
+      bucket = recvQueue_.dequeue();
     }
-    if (pid == kFinishBatchPid) {
-      Parameter* para = NULL;
-      FOR_TIMING(timer.start());
-      recv(para);
-      FOR_TIMING(timer.stop());
+    if (stopping_) break;
+    FOR_TIMING(timer.start());
+    recv(bucket);
+    FOR_TIMING(timer.stop());
+    if (bucket.empty()) {
       FOR_TIMING(stat->addSample(timer.get()));
       FOR_TIMING(timer.reset());
       finishBatchCond_.notify_all([this] { oneBatchFinished_ = true; });
     } else {
-      if (stopping_) break;
-      Parameter* para = parameters_[pid].get();
-      FOR_TIMING(timer.start());
-      recv(para);
-      FOR_TIMING(timer.stop());
       oneBatchFinished_ = false;
     }
   }
@@ -508,6 +549,18 @@ void ConcurrentRemoteParameterUpdater::send() {
   if (FLAGS_use_gpu) hl_set_device(FLAGS_gpu_id);
   StatPtr stat = getStat("send");
   FOR_TIMING(Timer timer);
+  // the parameters waiting to be sent together, in the order of their
+  // updateImpl(), that is in reverse layer order during backward()
+  std::vector<int> bucket;
+  size_t bucketBytes = 0;
+  auto sendBucket = [&]() {
+    FOR_TIMING(timer.start());
+    send(bucket);
+    FOR_TIMING(timer.stop());
+    recvQueue_.enqueue(std::move(bucket));
+    bucket.clear();
+    bucketBytes = 0;
+  };
   while (true) {
     int pid;
     {
@@ -515,6 +568,9 @@ void ConcurrentRemoteParameterUpdater::send() {
       pid = sendQueue_.dequeue();
     }
     if (pid == kFinishBatchPid) {
+      if (!bucket.empty()) {
+        sendBucket();
+      }
       batchStatus_ = BATCH_FINISH;
       if (!localUpdater_) {
         // if cpu, parameter should not changes until recvParameter().
@@ -528,13 +584,9 @@ void ConcurrentRemoteParameterUpdater::send() {
           }
         }
       }
-      Parameter* para = NULL;
-      FOR_TIMING(timer.start());
-      send(para);
-      FOR_TIMING(timer.stop());
+      sendBucket();
       FOR_TIMING(stat->addSample(timer.get()));
       FOR_TIMING(timer.reset());
-      recvQueue_.enqueue(pid);
     } else {
       if (stopping_) break;
       Parameter* para = parameters_[pid].get();
@@ -543,10 +595,11 @@ void ConcurrentRemoteParameterUpdater::send() {
         para->getBuf(PARAMETER_DELTA)
             ->add(*para->getBuf(PARAMETER_VALUE), -1.0f, 1.0f);
       }
-      FOR_TIMING(timer.start());
-      send(para);
-      FOR_TIMING(timer.stop());
-      recvQueue_.enqueue(nonStaticParaIDMap_[para->getID()]);
+      bucket.push_back(pid);
+      bucketBytes += para->getSize() * sizeof(real);
+      if (bucketBytes >= (size_t)FLAGS_remote_update_bucket_size) {
+        sendBucket();
+      }
     }
   }
 }
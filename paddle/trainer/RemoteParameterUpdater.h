@@ -114,6 +114,15 @@ protected:
 
   void startController();
 
+  /**
+   * @brief move the dense blocks between the pservers to balance their
+   *        traffic, with --rebalance_pserver_blocks
+   *
+   * @note  trainer 0 moves the blocks while the other trainers wait, and
+   *        then they use the new placement.
+   */
+  void rebalanceBlocks();
+
   /**
    * @brief copy parameters from cpu host to device, such as gpu.
    *
@@ -176,6 +185,14 @@ protected:
  * help to pipeline device-to-host copy and host-to-network to hide network
  * latency in backward stage.
  * It contains separate send and recv thread for pipeline usage.
+ *
+ * The parameters are sent in the order their gradients get ready, which is
+ * the reverse order of the layers in backward(). Consecutive small
+ * parameters are sent together in a bucket of at least
+ * --remote_update_bucket_size bytes, so that a network with many small
+ * layers does not pay a round trip per parameter. The values sent back are
+ * received bucket by bucket in the same order, and are copied to the device
+ * as soon as their bucket arrives.
  */
 class ConcurrentRemoteParameterUpdater : public RemoteParameterUpdater {
 public:
@@ -196,10 +213,11 @@ public:
 
 protected:
   virtual void updateImpl(Parameter* para);
-  /// internal thread called in send thread
-  void send(Parameter* para);  // para == NULL indicate end of a minibatch
+  /// internal function called in send thread, an empty bucket indicates
+  /// the end of a minibatch
+  void send(const std::vector<int>& bucket);
   /// internal function called in recv thread
-  void recv(Parameter* para);
+  void recv(const std::vector<int>& bucket);
   /**
    * @brief send thread for relaying data from gradient to parameter client
    *
@@ -228,8 +246,8 @@ private:
   std::unique_ptr<std::thread> recvThread_;
   /// buffer queue for overlapping
   Queue<int> sendQueue_;
-  /// buffer queue for overlapping
-  Queue<int> recvQueue_;
+  /// buffer queue for overlapping, of the buckets sent
+  Queue<std::vector<int>> recvQueue_;
   /// flags indicating to stop
   bool stopping_;
   /// conditional variable for threads synchronization between the
@@ -129,6 +129,7 @@ DECLARE_int32(num_gradient_servers);
 DECLARE_int32(port);
 DECLARE_bool(local);
 DECLARE_bool(use_old_updater);
+DECLARE_int32(remote_update_bucket_size);
 
 double checkRemoteParameterUpdater(TrainerForTest& trainer) {
   auto gradientMachine = trainer.getGradientMachine();
@@ -262,6 +263,27 @@ TEST(checkRemoteUpdater, cpuTrainer) {
   checkRemoteParameterUpdaterTest(configFile1, false, false);
 }
 
+TEST(checkRemoteUpdater, cpuTrainerUnbucketed) {
+  int bucketSize = FLAGS_remote_update_bucket_size;
+  FLAGS_remote_update_bucket_size = 0;
+  checkRemoteParameterUpdaterTest(configFile1, false, false);
+  FLAGS_remote_update_bucket_size = bucketSize;
+}
+
+TEST(checkRemoteUpdater, cpuTrainerOneBucket) {
+  int bucketSize = FLAGS_remote_update_bucket_size;
+  FLAGS_remote_update_bucket_size = 1 << 30;
+  checkRemoteParameterUpdaterTest(configFile1, false, false);
+  FLAGS_remote_update_bucket_size = bucketSize;
+}
+
+TEST(checkRemoteUpdater, cpuTrainerOneParameterPerBucket) {
+  int bucketSize = FLAGS_remote_update_bucket_size;
+  FLAGS_remote_update_bucket_size = 1;
+  checkRemoteParameterUpdaterTest(configFile1, false, false);
+  FLAGS_remote_update_bucket_size = bucketSize;
+}
+
 TEST(checkRemoteUpdater, cpuTrainerOldUpdater) {
   checkRemoteParameterUpdaterTest(configFile1, false, false, 1, true);
 }
@@ -279,6 +301,13 @@ TEST(checkRemoteUpdater, gpu4Trainer) {
   checkRemoteParameterUpdaterTest(configFile1, true, false, 4);
 }
 
+TEST(checkRemoteUpdater, gpu2TrainerOneBucket) {
+  int bucketSize = FLAGS_remote_update_bucket_size;
+  FLAGS_remote_update_bucket_size = 1 << 30;
+  checkRemoteParameterUpdaterTest(configFile1, true, false, 2);
+  FLAGS_remote_update_bucket_size = bucketSize;
+}
+
 TEST(checkRemoteUpdater, gpuTrainerOldUpdater) {
   checkRemoteParameterUpdaterTest(configFile1, true, false, 1, true);
 }
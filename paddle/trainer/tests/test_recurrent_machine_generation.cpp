@@ -31,6 +31,7 @@ static string expectFile =                                           // NOLINT
     "trainer/tests/rnn_gen_test_model_dir/r1.test";                  // NOLINT
 
 DECLARE_string(config_args);
+DECLARE_int32(beam_search_threads);
 
 vector<float> readRetFile(const string& fname) {
   ifstream inFile(fname);
@@ -129,6 +130,10 @@ TEST(RecurrentGradientMachine, test_generation) {
   };
   testGen(CONFIG_FILE, false, expectFile + ".nobeam", false);  // no beam search
   testGen(CONFIG_FILE, false, expectFile + ".beam", true);     // beam search
+  // the sequences of the batch are expanded in parallel.
+  FLAGS_beam_search_threads = 4;
+  testGen(CONFIG_FILE, false, expectFile + ".beam", true);
+  FLAGS_beam_search_threads = 1;
   // In hierarchical RNN, beam search and one way search are only in inner-RNN,
   // outer-RNN will concat the generated inner-results (first for beam search)
   // from inner-RNN. Thus, they have the same outer-results.
@@ -51,6 +51,7 @@ SIMDFlags::SIMDFlags() {
   CPUID(cpuInfo, 0x00000007);
   simd_flags_ |= cpuInfo[1] & (1 <<  5) ? SIMD_AVX2  : SIMD_NONE;
   simd_flags_ |= cpuInfo[1] & (1 << 16) ? SIMD_AVX512: SIMD_NONE;
+  simd_flags_ |= cpuInfo[2] & (1 << 11) ? SIMD_AVX512_VNNI : SIMD_NONE;
 
   CPUID(cpuInfo, 0x80000001);
   simd_flags_ |= cpuInfo[2] & (1 << 16) ? SIMD_FMA4  : SIMD_NONE;
@@ -31,6 +31,7 @@ enum simd_t {
   SIMD_AVX2   = 1 << 9,     ///< AVX 2
   SIMD_AVX512 = 1 << 10,    ///< AVX 512
   SIMD_NEON   = 1 << 11,    ///  NEON
+  SIMD_AVX512_VNNI = 1 << 12,  ///< AVX 512 VNNI (vpdpbusd)
 };
 // clang-format on
 
@@ -98,6 +99,7 @@ private:
 #define HAS_AVX2    HAS_SIMD(SIMD_AVX2)
 #define HAS_AVX512  HAS_SIMD(SIMD_AVX512)
 #define HAS_NEON    HAS_SIMD(SIMD_NEON)
+#define HAS_AVX512_VNNI HAS_SIMD(SIMD_AVX512_VNNI)
 // clang-format on
 
 /**
@@ -44,5 +44,6 @@ TEST(SIMDFlags, normalPrint) {
   LOG(INFO) << "Has AVX:     " << std::boolalpha << HAS_AVX;
   LOG(INFO) << "Has AVX2:    " << std::boolalpha << HAS_AVX2;
   LOG(INFO) << "Has AVX512:  " << std::boolalpha << HAS_AVX512;
+  LOG(INFO) << "Has VNNI:    " << std::boolalpha << HAS_AVX512_VNNI;
   LOG(INFO) << "Has NEON:    " << std::boolalpha << HAS_NEON;
 }
@@ -336,6 +336,7 @@ def provider(input_types=None,
              check=False,
              check_fail_continue=False,
              init_hook=None,
+             bucket_by_length=False,
              **outter_kwargs):
     """
     Provider decorator. Use it to make a function into PyDataProvider2 object.
@@ -414,6 +415,17 @@ def provider(input_types=None,
                                 drop the wrong format data when it is True. Has
                                 no effect when check set to False.
     :type check_fail_continue: bool
+
+    :param bucket_by_length: True if a mini-batch should hold samples of
+                             similar lengths, the ones of their longest
+                             sequence. Each mini-batch picks a random sample of
+                             the data pool, and the samples whose lengths are
+                             the closest to it. It reduces the padding of
+                             recurrent layers, which run as many steps as the
+                             longest sequence of a mini-batch. The larger
+                             min_pool_size is, the more similar the lengths
+                             are. Default is false.
+    :type bucket_by_length: bool
     """
 
     def __wrapper__(generator):
@@ -449,6 +461,7 @@ def provider(input_types=None,
                 self.pool_size = pool_size
                 self.can_over_batch_size = can_over_batch_size
                 self.calc_batch_size = calc_batch_size
+                self.bucket_by_length = bucket_by_length
                 self.file_list = file_list
                 self.generator = generator
                 self.cache = cache
@@ -1358,6 +1358,7 @@ class LayerBase(object):
             device=None,
             active_type="",
             drop_rate=0.,
+            fuse_epilogue=False,
             coeff=None):
         config_assert('@' not in name,
                       "layer name: %s contain special character @" % name)
@@ -1386,6 +1387,8 @@ class LayerBase(object):
             self.config.size = size
         if drop_rate != 0:
             self.config.drop_rate = drop_rate
+        if fuse_epilogue:
+            self.config.fuse_epilogue = True
 
         if device is not None:
             self.config.device = device
@@ -2128,13 +2131,21 @@ define_cost('SmoothL1Cost', 'smooth_l1')
 
 @config_layer('hsigmoid')
 class HierarchicalSigmoidLayer(LayerBase):
-    def __init__(self, name, num_classes, inputs, device=None, bias=True):
+    def __init__(self,
+                 name,
+                 num_classes,
+                 inputs,
+                 device=None,
+                 bias=True,
+                 tree_file=None):
         super(HierarchicalSigmoidLayer, self).__init__(
             name, 'hsigmoid', 1, inputs=inputs, device=device)
         config_assert(
             len(self.inputs) >= 2,
             'HierarchicalSigmoidLayer must have at least 2 inputs')
         self.config.num_classes = num_classes
+        if tree_file is not None:
+            self.config.tree_file = tree_file
         for input_index in xrange(len(self.inputs) - 1):
             input_layer = self.get_input_layer(input_index)
             psize = (num_classes - 1) * input_layer.size
@@ -2192,6 +2203,7 @@ class NCELayer(LayerBase):
                  num_neg_samples=10,
                  neg_sampling_dist=None,
                  bias=True,
+                 share_neg_samples=False,
                  **xargs):
         super(NCELayer, self).__init__(name, 'nce', 1, inputs=inputs, **xargs)
         config_assert(
@@ -2210,6 +2222,8 @@ class NCELayer(LayerBase):
             self.config.neg_sampling_dist.extend(neg_sampling_dist)
 
         self.config.num_neg_samples = num_neg_samples
+        if share_neg_samples:
+            self.config.share_neg_samples = True
         num_real_inputs = len(self.inputs) - 1
         input_layer = self.get_input_layer(num_real_inputs)
         config_assert(input_layer.type == 'data',
@@ -196,6 +196,10 @@ class ExtraLayerAttribute(object):
                       <https://www.cs.toronto.edu/~hinton/absps/
                       JMLRdropout.pdf>`_.
     :type drop_rate: float
+    :param fuse_epilogue: On cpu, add the bias, forward the activation and the
+                          dropout row by row in one sweep over the layer
+                          output. The result is the same as without it.
+    :type fuse_epilogue: bool
     :param device: device ID of layer. device=-1, use CPU. device>=0, use GPU.
                    The details allocation in parallel_nn please refer to `here
                    <http://www.paddlepaddle.org/doc/ui/cmd_argument/
@@ -206,6 +210,7 @@ class ExtraLayerAttribute(object):
     def __init__(self,
                  error_clipping_threshold=None,
                  drop_rate=None,
+                 fuse_epilogue=None,
                  device=None):
         self.attr = dict()
         if error_clipping_threshold is not None:
@@ -218,6 +223,8 @@ class ExtraLayerAttribute(object):
             if drop_rate < 0:
                 raise ValueError("Dropout rate must > 0")
             self.attr["drop_rate"] = drop_rate
+        if fuse_epilogue is not None:
+            self.attr["fuse_epilogue"] = bool(fuse_epilogue)
 
         if isinstance(device, int):
             self.attr["device"] = device
@@ -336,6 +336,7 @@ class LayerOutput(object):
 
 ERROR_CLIPPING = 'error_clipping_threshold'
 DROPOUT = 'drop_rate'
+FUSE_EPILOGUE = 'fuse_epilogue'
 DEVICE = 'device'
 
 
@@ -905,7 +906,7 @@ def embedding_layer(input, size, name=None, param_attr=None, layer_attr=None):
 @wrap_param_attr_default()
 @wrap_bias_attr_default()
 @wrap_act_default()
-@layer_support(ERROR_CLIPPING, DROPOUT)
+@layer_support(ERROR_CLIPPING, DROPOUT, FUSE_EPILOGUE)
 def fc_layer(input,
              size,
              act=None,
@@ -2037,13 +2038,18 @@ def hsigmoid(input,
              name=None,
              bias_attr=None,
              param_attr=None,
-             layer_attr=None):
+             layer_attr=None,
+             tree_file=None):
     """
     Organize the classes into a binary tree. At each node, a sigmoid function
     is used to calculate the probability of belonging to the right branch.
     This idea is from "F. Morin, Y. Bengio (AISTATS 05):
     Hierarchical Probabilistic Neural Network Language Model."
 
+    The tree is a complete binary tree, unless tree_file gives another one.
+    A Huffman tree of the class frequencies, for instance, gives the frequent
+    classes short codes, which makes training faster.
+
     The example usage is:
 
     ..  code-block:: python
@@ -2067,6 +2073,13 @@ def hsigmoid(input,
     :type param_attr: ParameterAttribute|None
     :param layer_attr: Extra Layer Attribute.
     :type layer_attr: ExtraLayerAttribute
+    :param tree_file: A text file with a line per class, which holds either
+                      the frequency of the class, to use the Huffman tree of
+                      the frequencies, or the code of the class,
+                      "node bit node bit ...", from the leaf up. The internal
+                      nodes are numbered from 0 to num_classes - 2. Only
+                      supported on cpu.
+    :type tree_file: basestring|None
     :return: LayerOutput object.
     :rtype: LayerOutput
     """
@@ -2104,6 +2117,7 @@ def hsigmoid(input,
         num_classes=num_classes,
         bias=ParamAttr.to_bias(bias_attr),
         inputs=ipts_for_layer,
+        tree_file=tree_file,
         **ExtraLayerAttribute.to_kwargs(layer_attr))
     return LayerOutput(
         name, LayerType.HSIGMOID, parents=parents, size=l.config.size)
@@ -5043,7 +5057,8 @@ def nce_layer(input,
               neg_distribution=None,
               name=None,
               bias_attr=None,
-              layer_attr=None):
+              layer_attr=None,
+              share_neg_samples=False):
     """
     Noise-contrastive estimation.
     Implements the method in the following paper:
@@ -5081,6 +5096,11 @@ def nce_layer(input,
     :type bias_attr: ParameterAttribute|None|False
     :param layer_attr: Extra Layer Attribute.
     :type layer_attr: ExtraLayerAttribute
+    :param share_neg_samples: Whether all the samples of a batch share the
+                              same negative labels. Their scores are then
+                              computed by one matrix multiplication, which
+                              is much faster for large batches.
+    :type share_neg_samples: bool
     :return: layer name.
     :rtype: LayerOutput
     """
@@ -5129,6 +5149,7 @@ def nce_layer(input,
         neg_sampling_dist=neg_distribution,
         active_type=act.name,
         num_neg_samples=num_neg_samples,
+        share_neg_samples=share_neg_samples,
         inputs=ipts_for_layer,
         bias=ParamAttr.to_bias(bias_attr),
         **ExtraLayerAttribute.to_kwargs(layer_attr))
@@ -335,3 +335,6 @@ def __copy_parameter_to_gradient_machine__(gradient_machine, name, arr):
     vec = param.getBuf(api.PARAMETER_VALUE)
     assert isinstance(vec, api.Vector)
     vec.copyFromNumpyArray(arr.flatten())
+    # drops the copies of the value made for inference, such as the packed
+    # weights.
+    param.setValueUpdated()